@@ -0,0 +1,902 @@
+#include "benchmark.hpp"
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <cstring>
+#include "model.hpp"
+#include "meshcache.hpp"
+#include "instancebatch.hpp"
+#include "uniformbuffer.hpp"
+#include "lightsystem.hpp"
+#include "programcache.hpp"
+#include "texturecache.hpp"
+#include "workerpool.hpp"
+#include "shadervariants.hpp"
+#include "imageops.hpp"
+#include "materialsystem.hpp"
+#include "tilepyramid.hpp"
+#include "virtualtexturesystem.hpp"
+#include "texture.hpp"
+#include "renderqueue.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+
+// NOTE(Jovan): Allocations made through CountingAllocator. Benchmarks run on the main
+// thread, so a plain counter is enough
+static unsigned long long AllocationCount = 0;
+
+/**
+ * @brief Standard allocator that counts its allocations, so a benchmark can report how
+ * many allocations the containers it measures make without touching the global heap
+ */
+template <typename T>
+struct CountingAllocator {
+    typedef T value_type;
+
+    CountingAllocator() {}
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>&) {}
+
+    T*
+    allocate(size_t count) {
+        ++AllocationCount;
+        return std::allocator<T>().allocate(count);
+    }
+
+    void
+    deallocate(T* ptr, size_t count) {
+        std::allocator<T>().deallocate(ptr, count);
+    }
+};
+
+template <typename T, typename U>
+static bool
+operator==(const CountingAllocator<T>&, const CountingAllocator<U>&) {
+    return true;
+}
+
+template <typename T, typename U>
+static bool
+operator!=(const CountingAllocator<T>&, const CountingAllocator<U>&) {
+    return false;
+}
+
+template <typename T>
+using CountedVector = std::vector<T, CountingAllocator<T> >;
+
+static float
+elapsedMS(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Builds a synthetic triangulated Assimp mesh with normals and UVs
+ *
+ * @param vertexCount - Number of vertices, rounded down to a multiple of 3
+ *
+ * @returns Mesh, owned by the caller
+ */
+static aiMesh*
+createSyntheticMesh(unsigned vertexCount) {
+    vertexCount -= vertexCount % 3;
+    aiMesh* Mesh = new aiMesh();
+    Mesh->mNumVertices = vertexCount;
+    Mesh->mVertices = new aiVector3D[vertexCount];
+    Mesh->mNormals = new aiVector3D[vertexCount];
+    Mesh->mTextureCoords[0] = new aiVector3D[vertexCount];
+    Mesh->mNumUVComponents[0] = 2;
+    for (unsigned VertexIdx = 0; VertexIdx < vertexCount; ++VertexIdx) {
+        float T = (float)VertexIdx;
+        Mesh->mVertices[VertexIdx] = aiVector3D(T, T * 0.5f, -T);
+        Mesh->mNormals[VertexIdx] = aiVector3D(0.0f, 1.0f, 0.0f);
+        Mesh->mTextureCoords[0][VertexIdx] = aiVector3D(T * 0.01f, T * 0.02f, 0.0f);
+    }
+
+    Mesh->mNumFaces = vertexCount / 3;
+    Mesh->mFaces = new aiFace[Mesh->mNumFaces];
+    for (unsigned FaceIdx = 0; FaceIdx < Mesh->mNumFaces; ++FaceIdx) {
+        aiFace& Face = Mesh->mFaces[FaceIdx];
+        Face.mNumIndices = 3;
+        Face.mIndices = new unsigned[3];
+        Face.mIndices[0] = FaceIdx * 3;
+        Face.mIndices[1] = FaceIdx * 3 + 1;
+        Face.mIndices[2] = FaceIdx * 3 + 2;
+    }
+
+    return Mesh;
+}
+
+/**
+ * @brief Reference packing path as Mesh::processMesh used to do it: three temporary
+ * vectors per vertex and no reserve
+ */
+static void
+packPerVertexVectors(const aiMesh* mesh, CountedVector<float>& vertices, CountedVector<unsigned>& indices) {
+    const aiVector3D Zero3D(0.0f, 0.0f, 0.0f);
+    for (unsigned VertexIndex = 0; VertexIndex < mesh->mNumVertices; ++VertexIndex) {
+        CountedVector<float> Position = { mesh->mVertices[VertexIndex].x, mesh->mVertices[VertexIndex].y, mesh->mVertices[VertexIndex].z };
+        vertices.insert(vertices.end(), Position.begin(), Position.end());
+        CountedVector<float> Normals = { mesh->mNormals[VertexIndex].x, mesh->mNormals[VertexIndex].y, mesh->mNormals[VertexIndex].z };
+        vertices.insert(vertices.end(), Normals.begin(), Normals.end());
+        const aiVector3D* TexCoords = mesh->HasTextureCoords(0) ? &(mesh->mTextureCoords[0][VertexIndex]) : &Zero3D;
+        CountedVector<float> UV = { TexCoords->x, TexCoords->y };
+        vertices.insert(vertices.end(), UV.begin(), UV.end());
+    }
+
+    for (unsigned FaceIndex = 0; FaceIndex < mesh->mNumFaces; ++FaceIndex) {
+        const aiFace& Face = mesh->mFaces[FaceIndex];
+        indices.push_back(Face.mIndices[0]);
+        indices.push_back(Face.mIndices[1]);
+        indices.push_back(Face.mIndices[2]);
+    }
+}
+
+/**
+ * @brief Reference flip as stb_image does it, swapping rows through a small stack buffer
+ */
+static void
+flipRowsScalar(unsigned char* pixels, size_t rowSize, unsigned height) {
+    unsigned char Temp[2048];
+    for (unsigned Row = 0; Row < height / 2; ++Row) {
+        unsigned char* Top = pixels + Row * rowSize;
+        unsigned char* Bottom = pixels + (height - 1 - Row) * rowSize;
+        size_t Left = rowSize;
+        while (Left) {
+            size_t Chunk = Left < sizeof(Temp) ? Left : sizeof(Temp);
+            memcpy(Temp, Top, Chunk);
+            memcpy(Top, Bottom, Chunk);
+            memcpy(Bottom, Temp, Chunk);
+            Top += Chunk;
+            Bottom += Chunk;
+            Left -= Chunk;
+        }
+    }
+}
+
+/**
+ * @brief Reference swizzle, one channel at a time
+ */
+static void
+swizzleScalar(const unsigned char* src, unsigned srcChannels, unsigned char* dst, unsigned dstChannels, const int* mapping, size_t pixelCount) {
+    for (size_t Pixel = 0; Pixel < pixelCount; ++Pixel) {
+        for (unsigned Channel = 0; Channel < dstChannels; ++Channel) {
+            dst[Pixel * dstChannels + Channel] = mapping[Channel] < 0 ? 255 : src[Pixel * srcChannels + mapping[Channel]];
+        }
+    }
+}
+
+/**
+ * @brief Sets up a new Phong variant for benchmarks: lights, plain float vertices and
+ * an identity model matrix
+ *
+ * @param shader - New variant, in use
+ */
+static void
+setupBenchShader(const Shader& shader) {
+    MaterialSystem::SetupShader(shader);
+    LightSystem::SetupShader(shader);
+    VertexFormat::ResetDequantization(shader);
+    shader.SetModel(glm::mat4(1.0f));
+}
+
+// NOTE(Jovan): Units the scene bound diffuse and specular maps to before MaterialSystem,
+// unused by the Phong program since
+#define BENCH_DIFFUSE_TEXTURE_UNIT 0
+#define BENCH_SPECULAR_TEXTURE_UNIT 1
+
+// NOTE(Jovan): A single small triangle per prop, so the frame time is dominated by
+// submission rather than by rasterization
+static const float BenchTriangle[] = {
+    -0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+     0.5f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f,
+     0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.5f, 1.0f,
+};
+
+/**
+ * @brief Scene of the draw benchmarks: triangle props on a square grid seen from above,
+ * the Frame block filled in and no lights
+ *
+ */
+struct BenchScene {
+    GeometryAllocation Geometry;
+    Bounds TriangleBounds;
+    std::vector<glm::mat4> Models;
+    glm::mat4 Projection;
+    glm::mat4 View;
+    UniformBuffer FrameBuffer;
+    LightSystem NoLights;
+
+    /**
+     * @brief Ctor - uploads the triangle and lays out the props
+     *
+     * @param propCount - Number of props
+     */
+    BenchScene(unsigned propCount);
+};
+
+BenchScene::BenchScene(unsigned propCount)
+    : Geometry(VERTEX_FORMAT_FLOAT, (const unsigned char*)BenchTriangle, 3, 0, 0),
+      FrameBuffer(UNIFORM_BINDING_FRAME, sizeof(FrameUniforms)) {
+    TriangleBounds = Bounds::FromPoints(BenchTriangle, 3, VertexFormat::FLOAT_COMPONENTS);
+    unsigned Side = 1;
+    while (Side * Side < propCount) {
+        ++Side;
+    }
+    Models.resize(propCount);
+    for (unsigned Prop = 0; Prop < propCount; ++Prop) {
+        glm::vec3 Position((float)(Prop % Side) - Side * 0.5f, 0.0f, -(float)(Prop / Side) - 2.0f);
+        Models[Prop] = glm::translate(glm::mat4(1.0f), Position);
+    }
+
+    Projection = glm::perspective(45.0f, 1.0f, 0.1f, 1000.0f);
+    View = glm::lookAt(glm::vec3(0.0f, Side * 0.5f, Side * 0.25f), glm::vec3(0.0f, 0.0f, -(float)Side * 0.5f), glm::vec3(0.0f, 1.0f, 0.0f));
+    FrameUniforms FrameData = {};
+    FrameData.Projection = Projection;
+    FrameData.View = View;
+    FrameData.ViewProjection = Projection * View;
+    FrameBuffer.Update(&FrameData);
+    NoLights.Upload(Projection, View, 1, 1);
+}
+
+void
+Benchmark::Run(const std::vector<std::string>& models) {
+    // NOTE(Jovan): Creates the Materials block and binds the material array, every Phong
+    // draw samples the default material unless it selects another
+    MaterialSystem::Get().Update();
+    if (models.empty()) {
+        ModelLoad("res/low-poly-fox/low-poly-fox.obj", 5);
+    }
+    for (unsigned ModelIdx = 0; ModelIdx < models.size(); ++ModelIdx) {
+        ModelLoad(models[ModelIdx], 5);
+    }
+    VertexPacking();
+    ShaderLoad(5);
+    TextureLoad();
+    ImageProcessing(2048, 5);
+    VirtualTexturing("res/planina.jpg");
+    InstancedDraw(10000, 60);
+    MaterialDraw(10000, 60);
+    RenderQueueDraw(10000, 60);
+    LightCount(60);
+}
+
+void
+Benchmark::ModelLoad(const std::string& filename, unsigned iterations) {
+    std::cout << "[Bench] Model load: " << filename << std::endl;
+    std::remove(MeshCache::GetCachePath(filename).c_str());
+
+    std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+    Model Cold(filename);
+    if (!Cold.Load()) {
+        std::cerr << "[Bench] Failed to load " << filename << std::endl;
+        return;
+    }
+    // NOTE(Jovan): Textures stream in the background, the load is done once they are resident
+    TextureCache::Get().Finish();
+    float ColdMS = elapsedMS(Start);
+
+    float WarmMS = 0.0f;
+    for (unsigned Iteration = 0; Iteration < iterations; ++Iteration) {
+        Start = std::chrono::steady_clock::now();
+        Model Warm(filename);
+        Warm.Load();
+        TextureCache::Get().Finish();
+        WarmMS += elapsedMS(Start);
+    }
+    WarmMS /= iterations ? iterations : 1;
+
+    std::cout << "[Bench] cold: " << ColdMS << "ms, warm: " << WarmMS << "ms, speedup: "
+        << (WarmMS > 0.0f ? ColdMS / WarmMS : 0.0f) << "x" << std::endl;
+    // NOTE(Jovan): Warm loads share the cold model's textures while it is alive
+    TextureCacheStats TextureStats = TextureCache::Get().GetStats();
+    std::cout << "[Bench] texture cache: " << TextureStats.Hits << " hits, " << TextureStats.ContentHits << " content hits, "
+        << TextureStats.Misses << " misses, " << TextureStats.BytesSaved / 1024 << "KB saved, "
+        << TextureStats.BytesResident / 1024 << "KB resident" << std::endl;
+}
+
+void
+Benchmark::VertexPacking() {
+    const unsigned VertexCounts[] = { 10000, 100000, 1000000, 10000000 };
+    for (unsigned CountIdx = 0; CountIdx < sizeof(VertexCounts) / sizeof(VertexCounts[0]); ++CountIdx) {
+        aiMesh* Synthetic = createSyntheticMesh(VertexCounts[CountIdx]);
+        double VertexCount = Synthetic->mNumVertices;
+
+        unsigned long long Allocations = AllocationCount;
+        std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+        {
+            CountedVector<float> Vertices;
+            CountedVector<unsigned> Indices;
+            packPerVertexVectors(Synthetic, Vertices, Indices);
+        }
+        float PerVertexMS = std::max(elapsedMS(Start), 0.001f);
+        unsigned long long PerVertexAllocations = AllocationCount - Allocations;
+
+        Allocations = AllocationCount;
+        Start = std::chrono::steady_clock::now();
+        {
+            CountedVector<float> Vertices((size_t)Synthetic->mNumVertices * Mesh::VERTEX_STRIDE);
+            CountedVector<unsigned> Indices((size_t)Synthetic->mNumFaces * 3);
+            glm::vec3 Min, Max;
+            Mesh::PackVertices(Synthetic, Vertices.data(), Min, Max);
+            Mesh::PackIndices(Synthetic, Indices.data());
+        }
+        float InPlaceMS = std::max(elapsedMS(Start), 0.001f);
+        unsigned long long InPlaceAllocations = AllocationCount - Allocations;
+
+        std::cout << "[Bench] Vertex packing, " << Synthetic->mNumVertices << " vertices" << std::endl
+            << "    per-vertex vectors: " << VertexCount / (PerVertexMS / 1000.0) << " vertices/s, "
+            << PerVertexAllocations << " allocations" << std::endl
+            << "    in-place:           " << VertexCount / (InPlaceMS / 1000.0) << " vertices/s, "
+            << InPlaceAllocations << " allocations" << std::endl;
+        delete Synthetic;
+    }
+}
+
+void
+Benchmark::InstancedDraw(unsigned instanceCount, unsigned frames) {
+    ShaderVariants PhongVariants("shaders/basic.vert", "shaders/phong_material_texture.frag", setupBenchShader);
+    if (!PhongVariants.Wait(0).GetId()) {
+        std::cerr << "[Bench] Failed to load shader" << std::endl;
+        return;
+    }
+
+    BenchScene Scene(instanceCount);
+    if (!Scene.Geometry.IsValid()) {
+        return;
+    }
+    const GeometryRange& Range = Scene.Geometry.GetRange();
+    InstanceBatch Forest(VERTEX_FORMAT_FLOAT, Range, Scene.TriangleBounds);
+    for (unsigned Instance = 0; Instance < instanceCount; ++Instance) {
+        Forest.Add(Scene.Models[Instance]);
+    }
+
+    const Shader& PhongShader = PhongVariants.Use(0);
+    PhongVariants.Wait(SHADER_FEATURE_INSTANCED);
+    Culler ForestCuller;
+
+    glFinish();
+    std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+    for (unsigned Frame = 0; Frame < frames; ++Frame) {
+        ForestCuller.BeginFrame(Scene.Projection, Scene.View);
+        GeometryBuffer::Bind(VERTEX_FORMAT_FLOAT);
+        for (unsigned Instance = 0; Instance < instanceCount; ++Instance) {
+            if (ForestCuller.IsVisible(Scene.TriangleBounds, Scene.Models[Instance])) {
+                PhongShader.SetModel(Scene.Models[Instance]);
+                glDrawArrays(GL_TRIANGLES, Range.BaseVertex, Range.VertexCount);
+            }
+        }
+        glFinish();
+    }
+    float PerObjectMS = elapsedMS(Start) / (frames ? frames : 1);
+    unsigned Visible = ForestCuller.GetStats().Submitted;
+
+    Start = std::chrono::steady_clock::now();
+    for (unsigned Frame = 0; Frame < frames; ++Frame) {
+        ForestCuller.BeginFrame(Scene.Projection, Scene.View);
+        Forest.Render(PhongVariants, 0, ForestCuller);
+        glFinish();
+    }
+    float InstancedMS = elapsedMS(Start) / (frames ? frames : 1);
+    GeometryBuffer::Unbind();
+    Shader::UseProgram(0);
+
+    std::cout << "[Bench] Instanced draw, " << instanceCount << " props, " << Visible << " visible" << std::endl
+        << "    draw per prop: " << PerObjectMS << "ms/frame, " << Visible << " draw calls" << std::endl
+        << "    instanced:     " << InstancedMS << "ms/frame, " << (Visible ? 1 : 0) << " draw call" << std::endl;
+}
+
+void
+Benchmark::MaterialDraw(unsigned instanceCount, unsigned frames) {
+    ShaderVariants PhongVariants("shaders/basic.vert", "shaders/phong_material_texture.frag", setupBenchShader);
+    if (!PhongVariants.Wait(0).GetId()) {
+        std::cerr << "[Bench] Failed to load shader" << std::endl;
+        return;
+    }
+
+    const char* Paths[] = {
+        "res/trava.jpg", "res/drvo.jpg", "res/krosnja.jpeg", "res/planina.jpg",
+        "res/sunce.jpg", "res/mesec.jpg", "res/trava2_s.jpg", "res/trava1.jpg",
+    };
+    const unsigned MaterialCount = sizeof(Paths) / sizeof(Paths[0]);
+    MaterialSystem& Materials = MaterialSystem::Get();
+    unsigned MaterialIds[MaterialCount];
+    // NOTE(Jovan): Stand ins for per material textures, only their binds are measured
+    std::vector<TextureHandle> Textures(MaterialCount);
+    for (unsigned MaterialIdx = 0; MaterialIdx < MaterialCount; ++MaterialIdx) {
+        MaterialIds[MaterialIdx] = Materials.Add(Paths[MaterialIdx]);
+        unsigned Id;
+        glGenTextures(1, &Id);
+        glBindTexture(GL_TEXTURE_2D, Id);
+        unsigned char Texel[4] = { 255, 255, 255, 255 };
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, Texel);
+        Textures[MaterialIdx].Reset(Id);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    Materials.Finish();
+
+    // NOTE(Jovan): Neighbouring props alternate materials, the worst case for state changes
+    BenchScene Scene(instanceCount);
+    if (!Scene.Geometry.IsValid()) {
+        return;
+    }
+    const GeometryRange& Range = Scene.Geometry.GetRange();
+    InstanceBatch Forest(VERTEX_FORMAT_FLOAT, Range, Scene.TriangleBounds);
+    for (unsigned Instance = 0; Instance < instanceCount; ++Instance) {
+        Forest.Add(Scene.Models[Instance], MaterialIds[Instance % MaterialCount]);
+    }
+
+    const Shader& PhongShader = PhongVariants.Use(0);
+    PhongVariants.Wait(SHADER_FEATURE_INSTANCED);
+    unsigned Frames = frames ? frames : 1;
+    // NOTE(Jovan): Every path culls the same way, so they all draw the same props
+    Culler ForestCuller;
+
+    // NOTE(Jovan): Draw per prop binding its diffuse and specular texture, as the scene did
+    glFinish();
+    std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+    for (unsigned Frame = 0; Frame < Frames; ++Frame) {
+        ForestCuller.BeginFrame(Scene.Projection, Scene.View);
+        GeometryBuffer::Bind(VERTEX_FORMAT_FLOAT);
+        for (unsigned Instance = 0; Instance < instanceCount; ++Instance) {
+            if (!ForestCuller.IsVisible(Scene.TriangleBounds, Scene.Models[Instance])) {
+                continue;
+            }
+            unsigned Texture = Textures[Instance % MaterialCount].GetId();
+            glActiveTexture(GL_TEXTURE0 + BENCH_DIFFUSE_TEXTURE_UNIT);
+            glBindTexture(GL_TEXTURE_2D, Texture);
+            glActiveTexture(GL_TEXTURE0 + BENCH_SPECULAR_TEXTURE_UNIT);
+            glBindTexture(GL_TEXTURE_2D, Texture);
+            PhongShader.SetModel(Scene.Models[Instance]);
+            glDrawArrays(GL_TRIANGLES, Range.BaseVertex, Range.VertexCount);
+        }
+        glFinish();
+    }
+    float BindMS = elapsedMS(Start) / Frames;
+    unsigned Visible = ForestCuller.GetStats().Submitted;
+    glActiveTexture(GL_TEXTURE0 + BENCH_DIFFUSE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0 + BENCH_SPECULAR_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    Start = std::chrono::steady_clock::now();
+    for (unsigned Frame = 0; Frame < Frames; ++Frame) {
+        ForestCuller.BeginFrame(Scene.Projection, Scene.View);
+        GeometryBuffer::Bind(VERTEX_FORMAT_FLOAT);
+        for (unsigned Instance = 0; Instance < instanceCount; ++Instance) {
+            if (!ForestCuller.IsVisible(Scene.TriangleBounds, Scene.Models[Instance])) {
+                continue;
+            }
+            MaterialSystem::Select(PhongShader, MaterialIds[Instance % MaterialCount]);
+            PhongShader.SetModel(Scene.Models[Instance]);
+            glDrawArrays(GL_TRIANGLES, Range.BaseVertex, Range.VertexCount);
+        }
+        glFinish();
+    }
+    float SelectMS = elapsedMS(Start) / Frames;
+
+    Start = std::chrono::steady_clock::now();
+    for (unsigned Frame = 0; Frame < Frames; ++Frame) {
+        ForestCuller.BeginFrame(Scene.Projection, Scene.View);
+        Forest.Render(PhongVariants, 0, ForestCuller);
+        glFinish();
+    }
+    float InstancedMS = elapsedMS(Start) / Frames;
+    MaterialSystem::Select(PhongShader, MATERIAL_DEFAULT);
+    GeometryBuffer::Unbind();
+    Shader::UseProgram(0);
+
+    std::cout << "[Bench] Material draw, " << instanceCount << " props, " << Visible << " visible, " << MaterialCount << " materials" << std::endl
+        << "    draw per prop, 2 texture binds: " << BindMS << "ms/frame" << std::endl
+        << "    draw per prop, material index:  " << SelectMS << "ms/frame" << std::endl
+        << "    instanced across materials:     " << InstancedMS << "ms/frame, 1 draw call" << std::endl;
+}
+
+void
+Benchmark::RenderQueueDraw(unsigned objectCount, unsigned frames) {
+    ShaderVariants PhongVariants("shaders/basic.vert", "shaders/phong_material_texture.frag", setupBenchShader);
+    const Shader* Programs[2] = { &PhongVariants.Wait(0), &PhongVariants.Wait(SHADER_FEATURE_SPECULAR_MAP) };
+    if (!Programs[0]->GetId() || !Programs[1]->GetId()) {
+        std::cerr << "[Bench] Failed to load shader" << std::endl;
+        return;
+    }
+
+    const char* Paths[] = {
+        "res/trava.jpg", "res/drvo.jpg", "res/krosnja.jpeg", "res/planina.jpg",
+        "res/sunce.jpg", "res/mesec.jpg", "res/trava2_s.jpg", "res/trava1.jpg",
+    };
+    const unsigned MaterialCount = sizeof(Paths) / sizeof(Paths[0]);
+    MaterialSystem& Materials = MaterialSystem::Get();
+    unsigned MaterialIds[MaterialCount];
+    for (unsigned MaterialIdx = 0; MaterialIdx < MaterialCount; ++MaterialIdx) {
+        MaterialIds[MaterialIdx] = Materials.Add(Paths[MaterialIdx]);
+    }
+    Materials.Finish();
+
+    // NOTE(Jovan): Neighbouring props alternate programs and materials, the worst case
+    // for drawing in listing order
+    BenchScene Scene(objectCount);
+    if (!Scene.Geometry.IsValid()) {
+        return;
+    }
+    const GeometryRange& Range = Scene.Geometry.GetRange();
+    const std::vector<glm::mat4>& Models = Scene.Models;
+    unsigned Frames = frames ? frames : 1;
+
+    glFinish();
+    std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+    for (unsigned Frame = 0; Frame < Frames; ++Frame) {
+        for (unsigned Object = 0; Object < objectCount; ++Object) {
+            const Shader& Program = *Programs[Object % 2];
+            Program.Use();
+            MaterialSystem::Select(Program, MaterialIds[Object % MaterialCount]);
+            Program.SetModel(Models[Object]);
+            GeometryBuffer::Bind(VERTEX_FORMAT_FLOAT);
+            glDrawArrays(GL_TRIANGLES, Range.BaseVertex, Range.VertexCount);
+        }
+        glFinish();
+    }
+    float ImmediateMS = elapsedMS(Start) / Frames;
+
+    RenderQueue Queue;
+    Start = std::chrono::steady_clock::now();
+    for (unsigned Frame = 0; Frame < Frames; ++Frame) {
+        Queue.Begin(Scene.View);
+        for (unsigned Object = 0; Object < objectCount; ++Object) {
+            Queue.AddRange(RENDER_PASS_OPAQUE, *Programs[Object % 2], MaterialIds[Object % MaterialCount], VERTEX_FORMAT_FLOAT, Range, Models[Object]);
+        }
+        Queue.Submit();
+        glFinish();
+    }
+    float QueuedMS = elapsedMS(Start) / Frames;
+    for (unsigned ProgramIdx = 0; ProgramIdx < 2; ++ProgramIdx) {
+        Programs[ProgramIdx]->Use();
+        MaterialSystem::Select(*Programs[ProgramIdx], MATERIAL_DEFAULT);
+        Programs[ProgramIdx]->SetModel(glm::mat4(1.0f));
+    }
+    GeometryBuffer::Unbind();
+    Shader::UseProgram(0);
+
+    const RenderQueueStats& Stats = Queue.GetStats();
+    std::cout << "[Bench] Render queue, " << objectCount << " props, 2 programs, " << MaterialCount << " materials" << std::endl
+        << "    listing order: " << ImmediateMS << "ms/frame" << std::endl
+        << "    render queue:  " << QueuedMS << "ms/frame, " << Stats.DrawCalls << " draw calls" << std::endl
+        << "    switches, sorted / listing order: programs " << Stats.ProgramSwitches << " / " << Stats.UnsortedProgramSwitches
+        << ", materials " << Stats.MaterialSwitches << " / " << Stats.UnsortedMaterialSwitches
+        << ", VAOs " << Stats.VAOSwitches << " / " << Stats.UnsortedVAOSwitches << std::endl;
+}
+
+void
+Benchmark::LightCount(unsigned frames) {
+    ShaderVariants PhongVariants("shaders/basic.vert", "shaders/phong_material_texture.frag", setupBenchShader);
+    if (!PhongVariants.Wait(0).GetId()) {
+        std::cerr << "[Bench] Failed to load shader" << std::endl;
+        return;
+    }
+
+    // NOTE(Jovan): A floor filling the view, so every pixel shades the lights of its cluster
+    float Floor[] = {
+        -50.0f, 0.0f,    0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f,
+         50.0f, 0.0f,    0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+         50.0f, 0.0f, -100.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+        -50.0f, 0.0f,    0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f,
+         50.0f, 0.0f, -100.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+        -50.0f, 0.0f, -100.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+    };
+    GeometryAllocation Geometry(VERTEX_FORMAT_FLOAT, (const unsigned char*)Floor, 6, 0, 0);
+    if (!Geometry.IsValid()) {
+        return;
+    }
+
+    int Viewport[4];
+    glGetIntegerv(GL_VIEWPORT, Viewport);
+    unsigned Width = Viewport[2] > 0 ? Viewport[2] : 1;
+    unsigned Height = Viewport[3] > 0 ? Viewport[3] : 1;
+    glm::mat4 Projection = glm::perspective(45.0f, Width / (float)Height, 0.1f, 100.0f);
+    glm::mat4 View = glm::lookAt(glm::vec3(0.0f, 8.0f, 2.0f), glm::vec3(0.0f, 0.0f, -30.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    FrameUniforms FrameData = {};
+    FrameData.Projection = Projection;
+    FrameData.View = View;
+    FrameData.ViewProjection = Projection * View;
+    FrameData.ViewPosition = glm::vec3(0.0f, 8.0f, 2.0f);
+    UniformBuffer FrameBuffer(UNIFORM_BINDING_FRAME, sizeof(FrameUniforms));
+    FrameBuffer.Update(&FrameData);
+
+    const unsigned LightCounts[] = { 16, 64, 256, 1024, 4096 };
+    // NOTE(Jovan): A single cluster holds every light in view, the same as looping over all of them
+    const unsigned Grids[2][3] = { { CLUSTER_COUNT_X, CLUSTER_COUNT_Y, CLUSTER_COUNT_Z }, { 1, 1, 1 } };
+    std::srand(1);
+    for (unsigned CountIdx = 0; CountIdx < sizeof(LightCounts) / sizeof(LightCounts[0]); ++CountIdx) {
+        LightSystem Lights;
+        for (unsigned LightIdx = 0; LightIdx < LightCounts[CountIdx]; ++LightIdx) {
+            Light Point;
+            Point.Position = glm::vec3(std::rand() % 100 - 50.0f, 0.5f + (std::rand() % 100) / 50.0f, -(float)(std::rand() % 100));
+            Point.Kd = glm::vec3((std::rand() % 100) / 100.0f, (std::rand() % 100) / 100.0f, (std::rand() % 100) / 100.0f);
+            Point.Ks = glm::vec3(0.5f);
+            // NOTE(Jovan): Range of roughly 10 units
+            Point.Kq = 4.0f;
+            Lights.Add(Point);
+        }
+
+        std::cout << "[Bench] Light count, " << LightCounts[CountIdx] << " point lights, " << Width << "x" << Height << std::endl;
+        for (unsigned GridIdx = 0; GridIdx < 2; ++GridIdx) {
+            Lights.SetClusterGrid(Grids[GridIdx][0], Grids[GridIdx][1], Grids[GridIdx][2]);
+            float BuildMS = 0.0f;
+            float FrameMS = 0.0f;
+            // NOTE(Jovan): Compiles the variant the lights need outside of the timed frames
+            Lights.Upload(Projection, View, Width, Height);
+            PhongVariants.Wait(Lights.GetShaderFeatures());
+            glFinish();
+            for (unsigned Frame = 0; Frame < frames; ++Frame) {
+                std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+                Lights.Upload(Projection, View, Width, Height);
+                BuildMS += elapsedMS(Start);
+                PhongVariants.Use(Lights.GetShaderFeatures());
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                GeometryBuffer::Bind(VERTEX_FORMAT_FLOAT);
+                glDrawArrays(GL_TRIANGLES, Geometry.GetRange().BaseVertex, Geometry.GetRange().VertexCount);
+                glFinish();
+                FrameMS += elapsedMS(Start);
+            }
+
+            const ClusterStats& Stats = Lights.GetClusterStats();
+            std::cout << "    " << (GridIdx ? "unclustered:       " : "clustered 16x9x24: ")
+                << BuildMS / (frames ? frames : 1) << "ms build, "
+                << FrameMS / (frames ? frames : 1) << "ms/frame, lights per cluster "
+                << Stats.LightIndices / (float)(Stats.Clusters ? Stats.Clusters : 1) << " avg, "
+                << Stats.MaxLightsPerCluster << " max" << std::endl;
+        }
+    }
+    GeometryBuffer::Unbind();
+    Shader::UseProgram(0);
+}
+
+void
+Benchmark::ShaderLoad(unsigned iterations) {
+    // NOTE(Jovan): Every Phong variant, built one at a time and then all submitted at once.
+    // Caches are removed first so both really compile
+    const char* PhongPaths[2] = { "shaders/basic.vert", "shaders/phong_material_texture.frag" };
+    const unsigned VariantCount = 1u << SHADER_FEATURE_COUNT;
+    for (unsigned Features = 0; Features < VariantCount; ++Features) {
+        std::remove(ProgramCache::GetCachePath(PhongPaths[0], PhongPaths[1], ShaderVariants::GetDefines(Features)).c_str());
+    }
+    std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+    {
+        ShaderVariants Blocking(PhongPaths[0], PhongPaths[1], setupBenchShader);
+        for (unsigned Features = 0; Features < VariantCount; ++Features) {
+            Blocking.Wait(Features);
+        }
+        glFinish();
+    }
+    float BlockingMS = elapsedMS(Start);
+
+    for (unsigned Features = 0; Features < VariantCount; ++Features) {
+        std::remove(ProgramCache::GetCachePath(PhongPaths[0], PhongPaths[1], ShaderVariants::GetDefines(Features)).c_str());
+    }
+    Start = std::chrono::steady_clock::now();
+    float SubmitMS = 0.0f;
+    {
+        ShaderVariants Async(PhongPaths[0], PhongPaths[1], setupBenchShader);
+        for (unsigned Features = 0; Features < VariantCount; ++Features) {
+            Async.Request(Features);
+        }
+        SubmitMS = elapsedMS(Start);
+        for (unsigned Features = 0; Features < VariantCount; ++Features) {
+            Async.Wait(Features);
+        }
+        glFinish();
+    }
+    float AsyncMS = elapsedMS(Start);
+    std::cout << "[Bench] Shader variants, " << VariantCount << " Phong variants, parallel compile "
+        << (GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile ? "on" : "off") << std::endl
+        << "    one at a time: " << BlockingMS << "ms" << std::endl
+        << "    all at once:   " << SubmitMS << "ms to submit, " << AsyncMS << "ms until all are ready" << std::endl;
+
+    if (!ProgramCache::IsSupported()) {
+        std::cout << "[Bench] Shader load skipped, driver doesn't support program binaries" << std::endl;
+        return;
+    }
+
+    const char* Programs[][2] = {
+        { "shaders/basic.vert", "shaders/phong_material_texture.frag" },
+        { "shaders/color.vert", "shaders/color.frag" },
+    };
+    const unsigned ProgramCount = sizeof(Programs) / sizeof(Programs[0]);
+
+    float ColdMS = 0.0f;
+    float WarmMS = 0.0f;
+    for (unsigned Iteration = 0; Iteration < iterations; ++Iteration) {
+        // NOTE(Jovan): Cold loads compile, link and write the cache, warm loads read it back
+        for (unsigned ProgramIdx = 0; ProgramIdx < ProgramCount; ++ProgramIdx) {
+            std::remove(ProgramCache::GetCachePath(Programs[ProgramIdx][0], Programs[ProgramIdx][1]).c_str());
+        }
+        Start = std::chrono::steady_clock::now();
+        for (unsigned ProgramIdx = 0; ProgramIdx < ProgramCount; ++ProgramIdx) {
+            Shader Cold(Programs[ProgramIdx][0], Programs[ProgramIdx][1]);
+        }
+        glFinish();
+        ColdMS += elapsedMS(Start);
+
+        Start = std::chrono::steady_clock::now();
+        for (unsigned ProgramIdx = 0; ProgramIdx < ProgramCount; ++ProgramIdx) {
+            Shader Warm(Programs[ProgramIdx][0], Programs[ProgramIdx][1]);
+        }
+        glFinish();
+        WarmMS += elapsedMS(Start);
+    }
+
+    unsigned Iterations = iterations ? iterations : 1;
+    std::cout << "[Bench] Shader load, " << ProgramCount << " programs" << std::endl
+        << "    compile and link: " << ColdMS / Iterations << "ms" << std::endl
+        << "    program cache:    " << WarmMS / Iterations << "ms" << std::endl;
+}
+
+void
+Benchmark::TextureLoad() {
+    const char* Paths[] = {
+        "res/trava.jpg", "res/drvo.jpg", "res/krosnja.jpeg", "res/planina.jpg",
+        "res/sunce.jpg", "res/mesec.jpg", "res/trava2_s.jpg", "res/trava1.jpg", "res/trava1_s.jpg",
+    };
+    const unsigned PathCount = sizeof(Paths) / sizeof(Paths[0]);
+    TextureCache& Cache = TextureCache::Get();
+
+    // NOTE(Jovan): Textures are dropped between runs, so both load every file
+    std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+    {
+        std::vector<SharedTexture> Textures;
+        for (unsigned PathIdx = 0; PathIdx < PathCount; ++PathIdx) {
+            Textures.push_back(Cache.Load(Paths[PathIdx]));
+        }
+        glFinish();
+    }
+    float BlockingMS = elapsedMS(Start);
+
+    Start = std::chrono::steady_clock::now();
+    float SubmitMS = 0.0f;
+    float LongestUpdateMS = 0.0f;
+    unsigned Updates = 0;
+    {
+        std::vector<SharedTexture> Textures;
+        for (unsigned PathIdx = 0; PathIdx < PathCount; ++PathIdx) {
+            Textures.push_back(Cache.LoadAsync(Paths[PathIdx]));
+        }
+        SubmitMS = elapsedMS(Start);
+        while (Cache.GetStats().Pending) {
+            std::chrono::steady_clock::time_point UpdateStart = std::chrono::steady_clock::now();
+            Cache.Update();
+            LongestUpdateMS = std::max(LongestUpdateMS, elapsedMS(UpdateStart));
+            ++Updates;
+            glFlush();
+            std::this_thread::yield();
+        }
+    }
+    float StreamedMS = elapsedMS(Start);
+    std::cout << "[Bench] Texture load, " << PathCount << " textures, " << WorkerPool::Get().GetThreadCount() << " workers" << std::endl
+        << "    blocking: " << BlockingMS << "ms" << std::endl
+        << "    streamed: " << SubmitMS << "ms to submit, " << StreamedMS << "ms until all are resident, "
+        << Updates << " updates, longest " << LongestUpdateMS << "ms" << std::endl;
+}
+
+void
+Benchmark::ImageProcessing(unsigned size, unsigned iterations) {
+    unsigned Iterations = iterations ? iterations : 1;
+    size_t PixelCount = (size_t)size * size;
+    std::vector<unsigned char> RGB(PixelCount * 3);
+    std::vector<unsigned char> RGBA(PixelCount * 4);
+    // NOTE(Jovan): Noise, so nothing gets an easier time from flat areas
+    unsigned Seed = 12345;
+    for (size_t ByteIdx = 0; ByteIdx < RGBA.size(); ++ByteIdx) {
+        Seed = Seed * 1664525u + 1013904223u;
+        RGBA[ByteIdx] = (unsigned char)(Seed >> 24);
+    }
+    memcpy(RGB.data(), RGBA.data(), RGB.size());
+    float MB = RGBA.size() / (1024.0f * 1024.0f);
+
+    std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+    for (unsigned Iteration = 0; Iteration < Iterations; ++Iteration) {
+        flipRowsScalar(RGBA.data(), (size_t)size * 4, size);
+    }
+    float FlipScalarMS = elapsedMS(Start) / Iterations;
+    Start = std::chrono::steady_clock::now();
+    for (unsigned Iteration = 0; Iteration < Iterations; ++Iteration) {
+        ImageOps::FlipVertical(RGBA.data(), (size_t)size * 4, size);
+    }
+    float FlipMS = elapsedMS(Start) / Iterations;
+
+    const int RGBToBGRA[4] = { 2, 1, 0, -1 };
+    std::vector<unsigned char> Swizzled(PixelCount * 4);
+    Start = std::chrono::steady_clock::now();
+    for (unsigned Iteration = 0; Iteration < Iterations; ++Iteration) {
+        swizzleScalar(RGB.data(), 3, Swizzled.data(), 4, RGBToBGRA, PixelCount);
+    }
+    float SwizzleScalarMS = elapsedMS(Start) / Iterations;
+    Start = std::chrono::steady_clock::now();
+    for (unsigned Iteration = 0; Iteration < Iterations; ++Iteration) {
+        ImageOps::Swizzle(RGB.data(), 3, Swizzled.data(), 4, RGBToBGRA, PixelCount);
+    }
+    float SwizzleMS = elapsedMS(Start) / Iterations;
+
+    // NOTE(Jovan): Upload and mips as every texture was created before, the driver
+    // generates the chain from the base level
+    Start = std::chrono::steady_clock::now();
+    for (unsigned Iteration = 0; Iteration < Iterations; ++Iteration) {
+        unsigned Id;
+        glGenTextures(1, &Id);
+        glBindTexture(GL_TEXTURE_2D, Id);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, RGBA.data());
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glFinish();
+        glDeleteTextures(1, &Id);
+    }
+    float DriverMipsMS = elapsedMS(Start) / Iterations;
+
+    float BuildMS[2] = { 0.0f, 0.0f };
+    float UploadMS = 0.0f;
+    for (unsigned Filter = MIP_FILTER_BOX; Filter <= MIP_FILTER_KAISER; ++Filter) {
+        for (unsigned Iteration = 0; Iteration < Iterations; ++Iteration) {
+            MipChain Mips;
+            Start = std::chrono::steady_clock::now();
+            ImageOps::BuildMipChain(RGBA.data(), size, size, 4, (EMipFilter)Filter, true, Mips);
+            BuildMS[Filter] += elapsedMS(Start) / Iterations;
+
+            // NOTE(Jovan): What a load from the mip cache costs on the context thread
+            if (Filter == MIP_FILTER_BOX) {
+                Start = std::chrono::steady_clock::now();
+                unsigned Id = Texture::CreateFromMipChain(Mips, Mips.Data.data());
+                glFinish();
+                UploadMS += elapsedMS(Start) / Iterations;
+                glDeleteTextures(1, &Id);
+            }
+        }
+    }
+
+    std::cout << "[Bench] Image processing, " << size << "x" << size << " RGBA, " << MB << "MB" << std::endl
+        << "    flip:    scalar " << FlipScalarMS << "ms (" << MB * 1000.0f / FlipScalarMS << "MB/s), SIMD "
+        << FlipMS << "ms (" << MB * 1000.0f / FlipMS << "MB/s)" << std::endl
+        << "    swizzle: RGB to BGRA scalar " << SwizzleScalarMS << "ms, SIMD " << SwizzleMS << "ms" << std::endl
+        << "    mips:    glGenerateMipmap " << DriverMipsMS << "ms, CPU box " << BuildMS[MIP_FILTER_BOX] << "ms ("
+        << MB * 1000.0f / BuildMS[MIP_FILTER_BOX] << "MB/s), CPU Kaiser " << BuildMS[MIP_FILTER_KAISER] << "ms ("
+        << MB * 1000.0f / BuildMS[MIP_FILTER_KAISER] << "MB/s)" << std::endl
+        << "    upload of a prebuilt chain: " << UploadMS << "ms" << std::endl;
+}
+
+void
+Benchmark::VirtualTexturing(const std::string& path) {
+    std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+    if (!TilePyramid::Build(path)) {
+        std::cerr << "[Bench] Failed to build tile pyramid of " << path << std::endl;
+        return;
+    }
+    float BuildMS = elapsedMS(Start);
+
+    TilePyramid Pyramid;
+    if (!Pyramid.Open(path)) {
+        return;
+    }
+    unsigned TilesLog2 = Pyramid.GetTilesLog2();
+    size_t TileCount = TilePyramid::GetLevelTileOffset(TilesLog2, TilesLog2 + 1);
+    // NOTE(Jovan): Copied out of the mapping like tile jobs do, the first read goes to disk
+    std::vector<unsigned char> Tile(VIRTUAL_TILE_BYTES);
+    Start = std::chrono::steady_clock::now();
+    for (unsigned Level = 0; Level <= TilesLog2; ++Level) {
+        unsigned Side = 1u << (TilesLog2 - Level);
+        for (unsigned Y = 0; Y < Side; ++Y) {
+            for (unsigned X = 0; X < Side; ++X) {
+                memcpy(Tile.data(), Pyramid.GetTile(Level, X, Y), VIRTUAL_TILE_BYTES);
+            }
+        }
+    }
+    float ReadMS = elapsedMS(Start);
+
+    size_t Size = (size_t)VIRTUAL_TILE_SIZE << TilesLog2;
+    size_t WholeBytes = Size * Size * 4 * 4 / 3;
+    size_t AtlasSide = (size_t)VIRTUAL_ATLAS_TILES * VIRTUAL_TILE_STRIDE;
+    std::cout << "[Bench] Virtual texture " << path << ", " << Size << "x" << Size << ", " << TileCount << " tiles" << std::endl
+        << "    pyramid build: " << BuildMS << "ms" << std::endl
+        << "    tile reads:    " << ReadMS / TileCount << "ms/tile" << std::endl
+        << "    whole texture: " << WholeBytes / 1024 << "KB, atlas: " << AtlasSide * AtlasSide * 4 / 1024
+        << "KB for any number of textures of any size" << std::endl;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file benchmark.hpp
+ * @author Jovan Ivosevic
+ * @brief Startup and throughput benchmarks, run with the --bench argument
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+class Benchmark {
+public:
+    /**
+     * @brief Runs all benchmarks and prints the results. Requires a current GL context
+     *
+     * @param models - Models to benchmark loading of, e.g. res/alduin or res/vitez models.
+     * The fox is used if none are given
+     */
+    static void Run(const std::vector<std::string>& models);
+
+    /**
+     * @brief Compares cold (Assimp import) and warm (mesh cache) model loads. The cold
+     * load also reports how the mesh processing scaled over the worker pool
+     *
+     * @param filename - Model path
+     * @param iterations - Number of warm loads to average
+     */
+    static void ModelLoad(const std::string& filename, unsigned iterations);
+
+    /**
+     * @brief Compares per-vertex vector packing with in-place packing on synthetic
+     * Assimp meshes of 10k to 10M vertices. Reports vertices per second and heap allocations
+     *
+     */
+    static void VertexPacking();
+
+    /**
+     * @brief Draws a grid of small props (a "forest") once with a draw call per prop and once
+     * with a single instanced draw. Reports average frame time, GPU included, for both
+     *
+     * @param instanceCount - Number of props
+     * @param frames - Number of frames to average
+     */
+    static void InstancedDraw(unsigned instanceCount, unsigned frames);
+
+    /**
+     * @brief Draws a grid of props alternating between materials three ways: a draw per
+     * prop binding its textures like the scene used to, a draw per prop selecting its
+     * material index, and one instanced draw across all materials
+     *
+     * @param instanceCount - Number of props
+     * @param frames - Number of frames to average
+     */
+    static void MaterialDraw(unsigned instanceCount, unsigned frames);
+
+    /**
+     * @brief Draws props mixing two programs and several materials, once in the order
+     * they're listed and once through a render queue. Reports frame time and the queue's
+     * program, material and VAO switches, sorted and in listing order
+     *
+     * @param objectCount - Number of props
+     * @param frames - Number of frames to average
+     */
+    static void RenderQueueDraw(unsigned objectCount, unsigned frames);
+
+    /**
+     * @brief Shades a floor lit by 16 to 4096 random point lights, once with clustered
+     * lighting and once with a single cluster, i.e. every fragment looping over every light.
+     * Reports light assignment time, frame time and lights per cluster
+     *
+     * @param frames - Number of frames to average
+     */
+    static void LightCount(unsigned frames);
+
+    /**
+     * @brief Compares building every Phong variant one at a time with submitting them all
+     * at once, then creating the scene's programs by compiling and linking them with loading
+     * them from the program cache
+     *
+     * @param iterations - Number of loads to average
+     */
+    static void ShaderLoad(unsigned iterations);
+
+    /**
+     * @brief Compares loading the scene's textures one at a time on the calling thread with
+     * streaming them through the texture cache. Reports the longest single Update, which
+     * is what a frame would stall on while streaming
+     *
+     */
+    static void TextureLoad();
+
+    /**
+     * @brief Compares stb_image's scalar flip and a scalar swizzle with their SIMD versions,
+     * and mip generation by the driver with building the chain on the CPU. Throughput is
+     * measured on a synthetic image, so it doesn't depend on what's on disk
+     *
+     * @param size - Width and height of the image
+     * @param iterations - Number of runs to average
+     */
+    static void ImageProcessing(unsigned size, unsigned iterations);
+
+    /**
+     * @brief Builds the tile pyramid of an image, reads every tile back the way workers
+     * stream them and compares video memory of the whole texture with the atlas
+     *
+     * @param path - Image path
+     */
+    static void VirtualTexturing(const std::string& path);
+};
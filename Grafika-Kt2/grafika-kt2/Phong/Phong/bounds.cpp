@@ -0,0 +1,91 @@
+#include "bounds.hpp"
+#include <cmath>
+
+Bounds
+Bounds::FromBox(const glm::vec3& min, const glm::vec3& max) {
+    Bounds Result;
+    Result.Box.Min = min;
+    Result.Box.Max = max;
+    Result.Sphere.Center = (min + max) * 0.5f;
+    Result.Sphere.Radius = glm::length(max - min) * 0.5f;
+    return Result;
+}
+
+Bounds
+Bounds::FromPoints(const float* vertices, unsigned vertexCount, unsigned stride) {
+    if (!vertexCount) {
+        return FromBox(glm::vec3(0.0f), glm::vec3(0.0f));
+    }
+
+    glm::vec3 Min(vertices[0], vertices[1], vertices[2]);
+    glm::vec3 Max = Min;
+    for (unsigned Vertex = 1; Vertex < vertexCount; ++Vertex) {
+        const float* Position = vertices + (size_t)Vertex * stride;
+        for (int Axis = 0; Axis < 3; ++Axis) {
+            Min[Axis] = Position[Axis] < Min[Axis] ? Position[Axis] : Min[Axis];
+            Max[Axis] = Position[Axis] > Max[Axis] ? Position[Axis] : Max[Axis];
+        }
+    }
+
+    Bounds Result = FromBox(Min, Max);
+    float MaxDistance2 = 0.0f;
+    for (unsigned Vertex = 0; Vertex < vertexCount; ++Vertex) {
+        const float* Position = vertices + (size_t)Vertex * stride;
+        glm::vec3 Offset = glm::vec3(Position[0], Position[1], Position[2]) - Result.Sphere.Center;
+        float Distance2 = glm::dot(Offset, Offset);
+        MaxDistance2 = Distance2 > MaxDistance2 ? Distance2 : MaxDistance2;
+    }
+    Result.Sphere.Radius = std::sqrt(MaxDistance2);
+    return Result;
+}
+
+void
+Bounds::Enclose(const Bounds& other, bool first) {
+    if (first) {
+        *this = other;
+        return;
+    }
+
+    Box.Min = glm::min(Box.Min, other.Box.Min);
+    Box.Max = glm::max(Box.Max, other.Box.Max);
+
+    // NOTE(Jovan): Smallest sphere around both spheres
+    glm::vec3 Offset = other.Sphere.Center - Sphere.Center;
+    float Distance = glm::length(Offset);
+    if (Distance + other.Sphere.Radius <= Sphere.Radius) {
+        return;
+    }
+    if (Distance + Sphere.Radius <= other.Sphere.Radius) {
+        Sphere = other.Sphere;
+        return;
+    }
+    float Radius = (Distance + Sphere.Radius + other.Sphere.Radius) * 0.5f;
+    Sphere.Center += Offset * ((Radius - Sphere.Radius) / Distance);
+    Sphere.Radius = Radius;
+}
+
+Bounds
+Bounds::Transform(const glm::mat4& m) const {
+    // NOTE(Jovan): Arvo's method, each matrix element contributes its smaller product
+    // to the new minimum and the larger one to the new maximum
+    Bounds Result;
+    glm::vec3 Translation(m[3]);
+    Result.Box.Min = Translation;
+    Result.Box.Max = Translation;
+    for (int Column = 0; Column < 3; ++Column) {
+        for (int Row = 0; Row < 3; ++Row) {
+            float A = m[Column][Row] * Box.Min[Column];
+            float B = m[Column][Row] * Box.Max[Column];
+            Result.Box.Min[Row] += A < B ? A : B;
+            Result.Box.Max[Row] += A < B ? B : A;
+        }
+    }
+
+    float ScaleX = glm::dot(glm::vec3(m[0]), glm::vec3(m[0]));
+    float ScaleY = glm::dot(glm::vec3(m[1]), glm::vec3(m[1]));
+    float ScaleZ = glm::dot(glm::vec3(m[2]), glm::vec3(m[2]));
+    float MaxScale2 = ScaleX > ScaleY ? (ScaleX > ScaleZ ? ScaleX : ScaleZ) : (ScaleY > ScaleZ ? ScaleY : ScaleZ);
+    Result.Sphere.Center = glm::vec3(m * glm::vec4(Sphere.Center, 1.0f));
+    Result.Sphere.Radius = Sphere.Radius * std::sqrt(MaxScale2);
+    return Result;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file bounds.hpp
+ * @author Jovan Ivosevic
+ * @brief Axis aligned bounding boxes and bounding spheres
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+struct AABB {
+    glm::vec3 Min;
+    glm::vec3 Max;
+};
+
+struct BoundingSphere {
+    glm::vec3 Center;
+    float Radius;
+};
+
+/**
+ * @brief Box and sphere around the same geometry. The sphere is the cheaper test,
+ * the box the tighter one
+ *
+ */
+struct Bounds {
+    AABB Box;
+    BoundingSphere Sphere;
+
+    /**
+     * @brief Returns bounds of a box, with the sphere around the box's corners
+     *
+     * @param min - Box minimum
+     * @param max - Box maximum
+     *
+     * @returns Bounds
+     */
+    static Bounds FromBox(const glm::vec3& min, const glm::vec3& max);
+
+    /**
+     * @brief Returns bounds of interleaved vertices. The sphere is centered on the box and
+     * sized to the farthest vertex, which is tighter than the box's corners
+     *
+     * @param vertices - Vertices, position is expected first
+     * @param vertexCount - Number of vertices
+     * @param stride - Floats per vertex
+     *
+     * @returns Bounds
+     */
+    static Bounds FromPoints(const float* vertices, unsigned vertexCount, unsigned stride);
+
+    /**
+     * @brief Grows these bounds to also enclose other bounds
+     *
+     * @param other - Bounds to enclose
+     * @param first - If true, these bounds are replaced instead of grown
+     */
+    void Enclose(const Bounds& other, bool first);
+
+    /**
+     * @brief Returns bounds transformed into another space. The box is re-fit around the
+     * transformed box and the sphere scaled by the largest axis scale
+     *
+     * @param m - Transformation matrix, affine
+     *
+     * @returns Transformed bounds
+     */
+    Bounds Transform(const glm::mat4& m) const;
+};
@@ -0,0 +1,478 @@
+#include "compressedtexture.hpp"
+#include "texture.hpp"
+#include "mappedfile.hpp"
+#include "workerpool.hpp"
+#include "imageops.hpp"
+#include "stb_image.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const char COMPRESSED_TEXTURE_MAGIC[4] = { 'P', 'T', 'E', 'X' };
+// NOTE(Jovan): A 2^32 texture would still fit, anything beyond is a corrupt file
+#define COMPRESSED_TEXTURE_MAX_LEVELS 32
+
+struct CompressedTextureHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint32_t Format;
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t LevelCount;
+    uint64_t SourceSize;
+    int64_t SourceModifiedTime;
+};
+
+/**
+ * @brief Packs a color into 5:6:5 bits
+ *
+ * @param color - RGB color
+ *
+ * @returns Packed color
+ */
+static uint16_t
+packColor565(const unsigned char* color) {
+    unsigned R = (color[0] * 31 + 127) / 255;
+    unsigned G = (color[1] * 63 + 127) / 255;
+    unsigned B = (color[2] * 31 + 127) / 255;
+    return (uint16_t)((R << 11) | (G << 5) | B);
+}
+
+/**
+ * @brief Expands a 5:6:5 color back to 8 bits per channel, the way the GPU decodes it
+ *
+ * @param packed - Packed color
+ * @param color - Output RGB color
+ */
+static void
+unpackColor565(uint16_t packed, int* color) {
+    int R = (packed >> 11) & 31;
+    int G = (packed >> 5) & 63;
+    int B = packed & 31;
+    color[0] = (R << 3) | (R >> 2);
+    color[1] = (G << 2) | (G >> 4);
+    color[2] = (B << 3) | (B >> 2);
+}
+
+/**
+ * @brief Encodes the RGB of a block as a BC1 color block. Endpoints start as the two pixels
+ * furthest apart along the block's principal axis and are then refit to the whole block
+ *
+ * @param block - 16 RGBA pixels
+ * @param dst - Output 8 bytes
+ */
+static void
+encodeColorBlock(const unsigned char* block, unsigned char* dst) {
+    float Mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (unsigned Pixel = 0; Pixel < 16; ++Pixel) {
+        for (unsigned Channel = 0; Channel < 3; ++Channel) {
+            Mean[Channel] += block[Pixel * 4 + Channel];
+        }
+    }
+    for (unsigned Channel = 0; Channel < 3; ++Channel) {
+        Mean[Channel] /= 16.0f;
+    }
+
+    // NOTE(Jovan): Covariance rr, rg, rb, gg, gb, bb
+    float Cov[6] = { 0.0f };
+    for (unsigned Pixel = 0; Pixel < 16; ++Pixel) {
+        float R = block[Pixel * 4 + 0] - Mean[0];
+        float G = block[Pixel * 4 + 1] - Mean[1];
+        float B = block[Pixel * 4 + 2] - Mean[2];
+        Cov[0] += R * R; Cov[1] += R * G; Cov[2] += R * B;
+        Cov[3] += G * G; Cov[4] += G * B; Cov[5] += B * B;
+    }
+
+    // NOTE(Jovan): Power iteration, a few steps are plenty for a 3x3 matrix
+    float Axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (unsigned Iteration = 0; Iteration < 4; ++Iteration) {
+        float X = Cov[0] * Axis[0] + Cov[1] * Axis[1] + Cov[2] * Axis[2];
+        float Y = Cov[1] * Axis[0] + Cov[3] * Axis[1] + Cov[4] * Axis[2];
+        float Z = Cov[2] * Axis[0] + Cov[4] * Axis[1] + Cov[5] * Axis[2];
+        float Largest = std::max(std::fabs(X), std::max(std::fabs(Y), std::fabs(Z)));
+        if (Largest < 1e-6f) {
+            break;
+        }
+        Axis[0] = X / Largest;
+        Axis[1] = Y / Largest;
+        Axis[2] = Z / Largest;
+    }
+
+    unsigned MinPixel = 0;
+    unsigned MaxPixel = 0;
+    float MinProjection = 0.0f;
+    float MaxProjection = 0.0f;
+    for (unsigned Pixel = 0; Pixel < 16; ++Pixel) {
+        float Projection = (block[Pixel * 4 + 0] - Mean[0]) * Axis[0]
+            + (block[Pixel * 4 + 1] - Mean[1]) * Axis[1]
+            + (block[Pixel * 4 + 2] - Mean[2]) * Axis[2];
+        if (!Pixel || Projection < MinProjection) {
+            MinProjection = Projection;
+            MinPixel = Pixel;
+        }
+        if (!Pixel || Projection > MaxProjection) {
+            MaxProjection = Projection;
+            MaxPixel = Pixel;
+        }
+    }
+
+    float Endpoints[2][3];
+    for (unsigned Channel = 0; Channel < 3; ++Channel) {
+        Endpoints[0][Channel] = block[MaxPixel * 4 + Channel];
+        Endpoints[1][Channel] = block[MinPixel * 4 + Channel];
+    }
+    // NOTE(Jovan): Extreme pixels make poor endpoints in noisy blocks. Refits them to the
+    // pixels by least squares, keeping each pixel's position along the axis
+    float Range = MaxProjection - MinProjection;
+    if (Range > 0.0f) {
+        float AA = 0.0f, AB = 0.0f, BB = 0.0f;
+        float AX[3] = { 0.0f, 0.0f, 0.0f };
+        float BX[3] = { 0.0f, 0.0f, 0.0f };
+        for (unsigned Pixel = 0; Pixel < 16; ++Pixel) {
+            float Projection = (block[Pixel * 4 + 0] - Mean[0]) * Axis[0]
+                + (block[Pixel * 4 + 1] - Mean[1]) * Axis[1]
+                + (block[Pixel * 4 + 2] - Mean[2]) * Axis[2];
+            // NOTE(Jovan): Snapped to the palette's weights 0, 1/3, 2/3 and 1
+            float Weight = std::floor((Projection - MinProjection) / Range * 3.0f + 0.5f) / 3.0f;
+            AA += Weight * Weight;
+            AB += Weight * (1.0f - Weight);
+            BB += (1.0f - Weight) * (1.0f - Weight);
+            for (unsigned Channel = 0; Channel < 3; ++Channel) {
+                AX[Channel] += Weight * block[Pixel * 4 + Channel];
+                BX[Channel] += (1.0f - Weight) * block[Pixel * 4 + Channel];
+            }
+        }
+        float Determinant = AA * BB - AB * AB;
+        if (std::fabs(Determinant) > 1e-6f) {
+            for (unsigned Channel = 0; Channel < 3; ++Channel) {
+                float A = (AX[Channel] * BB - BX[Channel] * AB) / Determinant;
+                float B = (BX[Channel] * AA - AX[Channel] * AB) / Determinant;
+                Endpoints[0][Channel] = std::min(255.0f, std::max(0.0f, A));
+                Endpoints[1][Channel] = std::min(255.0f, std::max(0.0f, B));
+            }
+        }
+    }
+
+    unsigned char Max[3];
+    unsigned char Min[3];
+    for (unsigned Channel = 0; Channel < 3; ++Channel) {
+        Max[Channel] = (unsigned char)(Endpoints[0][Channel] + 0.5f);
+        Min[Channel] = (unsigned char)(Endpoints[1][Channel] + 0.5f);
+    }
+    uint16_t Color0 = packColor565(Max);
+    uint16_t Color1 = packColor565(Min);
+    // NOTE(Jovan): Color0 > Color1 selects the four color mode
+    if (Color0 < Color1) {
+        std::swap(Color0, Color1);
+    }
+
+    uint32_t Indices = 0;
+    if (Color0 != Color1) {
+        int Palette[4][3];
+        unpackColor565(Color0, Palette[0]);
+        unpackColor565(Color1, Palette[1]);
+        for (unsigned Channel = 0; Channel < 3; ++Channel) {
+            Palette[2][Channel] = (2 * Palette[0][Channel] + Palette[1][Channel]) / 3;
+            Palette[3][Channel] = (Palette[0][Channel] + 2 * Palette[1][Channel]) / 3;
+        }
+
+        for (unsigned Pixel = 0; Pixel < 16; ++Pixel) {
+            unsigned Best = 0;
+            int BestDistance = 0;
+            for (unsigned Entry = 0; Entry < 4; ++Entry) {
+                int Distance = 0;
+                for (unsigned Channel = 0; Channel < 3; ++Channel) {
+                    int Delta = block[Pixel * 4 + Channel] - Palette[Entry][Channel];
+                    Distance += Delta * Delta;
+                }
+                if (!Entry || Distance < BestDistance) {
+                    BestDistance = Distance;
+                    Best = Entry;
+                }
+            }
+            Indices |= Best << (Pixel * 2);
+        }
+    }
+
+    dst[0] = Color0 & 0xFF;
+    dst[1] = Color0 >> 8;
+    dst[2] = Color1 & 0xFF;
+    dst[3] = Color1 >> 8;
+    for (unsigned Byte = 0; Byte < 4; ++Byte) {
+        dst[4 + Byte] = (Indices >> (Byte * 8)) & 0xFF;
+    }
+}
+
+/**
+ * @brief Encodes one channel of a block as a BC4 block, also the alpha half of BC3
+ *
+ * @param block - 16 pixels
+ * @param stride - Bytes between pixels
+ * @param dst - Output 8 bytes
+ */
+static void
+encodeChannelBlock(const unsigned char* block, unsigned stride, unsigned char* dst) {
+    unsigned char Min = 255;
+    unsigned char Max = 0;
+    for (unsigned Pixel = 0; Pixel < 16; ++Pixel) {
+        Min = std::min(Min, block[Pixel * stride]);
+        Max = std::max(Max, block[Pixel * stride]);
+    }
+
+    uint64_t Indices = 0;
+    if (Max != Min) {
+        // NOTE(Jovan): Max > Min selects the mode with six interpolated values
+        int Palette[8];
+        Palette[0] = Max;
+        Palette[1] = Min;
+        for (unsigned Entry = 2; Entry < 8; ++Entry) {
+            Palette[Entry] = ((8 - Entry) * Max + (Entry - 1) * Min + 3) / 7;
+        }
+
+        for (unsigned Pixel = 0; Pixel < 16; ++Pixel) {
+            unsigned Best = 0;
+            int BestDistance = 256;
+            for (unsigned Entry = 0; Entry < 8; ++Entry) {
+                int Distance = std::abs(block[Pixel * stride] - Palette[Entry]);
+                if (Distance < BestDistance) {
+                    BestDistance = Distance;
+                    Best = Entry;
+                }
+            }
+            Indices |= (uint64_t)Best << (Pixel * 3);
+        }
+    }
+
+    dst[0] = Max;
+    dst[1] = Min;
+    for (unsigned Byte = 0; Byte < 6; ++Byte) {
+        dst[2 + Byte] = (Indices >> (Byte * 8)) & 0xFF;
+    }
+}
+
+std::string
+CompressedTexture::GetPath(const std::string& sourcePath, unsigned size) {
+    return size ? sourcePath + "." + std::to_string(size) + COMPRESSED_TEXTURE_EXTENSION : sourcePath + COMPRESSED_TEXTURE_EXTENSION;
+}
+
+bool
+CompressedTexture::IsSupported(ETextureBlockFormat format) {
+    switch (format) {
+    case TEXTURE_BLOCK_BC1:
+    case TEXTURE_BLOCK_BC3: return GLEW_EXT_texture_compression_s3tc;
+    // NOTE(Jovan): RGTC is core since 3.0
+    case TEXTURE_BLOCK_BC4: return true;
+    default: return false;
+    }
+}
+
+GLenum
+CompressedTexture::GetInternalFormat(ETextureBlockFormat format) {
+    switch (format) {
+    case TEXTURE_BLOCK_BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case TEXTURE_BLOCK_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case TEXTURE_BLOCK_BC4: return GL_COMPRESSED_RED_RGTC1;
+    default: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    }
+}
+
+unsigned
+CompressedTexture::GetBlockSize(ETextureBlockFormat format) {
+    return format == TEXTURE_BLOCK_BC3 ? 16 : 8;
+}
+
+bool
+CompressedTexture::Read(const std::string& sourcePath, CompressedImage& image, unsigned size) {
+    std::string Path = GetPath(sourcePath, size);
+    std::ifstream In(Path, std::ios::binary);
+    if (!In) {
+        return false;
+    }
+
+    CompressedTextureHeader Header;
+    if (!In.read((char*)&Header, sizeof(Header))
+        || memcmp(Header.Magic, COMPRESSED_TEXTURE_MAGIC, sizeof(COMPRESSED_TEXTURE_MAGIC))
+        || Header.Version != COMPRESSED_TEXTURE_VERSION
+        || Header.Format >= TEXTURE_BLOCK_FORMAT_COUNT
+        || !Header.LevelCount || Header.LevelCount > COMPRESSED_TEXTURE_MAX_LEVELS
+        || (size && (Header.Width != size || Header.Height != size))) {
+        return false;
+    }
+
+    uint64_t SourceSize;
+    int64_t SourceModifiedTime;
+    if (!MappedFile::GetStamp(sourcePath, SourceSize, SourceModifiedTime)
+        || Header.SourceSize != SourceSize
+        || Header.SourceModifiedTime != SourceModifiedTime) {
+        std::cout << Path << " is stale, loading " << sourcePath << std::endl;
+        return false;
+    }
+
+    image.Format = (ETextureBlockFormat)Header.Format;
+    if (!IsSupported(image.Format)) {
+        return false;
+    }
+
+    image.Levels.resize(Header.LevelCount);
+    if (!In.read((char*)image.Levels.data(), image.Levels.size() * sizeof(CompressedLevel))) {
+        return false;
+    }
+
+    // NOTE(Jovan): Levels have to be exactly the size their blocks need, a GL error later
+    // would be much harder to track down
+    size_t DataSize = 0;
+    unsigned BlockSize = GetBlockSize(image.Format);
+    for (unsigned LevelIdx = 0; LevelIdx < image.Levels.size(); ++LevelIdx) {
+        const CompressedLevel& Level = image.Levels[LevelIdx];
+        size_t Expected = (size_t)((Level.Width + 3) / 4) * ((Level.Height + 3) / 4) * BlockSize;
+        if (Level.Size != Expected || Level.Offset != DataSize) {
+            return false;
+        }
+        DataSize += Level.Size;
+    }
+
+    image.Data.resize(DataSize);
+    return (bool)In.read((char*)image.Data.data(), DataSize);
+}
+
+unsigned
+CompressedTexture::CreateTexture(const CompressedImage& image, const unsigned char* data) {
+    GLenum InternalFormat = GetInternalFormat(image.Format);
+    unsigned Id;
+    glGenTextures(1, &Id);
+    glBindTexture(GL_TEXTURE_2D, Id);
+    for (unsigned LevelIdx = 0; LevelIdx < image.Levels.size(); ++LevelIdx) {
+        const CompressedLevel& Level = image.Levels[LevelIdx];
+        glCompressedTexImage2D(GL_TEXTURE_2D, LevelIdx, InternalFormat, Level.Width, Level.Height, 0, Level.Size, data + Level.Offset);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.Levels.size() - 1);
+    Texture::SetDefaultParameters();
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return Id;
+}
+
+bool
+CompressedTexture::Compress(const std::string& sourcePath, unsigned size) {
+    int Width;
+    int Height;
+    int Channels;
+    unsigned char* Pixels = stbi_load(sourcePath.c_str(), &Width, &Height, &Channels, 4);
+    if (!Pixels) {
+        std::cerr << "[Err] Failed to load " << sourcePath << " for compression" << std::endl;
+        return false;
+    }
+    // NOTE(Jovan): Flipped like every loaded image, blocks are stored in the order GL expects
+    ImageOps::FlipVertical(Pixels, (size_t)Width * 4, Height);
+    // NOTE(Jovan): Built offline, so it can afford the sharper filter. Single channel images
+    // are usually data rather than color and are filtered as is
+    MipChain Mips;
+    ImageOps::BuildMipChain(Pixels, Width, Height, 4, MIP_FILTER_KAISER, Channels != 1, Mips);
+    stbi_image_free(Pixels);
+    if (size) {
+        MipChain Resampled;
+        ImageOps::ResampleMipChain(Mips, size, MIP_FILTER_KAISER, Channels != 1, Resampled);
+        Mips = std::move(Resampled);
+    }
+    unsigned BaseWidth = Mips.Levels[0].Width;
+    unsigned BaseHeight = Mips.Levels[0].Height;
+
+    CompressedImage Image;
+    Image.Format = TEXTURE_BLOCK_BC1;
+    if (Channels == 1) {
+        Image.Format = TEXTURE_BLOCK_BC4;
+    } else if (Channels == 2 || Channels == 4) {
+        for (size_t Pixel = 0; Pixel < (size_t)BaseWidth * BaseHeight; ++Pixel) {
+            if (Mips.Data[Pixel * 4 + 3] != 255) {
+                Image.Format = TEXTURE_BLOCK_BC3;
+                break;
+            }
+        }
+    }
+
+    unsigned BlockSize = GetBlockSize(Image.Format);
+    for (size_t LevelIdx = 0; LevelIdx < Mips.Levels.size(); ++LevelIdx) {
+        const ImageLevel& Level = Mips.Levels[LevelIdx];
+        CompressedLevel Info;
+        Info.Offset = (uint32_t)Image.Data.size();
+        Info.Width = Level.Width;
+        Info.Height = Level.Height;
+        Info.Size = ((Level.Width + 3) / 4) * ((Level.Height + 3) / 4) * BlockSize;
+        Image.Data.resize(Image.Data.size() + Info.Size);
+        encodeLevel(Mips.Data.data() + Level.Offset, Level.Width, Level.Height, Image.Format, Image.Data.data() + Info.Offset);
+        Image.Levels.push_back(Info);
+    }
+
+    CompressedTextureHeader Header;
+    memcpy(Header.Magic, COMPRESSED_TEXTURE_MAGIC, sizeof(COMPRESSED_TEXTURE_MAGIC));
+    Header.Version = COMPRESSED_TEXTURE_VERSION;
+    Header.Format = Image.Format;
+    Header.Width = BaseWidth;
+    Header.Height = BaseHeight;
+    Header.LevelCount = (uint32_t)Image.Levels.size();
+    if (!MappedFile::GetStamp(sourcePath, Header.SourceSize, Header.SourceModifiedTime)) {
+        return false;
+    }
+
+    // NOTE(Jovan): Written to a temporary file first so a crash mid-write never leaves
+    // a file that looks valid but is truncated
+    std::string Path = GetPath(sourcePath, size);
+    std::string TempPath = Path + ".tmp";
+    std::ofstream Out(TempPath, std::ios::binary | std::ios::trunc);
+    if (!Out) {
+        return false;
+    }
+    Out.write((const char*)&Header, sizeof(Header));
+    Out.write((const char*)Image.Levels.data(), Image.Levels.size() * sizeof(CompressedLevel));
+    Out.write((const char*)Image.Data.data(), Image.Data.size());
+    Out.close();
+    if (!Out) {
+        std::remove(TempPath.c_str());
+        return false;
+    }
+    std::remove(Path.c_str());
+    if (std::rename(TempPath.c_str(), Path.c_str()) != 0) {
+        std::remove(TempPath.c_str());
+        return false;
+    }
+
+    // NOTE(Jovan): Uncompressed size is what the source took up with its mips once loaded
+    const char* FormatNames[TEXTURE_BLOCK_FORMAT_COUNT] = { "BC1", "BC3", "BC4" };
+    size_t Uncompressed = (size_t)BaseWidth * BaseHeight * Channels * 4 / 3;
+    std::cout << "Compressed " << sourcePath << " " << BaseWidth << "x" << BaseHeight << " to " << FormatNames[Image.Format]
+        << ", " << Image.Levels.size() << " levels, " << Uncompressed / 1024 << "KB -> " << Image.Data.size() / 1024 << "KB" << std::endl;
+    return true;
+}
+
+void
+CompressedTexture::encodeLevel(const unsigned char* rgba, unsigned width, unsigned height, ETextureBlockFormat format, unsigned char* dst) {
+    unsigned BlocksX = (width + 3) / 4;
+    unsigned BlocksY = (height + 3) / 4;
+    unsigned BlockSize = GetBlockSize(format);
+    WorkerPool::Get().ParallelFor(BlocksY, [rgba, width, height, format, dst, BlocksX, BlockSize](unsigned blockY) {
+        unsigned char Block[16 * 4];
+        for (unsigned BlockX = 0; BlockX < BlocksX; ++BlockX) {
+            // NOTE(Jovan): Blocks past the edge repeat the last row and column
+            for (unsigned Y = 0; Y < 4; ++Y) {
+                unsigned SrcY = std::min(blockY * 4 + Y, height - 1);
+                for (unsigned X = 0; X < 4; ++X) {
+                    unsigned SrcX = std::min(BlockX * 4 + X, width - 1);
+                    memcpy(Block + (Y * 4 + X) * 4, rgba + ((size_t)SrcY * width + SrcX) * 4, 4);
+                }
+            }
+
+            unsigned char* Out = dst + ((size_t)blockY * BlocksX + BlockX) * BlockSize;
+            switch (format) {
+            case TEXTURE_BLOCK_BC1: encodeColorBlock(Block, Out); break;
+            case TEXTURE_BLOCK_BC3: {
+                encodeChannelBlock(Block + 3, 4, Out);
+                encodeColorBlock(Block, Out + 8);
+            } break;
+            case TEXTURE_BLOCK_BC4: encodeChannelBlock(Block, 4, Out); break;
+            default: break;
+            }
+        }
+    });
+}
@@ -0,0 +1,130 @@
+/**
+ * @file compressedtexture.hpp
+ * @author Jovan Ivosevic
+ * @brief Offline block compression of textures and loading of the compressed files
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// NOTE(Jovan): Bump whenever the layout of the file or the encoders change
+#define COMPRESSED_TEXTURE_VERSION 2
+#define COMPRESSED_TEXTURE_EXTENSION ".ctex"
+
+/**
+ * @brief GPU block formats. Every format encodes 4x4 pixel blocks
+ *
+ */
+enum ETextureBlockFormat {
+    // NOTE(Jovan): Opaque RGB, 8 bytes per block
+    TEXTURE_BLOCK_BC1 = 0,
+    // NOTE(Jovan): RGB with separate alpha, 16 bytes per block
+    TEXTURE_BLOCK_BC3,
+    // NOTE(Jovan): Single channel, 8 bytes per block
+    TEXTURE_BLOCK_BC4,
+
+    TEXTURE_BLOCK_FORMAT_COUNT
+};
+
+struct CompressedLevel {
+    // NOTE(Jovan): Relative to the start of CompressedImage::Data
+    uint32_t Offset;
+    uint32_t Size;
+    uint32_t Width;
+    uint32_t Height;
+};
+
+/**
+ * @brief Block compressed image with its whole mip chain, levels stored back to back
+ *
+ */
+struct CompressedImage {
+    ETextureBlockFormat Format;
+    std::vector<CompressedLevel> Levels;
+    std::vector<unsigned char> Data;
+};
+
+/**
+ * @brief Converts images into block compressed files stored next to the source image as
+ * <image><COMPRESSED_TEXTURE_EXTENSION>, with a precomputed mip chain. Copies resampled to
+ * the size of a texture array layer (see TextureCache::LoadLayerAsync) are stored as
+ * <image>.<size><COMPRESSED_TEXTURE_EXTENSION>:
+ *
+ *  CompressedTextureHeader, LevelCount x CompressedLevel, level blocks
+ *
+ * Files are produced by running with --compress-textures. Loading prefers a compressed file
+ * over its source when its version and the source's size and modification time match and
+ * the driver supports the format, otherwise the source image is decoded as before
+ */
+class CompressedTexture {
+public:
+    /**
+     * @brief Returns compressed file path for the given source image
+     *
+     * @param sourcePath - Source image path
+     * @param size - Width and height of the resampled copy, 0 for the native size
+     *
+     * @returns Compressed file path
+     */
+    static std::string GetPath(const std::string& sourcePath, unsigned size = 0);
+
+    /**
+     * @brief Returns whether the driver can sample the format
+     *
+     */
+    static bool IsSupported(ETextureBlockFormat format);
+
+    static GLenum GetInternalFormat(ETextureBlockFormat format);
+
+    /**
+     * @brief Returns bytes per 4x4 block
+     *
+     */
+    static unsigned GetBlockSize(ETextureBlockFormat format);
+
+    /**
+     * @brief Reads the compressed file of a source image. Makes no GL calls, so it can run
+     * on a worker thread
+     *
+     * @param sourcePath - Source image path
+     * @param image - Output compressed image
+     * @param size - Width and height of the resampled copy, 0 for the native size
+     *
+     * @returns true - Success, false - File is missing, stale or its format isn't supported
+     */
+    static bool Read(const std::string& sourcePath, CompressedImage& image, unsigned size = 0);
+
+    /**
+     * @brief Creates a texture from compressed levels
+     *
+     * @param image - Compressed image
+     * @param data - Level data, or 0 to upload from the bound pixel unpack buffer which
+     * holds it at offset 0
+     *
+     * @returns TextureID
+     */
+    static unsigned CreateTexture(const CompressedImage& image, const unsigned char* data);
+
+    /**
+     * @brief Decodes a source image, builds its mip chain, encodes every level and writes the
+     * compressed file. Images with alpha become BC3, single channel ones BC4, others BC1
+     *
+     * @param sourcePath - Source image path
+     * @param size - Width and height to resample to first, 0 to keep the native size
+     *
+     * @returns true - Success, false - Failure
+     */
+    static bool Compress(const std::string& sourcePath, unsigned size = 0);
+
+private:
+    static void encodeLevel(const unsigned char* rgba, unsigned width, unsigned height, ETextureBlockFormat format, unsigned char* dst);
+};
@@ -0,0 +1,115 @@
+#include "culling.hpp"
+
+Frustum::Frustum() {
+    for (int Plane = 0; Plane < 6; ++Plane) {
+        mPlanes[Plane] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+}
+
+void
+Frustum::Update(const glm::mat4& viewProjection) {
+    // NOTE(Jovan): GLM matrices are column major, so row i is m[0][i], m[1][i], ...
+    glm::vec4 Rows[4];
+    for (int Row = 0; Row < 4; ++Row) {
+        Rows[Row] = glm::vec4(viewProjection[0][Row], viewProjection[1][Row], viewProjection[2][Row], viewProjection[3][Row]);
+    }
+
+    mPlanes[0] = Rows[3] + Rows[0];
+    mPlanes[1] = Rows[3] - Rows[0];
+    mPlanes[2] = Rows[3] + Rows[1];
+    mPlanes[3] = Rows[3] - Rows[1];
+    mPlanes[4] = Rows[3] + Rows[2];
+    mPlanes[5] = Rows[3] - Rows[2];
+    for (int Plane = 0; Plane < 6; ++Plane) {
+        float Length = glm::length(glm::vec3(mPlanes[Plane]));
+        if (Length > 0.0f) {
+            mPlanes[Plane] /= Length;
+        }
+    }
+}
+
+bool
+Frustum::Intersects(const BoundingSphere& sphere) const {
+    bool Contained;
+    return Intersects(sphere, Contained);
+}
+
+bool
+Frustum::Intersects(const BoundingSphere& sphere, bool& contained) const {
+    contained = true;
+    for (int Plane = 0; Plane < 6; ++Plane) {
+        float Distance = glm::dot(glm::vec3(mPlanes[Plane]), sphere.Center) + mPlanes[Plane].w;
+        if (Distance < -sphere.Radius) {
+            return false;
+        }
+        if (Distance < sphere.Radius) {
+            contained = false;
+        }
+    }
+    return true;
+}
+
+bool
+Frustum::Intersects(const AABB& box) const {
+    for (int Plane = 0; Plane < 6; ++Plane) {
+        // NOTE(Jovan): Corner farthest along the plane normal. If even that one is
+        // behind the plane, the whole box is
+        glm::vec3 Normal(mPlanes[Plane]);
+        glm::vec3 Positive(Normal.x >= 0.0f ? box.Max.x : box.Min.x,
+                           Normal.y >= 0.0f ? box.Max.y : box.Min.y,
+                           Normal.z >= 0.0f ? box.Max.z : box.Min.z);
+        if (glm::dot(Normal, Positive) + mPlanes[Plane].w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Culler::Culler() {
+    mStats.Submitted = 0;
+    mStats.Culled = 0;
+}
+
+void
+Culler::BeginFrame(const glm::mat4& projection, const glm::mat4& view) {
+    mFrustum.Update(projection * view);
+    mStats.Submitted = 0;
+    mStats.Culled = 0;
+}
+
+bool
+Culler::IsVisible(const Bounds& bounds, const glm::mat4& model) {
+    return IsVisible(bounds.Transform(model));
+}
+
+bool
+Culler::Intersects(const Bounds& bounds) const {
+    // NOTE(Jovan): Both bound the same geometry, so a sphere fully inside leaves the box test
+    // nothing to cull
+    bool Contained;
+    if (!mFrustum.Intersects(bounds.Sphere, Contained)) {
+        return false;
+    }
+    return Contained || mFrustum.Intersects(bounds.Box);
+}
+
+void
+Culler::CountCulled(unsigned draws) {
+    mStats.Culled += draws;
+}
+
+bool
+Culler::IsVisible(const Bounds& bounds) {
+    bool Visible = Intersects(bounds);
+    if (Visible) {
+        ++mStats.Submitted;
+    } else {
+        ++mStats.Culled;
+    }
+    return Visible;
+}
+
+const CullingStats&
+Culler::GetStats() const {
+    return mStats;
+}
@@ -0,0 +1,124 @@
+/**
+ * @file culling.hpp
+ * @author Jovan Ivosevic
+ * @brief View frustum extraction and CPU frustum culling
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include "bounds.hpp"
+
+/**
+ * @brief Six planes of a view frustum in world space, normals pointing inwards
+ *
+ */
+class Frustum {
+public:
+    Frustum();
+
+    /**
+     * @brief Extracts planes from a combined matrix (Gribb/Hartmann)
+     *
+     * @param viewProjection - Projection * View
+     */
+    void Update(const glm::mat4& viewProjection);
+
+    /**
+     * @brief Tests a sphere against the frustum, conservatively
+     *
+     * @returns true - Sphere is at least partly inside
+     */
+    bool Intersects(const BoundingSphere& sphere) const;
+
+    /**
+     * @brief Same as Intersects, and reports whether the sphere is fully inside
+     *
+     * @param sphere - Sphere
+     * @param contained - Output, true if the sphere is inside every plane
+     *
+     * @returns true - Sphere is at least partly inside
+     */
+    bool Intersects(const BoundingSphere& sphere, bool& contained) const;
+
+    /**
+     * @brief Tests a box against the frustum, conservatively
+     *
+     * @returns true - Box is at least partly inside
+     */
+    bool Intersects(const AABB& box) const;
+
+private:
+    glm::vec4 mPlanes[6];
+};
+
+struct CullingStats {
+    unsigned Submitted;
+    unsigned Culled;
+};
+
+/**
+ * @brief Per frame culling pass. Tests bounds against the current frustum and counts
+ * what got submitted and what got culled
+ *
+ */
+class Culler {
+public:
+    Culler();
+
+    /**
+     * @brief Extracts the frame's frustum and resets the counters
+     *
+     * @param projection - Projection matrix
+     * @param view - View matrix
+     */
+    void BeginFrame(const glm::mat4& projection, const glm::mat4& view);
+
+    /**
+     * @brief Tests object space bounds placed with a model matrix. The sphere is tested
+     * first and the box only if the sphere straddles the frustum
+     *
+     * @param bounds - Object space bounds
+     * @param model - Model matrix
+     *
+     * @returns true - Object is visible and counted as submitted, false - Counted as culled
+     */
+    bool IsVisible(const Bounds& bounds, const glm::mat4& model);
+
+    /**
+     * @brief Tests world space bounds, same as IsVisible with an identity model matrix
+     *
+     * @param bounds - World space bounds
+     *
+     * @returns true - Object is visible and counted as submitted, false - Counted as culled
+     */
+    bool IsVisible(const Bounds& bounds);
+
+    /**
+     * @brief Tests world space bounds without counting anything. Used for coarse tests,
+     * e.g. a whole model before its meshes
+     *
+     * @param bounds - World space bounds
+     *
+     * @returns true - Bounds are at least partly inside the frustum
+     */
+    bool Intersects(const Bounds& bounds) const;
+
+    /**
+     * @brief Counts draws skipped by a coarse test as culled
+     *
+     * @param draws - Number of draws
+     */
+    void CountCulled(unsigned draws);
+
+    const CullingStats& GetStats() const;
+
+private:
+    Frustum mFrustum;
+    CullingStats mStats;
+};
@@ -0,0 +1,346 @@
+#include "geometrybuffer.hpp"
+#include <iostream>
+#include <utility>
+
+unsigned GeometryBuffer::sBoundVAO = 0;
+
+RangeAllocator::RangeAllocator() {
+    mCapacity = 0;
+}
+
+unsigned
+RangeAllocator::GetCapacity() const {
+    return mCapacity;
+}
+
+bool
+RangeAllocator::Allocate(unsigned size, unsigned alignment, unsigned& offset) {
+    for (std::map<unsigned, unsigned>::iterator Block = mFree.begin(); Block != mFree.end(); ++Block) {
+        unsigned BlockStart = Block->first;
+        unsigned BlockEnd = Block->first + Block->second;
+        unsigned Aligned = (BlockStart + alignment - 1) & ~(alignment - 1);
+        if (Aligned > BlockEnd || BlockEnd - Aligned < size) {
+            continue;
+        }
+
+        mFree.erase(Block);
+        if (Aligned > BlockStart) {
+            mFree[BlockStart] = Aligned - BlockStart;
+        }
+        if (Aligned + size < BlockEnd) {
+            mFree[Aligned + size] = BlockEnd - (Aligned + size);
+        }
+        offset = Aligned;
+        return true;
+    }
+
+    return false;
+}
+
+void
+RangeAllocator::Free(unsigned offset, unsigned size) {
+    if (size) {
+        insertFree(offset, size);
+    }
+}
+
+void
+RangeAllocator::Grow(unsigned capacity) {
+    if (capacity > mCapacity) {
+        unsigned OldCapacity = mCapacity;
+        mCapacity = capacity;
+        insertFree(OldCapacity, capacity - OldCapacity);
+    }
+}
+
+void
+RangeAllocator::insertFree(unsigned offset, unsigned size) {
+    std::map<unsigned, unsigned>::iterator Next = mFree.lower_bound(offset);
+    if (Next != mFree.end() && offset + size == Next->first) {
+        size += Next->second;
+        Next = mFree.erase(Next);
+    }
+    if (Next != mFree.begin()) {
+        std::map<unsigned, unsigned>::iterator Prev = Next;
+        --Prev;
+        if (Prev->first + Prev->second == offset) {
+            Prev->second += size;
+            return;
+        }
+    }
+    mFree[offset] = size;
+}
+
+GeometryBuffer::GeometryBuffer() {
+    mFormat = VERTEX_FORMAT_FLOAT;
+    mInstanceCapacity = 0;
+}
+
+GeometryBuffer&
+GeometryBuffer::Get(EVertexFormat format) {
+    static GeometryBuffer Buffers[VERTEX_FORMAT_COUNT];
+    GeometryBuffer& Buffer = Buffers[format];
+    Buffer.mFormat = format;
+    return Buffer;
+}
+
+void
+GeometryBuffer::Bind(EVertexFormat format) {
+    GeometryBuffer& Buffer = Get(format);
+    if (!Buffer.mVAO.GetId()) {
+        Buffer.create();
+    }
+    if (sBoundVAO != Buffer.mVAO.GetId()) {
+        glBindVertexArray(Buffer.mVAO.GetId());
+        sBoundVAO = Buffer.mVAO.GetId();
+    }
+}
+
+void
+GeometryBuffer::Unbind() {
+    glBindVertexArray(0);
+    sBoundVAO = 0;
+}
+
+void
+GeometryBuffer::ReleaseAll() {
+    for (unsigned Format = 0; Format < VERTEX_FORMAT_COUNT; ++Format) {
+        Get((EVertexFormat)Format).release();
+    }
+    Unbind();
+}
+
+void
+GeometryBuffer::UploadInstances(EVertexFormat format, const InstanceTransform* instances, unsigned count) {
+    GeometryBuffer& Buffer = Get(format);
+    if (!Buffer.mVAO.GetId()) {
+        Buffer.create();
+    }
+
+    // NOTE(Jovan): Storage is respecified on the same buffer name, so the VAO's
+    // attribute pointers stay valid and need no setup
+    while (Buffer.mInstanceCapacity < count) {
+        Buffer.mInstanceCapacity *= 2;
+    }
+    size_t Size = (size_t)Buffer.mInstanceCapacity * sizeof(InstanceTransform);
+    glBindBuffer(GL_ARRAY_BUFFER, Buffer.mInstanceVBO.GetId());
+    glBufferData(GL_ARRAY_BUFFER, Size, 0, GL_STREAM_DRAW);
+    if (count) {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (size_t)count * sizeof(InstanceTransform), instances);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * @brief Creates a new buffer object
+ *
+ * @returns Buffer object name
+ */
+static unsigned
+genBuffer() {
+    unsigned Buffer;
+    glGenBuffers(1, &Buffer);
+    return Buffer;
+}
+
+void
+GeometryBuffer::create() {
+    unsigned VAO;
+    glGenVertexArrays(1, &VAO);
+    mVAO.Reset(VAO);
+    mVBO.Reset(genBuffer());
+    mEBO.Reset(genBuffer());
+    mInstanceVBO.Reset(genBuffer());
+
+    glBindBuffer(GL_ARRAY_BUFFER, mVBO.GetId());
+    glBufferData(GL_ARRAY_BUFFER, (size_t)GEOMETRY_BUFFER_INITIAL_VERTICES * VertexFormat::GetStride(mFormat), 0, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    mVertices.Grow(GEOMETRY_BUFFER_INITIAL_VERTICES);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mEBO.GetId());
+    glBufferData(GL_COPY_WRITE_BUFFER, GEOMETRY_BUFFER_INITIAL_INDEX_BYTES, 0, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    mIndices.Grow(GEOMETRY_BUFFER_INITIAL_INDEX_BYTES);
+
+    // NOTE(Jovan): Never left empty, non-instanced draws still fetch instance 0
+    glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO.GetId());
+    glBufferData(GL_ARRAY_BUFFER, GEOMETRY_BUFFER_INITIAL_INSTANCES * sizeof(InstanceTransform), 0, GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    mInstanceCapacity = GEOMETRY_BUFFER_INITIAL_INSTANCES;
+
+    setupVAO();
+}
+
+void
+GeometryBuffer::release() {
+    mVAO.Reset();
+    mVBO.Reset();
+    mEBO.Reset();
+    mInstanceVBO.Reset();
+    mInstanceCapacity = 0;
+    mVertices = RangeAllocator();
+    mIndices = RangeAllocator();
+}
+
+void
+GeometryBuffer::setupVAO() {
+    // NOTE(Jovan): Attribute pointers and the element buffer are VAO state,
+    // so they are set once here and after every buffer reallocation
+    glBindVertexArray(mVAO.GetId());
+    sBoundVAO = mVAO.GetId();
+    glBindBuffer(GL_ARRAY_BUFFER, mVBO.GetId());
+    VertexFormat::SetupAttributes(mFormat);
+    glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO.GetId());
+    VertexFormat::SetupInstanceAttributes();
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO.GetId());
+}
+
+/**
+ * @brief Reallocates a buffer object with a larger size and copies the old contents over on the GPU
+ *
+ * @param buffer - Buffer object, replaced with the new one and the old one deleted
+ * @param oldSize - Old size in bytes
+ * @param newSize - New size in bytes
+ */
+static void
+reallocateBuffer(BufferHandle& buffer, size_t oldSize, size_t newSize) {
+    BufferHandle NewBuffer(genBuffer());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, NewBuffer.GetId());
+    glBufferData(GL_COPY_WRITE_BUFFER, newSize, 0, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer.GetId());
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    buffer = std::move(NewBuffer);
+}
+
+void
+GeometryBuffer::growVertices(unsigned minimumVertices) {
+    unsigned OldCapacity = mVertices.GetCapacity();
+    unsigned NewCapacity = OldCapacity * 2;
+    while (NewCapacity < OldCapacity + minimumVertices) {
+        NewCapacity *= 2;
+    }
+
+    unsigned Stride = VertexFormat::GetStride(mFormat);
+    reallocateBuffer(mVBO, (size_t)OldCapacity * Stride, (size_t)NewCapacity * Stride);
+    mVertices.Grow(NewCapacity);
+    setupVAO();
+    std::cout << "Geometry buffer " << VertexFormat::GetName(mFormat) << " grown to " << NewCapacity << " vertices" << std::endl;
+}
+
+void
+GeometryBuffer::growIndices(unsigned minimumBytes) {
+    unsigned OldCapacity = mIndices.GetCapacity();
+    unsigned NewCapacity = OldCapacity * 2;
+    while (NewCapacity < OldCapacity + minimumBytes + GEOMETRY_BUFFER_INDEX_ALIGNMENT) {
+        NewCapacity *= 2;
+    }
+
+    reallocateBuffer(mEBO, OldCapacity, NewCapacity);
+    mIndices.Grow(NewCapacity);
+    setupVAO();
+    std::cout << "Geometry buffer " << VertexFormat::GetName(mFormat) << " grown to " << NewCapacity << " index bytes" << std::endl;
+}
+
+bool
+GeometryBuffer::Allocate(const unsigned char* vertexData, unsigned vertexCount, const unsigned char* indexData, unsigned indexBytes, GeometryRange& range) {
+    if (!mVAO.GetId()) {
+        create();
+    }
+
+    range.VertexCount = vertexCount;
+    range.IndexBytes = indexBytes;
+    range.BaseVertex = 0;
+    range.IndexOffset = 0;
+    if (vertexCount && !mVertices.Allocate(vertexCount, 1, range.BaseVertex)) {
+        growVertices(vertexCount);
+        if (!mVertices.Allocate(vertexCount, 1, range.BaseVertex)) {
+            std::cerr << "[Err] Failed to allocate " << vertexCount << " vertices in geometry buffer" << std::endl;
+            return false;
+        }
+    }
+    if (indexBytes && !mIndices.Allocate(indexBytes, GEOMETRY_BUFFER_INDEX_ALIGNMENT, range.IndexOffset)) {
+        growIndices(indexBytes);
+        if (!mIndices.Allocate(indexBytes, GEOMETRY_BUFFER_INDEX_ALIGNMENT, range.IndexOffset)) {
+            std::cerr << "[Err] Failed to allocate " << indexBytes << " index bytes in geometry buffer" << std::endl;
+            mVertices.Free(range.BaseVertex, vertexCount);
+            return false;
+        }
+    }
+
+    unsigned Stride = VertexFormat::GetStride(mFormat);
+    glBindBuffer(GL_ARRAY_BUFFER, mVBO.GetId());
+    glBufferSubData(GL_ARRAY_BUFFER, (size_t)range.BaseVertex * Stride, (size_t)vertexCount * Stride, vertexData);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (indexBytes) {
+        // NOTE(Jovan): Uploaded through the copy target so the element buffer binding
+        // of whichever VAO happens to be bound is left alone
+        glBindBuffer(GL_COPY_WRITE_BUFFER, mEBO.GetId());
+        glBufferSubData(GL_COPY_WRITE_BUFFER, range.IndexOffset, indexBytes, indexData);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    return true;
+}
+
+void
+GeometryBuffer::Free(const GeometryRange& range) {
+    if (!mVAO.GetId()) {
+        return;
+    }
+    mVertices.Free(range.BaseVertex, range.VertexCount);
+    mIndices.Free(range.IndexOffset, range.IndexBytes);
+}
+
+GeometryAllocation::GeometryAllocation() {
+    mFormat = VERTEX_FORMAT_FLOAT;
+    mRange.BaseVertex = mRange.VertexCount = mRange.IndexOffset = mRange.IndexBytes = 0;
+    mValid = false;
+}
+
+GeometryAllocation::GeometryAllocation(EVertexFormat format, const unsigned char* vertexData, unsigned vertexCount, const unsigned char* indexData, unsigned indexBytes) : GeometryAllocation() {
+    mFormat = format;
+    mValid = GeometryBuffer::Get(format).Allocate(vertexData, vertexCount, indexData, indexBytes, mRange);
+}
+
+GeometryAllocation::~GeometryAllocation() {
+    Reset();
+}
+
+GeometryAllocation::GeometryAllocation(GeometryAllocation&& other) noexcept {
+    mFormat = other.mFormat;
+    mRange = other.mRange;
+    mValid = other.mValid;
+    other.mValid = false;
+}
+
+GeometryAllocation&
+GeometryAllocation::operator=(GeometryAllocation&& other) noexcept {
+    if (this != &other) {
+        Reset();
+        mFormat = other.mFormat;
+        mRange = other.mRange;
+        mValid = other.mValid;
+        other.mValid = false;
+    }
+    return *this;
+}
+
+bool
+GeometryAllocation::IsValid() const {
+    return mValid;
+}
+
+const GeometryRange&
+GeometryAllocation::GetRange() const {
+    return mRange;
+}
+
+void
+GeometryAllocation::Reset() {
+    if (mValid) {
+        GeometryBuffer::Get(mFormat).Free(mRange);
+        mValid = false;
+    }
+}
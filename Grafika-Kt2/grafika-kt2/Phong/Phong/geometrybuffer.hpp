@@ -0,0 +1,215 @@
+/**
+ * @file geometrybuffer.hpp
+ * @author Jovan Ivosevic
+ * @brief Shared vertex/index arenas, one VAO/VBO/EBO per vertex format
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+#include <map>
+#include "vertexformat.hpp"
+#include "glhandle.hpp"
+
+#define GEOMETRY_BUFFER_INITIAL_VERTICES (64 * 1024)
+#define GEOMETRY_BUFFER_INITIAL_INDEX_BYTES (256 * 1024)
+#define GEOMETRY_BUFFER_INITIAL_INSTANCES 256
+// NOTE(Jovan): Index ranges are aligned so both 16 and 32-bit indices can share the element buffer
+#define GEOMETRY_BUFFER_INDEX_ALIGNMENT 4
+
+/**
+ * @brief Part of a geometry buffer owned by a single mesh
+ *
+ */
+struct GeometryRange {
+    // NOTE(Jovan): Added to every index (glDrawElementsBaseVertex) or used as first vertex (glDrawArrays)
+    unsigned BaseVertex;
+    unsigned VertexCount;
+    // NOTE(Jovan): Byte offset of the mesh's indices in the shared element buffer
+    unsigned IndexOffset;
+    unsigned IndexBytes;
+};
+
+/**
+ * @brief First-fit free list allocator over an abstract [0, capacity) range.
+ * Neighbouring free blocks are merged on free
+ *
+ */
+class RangeAllocator {
+public:
+    RangeAllocator();
+
+    /**
+     * @brief Allocates size units aligned to alignment
+     *
+     * @param size - Number of units
+     * @param alignment - Offset alignment, power of two
+     * @param offset - Output offset of the allocated range
+     *
+     * @returns true - Success, false - No free block is large enough
+     */
+    bool Allocate(unsigned size, unsigned alignment, unsigned& offset);
+
+    /**
+     * @brief Returns a previously allocated range to the free list
+     *
+     * @param offset - Range offset
+     * @param size - Range size
+     */
+    void Free(unsigned offset, unsigned size);
+
+    /**
+     * @brief Extends the managed range, new space is added as a free block
+     *
+     * @param capacity - New capacity, must not be smaller than the current one
+     */
+    void Grow(unsigned capacity);
+
+    unsigned GetCapacity() const;
+
+private:
+    unsigned mCapacity;
+    // NOTE(Jovan): Free blocks, offset -> size
+    std::map<unsigned, unsigned> mFree;
+    void insertFree(unsigned offset, unsigned size);
+};
+
+/**
+ * @brief Global vertex/index arena for one vertex format. Meshes sub-allocate ranges
+ * from it instead of creating their own buffers, so all meshes of a format are drawn
+ * with a single VAO bound. Buffers are created lazily on first allocation and grow by
+ * doubling, copying the old contents on the GPU
+ *
+ */
+class GeometryBuffer {
+public:
+    /**
+     * @brief Returns the geometry buffer for the given vertex format
+     *
+     * @param format - Vertex format
+     *
+     * @returns Geometry buffer
+     */
+    static GeometryBuffer& Get(EVertexFormat format);
+
+    /**
+     * @brief Binds VAO of the given format's geometry buffer. Does nothing if it is
+     * already bound, so callers can bind freely before every draw
+     *
+     * @param format - Vertex format
+     */
+    static void Bind(EVertexFormat format);
+
+    /**
+     * @brief Unbinds any geometry buffer VAO
+     *
+     */
+    static void Unbind();
+
+    /**
+     * @brief Deletes GL objects of all geometry buffers. Must be called while the context is alive
+     *
+     */
+    static void ReleaseAll();
+
+    /**
+     * @brief Replaces the per instance transforms read by instanced draws of the given
+     * format. The old storage is orphaned, so draws still in flight keep their data and
+     * several batches can be uploaded and drawn one after another in a frame
+     *
+     * @param format - Vertex format
+     * @param instances - Instance transforms
+     * @param count - Number of instances
+     */
+    static void UploadInstances(EVertexFormat format, const InstanceTransform* instances, unsigned count);
+
+    /**
+     * @brief Allocates a range and uploads data into it
+     *
+     * @param vertexData - Vertices encoded in this buffer's format
+     * @param vertexCount - Number of vertices
+     * @param indexData - Encoded indices, may be null if indexBytes is 0
+     * @param indexBytes - Size of index data in bytes
+     * @param range - Output allocated range
+     *
+     * @returns true - Success, false - Failure
+     */
+    bool Allocate(const unsigned char* vertexData, unsigned vertexCount, const unsigned char* indexData, unsigned indexBytes, GeometryRange& range);
+
+    /**
+     * @brief Returns a range to the buffer. Its contents are left as is until reused.
+     * Does nothing if the buffer was released in the meantime
+     *
+     * @param range - Range returned by Allocate
+     */
+    void Free(const GeometryRange& range);
+
+private:
+    static unsigned sBoundVAO;
+    EVertexFormat mFormat;
+    VertexArrayHandle mVAO;
+    BufferHandle mVBO;
+    BufferHandle mEBO;
+    BufferHandle mInstanceVBO;
+    unsigned mInstanceCapacity;
+    RangeAllocator mVertices;
+    RangeAllocator mIndices;
+
+    GeometryBuffer();
+    GeometryBuffer(const GeometryBuffer&) = delete;
+    GeometryBuffer& operator=(const GeometryBuffer&) = delete;
+    void create();
+    void release();
+    void growVertices(unsigned minimumVertices);
+    void growIndices(unsigned minimumBytes);
+    void setupVAO();
+};
+
+/**
+ * @brief Owning geometry buffer range, returned to its buffer when destroyed. Move-only
+ * like the GL handles
+ *
+ */
+class GeometryAllocation {
+public:
+    GeometryAllocation();
+
+    /**
+     * @brief Ctor - allocates a range and uploads data into it, see GeometryBuffer::Allocate
+     *
+     * @param format - Vertex format, selects the geometry buffer
+     * @param vertexData - Vertices encoded in format
+     * @param vertexCount - Number of vertices
+     * @param indexData - Encoded indices, may be null if indexBytes is 0
+     * @param indexBytes - Size of index data in bytes
+     */
+    GeometryAllocation(EVertexFormat format, const unsigned char* vertexData, unsigned vertexCount, const unsigned char* indexData, unsigned indexBytes);
+    ~GeometryAllocation();
+    GeometryAllocation(GeometryAllocation&& other) noexcept;
+    GeometryAllocation& operator=(GeometryAllocation&& other) noexcept;
+    GeometryAllocation(const GeometryAllocation&) = delete;
+    GeometryAllocation& operator=(const GeometryAllocation&) = delete;
+
+    /**
+     * @brief Returns true if the range was allocated successfully and is still owned
+     *
+     */
+    bool IsValid() const;
+    const GeometryRange& GetRange() const;
+
+    /**
+     * @brief Returns the owned range to its buffer
+     *
+     */
+    void Reset();
+
+private:
+    EVertexFormat mFormat;
+    GeometryRange mRange;
+    bool mValid;
+};
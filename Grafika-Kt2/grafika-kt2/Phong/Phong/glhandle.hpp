@@ -0,0 +1,92 @@
+/**
+ * @file glhandle.hpp
+ * @author Jovan Ivosevic
+ * @brief Move-only owning wrappers around OpenGL object names
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+
+/**
+ * @brief Deleters for the object types wrapped by GLHandle
+ *
+ */
+class GLDelete {
+public:
+    static void Buffer(unsigned id) { glDeleteBuffers(1, &id); }
+    static void VertexArray(unsigned id) { glDeleteVertexArrays(1, &id); }
+    static void Texture(unsigned id) { glDeleteTextures(1, &id); }
+    static void Program(unsigned id) { glDeleteProgram(id); }
+    static void ShaderObject(unsigned id) { glDeleteShader(id); }
+    static void Framebuffer(unsigned id) { glDeleteFramebuffers(1, &id); }
+};
+
+/**
+ * @brief Owns a single OpenGL object and deletes it when destroyed. Can be moved but
+ * not copied, so every object has exactly one owner. Handles must be destroyed while
+ * the GL context is still current
+ *
+ */
+template <void (*Delete)(unsigned)>
+class GLHandle {
+public:
+    GLHandle() : mId(0) {}
+
+    /**
+     * @brief Ctor - takes ownership of an existing object
+     *
+     * @param id - Object name, 0 for none
+     */
+    explicit GLHandle(unsigned id) : mId(id) {}
+
+    ~GLHandle() {
+        Reset();
+    }
+
+    GLHandle(GLHandle&& other) noexcept : mId(other.mId) {
+        other.mId = 0;
+    }
+
+    GLHandle& operator=(GLHandle&& other) noexcept {
+        if (this != &other) {
+            Reset(other.mId);
+            other.mId = 0;
+        }
+        return *this;
+    }
+
+    GLHandle(const GLHandle&) = delete;
+    GLHandle& operator=(const GLHandle&) = delete;
+
+    unsigned GetId() const {
+        return mId;
+    }
+
+    /**
+     * @brief Deletes the owned object, if any, and takes ownership of another one
+     *
+     * @param id - New object name, 0 for none
+     */
+    void Reset(unsigned id = 0) {
+        if (mId && mId != id) {
+            Delete(mId);
+        }
+        mId = id;
+    }
+
+private:
+    unsigned mId;
+};
+
+typedef GLHandle<&GLDelete::Buffer> BufferHandle;
+typedef GLHandle<&GLDelete::VertexArray> VertexArrayHandle;
+typedef GLHandle<&GLDelete::Texture> TextureHandle;
+typedef GLHandle<&GLDelete::Program> ProgramHandle;
+typedef GLHandle<&GLDelete::ShaderObject> ShaderHandle;
+typedef GLHandle<&GLDelete::Framebuffer> FramebufferHandle;
@@ -0,0 +1,425 @@
+#include "imageops.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_SIMD 1
+#include <emmintrin.h>
+#endif
+// NOTE(Jovan): MSVC has no SSSE3 macro, AVX builds imply it
+#if defined(__SSSE3__) || defined(__AVX__)
+#define IMAGE_SIMD_SHUFFLE 1
+#include <tmmintrin.h>
+#endif
+
+// NOTE(Jovan): Kaiser filter radius, in output texels
+#define KAISER_RADIUS 1.5f
+#define KAISER_ALPHA 4.0f
+#define LINEAR_TO_SRGB_STEPS 4096
+
+/**
+ * @brief sRGB conversion tables, built once on first use
+ *
+ */
+struct SRGBTables {
+    float ToLinear[256];
+    unsigned char ToSRGB[LINEAR_TO_SRGB_STEPS];
+
+    SRGBTables() {
+        for (unsigned Value = 0; Value < 256; ++Value) {
+            float S = Value / 255.0f;
+            ToLinear[Value] = S <= 0.04045f ? S / 12.92f : std::pow((S + 0.055f) / 1.055f, 2.4f);
+        }
+        for (unsigned Step = 0; Step < LINEAR_TO_SRGB_STEPS; ++Step) {
+            float L = Step / (float)(LINEAR_TO_SRGB_STEPS - 1);
+            float S = L <= 0.0031308f ? L * 12.92f : 1.055f * std::pow(L, 1.0f / 2.4f) - 0.055f;
+            ToSRGB[Step] = (unsigned char)(S * 255.0f + 0.5f);
+        }
+    }
+};
+
+static const SRGBTables&
+getSRGBTables() {
+    static SRGBTables Tables;
+    return Tables;
+}
+
+/**
+ * @brief Source texels and weights of every output texel along one axis
+ *
+ */
+struct FilterTaps {
+    std::vector<unsigned> Count;
+    // NOTE(Jovan): Most source texels a single output texel is filtered from. Indices and
+    // Weights hold this many entries per output texel
+    unsigned Stride;
+    std::vector<unsigned> Indices;
+    std::vector<float> Weights;
+};
+
+/**
+ * @brief Zeroth order modified Bessel function of the first kind, used by the Kaiser window
+ *
+ */
+static float
+besselI0(float x) {
+    float Sum = 1.0f;
+    float Term = 1.0f;
+    for (unsigned K = 1; K < 16; ++K) {
+        Term *= (x * 0.5f / K) * (x * 0.5f / K);
+        Sum += Term;
+    }
+    return Sum;
+}
+
+/**
+ * @brief Kaiser windowed sinc
+ *
+ * @param x - Distance in output texels
+ *
+ * @returns Unnormalized weight
+ */
+static float
+kaiser(float x) {
+    float T = x / KAISER_RADIUS;
+    if (T <= -1.0f || T >= 1.0f) {
+        return 0.0f;
+    }
+    float Sinc = std::fabs(x) < 1e-5f ? 1.0f : std::sin(3.14159265f * x) / (3.14159265f * x);
+    return Sinc * besselI0(KAISER_ALPHA * std::sqrt(1.0f - T * T)) / besselI0(KAISER_ALPHA);
+}
+
+/**
+ * @brief Computes filter taps for resampling one axis
+ *
+ * @param srcSize - Source texels
+ * @param dstSize - Output texels
+ * @param filter - Filter
+ * @param taps - Output taps
+ */
+static void
+buildTaps(unsigned srcSize, unsigned dstSize, EMipFilter filter, FilterTaps& taps) {
+    float Scale = srcSize / (float)dstSize;
+    // NOTE(Jovan): Filters are never narrower than a source texel, so upscaling interpolates
+    float Width = std::max(Scale, 1.0f);
+    // NOTE(Jovan): Sized from the widest footprint so large downscales are never truncated
+    float MaxRadius = filter == MIP_FILTER_BOX ? 0.5f * Scale : KAISER_RADIUS * Width;
+    taps.Stride = (unsigned)std::ceil(2.0f * MaxRadius) + 2;
+    taps.Count.assign(dstSize, 0);
+    taps.Indices.assign((size_t)dstSize * taps.Stride, 0);
+    taps.Weights.assign((size_t)dstSize * taps.Stride, 0.0f);
+    for (unsigned Dst = 0; Dst < dstSize; ++Dst) {
+        unsigned* Indices = &taps.Indices[(size_t)Dst * taps.Stride];
+        float* Weights = &taps.Weights[(size_t)Dst * taps.Stride];
+        unsigned Count = 0;
+        float Total = 0.0f;
+        float Start = Dst * Scale;
+        float End = (Dst + 1) * Scale;
+        float Center = (Dst + 0.5f) * Scale;
+        int First = (int)std::floor(Center - MaxRadius);
+        int Last = (int)std::ceil(Center + MaxRadius);
+        for (int Src = First; Src <= Last && Count < taps.Stride; ++Src) {
+            float Weight;
+            if (filter == MIP_FILTER_BOX) {
+                // NOTE(Jovan): Texel coverage, so odd sizes blend in the leftover texel
+                Weight = std::min(End, Src + 1.0f) - std::max(Start, (float)Src);
+            } else {
+                Weight = kaiser((Src + 0.5f - Center) / Width);
+            }
+            if (Weight == 0.0f || (filter == MIP_FILTER_BOX && Weight < 0.0f)) {
+                continue;
+            }
+            // NOTE(Jovan): Edges are clamped
+            Indices[Count] = (unsigned)std::min(std::max(Src, 0), (int)srcSize - 1);
+            Weights[Count] = Weight;
+            Total += Weight;
+            ++Count;
+        }
+        for (unsigned Tap = 0; Tap < Count; ++Tap) {
+            Weights[Tap] /= Total;
+        }
+        taps.Count[Dst] = Count;
+    }
+}
+
+/**
+ * @brief Adds a weighted row to another
+ *
+ * @param dst - Accumulated row
+ * @param src - Source row
+ * @param weight - Weight of src
+ * @param count - Number of floats
+ */
+static void
+accumulateRow(float* dst, const float* src, float weight, size_t count) {
+    size_t Idx = 0;
+#ifdef IMAGE_SIMD
+    __m128 Weight = _mm_set1_ps(weight);
+    for (; Idx + 4 <= count; Idx += 4) {
+        _mm_storeu_ps(dst + Idx, _mm_add_ps(_mm_loadu_ps(dst + Idx), _mm_mul_ps(_mm_loadu_ps(src + Idx), Weight)));
+    }
+#endif
+    for (; Idx < count; ++Idx) {
+        dst[Idx] += src[Idx] * weight;
+    }
+}
+
+/**
+ * @brief Resamples rows horizontally
+ *
+ * @param src - Source rows
+ * @param srcWidth - Source width
+ * @param dst - Output rows
+ * @param dstWidth - Output width
+ * @param rows - Number of rows
+ * @param channels - Channels per pixel
+ * @param taps - Horizontal taps
+ */
+static void
+filterColumns(const float* src, unsigned srcWidth, float* dst, unsigned dstWidth, unsigned rows, unsigned channels, const FilterTaps& taps) {
+    for (unsigned Row = 0; Row < rows; ++Row) {
+        const float* SrcRow = src + (size_t)Row * srcWidth * channels;
+        float* DstRow = dst + (size_t)Row * dstWidth * channels;
+        for (unsigned X = 0; X < dstWidth; ++X) {
+            const unsigned* Indices = &taps.Indices[(size_t)X * taps.Stride];
+            const float* Weights = &taps.Weights[(size_t)X * taps.Stride];
+#ifdef IMAGE_SIMD
+            // NOTE(Jovan): A whole RGBA pixel per register
+            if (channels == 4) {
+                __m128 Sum = _mm_setzero_ps();
+                for (unsigned Tap = 0; Tap < taps.Count[X]; ++Tap) {
+                    Sum = _mm_add_ps(Sum, _mm_mul_ps(_mm_loadu_ps(SrcRow + Indices[Tap] * 4), _mm_set1_ps(Weights[Tap])));
+                }
+                _mm_storeu_ps(DstRow + X * 4, Sum);
+                continue;
+            }
+#endif
+            for (unsigned Channel = 0; Channel < channels; ++Channel) {
+                float Sum = 0.0f;
+                for (unsigned Tap = 0; Tap < taps.Count[X]; ++Tap) {
+                    Sum += SrcRow[Indices[Tap] * channels + Channel] * Weights[Tap];
+                }
+                DstRow[X * channels + Channel] = Sum;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Resamples a linear image
+ *
+ * @param src - Source pixels
+ * @param width - Source width
+ * @param height - Source height
+ * @param channels - Channels per pixel
+ * @param dstWidth - Output width
+ * @param dstHeight - Output height
+ * @param filter - Filter
+ * @param rows - Scratch space for the vertical pass
+ * @param dst - Output pixels
+ */
+static void
+resample(const std::vector<float>& src, unsigned width, unsigned height, unsigned channels, unsigned dstWidth, unsigned dstHeight, EMipFilter filter, std::vector<float>& rows, std::vector<float>& dst) {
+    FilterTaps VerticalTaps;
+    FilterTaps HorizontalTaps;
+    buildTaps(height, dstHeight, filter, VerticalTaps);
+    buildTaps(width, dstWidth, filter, HorizontalTaps);
+
+    // NOTE(Jovan): Vertical pass first, its rows are contiguous and vectorize fully
+    size_t RowSize = (size_t)width * channels;
+    rows.assign(RowSize * dstHeight, 0.0f);
+    for (unsigned Y = 0; Y < dstHeight; ++Y) {
+        for (unsigned Tap = 0; Tap < VerticalTaps.Count[Y]; ++Tap) {
+            unsigned Source = VerticalTaps.Indices[(size_t)Y * VerticalTaps.Stride + Tap];
+            float Weight = VerticalTaps.Weights[(size_t)Y * VerticalTaps.Stride + Tap];
+            accumulateRow(&rows[RowSize * Y], &src[RowSize * Source], Weight, RowSize);
+        }
+    }
+
+    dst.resize((size_t)dstWidth * dstHeight * channels);
+    filterColumns(rows.data(), width, dst.data(), dstWidth, dstHeight, channels, HorizontalTaps);
+}
+
+/**
+ * @brief Returns whether a channel holds alpha, which is never sRGB encoded
+ *
+ */
+static bool
+isAlpha(unsigned channel, unsigned channels) {
+    return (channels == 2 || channels == 4) && channel == channels - 1;
+}
+
+/**
+ * @brief Converts 8 bits per channel pixels to linear floats
+ *
+ * @param pixels - Pixels
+ * @param count - Number of values, pixels times channels
+ * @param channels - Channels per pixel
+ * @param srgb - Whether color channels are sRGB encoded
+ * @param linear - Output values
+ */
+static void
+decodeLinear(const unsigned char* pixels, size_t count, unsigned channels, bool srgb, std::vector<float>& linear) {
+    const SRGBTables& Tables = getSRGBTables();
+    linear.resize(count);
+    for (size_t Idx = 0; Idx < count; ++Idx) {
+        bool Encoded = srgb && !isAlpha(Idx % channels, channels);
+        linear[Idx] = Encoded ? Tables.ToLinear[pixels[Idx]] : pixels[Idx] / 255.0f;
+    }
+}
+
+/**
+ * @brief Clamps linear floats and converts them back to 8 bits per channel
+ *
+ * @param linear - Linear values, clamped in place
+ * @param channels - Channels per pixel
+ * @param srgb - Whether color channels are sRGB encoded
+ * @param dst - Output pixels, linear.size() values
+ */
+static void
+encodeLinear(std::vector<float>& linear, unsigned channels, bool srgb, unsigned char* dst) {
+    const SRGBTables& Tables = getSRGBTables();
+    for (size_t Idx = 0; Idx < linear.size(); ++Idx) {
+        // NOTE(Jovan): Kaiser lobes can overshoot, clamped so it doesn't ring into smaller levels
+        float Value = std::min(std::max(linear[Idx], 0.0f), 1.0f);
+        linear[Idx] = Value;
+        if (srgb && !isAlpha(Idx % channels, channels)) {
+            dst[Idx] = Tables.ToSRGB[(unsigned)(Value * (LINEAR_TO_SRGB_STEPS - 1) + 0.5f)];
+        } else {
+            dst[Idx] = (unsigned char)(Value * 255.0f + 0.5f);
+        }
+    }
+}
+
+void
+ImageOps::FlipVertical(unsigned char* pixels, size_t rowSize, unsigned height) {
+    for (unsigned Row = 0; Row < height / 2; ++Row) {
+        unsigned char* Top = pixels + Row * rowSize;
+        unsigned char* Bottom = pixels + (height - 1 - Row) * rowSize;
+        size_t Idx = 0;
+#ifdef IMAGE_SIMD
+        // NOTE(Jovan): Swapped through registers, no temporary row
+        for (; Idx + 16 <= rowSize; Idx += 16) {
+            __m128i A = _mm_loadu_si128((const __m128i*)(Top + Idx));
+            __m128i B = _mm_loadu_si128((const __m128i*)(Bottom + Idx));
+            _mm_storeu_si128((__m128i*)(Top + Idx), B);
+            _mm_storeu_si128((__m128i*)(Bottom + Idx), A);
+        }
+#endif
+        for (; Idx < rowSize; ++Idx) {
+            std::swap(Top[Idx], Bottom[Idx]);
+        }
+    }
+}
+
+void
+ImageOps::Swizzle(const unsigned char* src, unsigned srcChannels, unsigned char* dst, unsigned dstChannels, const int* mapping, size_t pixelCount) {
+    size_t Pixel = 0;
+#ifdef IMAGE_SIMD_SHUFFLE
+    if (srcChannels == 4 && dstChannels == 4) {
+        // NOTE(Jovan): Four pixels per shuffle. Constant channels shuffle in zero and get OR-ed to 255
+        char Shuffle[16];
+        char Constant[16];
+        for (unsigned Lane = 0; Lane < 16; ++Lane) {
+            int Source = mapping[Lane % 4];
+            Shuffle[Lane] = Source < 0 ? (char)0x80 : (char)((Lane / 4) * 4 + Source);
+            Constant[Lane] = Source < 0 ? (char)0xFF : 0;
+        }
+        __m128i ShuffleMask = _mm_loadu_si128((const __m128i*)Shuffle);
+        __m128i ConstantMask = _mm_loadu_si128((const __m128i*)Constant);
+        for (; Pixel + 4 <= pixelCount; Pixel += 4) {
+            __m128i Pixels = _mm_loadu_si128((const __m128i*)(src + Pixel * 4));
+            _mm_storeu_si128((__m128i*)(dst + Pixel * 4), _mm_or_si128(_mm_shuffle_epi8(Pixels, ShuffleMask), ConstantMask));
+        }
+    }
+#endif
+    for (; Pixel < pixelCount; ++Pixel) {
+        for (unsigned Channel = 0; Channel < dstChannels; ++Channel) {
+            int Source = mapping[Channel];
+            dst[Pixel * dstChannels + Channel] = Source < 0 ? 255 : src[Pixel * srcChannels + Source];
+        }
+    }
+}
+
+void
+ImageOps::BuildMipChain(const unsigned char* pixels, unsigned width, unsigned height, unsigned channels, EMipFilter filter, bool srgb, MipChain& chain) {
+    chain.Channels = channels;
+    chain.Levels.clear();
+    chain.Data.clear();
+
+    size_t BaseSize = (size_t)width * height * channels;
+    // NOTE(Jovan): The chain adds a third on top of the base level
+    chain.Data.reserve(BaseSize * 4 / 3 + 64);
+    ImageLevel Base;
+    Base.Offset = 0;
+    Base.Size = (uint32_t)BaseSize;
+    Base.Width = width;
+    Base.Height = height;
+    chain.Data.assign(pixels, pixels + BaseSize);
+    chain.Levels.push_back(Base);
+
+    // NOTE(Jovan): Levels are filtered from the previous level kept in linear floats,
+    // so rounding doesn't build up down the chain
+    std::vector<float> Current;
+    decodeLinear(pixels, BaseSize, channels, srgb, Current);
+
+    std::vector<float> Rows;
+    std::vector<float> Next;
+    while (width > 1 || height > 1) {
+        unsigned DstWidth = std::max(1u, width / 2);
+        unsigned DstHeight = std::max(1u, height / 2);
+        resample(Current, width, height, channels, DstWidth, DstHeight, filter, Rows, Next);
+
+        ImageLevel Level;
+        Level.Offset = (uint32_t)chain.Data.size();
+        Level.Width = DstWidth;
+        Level.Height = DstHeight;
+        Level.Size = DstWidth * DstHeight * channels;
+        chain.Data.resize(chain.Data.size() + Level.Size);
+        encodeLinear(Next, channels, srgb, chain.Data.data() + Level.Offset);
+        chain.Levels.push_back(Level);
+        Current.swap(Next);
+        width = DstWidth;
+        height = DstHeight;
+    }
+}
+
+void
+ImageOps::Resize(const unsigned char* pixels, unsigned width, unsigned height, unsigned channels, unsigned dstWidth, unsigned dstHeight, EMipFilter filter, bool srgb, unsigned char* dst) {
+    if (width == dstWidth && height == dstHeight) {
+        memcpy(dst, pixels, (size_t)width * height * channels);
+        return;
+    }
+    std::vector<float> Linear;
+    std::vector<float> Rows;
+    std::vector<float> Resized;
+    decodeLinear(pixels, (size_t)width * height * channels, channels, srgb, Linear);
+    resample(Linear, width, height, channels, dstWidth, dstHeight, filter, Rows, Resized);
+    encodeLinear(Resized, channels, srgb, dst);
+}
+
+void
+ImageOps::ResampleMipChain(const MipChain& source, unsigned size, EMipFilter filter, bool srgb, MipChain& chain) {
+    unsigned LevelIdx = 0;
+    while (LevelIdx + 1 < source.Levels.size() && source.Levels[LevelIdx + 1].Width >= size
+        && source.Levels[LevelIdx + 1].Height >= size) {
+        ++LevelIdx;
+    }
+    const ImageLevel& Level = source.Levels[LevelIdx];
+    const unsigned char* Pixels = source.Data.data() + Level.Offset;
+    size_t PixelCount = (size_t)Level.Width * Level.Height;
+    std::vector<unsigned char> RGBA;
+    if (source.Channels != 4) {
+        const int FromGrey[4] = { 0, 0, 0, -1 };
+        const int FromGreyAlpha[4] = { 0, 0, 0, 1 };
+        const int FromRGB[4] = { 0, 1, 2, -1 };
+        const int* Mapping = source.Channels == 1 ? FromGrey : source.Channels == 2 ? FromGreyAlpha : FromRGB;
+        RGBA.resize(PixelCount * 4);
+        Swizzle(Pixels, source.Channels, RGBA.data(), 4, Mapping, PixelCount);
+        Pixels = RGBA.data();
+    }
+    std::vector<unsigned char> Resized((size_t)size * size * 4);
+    Resize(Pixels, Level.Width, Level.Height, 4, size, size, MIP_FILTER_KAISER, srgb, Resized.data());
+    BuildMipChain(Resized.data(), size, size, 4, filter, srgb, chain);
+}
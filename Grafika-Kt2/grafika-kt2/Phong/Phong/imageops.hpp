@@ -0,0 +1,114 @@
+/**
+ * @file imageops.hpp
+ * @author Jovan Ivosevic
+ * @brief CPU image processing for texture loading, flips, swizzles and mip chains
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum EMipFilter {
+    // NOTE(Jovan): Averages each 2x2 footprint, same as glGenerateMipmap on most drivers
+    MIP_FILTER_BOX = 0,
+    // NOTE(Jovan): Kaiser windowed sinc over 6 source texels per axis, keeps smaller mips sharper
+    MIP_FILTER_KAISER,
+};
+
+struct ImageLevel {
+    // NOTE(Jovan): Relative to the start of MipChain::Data
+    uint32_t Offset;
+    uint32_t Size;
+    uint32_t Width;
+    uint32_t Height;
+};
+
+/**
+ * @brief 8 bits per channel image with its whole mip chain, levels stored back to back
+ * with tightly packed rows
+ *
+ */
+struct MipChain {
+    unsigned Channels;
+    std::vector<ImageLevel> Levels;
+    std::vector<unsigned char> Data;
+};
+
+/**
+ * @brief Image operations done on the CPU while loading textures. Inner loops use SSE
+ * where available. Nothing here makes GL calls, so it all runs on worker threads
+ *
+ */
+class ImageOps {
+public:
+    /**
+     * @brief Flips an image vertically in place, images are loaded "upside-down"
+     *
+     * @param pixels - Pixels
+     * @param rowSize - Bytes per row
+     * @param height - Number of rows
+     */
+    static void FlipVertical(unsigned char* pixels, size_t rowSize, unsigned height);
+
+    /**
+     * @brief Rearranges channels of every pixel
+     *
+     * @param src - Source pixels
+     * @param srcChannels - Source channels per pixel
+     * @param dst - Output pixels, may not overlap src
+     * @param dstChannels - Output channels per pixel
+     * @param mapping - Source channel of each output channel, -1 for a constant 255
+     * @param pixelCount - Number of pixels
+     */
+    static void Swizzle(const unsigned char* src, unsigned srcChannels, unsigned char* dst, unsigned dstChannels, const int* mapping, size_t pixelCount);
+
+    /**
+     * @brief Builds the mip chain of an image down to 1x1. Color channels are filtered
+     * in linear space, alpha as is
+     *
+     * @param pixels - Base level, already flipped
+     * @param width - Width in pixels
+     * @param height - Height in pixels
+     * @param channels - Channels per pixel, 1 to 4. Alpha is the last of 2 or 4
+     * @param filter - Downsampling filter
+     * @param srgb - Whether color channels are sRGB encoded
+     * @param chain - Output mip chain, the base level included
+     */
+    static void BuildMipChain(const unsigned char* pixels, unsigned width, unsigned height, unsigned channels, EMipFilter filter, bool srgb, MipChain& chain);
+
+    /**
+     * @brief Resamples an image to another size, in linear space like BuildMipChain.
+     * Shrinks of more than 2x per axis should start from a mip level instead
+     *
+     * @param pixels - Source pixels
+     * @param width - Source width
+     * @param height - Source height
+     * @param channels - Channels per pixel, 1 to 4
+     * @param dstWidth - Output width
+     * @param dstHeight - Output height
+     * @param filter - Filter, MIP_FILTER_KAISER also interpolates smoothly when enlarging
+     * @param srgb - Whether color channels are sRGB encoded
+     * @param dst - Output pixels, dstWidth * dstHeight * channels bytes
+     */
+    static void Resize(const unsigned char* pixels, unsigned width, unsigned height, unsigned channels, unsigned dstWidth, unsigned dstHeight, EMipFilter filter, bool srgb, unsigned char* dst);
+
+    /**
+     * @brief Resamples an image to a square RGBA image and builds its mip chain. Starts from
+     * the smallest source mip still covering the size, so no source texel is skipped
+     *
+     * @param source - Source image with its mip chain, 1 to 4 channels. Grey stays grey and
+     * missing alpha is opaque
+     * @param size - Output width and height
+     * @param filter - Filter of the output mip chain, resampling itself is MIP_FILTER_KAISER
+     * @param srgb - Whether color channels are sRGB encoded
+     * @param chain - Output mip chain, 4 channels
+     */
+    static void ResampleMipChain(const MipChain& source, unsigned size, EMipFilter filter, bool srgb, MipChain& chain);
+};
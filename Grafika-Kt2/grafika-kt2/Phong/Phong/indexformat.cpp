@@ -0,0 +1,92 @@
+#include "indexformat.hpp"
+#include <cstring>
+#include <cstdint>
+
+static const unsigned MAX_SHORT_INDEX = 0xFFFF;
+
+unsigned
+IndexFormat::GetSize(GLenum type) {
+    return type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+/**
+ * @brief Splits triangles into runs whose vertex index range fits into 16 bits
+ *
+ * @returns false - A chunk can't hold even a single triangle or there are too many chunks
+ */
+static bool
+buildShortChunks(const unsigned* indices, unsigned indexCount, std::vector<IndexChunk>& chunks) {
+    unsigned MaxChunks = indexCount / (3 * MIN_TRIANGLES_PER_INDEX_CHUNK) + 1;
+    IndexChunk Chunk = { 0, 0, 0 };
+    unsigned ChunkMin = 0;
+    unsigned ChunkMax = 0;
+    for (unsigned Index = 0; Index + 2 < indexCount; Index += 3) {
+        unsigned TriangleMin = indices[Index];
+        unsigned TriangleMax = indices[Index];
+        for (unsigned Corner = 1; Corner < 3; ++Corner) {
+            unsigned Vertex = indices[Index + Corner];
+            TriangleMin = Vertex < TriangleMin ? Vertex : TriangleMin;
+            TriangleMax = Vertex > TriangleMax ? Vertex : TriangleMax;
+        }
+        if (TriangleMax - TriangleMin > MAX_SHORT_INDEX) {
+            return false;
+        }
+
+        unsigned NewMin = Chunk.IndexCount && ChunkMin < TriangleMin ? ChunkMin : TriangleMin;
+        unsigned NewMax = Chunk.IndexCount && ChunkMax > TriangleMax ? ChunkMax : TriangleMax;
+        if (Chunk.IndexCount && NewMax - NewMin > MAX_SHORT_INDEX) {
+            Chunk.BaseVertex = ChunkMin;
+            chunks.push_back(Chunk);
+            if (chunks.size() >= MaxChunks) {
+                return false;
+            }
+            Chunk.FirstIndex = Index;
+            Chunk.IndexCount = 0;
+            NewMin = TriangleMin;
+            NewMax = TriangleMax;
+        }
+
+        ChunkMin = NewMin;
+        ChunkMax = NewMax;
+        Chunk.IndexCount += 3;
+    }
+
+    if (Chunk.IndexCount) {
+        Chunk.BaseVertex = ChunkMin;
+        chunks.push_back(Chunk);
+    }
+    return true;
+}
+
+void
+IndexFormat::Encode(const unsigned* indices, unsigned indexCount, unsigned vertexCount, std::vector<unsigned char>& dst, GLenum& type, std::vector<IndexChunk>& chunks) {
+    chunks.clear();
+    if (!indexCount) {
+        dst.clear();
+        type = GL_UNSIGNED_SHORT;
+        return;
+    }
+
+    if (vertexCount <= MAX_SHORT_INDEX + 1) {
+        IndexChunk Whole = { 0, indexCount, 0 };
+        chunks.push_back(Whole);
+    } else if (!buildShortChunks(indices, indexCount, chunks)) {
+        chunks.clear();
+        IndexChunk Whole = { 0, indexCount, 0 };
+        chunks.push_back(Whole);
+        type = GL_UNSIGNED_INT;
+        dst.resize((size_t)indexCount * sizeof(uint32_t));
+        memcpy(dst.data(), indices, dst.size());
+        return;
+    }
+
+    type = GL_UNSIGNED_SHORT;
+    dst.resize((size_t)indexCount * sizeof(uint16_t));
+    uint16_t* Short = (uint16_t*)dst.data();
+    for (size_t ChunkIdx = 0; ChunkIdx < chunks.size(); ++ChunkIdx) {
+        const IndexChunk& Chunk = chunks[ChunkIdx];
+        for (unsigned Index = Chunk.FirstIndex; Index < Chunk.FirstIndex + Chunk.IndexCount; ++Index) {
+            Short[Index] = (uint16_t)(indices[Index] - Chunk.BaseVertex);
+        }
+    }
+}
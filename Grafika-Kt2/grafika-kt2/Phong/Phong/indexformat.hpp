@@ -0,0 +1,55 @@
+/**
+ * @file indexformat.hpp
+ * @author Jovan Ivosevic
+ * @brief Index buffer narrowing to 16 bits and chunking of large meshes
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+
+// NOTE(Jovan): Below this many triangles per chunk on average, splitting isn't worth the extra draw calls
+#define MIN_TRIANGLES_PER_INDEX_CHUNK 4096
+
+/**
+ * @brief Range of the index buffer drawn with a single glDrawElementsBaseVertex call
+ *
+ */
+struct IndexChunk {
+    unsigned FirstIndex;
+    unsigned IndexCount;
+    unsigned BaseVertex;
+};
+
+class IndexFormat {
+public:
+    /**
+     * @brief Returns size of one index in bytes
+     *
+     * @param type - GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+     *
+     * @returns Index size in bytes
+     */
+    static unsigned GetSize(GLenum type);
+
+    /**
+     * @brief Encodes triangle indices in the narrowest type that fits. Meshes with less than
+     * 65536 vertices get 16-bit indices directly. Larger meshes are split into chunks of
+     * consecutive triangles whose vertex range fits in 16 bits relative to the chunk's base
+     * vertex; if that would produce too many small chunks, 32-bit indices are used instead
+     *
+     * @param indices - Triangle indices
+     * @param indexCount - Number of indices
+     * @param vertexCount - Number of vertices the indices refer to
+     * @param dst - Output encoded index data
+     * @param type - Output index type, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+     * @param chunks - Output chunks covering all indices
+     */
+    static void Encode(const unsigned* indices, unsigned indexCount, unsigned vertexCount, std::vector<unsigned char>& dst, GLenum& type, std::vector<IndexChunk>& chunks);
+};
@@ -0,0 +1,61 @@
+#include "instancebatch.hpp"
+
+InstanceBatch::InstanceBatch(EVertexFormat format, const GeometryRange& range, const Bounds& bounds) {
+    mFormat = format;
+    mRange = range;
+    mBounds = bounds;
+}
+
+void
+InstanceBatch::Add(const glm::mat4& model, unsigned material) {
+    InstanceTransform Instance;
+    Instance.Model = model;
+    Instance.Normal = Shader::GetNormalMatrix(model);
+    Instance.Material = material;
+    mInstances.push_back(Instance);
+}
+
+void
+InstanceBatch::Clear() {
+    mInstances.clear();
+}
+
+unsigned
+InstanceBatch::GetCount() const {
+    return mInstances.size();
+}
+
+unsigned
+InstanceBatch::Render(ShaderVariants& variants, unsigned features, Culler& culler) {
+    cull(culler);
+    if (mVisible.empty()) {
+        return 0;
+    }
+
+    variants.Use(features | SHADER_FEATURE_INSTANCED);
+    GeometryBuffer::Bind(mFormat);
+    GeometryBuffer::UploadInstances(mFormat, &mVisible[0], mVisible.size());
+    glDrawArraysInstanced(GL_TRIANGLES, mRange.BaseVertex, mRange.VertexCount, mVisible.size());
+    return mVisible.size();
+}
+
+unsigned
+InstanceBatch::Enqueue(RenderQueue& queue, ShaderVariants& variants, unsigned features, Culler& culler) {
+    cull(culler);
+    if (mVisible.empty()) {
+        return 0;
+    }
+
+    queue.AddInstances(RENDER_PASS_OPAQUE, variants.Get(features | SHADER_FEATURE_INSTANCED), mFormat, mRange, &mVisible[0], mVisible.size());
+    return mVisible.size();
+}
+
+void
+InstanceBatch::cull(Culler& culler) {
+    mVisible.clear();
+    for (unsigned Instance = 0; Instance < mInstances.size(); ++Instance) {
+        if (culler.IsVisible(mBounds, mInstances[Instance].Model)) {
+            mVisible.push_back(mInstances[Instance]);
+        }
+    }
+}
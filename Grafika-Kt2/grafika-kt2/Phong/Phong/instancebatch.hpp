@@ -0,0 +1,95 @@
+/**
+ * @file instancebatch.hpp
+ * @author Jovan Ivosevic
+ * @brief Instanced drawing of many copies of the same geometry
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "geometrybuffer.hpp"
+#include "culling.hpp"
+#include "shadervariants.hpp"
+#include "materialsystem.hpp"
+#include "renderqueue.hpp"
+
+/**
+ * @brief Copies of one non-indexed geometry range, each with its own model matrix and
+ * material.
+ * Copies are culled one by one on the CPU, the visible ones are uploaded to the format's
+ * instance buffer and drawn with a single glDrawArraysInstanced
+ *
+ */
+class InstanceBatch {
+public:
+    /**
+     * @brief Ctor
+     *
+     * @param format - Vertex format of the geometry
+     * @param range - Geometry range, drawn as GL_TRIANGLES without indices
+     * @param bounds - Object space bounds of the geometry
+     */
+    InstanceBatch(EVertexFormat format, const GeometryRange& range, const Bounds& bounds);
+
+    /**
+     * @brief Adds a copy
+     *
+     * @param model - Model matrix of the copy
+     * @param material - Material of the copy, see MaterialSystem
+     */
+    void Add(const glm::mat4& model, unsigned material = MATERIAL_DEFAULT);
+
+    /**
+     * @brief Removes all copies
+     *
+     */
+    void Clear();
+
+    unsigned GetCount() const;
+
+    /**
+     * @brief Draws visible copies with the instanced variant of the given features.
+     * Each copy samples its own material, so one draw covers them all
+     *
+     * @param variants - Shader variants, the SHADER_FEATURE_INSTANCED one is put in use
+     * @param features - Features of the copies' materials, without SHADER_FEATURE_INSTANCED
+     * @param culler - Culling pass of the current frame
+     *
+     * @returns Number of drawn copies
+     */
+    unsigned Render(ShaderVariants& variants, unsigned features, Culler& culler);
+
+    /**
+     * @brief Same as Render, but adds the visible copies to a render queue as one
+     * instanced item instead of drawing them
+     *
+     * @param queue - Render queue of the current frame
+     * @param variants - Shader variants
+     * @param features - Features of the copies' materials, without SHADER_FEATURE_INSTANCED
+     * @param culler - Culling pass of the current frame
+     *
+     * @returns Number of queued copies
+     */
+    unsigned Enqueue(RenderQueue& queue, ShaderVariants& variants, unsigned features, Culler& culler);
+
+private:
+    EVertexFormat mFormat;
+    GeometryRange mRange;
+    Bounds mBounds;
+    // NOTE(Jovan): Normal matrices are computed once, when copies are added
+    std::vector<InstanceTransform> mInstances;
+    // NOTE(Jovan): Kept between frames so culling does not allocate
+    std::vector<InstanceTransform> mVisible;
+
+    /**
+     * @brief Fills mVisible with the copies inside the view frustum
+     *
+     */
+    void cull(Culler& culler);
+};
@@ -0,0 +1,322 @@
+#include "lightclusters.hpp"
+#include <cmath>
+#include "workerpool.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CLUSTER_SIMD 1
+#include <emmintrin.h>
+#endif
+
+// NOTE(Jovan): Below this many lights, handing slices to the worker pool costs more than it saves
+#define CLUSTER_PARALLEL_MIN_LIGHTS 64
+
+/**
+ * @brief Tests a sphere against four neighbouring cluster boxes
+ *
+ * @param minX - First of four box minimums on x, other arrays likewise
+ * @param sphere - View space sphere, xyz center and w radius
+ *
+ * @returns Bit i set if the sphere touches box i
+ */
+static unsigned
+testFourBoxes(const float* minX, const float* minY, const float* minZ, const float* maxX, const float* maxY, const float* maxZ, const glm::vec4& sphere) {
+#ifdef CLUSTER_SIMD
+    // NOTE(Jovan): Distance from the center to the box along each axis, 0 inside the box
+    const __m128 Zero = _mm_setzero_ps();
+    __m128 Center = _mm_set1_ps(sphere.x);
+    __m128 DX = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minX), Center), Zero), _mm_max_ps(_mm_sub_ps(Center, _mm_loadu_ps(maxX)), Zero));
+    Center = _mm_set1_ps(sphere.y);
+    __m128 DY = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minY), Center), Zero), _mm_max_ps(_mm_sub_ps(Center, _mm_loadu_ps(maxY)), Zero));
+    Center = _mm_set1_ps(sphere.z);
+    __m128 DZ = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minZ), Center), Zero), _mm_max_ps(_mm_sub_ps(Center, _mm_loadu_ps(maxZ)), Zero));
+    __m128 Distance2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(DX, DX), _mm_mul_ps(DY, DY)), _mm_mul_ps(DZ, DZ));
+    return _mm_movemask_ps(_mm_cmple_ps(Distance2, _mm_set1_ps(sphere.w * sphere.w)));
+#else
+    unsigned Mask = 0;
+    for (unsigned Lane = 0; Lane < 4; ++Lane) {
+        float DX = fmaxf(minX[Lane] - sphere.x, 0.0f) + fmaxf(sphere.x - maxX[Lane], 0.0f);
+        float DY = fmaxf(minY[Lane] - sphere.y, 0.0f) + fmaxf(sphere.y - maxY[Lane], 0.0f);
+        float DZ = fmaxf(minZ[Lane] - sphere.z, 0.0f) + fmaxf(sphere.z - maxZ[Lane], 0.0f);
+        if (DX * DX + DY * DY + DZ * DZ <= sphere.w * sphere.w) {
+            Mask |= 1u << Lane;
+        }
+    }
+    return Mask;
+#endif
+}
+
+/**
+ * @brief Creates a buffer texture over a new buffer
+ *
+ * @param buffer - Output buffer
+ * @param texture - Output texture
+ * @param format - Texel format
+ */
+static void
+createBufferTexture(BufferHandle& buffer, TextureHandle& texture, GLenum format) {
+    unsigned Buffer;
+    glGenBuffers(1, &Buffer);
+    buffer.Reset(Buffer);
+    unsigned Texture;
+    glGenTextures(1, &Texture);
+    texture.Reset(Texture);
+
+    // NOTE(Jovan): A buffer texture needs a data store before it can be attached
+    glBindBuffer(GL_TEXTURE_BUFFER, Buffer);
+    glBufferData(GL_TEXTURE_BUFFER, 16, 0, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, Texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, Buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+/**
+ * @brief Replaces buffer contents, orphaning the old storage
+ *
+ * @param buffer - Buffer
+ * @param data - Data, at least one element
+ */
+static void
+uploadBuffer(const BufferHandle& buffer, const std::vector<unsigned>& data) {
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer.GetId());
+    glBufferData(GL_TEXTURE_BUFFER, data.size() * sizeof(unsigned), &data[0], GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+LightClusters::LightClusters() {
+    mProjection = glm::mat4(0.0f);
+    mNear = 0.1f;
+    mFar = 100.0f;
+    mDepthScale = 1.0f;
+    mStats.Clusters = 0;
+    mStats.LightIndices = 0;
+    mStats.MaxLightsPerCluster = 0;
+    SetGrid(CLUSTER_COUNT_X, CLUSTER_COUNT_Y, CLUSTER_COUNT_Z);
+    createBufferTexture(mGridBuffer, mGridTexture, GL_RG32UI);
+    createBufferTexture(mIndexBuffer, mIndexTexture, GL_R32UI);
+}
+
+void
+LightClusters::SetGrid(unsigned x, unsigned y, unsigned z) {
+    mCountX = x ? x : 1;
+    mCountY = y ? y : 1;
+    mCountZ = z ? z : 1;
+    mRowStride = (mCountX + 3) & ~3u;
+    mLists.resize(mCountX * mCountY * mCountZ);
+    // NOTE(Jovan): Forces boxes to be rebuilt on the next Build
+    mProjection = glm::mat4(0.0f);
+}
+
+unsigned
+LightClusters::GetCountX() const {
+    return mCountX;
+}
+
+unsigned
+LightClusters::GetCountY() const {
+    return mCountY;
+}
+
+unsigned
+LightClusters::GetCountZ() const {
+    return mCountZ;
+}
+
+float
+LightClusters::GetNear() const {
+    return mNear;
+}
+
+float
+LightClusters::GetDepthScale() const {
+    return mDepthScale;
+}
+
+const ClusterStats&
+LightClusters::GetStats() const {
+    return mStats;
+}
+
+void
+LightClusters::buildBoxes() {
+    // NOTE(Jovan): Near and far planes recovered from a glm::perspective matrix
+    mNear = mProjection[3][2] / (mProjection[2][2] - 1.0f);
+    mFar = mProjection[3][2] / (mProjection[2][2] + 1.0f);
+    mDepthScale = mCountZ / std::log(mFar / mNear);
+    float ScaleX = 1.0f / mProjection[0][0];
+    float ScaleY = 1.0f / mProjection[1][1];
+
+    size_t BoxCount = (size_t)mRowStride * mCountY * mCountZ;
+    mMinX.assign(BoxCount, 1e30f);
+    mMinY.assign(BoxCount, 1e30f);
+    mMinZ.assign(BoxCount, 1e30f);
+    mMaxX.assign(BoxCount, -1e30f);
+    mMaxY.assign(BoxCount, -1e30f);
+    mMaxZ.assign(BoxCount, -1e30f);
+    for (unsigned Z = 0; Z < mCountZ; ++Z) {
+        float NearDepth = mNear * std::exp(Z / mDepthScale);
+        float FarDepth = mNear * std::exp((Z + 1) / mDepthScale);
+        for (unsigned Y = 0; Y < mCountY; ++Y) {
+            float Bottom = -1.0f + 2.0f * Y / mCountY;
+            float Top = -1.0f + 2.0f * (Y + 1) / mCountY;
+            for (unsigned X = 0; X < mCountX; ++X) {
+                float Left = -1.0f + 2.0f * X / mCountX;
+                float Right = -1.0f + 2.0f * (X + 1) / mCountX;
+                // NOTE(Jovan): Tile edges spread out with depth, the box must hold both ends
+                size_t Box = ((size_t)Z * mCountY + Y) * mRowStride + X;
+                mMinX[Box] = fminf(Left * NearDepth, Left * FarDepth) * ScaleX;
+                mMaxX[Box] = fmaxf(Right * NearDepth, Right * FarDepth) * ScaleX;
+                mMinY[Box] = fminf(Bottom * NearDepth, Bottom * FarDepth) * ScaleY;
+                mMaxY[Box] = fmaxf(Top * NearDepth, Top * FarDepth) * ScaleY;
+                mMinZ[Box] = -FarDepth;
+                mMaxZ[Box] = -NearDepth;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Returns the tile an NDC coordinate falls in
+ *
+ * @param ndc - NDC coordinate
+ * @param count - Tile count
+ *
+ * @returns Tile, clamped to the grid
+ */
+static unsigned
+ndcToTile(float ndc, unsigned count) {
+    int Tile = (int)std::floor((ndc + 1.0f) * 0.5f * count);
+    return Tile < 0 ? 0 : Tile >= (int)count ? count - 1 : Tile;
+}
+
+void
+LightClusters::boundLight(unsigned light) {
+    const glm::vec4& Sphere = mViewSpheres[light];
+    unsigned* Bounds = &mLightBounds[(size_t)light * 6];
+    Bounds[4] = 1;
+    Bounds[5] = 0;
+
+    float MinDepth = -Sphere.z - Sphere.w;
+    float MaxDepth = -Sphere.z + Sphere.w;
+    if (MaxDepth < mNear || MinDepth > mFar) {
+        return;
+    }
+    MinDepth = fmaxf(MinDepth, mNear);
+    MaxDepth = fminf(MaxDepth, mFar);
+
+    // NOTE(Jovan): x / depth over the sphere's view space box peaks at the box's corners
+    float NDC[2][2];
+    for (unsigned Axis = 0; Axis < 2; ++Axis) {
+        float Scale = mProjection[Axis][Axis];
+        float Low = Sphere[Axis] - Sphere.w;
+        float High = Sphere[Axis] + Sphere.w;
+        NDC[Axis][0] = fminf(Low / MinDepth, Low / MaxDepth) * Scale;
+        NDC[Axis][1] = fmaxf(High / MinDepth, High / MaxDepth) * Scale;
+        if (NDC[Axis][1] < -1.0f || NDC[Axis][0] > 1.0f) {
+            return;
+        }
+    }
+
+    unsigned Counts[2] = { mCountX, mCountY };
+    for (unsigned Axis = 0; Axis < 2; ++Axis) {
+        Bounds[Axis * 2] = ndcToTile(NDC[Axis][0], Counts[Axis]);
+        Bounds[Axis * 2 + 1] = ndcToTile(NDC[Axis][1], Counts[Axis]);
+    }
+    int Near = (int)std::floor(std::log(MinDepth / mNear) * mDepthScale);
+    int Far = (int)std::floor(std::log(MaxDepth / mNear) * mDepthScale);
+    Bounds[4] = Near < 0 ? 0 : Near >= (int)mCountZ ? mCountZ - 1 : Near;
+    Bounds[5] = Far < 0 ? 0 : Far >= (int)mCountZ ? mCountZ - 1 : Far;
+}
+
+void
+LightClusters::assignSlice(unsigned slice) {
+    size_t FirstCluster = (size_t)slice * mCountY * mCountX;
+    for (size_t Cluster = FirstCluster; Cluster < FirstCluster + (size_t)mCountY * mCountX; ++Cluster) {
+        mLists[Cluster].clear();
+    }
+
+    for (unsigned Light = 0; Light < mViewSpheres.size(); ++Light) {
+        const unsigned* Bounds = &mLightBounds[(size_t)Light * 6];
+        if (slice < Bounds[4] || slice > Bounds[5]) {
+            continue;
+        }
+
+        for (unsigned Y = Bounds[2]; Y <= Bounds[3]; ++Y) {
+            size_t Row = ((size_t)slice * mCountY + Y) * mRowStride;
+            for (unsigned X = Bounds[0] & ~3u; X <= Bounds[1]; X += 4) {
+                size_t Box = Row + X;
+                unsigned Hits = testFourBoxes(&mMinX[Box], &mMinY[Box], &mMinZ[Box], &mMaxX[Box], &mMaxY[Box], &mMaxZ[Box], mViewSpheres[Light]);
+                for (unsigned Lane = 0; Lane < 4; ++Lane) {
+                    unsigned TileX = X + Lane;
+                    if ((Hits & (1u << Lane)) && TileX >= Bounds[0] && TileX <= Bounds[1]) {
+                        mLists[FirstCluster + (size_t)Y * mCountX + TileX].push_back(Light);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void
+LightClusters::upload() {
+    mGrid.resize(mLists.size() * 2);
+    mIndices.clear();
+    mStats.Clusters = mLists.size();
+    mStats.MaxLightsPerCluster = 0;
+    for (size_t Cluster = 0; Cluster < mLists.size(); ++Cluster) {
+        const std::vector<unsigned>& List = mLists[Cluster];
+        mGrid[Cluster * 2] = mIndices.size();
+        mGrid[Cluster * 2 + 1] = List.size();
+        mIndices.insert(mIndices.end(), List.begin(), List.end());
+        mStats.MaxLightsPerCluster = List.size() > mStats.MaxLightsPerCluster ? List.size() : mStats.MaxLightsPerCluster;
+    }
+    mStats.LightIndices = mIndices.size();
+    if (mIndices.empty()) {
+        mIndices.push_back(0);
+    }
+
+    uploadBuffer(mGridBuffer, mGrid);
+    uploadBuffer(mIndexBuffer, mIndices);
+}
+
+void
+LightClusters::Build(const glm::mat4& projection, const glm::mat4& view, const std::vector<glm::vec4>& spheres, unsigned firstIndex) {
+    if (projection != mProjection) {
+        mProjection = projection;
+        buildBoxes();
+    }
+
+    mViewSpheres.resize(spheres.size());
+    mLightBounds.resize(spheres.size() * 6);
+    for (unsigned Light = 0; Light < spheres.size(); ++Light) {
+        glm::vec4 Center = view * glm::vec4(glm::vec3(spheres[Light]), 1.0f);
+        mViewSpheres[Light] = glm::vec4(glm::vec3(Center), spheres[Light].w);
+        boundLight(Light);
+    }
+
+    if (spheres.size() >= CLUSTER_PARALLEL_MIN_LIGHTS) {
+        WorkerPool::Get().ParallelFor(mCountZ, [this](unsigned slice) { assignSlice(slice); });
+    } else {
+        for (unsigned Slice = 0; Slice < mCountZ; ++Slice) {
+            assignSlice(Slice);
+        }
+    }
+
+    if (firstIndex) {
+        for (size_t Cluster = 0; Cluster < mLists.size(); ++Cluster) {
+            for (size_t Entry = 0; Entry < mLists[Cluster].size(); ++Entry) {
+                mLists[Cluster][Entry] += firstIndex;
+            }
+        }
+    }
+    upload();
+}
+
+void
+LightClusters::Bind() const {
+    glActiveTexture(GL_TEXTURE0 + CLUSTER_GRID_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, mGridTexture.GetId());
+    glActiveTexture(GL_TEXTURE0 + CLUSTER_INDEX_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, mIndexTexture.GetId());
+    glActiveTexture(GL_TEXTURE0);
+}
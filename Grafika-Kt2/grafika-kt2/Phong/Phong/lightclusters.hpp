@@ -0,0 +1,114 @@
+/**
+ * @file lightclusters.hpp
+ * @author Jovan Ivosevic
+ * @brief Clustered light assignment for forward shading
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "glhandle.hpp"
+
+#define CLUSTER_COUNT_X 16
+#define CLUSTER_COUNT_Y 9
+#define CLUSTER_COUNT_Z 24
+// NOTE(Jovan): Texture units of the cluster grid and light index buffer textures
+#define CLUSTER_GRID_TEXTURE_UNIT 3
+#define CLUSTER_INDEX_TEXTURE_UNIT 4
+
+struct ClusterStats {
+    unsigned Clusters;
+    // NOTE(Jovan): Sum of all cluster light lists
+    unsigned LightIndices;
+    unsigned MaxLightsPerCluster;
+};
+
+/**
+ * @brief Splits the view frustum into a grid of clusters, screen tiles in x and y and
+ * exponentially growing depth slices in z, and lists which lights reach each cluster.
+ * Fragments then only shade the lights of their own cluster.
+ *
+ * Lights are first bounded to a box of clusters, then tested against each cluster's view
+ * space box. Depth slices are processed in parallel on the worker pool, and the tests are
+ * done four clusters at a time with SSE where available
+ *
+ */
+class LightClusters {
+public:
+    LightClusters();
+
+    /**
+     * @brief Changes grid resolution. A 1x1x1 grid puts every light in view in one cluster,
+     * which is the same as not clustering
+     *
+     * @param x - Tiles across
+     * @param y - Tiles down
+     * @param z - Depth slices
+     */
+    void SetGrid(unsigned x, unsigned y, unsigned z);
+
+    /**
+     * @brief Assigns lights to clusters and uploads the cluster grid and light index lists
+     *
+     * @param projection - Symmetric perspective projection matrix
+     * @param view - View matrix
+     * @param spheres - World space light spheres, xyz center and w range
+     * @param firstIndex - Added to sphere indices to get light indices in the light buffer
+     */
+    void Build(const glm::mat4& projection, const glm::mat4& view, const std::vector<glm::vec4>& spheres, unsigned firstIndex);
+
+    /**
+     * @brief Binds buffer textures to CLUSTER_GRID_TEXTURE_UNIT and CLUSTER_INDEX_TEXTURE_UNIT
+     *
+     */
+    void Bind() const;
+
+    unsigned GetCountX() const;
+    unsigned GetCountY() const;
+    unsigned GetCountZ() const;
+    float GetNear() const;
+
+    /**
+     * @brief Returns depth slice scale, slice = log(depth / near) * scale
+     *
+     */
+    float GetDepthScale() const;
+    const ClusterStats& GetStats() const;
+
+private:
+    unsigned mCountX;
+    unsigned mCountY;
+    unsigned mCountZ;
+    // NOTE(Jovan): Clusters per row in the box arrays, padded to a multiple of 4 for SIMD
+    unsigned mRowStride;
+    glm::mat4 mProjection;
+    float mNear;
+    float mFar;
+    float mDepthScale;
+    // NOTE(Jovan): View space cluster boxes, structure of arrays so four of them load at once
+    std::vector<float> mMinX, mMinY, mMinZ, mMaxX, mMaxY, mMaxZ;
+    // NOTE(Jovan): Light lists per cluster, kept between frames so they don't reallocate
+    std::vector<std::vector<unsigned> > mLists;
+    std::vector<glm::vec4> mViewSpheres;
+    // NOTE(Jovan): Per light cluster bounds, x0, x1, y0, y1, z0, z1. Empty if z0 > z1
+    std::vector<unsigned> mLightBounds;
+    std::vector<unsigned> mGrid;
+    std::vector<unsigned> mIndices;
+    ClusterStats mStats;
+    BufferHandle mGridBuffer;
+    BufferHandle mIndexBuffer;
+    TextureHandle mGridTexture;
+    TextureHandle mIndexTexture;
+
+    void buildBoxes();
+    void boundLight(unsigned light);
+    void assignSlice(unsigned slice);
+    void upload();
+};
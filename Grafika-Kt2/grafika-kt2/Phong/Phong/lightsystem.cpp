@@ -0,0 +1,174 @@
+#include "lightsystem.hpp"
+#include <cmath>
+
+// NOTE(Jovan): Range of lights that don't attenuate
+static const float INFINITE_RANGE = 1e30f;
+
+Light::Light() {
+    Type = LIGHT_TYPE_POINT;
+    Enabled = true;
+    Position = glm::vec3(0.0f);
+    Direction = glm::vec3(0.0f, -1.0f, 0.0f);
+    Ka = glm::vec3(0.0f);
+    Kd = glm::vec3(0.0f);
+    Ks = glm::vec3(0.0f);
+    Kc = 1.0f;
+    Kl = 0.0f;
+    Kq = 0.0f;
+    InnerCutOff = 1.0f;
+    OuterCutOff = 1.0f;
+}
+
+LightSystem::LightSystem() : mBlock(UNIFORM_BINDING_LIGHTS, sizeof(LightUniforms)) {
+    mUploadedCount = 0;
+    mShaderFeatures = 0;
+    mBufferCapacity = 0;
+    unsigned Buffer;
+    glGenBuffers(1, &Buffer);
+    mBuffer.Reset(Buffer);
+    unsigned Texture;
+    glGenTextures(1, &Texture);
+    mTexture.Reset(Texture);
+}
+
+unsigned
+LightSystem::Add(const Light& light) {
+    mLights.push_back(light);
+    return mLights.size() - 1;
+}
+
+Light&
+LightSystem::Get(unsigned index) {
+    return mLights[index];
+}
+
+unsigned
+LightSystem::GetCount() const {
+    return mLights.size();
+}
+
+unsigned
+LightSystem::GetUploadedCount() const {
+    return mUploadedCount;
+}
+
+float
+LightSystem::GetRange(const Light& light) {
+    glm::vec3 Sum = light.Ka + light.Kd + light.Ks;
+    float Intensity = Sum.x > Sum.y ? (Sum.x > Sum.z ? Sum.x : Sum.z) : (Sum.y > Sum.z ? Sum.y : Sum.z);
+    // NOTE(Jovan): Solves Kc + Kl * d + Kq * d^2 = Intensity * LIGHT_ATTENUATION_CUTOFF for d
+    float Target = Intensity * LIGHT_ATTENUATION_CUTOFF;
+    if (!(light.Kc < Target)) {
+        return 0.0f;
+    }
+    if (light.Kq > 0.0f) {
+        float Discriminant = light.Kl * light.Kl - 4.0f * light.Kq * (light.Kc - Target);
+        return (-light.Kl + std::sqrt(Discriminant)) / (2.0f * light.Kq);
+    }
+    if (light.Kl > 0.0f) {
+        return (Target - light.Kc) / light.Kl;
+    }
+    return INFINITE_RANGE;
+}
+
+void
+LightSystem::pack(const Light& light, float range) {
+    if (light.Type == LIGHT_TYPE_SPOT) {
+        mShaderFeatures |= SHADER_FEATURE_SPOT_LIGHTS;
+    }
+    glm::vec3 Direction = glm::length(light.Direction) > 0.0f ? glm::normalize(light.Direction) : light.Direction;
+    mPacked.push_back(glm::vec4(light.Position, (float)light.Type));
+    mPacked.push_back(glm::vec4(Direction, range));
+    mPacked.push_back(glm::vec4(light.Ka, light.Kc));
+    mPacked.push_back(glm::vec4(light.Kd, light.Kl));
+    mPacked.push_back(glm::vec4(light.Ks, light.Kq));
+    mPacked.push_back(glm::vec4(light.InnerCutOff, light.OuterCutOff, 0.0f, 0.0f));
+}
+
+void
+LightSystem::Upload(const glm::mat4& projection, const glm::mat4& view, unsigned width, unsigned height) {
+    mPacked.clear();
+    mSpheres.clear();
+    mShaderFeatures = 0;
+    // NOTE(Jovan): Global lights first, so clustered light indices all start past them
+    for (unsigned LightIdx = 0; LightIdx < mLights.size(); ++LightIdx) {
+        const Light& Current = mLights[LightIdx];
+        float Range = Current.Type == LIGHT_TYPE_DIRECTIONAL ? INFINITE_RANGE : GetRange(Current);
+        if (Current.Enabled && Range >= INFINITE_RANGE) {
+            pack(Current, Range);
+        }
+    }
+    unsigned GlobalCount = mPacked.size() / LIGHT_TEXELS;
+    for (unsigned LightIdx = 0; LightIdx < mLights.size(); ++LightIdx) {
+        const Light& Current = mLights[LightIdx];
+        if (!Current.Enabled || Current.Type == LIGHT_TYPE_DIRECTIONAL) {
+            continue;
+        }
+        float Range = GetRange(Current);
+        if (Range < INFINITE_RANGE) {
+            pack(Current, Range);
+            mSpheres.push_back(glm::vec4(Current.Position, Range));
+        }
+    }
+    mUploadedCount = mPacked.size() / LIGHT_TEXELS;
+    if (!mSpheres.empty()) {
+        mShaderFeatures |= SHADER_FEATURE_LOCAL_LIGHTS;
+    }
+
+    // NOTE(Jovan): Never left empty, a buffer texture needs a data store
+    unsigned Lights = mUploadedCount ? mUploadedCount : 1;
+    glBindBuffer(GL_TEXTURE_BUFFER, mBuffer.GetId());
+    if (Lights > mBufferCapacity) {
+        mBufferCapacity = mBufferCapacity ? mBufferCapacity : 16;
+        while (mBufferCapacity < Lights) {
+            mBufferCapacity *= 2;
+        }
+    }
+    // NOTE(Jovan): Orphaned every frame so the driver doesn't wait on draws still reading the old lights
+    glBufferData(GL_TEXTURE_BUFFER, (size_t)mBufferCapacity * LIGHT_TEXELS * sizeof(glm::vec4), 0, GL_STREAM_DRAW);
+    if (mUploadedCount) {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, mPacked.size() * sizeof(glm::vec4), &mPacked[0]);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glActiveTexture(GL_TEXTURE0 + LIGHT_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, mTexture.GetId());
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, mBuffer.GetId());
+    glActiveTexture(GL_TEXTURE0);
+
+    mClusters.Build(projection, view, mSpheres, GlobalCount);
+    mClusters.Bind();
+
+    LightUniforms Block = {};
+    Block.LightCount = mUploadedCount;
+    Block.GlobalLightCount = GlobalCount;
+    Block.ClusterCount[0] = mClusters.GetCountX();
+    Block.ClusterCount[1] = mClusters.GetCountY();
+    Block.ClusterCount[2] = mClusters.GetCountZ();
+    Block.ClusterDepthNear = mClusters.GetNear();
+    Block.ClusterDepthScale = mClusters.GetDepthScale();
+    Block.ClusterTileSize = glm::vec2((float)width / mClusters.GetCountX(), (float)height / mClusters.GetCountY());
+    mBlock.Update(&Block);
+}
+
+void
+LightSystem::SetClusterGrid(unsigned x, unsigned y, unsigned z) {
+    mClusters.SetGrid(x, y, z);
+}
+
+unsigned
+LightSystem::GetShaderFeatures() const {
+    return mShaderFeatures;
+}
+
+const ClusterStats&
+LightSystem::GetClusterStats() const {
+    return mClusters.GetStats();
+}
+
+void
+LightSystem::SetupShader(const Shader& shader) {
+    shader.SetUniform1i("uLightData", LIGHT_TEXTURE_UNIT);
+    shader.SetUniform1i("uClusterGrid", CLUSTER_GRID_TEXTURE_UNIT);
+    shader.SetUniform1i("uClusterLightIndices", CLUSTER_INDEX_TEXTURE_UNIT);
+}
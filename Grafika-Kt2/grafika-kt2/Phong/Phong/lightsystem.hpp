@@ -0,0 +1,167 @@
+/**
+ * @file lightsystem.hpp
+ * @author Jovan Ivosevic
+ * @brief Scene lights, packed into a buffer texture read by phong_material_texture.frag
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "glhandle.hpp"
+#include "lightclusters.hpp"
+#include "shadervariants.hpp"
+#include "uniformbuffer.hpp"
+
+// NOTE(Jovan): Texture unit the light buffer texture is bound to. Units 3 and 4 are the cluster
+// grid and index, 5 and 6 the virtual texture atlas and page table, 7 and up the material
+// texture arrays. Units 0 and 1 are left to the benchmark's stand-in textures
+#define LIGHT_TEXTURE_UNIT 2
+// NOTE(Jovan): RGBA32F texels per light. Must match LIGHT_TEXELS in phong_material_texture.frag
+#define LIGHT_TEXELS 6
+// NOTE(Jovan): A light's range ends where its attenuation brings it below 1/256 of its intensity
+#define LIGHT_ATTENUATION_CUTOFF 256.0f
+
+// NOTE(Jovan): Must match light types in phong_material_texture.frag
+enum ELightType {
+    LIGHT_TYPE_POINT = 0,
+    LIGHT_TYPE_SPOT = 1,
+    LIGHT_TYPE_DIRECTIONAL = 2,
+};
+
+struct Light {
+    ELightType Type;
+    bool Enabled;
+    // NOTE(Jovan): Unused by directional lights
+    glm::vec3 Position;
+    // NOTE(Jovan): Unused by point lights
+    glm::vec3 Direction;
+    glm::vec3 Ka;
+    glm::vec3 Kd;
+    glm::vec3 Ks;
+    // NOTE(Jovan): Attenuation, unused by directional lights
+    float Kc;
+    float Kl;
+    float Kq;
+    // NOTE(Jovan): Cosines of the cone angles, spot lights only
+    float InnerCutOff;
+    float OuterCutOff;
+
+    Light();
+};
+
+/**
+ * @brief Owns all lights of a scene. Enabled lights are packed into a buffer texture once
+ * per frame, together with the range past which each of them can be skipped.
+ *
+ * Lights with unbounded range (directional and non-attenuating) are packed first and shaded
+ * for every fragment. The rest are assigned to view frustum clusters so a fragment only
+ * shades the ones that can reach it
+ *
+ */
+class LightSystem {
+public:
+    LightSystem();
+
+    /**
+     * @brief Adds a light
+     *
+     * @param light - Light
+     *
+     * @returns Light index, valid for the lifetime of the system
+     */
+    unsigned Add(const Light& light);
+
+    /**
+     * @brief Returns a light for modification. Changes are seen by the GPU after the next Upload
+     *
+     * @param index - Index returned by Add
+     *
+     * @returns Light
+     */
+    Light& Get(unsigned index);
+
+    unsigned GetCount() const;
+
+    /**
+     * @brief Returns the number of lights written by the last Upload
+     *
+     */
+    unsigned GetUploadedCount() const;
+
+    /**
+     * @brief Packs enabled lights into the light buffer, assigns them to clusters, updates
+     * the Lights uniform block and binds the buffer textures
+     *
+     * @param projection - Projection matrix, symmetric perspective
+     * @param view - View matrix
+     * @param width - Viewport width in pixels
+     * @param height - Viewport height in pixels
+     */
+    void Upload(const glm::mat4& projection, const glm::mat4& view, unsigned width, unsigned height);
+
+    /**
+     * @brief Changes cluster grid resolution, see LightClusters::SetGrid
+     *
+     */
+    void SetClusterGrid(unsigned x, unsigned y, unsigned z);
+
+    /**
+     * @brief Returns shader features the lights of the last Upload need
+     *
+     * @returns SHADER_FEATURE_SPOT_LIGHTS and SHADER_FEATURE_LOCAL_LIGHTS bits
+     */
+    unsigned GetShaderFeatures() const;
+
+    /**
+     * @brief Returns cluster stats of the last Upload
+     *
+     */
+    const ClusterStats& GetClusterStats() const;
+
+    /**
+     * @brief Points a program's light samplers at the light system's texture units.
+     * The program must be in use
+     *
+     * @param shader - Program using the Lights block
+     */
+    static void SetupShader(const Shader& shader);
+
+    /**
+     * @brief Returns the distance past which a light contributes less than 1/LIGHT_ATTENUATION_CUTOFF
+     * of its intensity
+     *
+     * @param light - Point or spot light
+     *
+     * @returns Range, a very large value if the light does not attenuate
+     */
+    static float GetRange(const Light& light);
+
+private:
+    std::vector<Light> mLights;
+    // NOTE(Jovan): Kept between frames so uploading does not allocate
+    std::vector<glm::vec4> mPacked;
+    // NOTE(Jovan): World space spheres of the clustered lights, in packing order
+    std::vector<glm::vec4> mSpheres;
+    unsigned mUploadedCount;
+    unsigned mShaderFeatures;
+    unsigned mBufferCapacity;
+    BufferHandle mBuffer;
+    TextureHandle mTexture;
+    UniformBuffer mBlock;
+    LightClusters mClusters;
+
+    /**
+     * @brief Appends a light to the packed data
+     *
+     * @param light - Light
+     * @param range - Light range
+     */
+    void pack(const Light& light, float range);
+};
@@ -8,9 +8,19 @@
 #include <chrono>
 #include <thread>
 #include "shader.hpp"
+#include "shadervariants.hpp"
 #include "camera.hpp"
 #include "model.hpp"
 #include "texture.hpp"
+#include "texturecache.hpp"
+#include "compressedtexture.hpp"
+#include "benchmark.hpp"
+#include "instancebatch.hpp"
+#include "uniformbuffer.hpp"
+#include "lightsystem.hpp"
+#include "materialsystem.hpp"
+#include "virtualtexturesystem.hpp"
+#include "renderqueue.hpp"
 
 float
 Clamp(float x, float min, float max) {
@@ -130,35 +140,120 @@ HandleInput(EngineState* state) {
 }
 
 /**
- * @brief Draws flattened cubes
+ * @brief Adds a textured cube to a render queue, unless it is outside the view frustum
  *
- * @param vao - Cube VAO
- * @param shader - Shader
+ * @param queue - Render queue of the current frame
+ * @param cube - Cube range in the float geometry buffer
+ * @param bounds - Cube bounds
+ * @param variants - Shader variants
+ * @param features - Shader features, material features are added
+ * @param model - Model matrix
+ * @param material - Material, see MaterialSystem
+ * @param culler - Culling pass of the current frame
  */
-static void DrawTrava(unsigned vao, const Shader& shader, unsigned diffuse,  unsigned specular) {
-    glUseProgram(shader.GetId());
-    glBindVertexArray(vao);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, diffuse);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, specular);
-
-    float Size = 4.0f;
-    for (int i = -2; i < 4; ++i) {
-        for (int j = -2; j < 4; ++j) {
-            glm::mat4 Model(1.0f);
-            Model = glm::translate(Model, glm::vec3(i * Size, 0.0f, j * Size));
-            Model = glm::scale(Model, glm::vec3(Size, 0.1f, Size));
-            shader.SetModel(Model);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+static void QueueCube(RenderQueue& queue, const GeometryRange& cube, const Bounds& bounds, ShaderVariants& variants, unsigned features, const glm::mat4& model, unsigned material, Culler& culler) {
+    if (!culler.IsVisible(bounds, model)) {
+        return;
+    }
+
+    const Shader& CubeShader = variants.Get(features | MaterialSystem::Get().GetShaderFeatures(material));
+    queue.AddRange(RENDER_PASS_OPAQUE, CubeShader, material, VERTEX_FORMAT_FLOAT, cube, model);
+}
+
+/**
+ * @brief Sets the uniforms of a Phong variant that never change
+ *
+ * @param shader - New Phong variant, in use
+ */
+static void SetupPhongShader(const Shader& shader) {
+    // NOTE(Jovan): Material textures and shininess come from the material system
+    MaterialSystem::SetupShader(shader);
+    LightSystem::SetupShader(shader);
+    // NOTE(Jovan): Cube VAO uses plain float vertices, models set their own dequantization
+    VertexFormat::ResetDequantization(shader);
+}
+
+/**
+ * @brief Sets the uniforms of a virtual texture feedback variant that never change
+ *
+ * @param shader - New feedback variant, in use
+ */
+static void SetupFeedbackShader(const Shader& shader) {
+    VertexFormat::ResetDequantization(shader);
+}
+
+/**
+ * @brief Loads the scene and runs the main loop. Scene resources are owned by locals,
+ * so they are all released when this returns, before the context is destroyed
+ *
+ * @param Window - Window with a current GL context
+ *
+ * @returns Exit code
+ */
+static int
+RunScene(GLFWwindow* Window);
+
+/**
+ * @brief Converts images into block compressed files that are loaded in their place, at
+ * their own size for textures and at TEXTURE_LAYER_SIZE for material layers
+ *
+ * @param Paths - Image paths, the scene's textures if empty
+ *
+ * @returns Exit code
+ */
+static int
+CompressTextures(const std::vector<std::string>& Paths) {
+    std::vector<std::string> Images = Paths;
+    if (Images.empty()) {
+        const char* SceneTextures[] = {
+            "res/trava.jpg", "res/drvo.jpg", "res/krosnja.jpeg", "res/planina.jpg",
+            "res/sunce.jpg", "res/mesec.jpg", "res/trava2_s.jpg", "res/missing_textures.png",
+        };
+        Images.assign(SceneTextures, SceneTextures + sizeof(SceneTextures) / sizeof(SceneTextures[0]));
+    }
+
+    int Result = 0;
+    for (unsigned ImageIdx = 0; ImageIdx < Images.size(); ++ImageIdx) {
+        if (!CompressedTexture::Compress(Images[ImageIdx]) || !CompressedTexture::Compress(Images[ImageIdx], TEXTURE_LAYER_SIZE)) {
+            Result = -1;
         }
     }
+    return Result;
+}
+
+/**
+ * @brief Builds tile pyramids of images used as virtual textures, otherwise built on first use
+ *
+ * @param Paths - Image paths, the scene's virtual textures if empty
+ *
+ * @returns Exit code
+ */
+static int
+BuildVirtualTextures(const std::vector<std::string>& Paths) {
+    std::vector<std::string> Images = Paths;
+    if (Images.empty()) {
+        Images.push_back("res/trava.jpg");
+        Images.push_back("res/planina.jpg");
+    }
 
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    int Result = 0;
+    for (unsigned ImageIdx = 0; ImageIdx < Images.size(); ++ImageIdx) {
+        if (!TilePyramid::Build(Images[ImageIdx])) {
+            Result = -1;
+        }
+    }
+    return Result;
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // NOTE(Jovan): Offline conversion, needs no window or context
+    if (argc > 1 && std::string(argv[1]) == "--compress-textures") {
+        return CompressTextures(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    if (argc > 1 && std::string(argv[1]) == "--build-virtual-textures") {
+        return BuildVirtualTextures(std::vector<std::string>(argv + 2, argv + argc));
+    }
+
     GLFWwindow* Window = 0;
     if (!glfwInit()) {
         std::cerr << "Failed to init glfw" << std::endl;
@@ -184,6 +279,28 @@ int main() {
         return -1;
     }
 
+    // NOTE(Jovan): Shader variants are built in the background where the driver allows it
+    Shader::EnableParallelCompile();
+
+    int Result = 0;
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        Benchmark::Run(std::vector<std::string>(argv + 2, argv + argc));
+    } else {
+        Result = RunScene(Window);
+    }
+
+    // NOTE(Jovan): All GL resource owners are gone by now, the shared buffers go last
+    // while the context is still alive
+    GeometryBuffer::ReleaseAll();
+    VirtualTextureSystem::Get().Release();
+    MaterialSystem::Get().Release();
+    TextureCache::Get().Release();
+    glfwTerminate();
+    return Result;
+}
+
+static int
+RunScene(GLFWwindow* Window) {
     EngineState State = { 0 };
     Camera FPSCamera;
     Input UserInput = { 0 };
@@ -200,18 +317,20 @@ int main() {
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
 
-    //Difuzne strukture
-    unsigned TravaDiffuseTexture = Texture::LoadImageToTexture("res/trava.jpg");
-    unsigned DrvoDiffuseTexture = Texture::LoadImageToTexture("res/drvo.jpg");
-    unsigned KrosnjaDiffuseTexture = Texture::LoadImageToTexture("res/krosnja.jpeg");
-    unsigned PlaninaDiffuseTexture = Texture::LoadImageToTexture("res/planina.jpg");
-    //unsigned Trava1DiffuseTexture = Texture::LoadImageToTexture("res/trava1.jpg");
-    unsigned SunceDiffuseTexture = Texture::LoadImageToTexture("res/sunce.jpg");
-    unsigned MesecDiffuseTexture = Texture::LoadImageToTexture("res/mesec.jpg");
-
-    //spekularne strukture
-    unsigned TravaSpecularTexture = Texture::LoadImageToTexture("res/trava2_s.jpg");
-    //unsigned Trava1SpecularTexture = Texture::LoadImageToTexture("res/trava1_s.jpg");
+    // NOTE(Jovan): Textures decode on the worker pool while the rest of the scene loads,
+    // the missing texture placeholder is drawn until each one is uploaded
+    //Difuzne i spekularne strukture
+    MaterialSystem& Materials = MaterialSystem::Get();
+    VirtualTextureSystem& VirtualTextures = VirtualTextureSystem::Get();
+    // NOTE(Jovan): Ground and mountain stretch one image over a large surface, so their
+    // diffuse textures are virtual and only the tiles in view take video memory
+    unsigned TravaMaterial = Materials.AddVirtual("res/trava.jpg", "res/trava2_s.jpg");
+    unsigned DrvoMaterial = Materials.Add("res/drvo.jpg");
+    unsigned KrosnjaMaterial = Materials.Add("res/krosnja.jpeg");
+    unsigned PlaninaVirtualMaterial = Materials.AddVirtual("res/planina.jpg");
+    //unsigned Trava1Material = Materials.Add("res/trava1.jpg", "res/trava1_s.jpg");
+    unsigned SunceMaterial = Materials.Add("res/sunce.jpg");
+    unsigned MesecMaterial = Materials.Add("res/mesec.jpg");
     
 
 
@@ -260,98 +379,134 @@ int main() {
          0.5f,  0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, // L U
     };
 
-    unsigned CubeVAO;
-    glGenVertexArrays(1, &CubeVAO);
-    glBindVertexArray(CubeVAO);
-    unsigned CubeVBO;
-    glGenBuffers(1, &CubeVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, CubeVBO);
-    glBufferData(GL_ARRAY_BUFFER, CubeVertices.size() * sizeof(float), CubeVertices.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    Model Fox("res/low-poly-fox/low-poly-fox.obj");
+    // NOTE(Jovan): Cube shares the float geometry buffer with float models, so drawing it
+    // between them doesn't need a VAO switch
+    GeometryRange CubeRange;
+    if (!GeometryBuffer::Get(VERTEX_FORMAT_FLOAT).Allocate((const unsigned char*)CubeVertices.data(), CubeVertices.size() / VertexFormat::FLOAT_COMPONENTS, 0, 0, CubeRange)) {
+        std::cerr << "Failed to upload cube\n";
+        return -1;
+    }
+    GeometryBuffer::Unbind();
+    Bounds CubeBounds = Bounds::FromBox(glm::vec3(-0.5f), glm::vec3(0.5f));
+
+    // NOTE(Jovan): Repeated props don't move, so their transforms are set up once and each
+    // group is drawn with a single instanced draw
+    InstanceBatch Trava(VERTEX_FORMAT_FLOAT, CubeRange, CubeBounds);
+    float TravaSize = 4.0f;
+    for (int i = -2; i < 4; ++i) {
+        for (int j = -2; j < 4; ++j) {
+            glm::mat4 Model = glm::translate(glm::mat4(1.0f), glm::vec3(i * TravaSize, 0.0f, j * TravaSize));
+            Trava.Add(glm::scale(Model, glm::vec3(TravaSize, 0.1f, TravaSize)), TravaMaterial);
+        }
+    }
+
+    const glm::vec3 StabloPositions[] = {
+        glm::vec3(-4.0f, 1.0f, 1.0f), glm::vec3(-1.0f, 1.0f, 4.5f), glm::vec3(-5.0f, 1.0f, 6.5f), glm::vec3(6.6f, 1.0f, 6.5f),
+        glm::vec3(9.6f, 1.0f, 4.5f), glm::vec3(10.6f, 1.0f, 9.0f), glm::vec3(5.6f, 1.0f, 10.0f), glm::vec3(-6.6f, 1.0f, -1.0f),
+    };
+    // NOTE(Jovan): Trunks and crowns are all cubes with materials of the same features, so
+    // they're one batch and one draw
+    InstanceBatch Drvece(VERTEX_FORMAT_FLOAT, CubeRange, CubeBounds);
+    for (unsigned StabloIdx = 0; StabloIdx < sizeof(StabloPositions) / sizeof(StabloPositions[0]); ++StabloIdx) {
+        glm::vec3 Position = StabloPositions[StabloIdx];
+        Drvece.Add(glm::scale(glm::translate(glm::mat4(1.0f), Position), glm::vec3(1, 2, 1)), DrvoMaterial);
+        Drvece.Add(glm::scale(glm::translate(glm::mat4(1.0f), Position + glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(1.5)), KrosnjaMaterial);
+    }
+
+    const glm::vec3 UkrasPositions[] = {
+        glm::vec3(-4.0f, 2.0f, 1.8f), glm::vec3(-1.0f, 2.0f, 5.3f), glm::vec3(-5.0f, 2.0f, 7.3f),
+        glm::vec3(10.6f, 2.0f, 9.9f), glm::vec3(5.6f, 2.0f, 10.9f),
+    };
+    // NOTE(Jovan): Ornaments share the mountain's virtual texture instead of loading planina.jpg
+    // a second time as a regular layer. They're tiny, so they're left out of the feedback pass
+    // and sample whatever tiles the mountain keeps resident
+    InstanceBatch Ukrasi(VERTEX_FORMAT_FLOAT, CubeRange, CubeBounds);
+    for (unsigned UkrasIdx = 0; UkrasIdx < sizeof(UkrasPositions) / sizeof(UkrasPositions[0]); ++UkrasIdx) {
+        Ukrasi.Add(glm::scale(glm::translate(glm::mat4(1.0f), UkrasPositions[UkrasIdx]), glm::vec3(0.1)), PlaninaVirtualMaterial);
+    }
+
+    Model Fox("res/low-poly-fox/low-poly-fox.obj", VERTEX_FORMAT_QUANTIZED_OCT);
     if (!Fox.Load()) {
         std::cerr << "Failed to load fox\n";
-        glfwTerminate();
         return -1;
     }
 
 
-    // NOTE(Jovan): Phong shader with material and texture support
-    Shader PhongShaderMaterialTexture("shaders/basic.vert", "shaders/phong_material_texture.frag");
+    // NOTE(Jovan): Phong shader with material and texture support, one variant per feature set in use
+    ShaderVariants PhongVariants("shaders/basic.vert", "shaders/phong_material_texture.frag", SetupPhongShader);
+    // NOTE(Jovan): Every variant the scene can need is submitted up front. Until one is built,
+    // draws use its fallback instead of stalling the frame
+    for (unsigned Features = 0; Features < (1u << SHADER_FEATURE_COUNT); ++Features) {
+        PhongVariants.Request(Features);
+    }
     Shader ColorShader("shaders/color.vert", "shaders/color.frag");
-    glUseProgram(PhongShaderMaterialTexture.GetId());
+    // NOTE(Jovan): Draws virtual textured geometry into the feedback framebuffer, see VirtualTextureSystem
+    ShaderVariants FeedbackVariants("shaders/basic.vert", "shaders/virtual_feedback.frag", SetupFeedbackShader);
+    FeedbackVariants.Request(0);
+    FeedbackVariants.Request(SHADER_FEATURE_INSTANCED);
    
-    //Kamen1
-    PhongShaderMaterialTexture.SetUniform3f("uKamenLight.Ka", glm::vec3(0.4, 0.1, 0.5));
-    PhongShaderMaterialTexture.SetUniform3f("uKamenLight.Kd", glm::vec3(0.4, 0.1, 0.5));
-    PhongShaderMaterialTexture.SetUniform3f("uKamenLight.Ks", glm::vec3(3));
-
-    //Kamen2
-    PhongShaderMaterialTexture.SetUniform3f("uKamenLight1.Ka", glm::vec3(0.4, 0.1, 0.5));
-    PhongShaderMaterialTexture.SetUniform3f("uKamenLight1.Kd", glm::vec3(0.4, 0.1, 0.5));
-    PhongShaderMaterialTexture.SetUniform3f("uKamenLight1.Ks", glm::vec3(3));
-
-    //Kamen3
-    PhongShaderMaterialTexture.SetUniform3f("uKamenLight2.Ka", glm::vec3(0.4, 0.1, 0.5));
-    PhongShaderMaterialTexture.SetUniform3f("uKamenLight2.Kd", glm::vec3(0.4, 0.1, 0.5));
-    PhongShaderMaterialTexture.SetUniform3f("uKamenLight2.Ks", glm::vec3(3));
-
-    //Kamen4
-    PhongShaderMaterialTexture.SetUniform3f("uKamenLight3.Ka", glm::vec3(0.4, 0.1, 0.5));
-    PhongShaderMaterialTexture.SetUniform3f("uKamenLight3.Kd", glm::vec3(0.4, 0.1, 0.5));
-    PhongShaderMaterialTexture.SetUniform3f("uKamenLight3.Ks", glm::vec3(3));
-
-    //Kamen5
-    PhongShaderMaterialTexture.SetUniform3f("uKamenLight4.Ka", glm::vec3(0.4, 0.1, 0.5));
-    PhongShaderMaterialTexture.SetUniform3f("uKamenLight4.Kd", glm::vec3(0.4, 0.1, 0.5));
-    PhongShaderMaterialTexture.SetUniform3f("uKamenLight4.Ks", glm::vec3(3));
+    // NOTE(Jovan): CPU copy of the Frame uniform block, uploaded once per frame
+    FrameUniforms FrameData = {};
+    UniformBuffer FrameBuffer(UNIFORM_BINDING_FRAME, sizeof(FrameUniforms));
+    LightSystem SceneLights;
+
+    //Kamen1..5
+    Light Kamen;
+    Kamen.Ka = glm::vec3(0.4, 0.1, 0.5);
+    Kamen.Kd = glm::vec3(0.4, 0.1, 0.5);
+    Kamen.Ks = glm::vec3(3);
+    const glm::vec3 KamenLightPositions[] = {
+        glm::vec3(-4.0f, 2.0f, 1.8f), glm::vec3(-1.0f, 2.0f, 5.3f), glm::vec3(-5.0f, 2.0f, 7.3f),
+        glm::vec3(10.6f, 2.0f, 10.0f), glm::vec3(5.6f, 2.0f, 11.0f),
+    };
+    const unsigned KamenLightCount = sizeof(KamenLightPositions) / sizeof(KamenLightPositions[0]);
+    unsigned KamenLights[KamenLightCount];
+    for (unsigned KamenIdx = 0; KamenIdx < KamenLightCount; ++KamenIdx) {
+        Kamen.Position = KamenLightPositions[KamenIdx];
+        KamenLights[KamenIdx] = SceneLights.Add(Kamen);
+    }
 
     //Sunce
-    PhongShaderMaterialTexture.SetUniform3f("uSunceLight.Ka", glm::vec3(0.4, 0.1, 0.5));
-    PhongShaderMaterialTexture.SetUniform3f("uSunceLight.Kd", glm::vec3(0.4, 0.1, 0.5));
-    PhongShaderMaterialTexture.SetUniform3f("uSunceLight.Ks", glm::vec3(3));
+    Light Sunce;
+    Sunce.Ka = glm::vec3(0.4, 0.1, 0.5);
+    Sunce.Kd = glm::vec3(0.4, 0.1, 0.5);
+    Sunce.Ks = glm::vec3(3);
+    unsigned SunceLight = SceneLights.Add(Sunce);
 
     //Mesec
-    PhongShaderMaterialTexture.SetUniform3f("uMesecLight.Ka", glm::vec3(0.1, 0.2, 0.9));
-    PhongShaderMaterialTexture.SetUniform3f("uMesecLight.Kd", glm::vec3(0.1, 0.2, 0.9));
-    PhongShaderMaterialTexture.SetUniform3f("uMesecLight.Ks", glm::vec3(3));
-
+    Light Mesec;
+    Mesec.Ka = glm::vec3(0.1, 0.2, 0.9);
+    Mesec.Kd = glm::vec3(0.1, 0.2, 0.9);
+    Mesec.Ks = glm::vec3(3);
+    unsigned MesecLight = SceneLights.Add(Mesec);
+
+    //usmereno svetlo, boje se menjaju za dan i noc
+    Light Dir;
+    Dir.Type = LIGHT_TYPE_DIRECTIONAL;
+    Dir.Direction = glm::vec3(0, -0.1, 0);
+    unsigned DirLight = SceneLights.Add(Dir);
 
     //svetlo za dan reflektorno
-    PhongShaderMaterialTexture.SetUniform3f("uReflektorLight1.Ka", glm::vec3(1.4, 0.1, 0.5));
-    PhongShaderMaterialTexture.SetUniform3f("uReflektorLight1.Kd", glm::vec3(1.4, 0.1, 0.5));
-    PhongShaderMaterialTexture.SetUniform3f("uReflektorLight1.Ks", glm::vec3(3));
+    Light Reflektor1;
+    Reflektor1.Type = LIGHT_TYPE_SPOT;
+    Reflektor1.Ka = glm::vec3(1.4, 0.1, 0.5);
+    Reflektor1.Kd = glm::vec3(1.4, 0.1, 0.5);
+    Reflektor1.Ks = glm::vec3(3);
     //koliko je svetlo udaljeno
-    PhongShaderMaterialTexture.SetUniform1f("uReflektorLight1.Kc", 1.0f);
-    PhongShaderMaterialTexture.SetUniform1f("uReflektorLight1.Kl", 0.0002f);
-    PhongShaderMaterialTexture.SetUniform1f("uReflektorLight1.Kq", 0.0002f);
-    PhongShaderMaterialTexture.SetUniform1f("uReflektorLight1.InnerCutOff", glm::cos(glm::radians(5.0f)));
-    PhongShaderMaterialTexture.SetUniform1f("uReflektorLight1.OuterCutOff", glm::cos(glm::radians(10.0f)));
+    Reflektor1.Kc = 1.0f;
+    Reflektor1.Kl = 0.0002f;
+    Reflektor1.Kq = 0.0002f;
+    Reflektor1.InnerCutOff = glm::cos(glm::radians(5.0f));
+    Reflektor1.OuterCutOff = glm::cos(glm::radians(10.0f));
+    unsigned ReflektorLight1 = SceneLights.Add(Reflektor1);
 
     //svetlo za dan reflektorno za noc
-    PhongShaderMaterialTexture.SetUniform3f("uReflektorLight2.Ka", glm::vec3(0.0, 0.50, 0.74));
-    PhongShaderMaterialTexture.SetUniform3f("uReflektorLight2.Kd", glm::vec3(0.0, 0.50, 0.74));
-    PhongShaderMaterialTexture.SetUniform3f("uReflektorLight2.Ks", glm::vec3(1));
-    PhongShaderMaterialTexture.SetUniform1f("uReflektorLight2.Kc", 1.0f);
-    PhongShaderMaterialTexture.SetUniform1f("uReflektorLight2.Kl", 0.0002f);
-    PhongShaderMaterialTexture.SetUniform1f("uReflektorLight2.Kq", 0.0002f);
-    PhongShaderMaterialTexture.SetUniform1f("uReflektorLight2.InnerCutOff", glm::cos(glm::radians(5.0f)));
-    PhongShaderMaterialTexture.SetUniform1f("uReflektorLight2.OuterCutOff", glm::cos(glm::radians(10.0f)));
-    
-    // NOTE(Jovan): Diminishes the light's diffuse component by half, tinting it slightly red
-    PhongShaderMaterialTexture.SetUniform1i("uMaterial.Kd", 0);
-    // NOTE(Jovan): Makes the object really shiny
-    PhongShaderMaterialTexture.SetUniform1i("uMaterial.Ks", 1);
-    PhongShaderMaterialTexture.SetUniform1f("uMaterial.Shininess", 32.0f);
-    glUseProgram(0);
+    Light Reflektor2 = Reflektor1;
+    Reflektor2.Ka = glm::vec3(0.0, 0.50, 0.74);
+    Reflektor2.Kd = glm::vec3(0.0, 0.50, 0.74);
+    Reflektor2.Ks = glm::vec3(1);
+    unsigned ReflektorLight2 = SceneLights.Add(Reflektor2);
+
 
     
 
@@ -378,8 +533,18 @@ int main() {
 
    
 
-    // NOTE(Jovan): Currently used shader
-    Shader* CurrentShader = &PhongShaderMaterialTexture;
+    glm::mat4 PlaninaModel = glm::mat4(1.0f);
+    PlaninaModel = glm::translate(PlaninaModel, glm::vec3(7.6f, 3.1f, -6.0f));
+    PlaninaModel = glm::scale(PlaninaModel, glm::vec3(7, 7, 4));
+
+    Culler SceneCuller;
+    // NOTE(Jovan): Separate from SceneCuller so the feedback pass doesn't count towards drawn objects
+    Culler FeedbackCuller;
+    // NOTE(Jovan): Draws are collected into queues and submitted sorted by state
+    RenderQueue SceneQueue;
+    RenderQueue FeedbackQueue;
+    std::string LastTitle;
+    bool TexturesStreamed = false;
     glClearColor(0.53f, 0.81f, 0.98f, 1.0f);
     while (!glfwWindowShouldClose(Window)) {
         glfwPollEvents();
@@ -391,31 +556,44 @@ int main() {
         // If laggy, remove this line
         Projection = glm::perspective(45.0f, WindowWidth / (float)WindowHeight, 0.1f, 100.0f);
         View = glm::lookAt(FPSCamera.GetPosition(), FPSCamera.GetTarget(), FPSCamera.GetUp());
+        SceneCuller.BeginFrame(Projection, View);
         StartTime = glfwGetTime();
        
         
 
-        //prikaz modela 
-        glUseProgram(CurrentShader->GetId());
-        CurrentShader->SetProjection(Projection);
-        CurrentShader->SetView(View);
-        CurrentShader->SetUniform3f("uViewPos", FPSCamera.GetPosition());
-        
-
-        DrawTrava(CubeVAO, *CurrentShader, TravaDiffuseTexture, TravaSpecularTexture);
-
-
-        // NOTE(Jovan): Rotate point light around 0, 0, -2
-       // glm::vec3 PointLightPosition(Distance * cos(Angle), 2.0f, -2.0f + Distance * sin(Angle));
-        //CurrentShader->SetUniform3f("uPointLight.Position", PointLightPosition);
-        //Angle += State.mDT;
+        FrameData.Projection = Projection;
+        FrameData.View = View;
+        FrameData.ViewProjection = Projection * View;
+        FrameData.ViewPosition = FPSCamera.GetPosition();
+        FrameData.Time = StartTime;
+        FrameBuffer.Update(&FrameData);
+
+        // NOTE(Jovan): Uploads a bounded amount of streamed layers per frame and binds the
+        // material array, the only texture bind of the frame
+        Materials.Update();
+        if (!TexturesStreamed) {
+            MaterialStats Stats = Materials.GetStats();
+            VirtualTextureStats VirtualStats = VirtualTextures.GetStats();
+            if (!Stats.Pending && !VirtualStats.PendingTiles) {
+                TexturesStreamed = true;
+                std::cout << "Materials: " << Stats.Materials << " materials, " << Stats.Layers << " layers, "
+                    << Stats.BytesResident / 1024 << "KB resident" << std::endl;
+                std::cout << "Virtual textures: " << VirtualStats.Textures << " textures, " << VirtualStats.ResidentTiles
+                    << " tiles, " << VirtualStats.BytesResident / 1024 << "KB resident" << std::endl;
+            }
+        }
 
-        
-        //lisica model
-        ModelMatrix = glm::mat4(1.0f);
-        ModelMatrix = glm::translate(ModelMatrix, glm::vec3(1.0f, 0.7f, 9.0f));
-        CurrentShader->SetModel(ModelMatrix);
-        Fox.Render();
+        // NOTE(Jovan): Tiles wanted by earlier frames' feedback are uploaded first, then this
+        // frame's feedback is drawn. It's read back a few frames later, never waited for
+        VirtualTextures.Update();
+        if (VirtualTextures.BeginFeedback(WindowWidth, WindowHeight)) {
+            FeedbackCuller.BeginFrame(Projection, View);
+            FeedbackQueue.Begin(View);
+            Trava.Enqueue(FeedbackQueue, FeedbackVariants, 0, FeedbackCuller);
+            QueueCube(FeedbackQueue, CubeRange, CubeBounds, FeedbackVariants, 0, PlaninaModel, PlaninaVirtualMaterial, FeedbackCuller);
+            FeedbackQueue.Submit();
+            VirtualTextures.EndFeedback(WindowWidth, WindowHeight);
+        }
 
         if (glfwGetKey(Window, GLFW_KEY_N) == GLFW_PRESS)
         {
@@ -426,486 +604,90 @@ int main() {
             is_day = true;
         }
 
+        // NOTE(Jovan): All lights are set before anything is drawn and uploaded in one go.
+        // Sun and day spotlight only shine by day, moon and night spotlight only by night
+        glm::vec3 point_light_position_sun(-1.0f, 6.7f, 7.0f);
+        float Flicker = 1.0f / abs(sin(StartTime));
+        Light& Directional = SceneLights.Get(DirLight);
+        Light& Sky = SceneLights.Get(is_day ? SunceLight : MesecLight);
+        Light& Reflektor = SceneLights.Get(is_day ? ReflektorLight1 : ReflektorLight2);
+        SceneLights.Get(SunceLight).Enabled = is_day;
+        SceneLights.Get(ReflektorLight1).Enabled = is_day;
+        SceneLights.Get(MesecLight).Enabled = !is_day;
+        SceneLights.Get(ReflektorLight2).Enabled = !is_day;
         if (is_day) {
             glClearColor(0.53f, 0.81f, 0.98f, 1.0f);
-
-            glm::vec3 point_light_position_sun(-1.0f, 6.7f, 7.0f); 
-            
-            CurrentShader->SetUniform3f("uDirLight.Direction", glm::vec3(0, -0.1, 0));
-            CurrentShader->SetUniform3f("uDirLight.Ka", glm::vec3(0.8, 0.8, 0.3));
-            CurrentShader->SetUniform3f("uDirLight.Kd", glm::vec3(0.8, 0.8, 0.3));
-            CurrentShader->SetUniform3f("uDirLight.Ks", glm::vec3(0.88, 1.0, 0.0));
-
-
-            CurrentShader->SetUniform3f("uReflektorLight1.Position", point_light_position_sun);
-            CurrentShader->SetUniform3f("uReflektorLight1.Direction", glm::vec3(5.5, -20, 5.0));
-            /*
-            glUseProgram(ColorShader.GetId());
-            ColorShader.SetProjection(Projection);
-            ColorShader.SetView(View);
-
-            //sunce
-           
-            model_matrix = glm::mat4(1.0f);
-            model_matrix = glm::translate(model_matrix, point_light_position_sun);
-            model_matrix = glm::scale(model_matrix, glm::vec3(3,2,2));
-            ColorShader.SetModel(model_matrix); 
-            unsigned int colorOffsetLocation = glGetUniformLocation(ColorShader.GetId(), "offset"); //Nadji adresu uniforme
-            glUniform3f(colorOffsetLocation, 0.9, 1.0, 0.0);
-            ColorShader.SetUniform4m("uMVP", Projection * View * model_matrix);
-
-            */
-
-            CurrentShader->SetUniform3f("uSunceLight.Position", point_light_position_sun);
-            CurrentShader->SetUniform1f("uSunceLight.Kc", 0.1 / abs(sin(StartTime)));
-            CurrentShader->SetUniform1f("uSunceLight.Kl", 0.1 / abs(sin(StartTime)));
-            CurrentShader->SetUniform1f("uSunceLight.Kq", 1.0 / abs(sin(StartTime)));
-           
-            model_matrix = glm::mat4(1.0f);
-            model_matrix = glm::translate(model_matrix, point_light_position_sun);
-            model_matrix = glm::scale(model_matrix, glm::vec3(1));
-            CurrentShader->SetModel(model_matrix);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, SunceDiffuseTexture);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, SunceDiffuseTexture);
-            glBindVertexArray(CubeVAO);
-            glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-
-            glBindVertexArray(CubeVAO);
-            glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
+            Directional.Ka = glm::vec3(0.8, 0.8, 0.3);
+            Directional.Kd = glm::vec3(0.8, 0.8, 0.3);
+            Directional.Ks = glm::vec3(0.88, 1.0, 0.0);
         }
 
         else {
-        
-            glm::vec3 point_light_position_sun(-1.0f, 6.7f, 7.0f);
             glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-            glUseProgram(PhongShaderMaterialTexture.GetId());
-           
-            CurrentShader->SetUniform3f("uDirLight.Direction", glm::vec3(0, -0.1, 0));
             //ambijentno
-            CurrentShader->SetUniform3f("uDirLight.Ka", glm::vec3(0.1, 0.2, 0.4));
+            Directional.Ka = glm::vec3(0.1, 0.2, 0.4);
             //difuzno
-            CurrentShader->SetUniform3f("uDirLight.Kd", glm::vec3(0.1, 0.2, 0.4));
+            Directional.Kd = glm::vec3(0.1, 0.2, 0.4);
             //reflektivno 
-            CurrentShader->SetUniform3f("uDirLight.Ks", glm::vec3(0.6,0.5,0.6));
-          
-
-            CurrentShader->SetUniform3f("uReflektorLight2.Position", point_light_position_sun);
-            CurrentShader->SetUniform3f("uReflektorLight2.Direction", glm::vec3(5.5, -20, 5.0));
-            
-            /*
-            glUseProgram(ColorShader.GetId());
-            ColorShader.SetProjection(Projection);
-            ColorShader.SetView(View);
-
-            //sunce
-            
-            model_matrix = glm::mat4(1.0f);
-            model_matrix = glm::translate(model_matrix, point_light_position_sun);
-            model_matrix = glm::scale(model_matrix, glm::vec3(3, 2, 2));
-            ColorShader.SetModel(model_matrix);
-
-            unsigned int colorOffsetLocation = glGetUniformLocation(ColorShader.GetId(), "offset"); //Nadji adresu uniforme
-            glUniform3f(colorOffsetLocation, 0.3, 0.5, 0.6);
-            ColorShader.SetUniform4m("uMVP", Projection * View * model_matrix);*/
-            
-
-            CurrentShader->SetUniform3f("uMesecLight.Position", point_light_position_sun);
-            CurrentShader->SetUniform1f("uMesecLight.Kc", 0.1 / abs(sin(StartTime)));
-            CurrentShader->SetUniform1f("uMesecLight.Kl", 0.1 / abs(sin(StartTime)));
-            CurrentShader->SetUniform1f("uMesecLight.Kq", 1.0 / abs(sin(StartTime)));
-
-            model_matrix = glm::mat4(1.0f);
-            model_matrix = glm::translate(model_matrix, point_light_position_sun);
-            model_matrix = glm::scale(model_matrix, glm::vec3(1));
-            CurrentShader->SetModel(model_matrix);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, MesecDiffuseTexture);
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, MesecDiffuseTexture);
-            glBindVertexArray(CubeVAO);
-            glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-            
-            glBindVertexArray(CubeVAO);
-            glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-
-
+            Directional.Ks = glm::vec3(0.6,0.5,0.6);
         }
+        Reflektor.Position = point_light_position_sun;
+        Reflektor.Direction = glm::vec3(5.5, -20, 5.0);
+        Sky.Position = point_light_position_sun;
+        Sky.Kc = 0.1f * Flicker;
+        Sky.Kl = 0.1f * Flicker;
+        Sky.Kq = 1.0f * Flicker;
+
+        //ukrasi na drvetu
+        for (unsigned KamenIdx = 0; KamenIdx < KamenLightCount; ++KamenIdx) {
+            Light& Ukras = SceneLights.Get(KamenLights[KamenIdx]);
+            Ukras.Kc = 0.1f * Flicker;
+            Ukras.Kl = 0.1f * Flicker;
+            Ukras.Kq = 1.0f * Flicker;
+        }
+        SceneLights.Upload(Projection, View, WindowWidth, WindowHeight);
 
-        glUseProgram(PhongShaderMaterialTexture.GetId());
-        //Stablo1
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, glm::vec3(-4.0f, 1.0f, 1.0f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(1, 2, 1));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, DrvoDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, DrvoDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-        //Stablo2
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, glm::vec3(-1.0f, 1.0f, 4.5f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(1, 2, 1));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, DrvoDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, DrvoDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-        //Stablo3
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, glm::vec3(-5.0f, 1.0f, 6.5f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(1, 2, 1));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, DrvoDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, DrvoDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-        //Stablo4
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, glm::vec3(6.6f, 1.0f, 6.5f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(1, 2, 1));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, DrvoDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, DrvoDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-        //Stablo5
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, glm::vec3(9.6f, 1.0f, 4.5f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(1, 2, 1));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, DrvoDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, DrvoDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-
-        //Stablo6
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, glm::vec3(10.6f, 1.0f, 9.0f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(1, 2, 1));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, DrvoDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, DrvoDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-
-        //Stablo7
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, glm::vec3(5.6f, 1.0f, 10.0f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(1, 2, 1));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, DrvoDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, DrvoDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-        //Stablo8
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, glm::vec3(-6.6f, 1.0f, -1.0f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(1, 2, 1));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, DrvoDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, DrvoDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
+        //prikaz modela 
+        // NOTE(Jovan): Lighting features are shared by every draw, material features are added per draw
+        unsigned LightFeatures = SceneLights.GetShaderFeatures();
+        SceneQueue.Begin(View);
+        Trava.Enqueue(SceneQueue, PhongVariants, LightFeatures | Materials.GetShaderFeatures(TravaMaterial), SceneCuller);
 
+        //lisica model
+        ModelMatrix = glm::mat4(1.0f);
+        ModelMatrix = glm::translate(ModelMatrix, glm::vec3(1.0f, 0.7f, 9.0f));
+        Fox.Enqueue(SceneQueue, PhongVariants, LightFeatures, ModelMatrix, SceneCuller);
 
-        //krosnja1
-       //glm::vec3 point_light_position_sun(10, 10, 0);
+        //sunce ili mesec
         model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, glm::vec3(-4.0f, 2.0f, 1.0f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(1.5));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, KrosnjaDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, KrosnjaDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-        //krosnja2
-      //glm::vec3 point_light_position_sun(10, 10, 0);
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, glm::vec3(-1.0f, 2.0f, 4.5f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(1.5));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, KrosnjaDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, KrosnjaDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-        //krosnja3
-   //glm::vec3 point_light_position_sun(10, 10, 0);
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, glm::vec3(-5.0f, 2.0f, 6.5f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(1.5));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, KrosnjaDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, KrosnjaDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-
-        //krosnja4
-   //glm::vec3 point_light_position_sun(10, 10, 0);
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, glm::vec3(6.6f, 2.0f, 6.5f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(1.5));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, KrosnjaDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, KrosnjaDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-
-        //krosnja5
-   //glm::vec3 point_light_position_sun(10, 10, 0);
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, glm::vec3(9.6f, 2.0f, 4.5f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(1.5));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, KrosnjaDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, KrosnjaDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-        //krosnja6
-//glm::vec3 point_light_position_sun(10, 10, 0);
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, glm::vec3(10.6f, 2.0f, 9.0f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(1.5));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, KrosnjaDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, KrosnjaDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-
-        //krosnja7
-//glm::vec3 point_light_position_sun(10, 10, 0);
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, glm::vec3(5.6f, 2.0f, 10.0f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(1.5));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, KrosnjaDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, KrosnjaDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-
-        //krosnja8
-//glm::vec3 point_light_position_sun(10, 10, 0);
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, glm::vec3(-6.6f, 2.0f, -1.0f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(1.5));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, KrosnjaDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, KrosnjaDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
+        model_matrix = glm::translate(model_matrix, point_light_position_sun);
+        model_matrix = glm::scale(model_matrix, glm::vec3(1));
+        QueueCube(SceneQueue, CubeRange, CubeBounds, PhongVariants, LightFeatures, model_matrix, is_day ? SunceMaterial : MesecMaterial, SceneCuller);
 
+        Drvece.Enqueue(SceneQueue, PhongVariants, LightFeatures, SceneCuller);
+        Ukrasi.Enqueue(SceneQueue, PhongVariants, LightFeatures | Materials.GetShaderFeatures(PlaninaVirtualMaterial), SceneCuller);
 
         //planina
-        model_matrix = glm::mat4(1.0f);
-        /*model_matrix = glm::translate(model_matrix, glm::vec3(7.6f, -3.1f, -6.0f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(9, 9, 9));
-        model_matrix = glm::rotate(model_matrix, glm::radians(45.0f), glm::vec3(0, 1, 0));
-        model_matrix = glm::rotate(model_matrix, glm::radians(90.0f), glm::vec3(1, 1, 0));*/
-
-        model_matrix = glm::translate(model_matrix, glm::vec3(7.6f, 3.1f, -6.0f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(7, 7, 4));
-
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, PlaninaDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, PlaninaDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-
-
-        //ukras na drvetu1
-        glm::vec3 point_light_position_ukras1(-4.0f, 2.0f, 1.8f);
-        CurrentShader->SetUniform3f("uKamenLight.Position", point_light_position_ukras1);
-        CurrentShader->SetUniform1f("uKamenLight.Kc", 0.1 / abs(sin(StartTime )));
-        CurrentShader->SetUniform1f("uKamenLight.Kl", 0.1 / abs(sin(StartTime )));
-        CurrentShader->SetUniform1f("uKamenLight.Kq", 1.0 / abs(sin(StartTime )));
-       /*
-        
-        glUseProgram(ColorShader.GetId());
-        ColorShader.SetProjection(Projection);
-        ColorShader.SetView(View);
-
-          
-
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, point_light_position_ukras1);
-        model_matrix = glm::scale(model_matrix, glm::vec3(0.1));
-        ColorShader.SetModel(model_matrix);
-
-        unsigned int colorOffsetLocation = glGetUniformLocation(ColorShader.GetId(), "offset"); //Nadji adresu uniforme
-        glUniform3f(colorOffsetLocation, 0.3, 0.5, 0.6);
-        ColorShader.SetUniform4m("uMVP", Projection * View * model_matrix);
-        */
-
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, point_light_position_ukras1);
-        model_matrix = glm::scale(model_matrix, glm::vec3(0.1));
-        
-        
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, PlaninaDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, PlaninaDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-        
-        //ukras na drvetu2
-        glm::vec3 point_light_position_ukras2( - 1.0f, 2.0f, 5.3f);
-        CurrentShader->SetUniform3f("uKamenLight1.Position", point_light_position_ukras2);
-        CurrentShader->SetUniform1f("uKamenLight1.Kc", 0.1 / abs(sin(StartTime)));
-        CurrentShader->SetUniform1f("uKamenLight1.Kl", 0.1 / abs(sin(StartTime)));
-        CurrentShader->SetUniform1f("uKamenLight1.Kq", 1.0 / abs(sin(StartTime)));
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, point_light_position_ukras2);
-        model_matrix = glm::scale(model_matrix, glm::vec3(0.1));
-
-
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, PlaninaDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, PlaninaDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-
-        //ukras na drvetu3
-        glm::vec3 point_light_position_ukras3(-5.0f, 2.0f, 7.3f);
-        CurrentShader->SetUniform3f("uKamenLight2.Position", point_light_position_ukras3);
-        CurrentShader->SetUniform1f("uKamenLight2.Kc", 0.1 / abs(sin(StartTime)));
-        CurrentShader->SetUniform1f("uKamenLight2.Kl", 0.1 / abs(sin(StartTime)));
-        CurrentShader->SetUniform1f("uKamenLight2.Kq", 1.0 / abs(sin(StartTime)));
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, point_light_position_ukras3);
-        model_matrix = glm::scale(model_matrix, glm::vec3(0.1));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, PlaninaDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, PlaninaDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-        /*
-        //ukras na drvetu4
-        glm::vec3 point_light_position_ukras3(-5.0f, 2.0f, 7.3f);
-        CurrentShader->SetUniform3f("uKamenLight3.Position", point_light_position_ukras3);
-        CurrentShader->SetUniform1f("uKamenLight2.Kc", 0.1 / abs(sin(StartTime)));
-        CurrentShader->SetUniform1f("uKamenLight2.Kl", 0.1 / abs(sin(StartTime)));
-        CurrentShader->SetUniform1f("uKamenLight2.Kq", 1.0 / abs(sin(StartTime)));
-        model_matrix = glm::translate(model_matrix, glm::vec3(6.6f, 2.0f, 7.3f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(0.1));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, PlaninaDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, PlaninaDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-        
-        //ukras na drvetu5
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, glm::vec3(9.6f, 2.0f, 5.5f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(0.1));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, PlaninaDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, PlaninaDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-        */
-
-        //ukras na drvetu6
-        glm::vec3 point_light_position_ukras4(10.6f, 2.0f, 10.0f);
-        CurrentShader->SetUniform3f("uKamenLight3.Position", point_light_position_ukras4);
-        CurrentShader->SetUniform1f("uKamenLight3.Kc", 0.1 / abs(sin(StartTime)));
-        CurrentShader->SetUniform1f("uKamenLight3.Kl", 0.1 / abs(sin(StartTime)));
-        CurrentShader->SetUniform1f("uKamenLight3.Kq", 1.0 / abs(sin(StartTime)));
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, glm::vec3(10.6f, 2.0f, 9.9f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(0.1));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, PlaninaDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, PlaninaDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-        //ukras na drvetu7
-        glm::vec3 point_light_position_ukras5(5.6f, 2.0f, 11.0f);
-        CurrentShader->SetUniform3f("uKamenLight4.Position", point_light_position_ukras5);
-        CurrentShader->SetUniform1f("uKamenLight4.Kc", 0.1 / abs(sin(StartTime)));
-        CurrentShader->SetUniform1f("uKamenLight4.Kl", 0.1 / abs(sin(StartTime)));
-        CurrentShader->SetUniform1f("uKamenLight4.Kq", 1.0 / abs(sin(StartTime)));
-        model_matrix = glm::mat4(1.0f);
-        model_matrix = glm::translate(model_matrix, glm::vec3(5.6f, 2.0f, 10.9f));
-        model_matrix = glm::scale(model_matrix, glm::vec3(0.1));
-        CurrentShader->SetModel(model_matrix);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, PlaninaDiffuseTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, PlaninaDiffuseTexture);
-        glBindVertexArray(CubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-        glBindVertexArray(0);
-        glUseProgram(0);
+        QueueCube(SceneQueue, CubeRange, CubeBounds, PhongVariants, LightFeatures, PlaninaModel, PlaninaVirtualMaterial, SceneCuller);
+        SceneQueue.Submit();
+        GeometryBuffer::Unbind();
+        Shader::UseProgram(0);
         glfwSwapBuffers(Window);
 
+        // NOTE(Jovan): Object counts and state changes, sorted vs in drawing order, shown in
+        // the title, only touched when they change
+        const CullingStats& Stats = SceneCuller.GetStats();
+        const RenderQueueStats& QueueStats = SceneQueue.GetStats();
+        std::string Title = WindowTitle + " | objects: " + std::to_string(Stats.Submitted) + " drawn, " + std::to_string(Stats.Culled) + " culled"
+            + " | draws: " + std::to_string(QueueStats.DrawCalls)
+            + " | programs: " + std::to_string(QueueStats.ProgramSwitches) + "/" + std::to_string(QueueStats.UnsortedProgramSwitches)
+            + " materials: " + std::to_string(QueueStats.MaterialSwitches) + "/" + std::to_string(QueueStats.UnsortedMaterialSwitches)
+            + " VAOs: " + std::to_string(QueueStats.VAOSwitches) + "/" + std::to_string(QueueStats.UnsortedVAOSwitches);
+        if (Title != LastTitle) {
+            LastTitle = Title;
+            glfwSetWindowTitle(Window, Title.c_str());
+        }
+
         // NOTE(Jovan): Time management
         EndTime = glfwGetTime();
         float WorkTime = EndTime - StartTime;
@@ -917,6 +699,5 @@ int main() {
         State.mDT = EndTime - StartTime;
     }
 
-    glfwTerminate();
     return 0;
 }
@@ -0,0 +1,138 @@
+#include "mappedfile.hpp"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile() : mData(0), mSize(0), mFileHandle(INVALID_HANDLE_VALUE), mMappingHandle(0) {}
+#else
+MappedFile::MappedFile() : mData(0), mSize(0), mFileDescriptor(-1) {}
+#endif
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+const unsigned char*
+MappedFile::GetData() const {
+    return mData;
+}
+
+size_t
+MappedFile::GetSize() const {
+    return mSize;
+}
+
+#ifdef _WIN32
+bool
+MappedFile::Open(const std::string& filePath) {
+    Close();
+    mFileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (mFileHandle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER FileSize;
+    if (!GetFileSizeEx(mFileHandle, &FileSize) || FileSize.QuadPart == 0) {
+        Close();
+        return false;
+    }
+
+    mMappingHandle = CreateFileMappingA(mFileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mMappingHandle) {
+        Close();
+        return false;
+    }
+
+    mData = (const unsigned char*)MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (!mData) {
+        Close();
+        return false;
+    }
+
+    mSize = (size_t)FileSize.QuadPart;
+    return true;
+}
+
+void
+MappedFile::Close() {
+    if (mData) {
+        UnmapViewOfFile(mData);
+    }
+    if (mMappingHandle) {
+        CloseHandle(mMappingHandle);
+    }
+    if (mFileHandle != INVALID_HANDLE_VALUE) {
+        CloseHandle(mFileHandle);
+    }
+    mData = 0;
+    mSize = 0;
+    mMappingHandle = 0;
+    mFileHandle = INVALID_HANDLE_VALUE;
+}
+#else
+bool
+MappedFile::Open(const std::string& filePath) {
+    Close();
+    mFileDescriptor = open(filePath.c_str(), O_RDONLY);
+    if (mFileDescriptor < 0) {
+        return false;
+    }
+
+    struct stat FileStat;
+    if (fstat(mFileDescriptor, &FileStat) != 0 || FileStat.st_size == 0) {
+        Close();
+        return false;
+    }
+
+    void* Data = mmap(0, (size_t)FileStat.st_size, PROT_READ, MAP_PRIVATE, mFileDescriptor, 0);
+    if (Data == MAP_FAILED) {
+        Close();
+        return false;
+    }
+
+    mData = (const unsigned char*)Data;
+    mSize = (size_t)FileStat.st_size;
+    return true;
+}
+
+void
+MappedFile::Close() {
+    if (mData) {
+        munmap((void*)mData, mSize);
+    }
+    if (mFileDescriptor >= 0) {
+        close(mFileDescriptor);
+    }
+    mData = 0;
+    mSize = 0;
+    mFileDescriptor = -1;
+}
+#endif
+
+bool
+MappedFile::GetStamp(const std::string& filePath, uint64_t& size, int64_t& modifiedTime) {
+#ifdef _WIN32
+    struct _stat64 FileStat;
+    if (_stat64(filePath.c_str(), &FileStat) != 0) {
+        return false;
+    }
+#else
+    struct stat FileStat;
+    if (stat(filePath.c_str(), &FileStat) != 0) {
+        return false;
+    }
+#endif
+    size = (uint64_t)FileStat.st_size;
+    modifiedTime = (int64_t)FileStat.st_mtime;
+    return true;
+}
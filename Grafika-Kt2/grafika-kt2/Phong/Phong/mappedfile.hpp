@@ -0,0 +1,74 @@
+/**
+ * @file mappedfile.hpp
+ * @author Jovan Ivosevic
+ * @brief Read-only memory mapped file
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Maps the whole file into memory for reading. Closes any previously mapped file
+     *
+     * @param filePath - File path
+     *
+     * @returns true - Success, false - Failure
+     */
+    bool Open(const std::string& filePath);
+
+    /**
+     * @brief Unmaps the file. Pointers returned by GetData are invalid afterwards
+     *
+     */
+    void Close();
+
+    /**
+     * @brief Returns pointer to the start of the mapped file or NULL if nothing is mapped
+     *
+     * @returns Mapped file contents
+     */
+    const unsigned char* GetData() const;
+
+    /**
+     * @brief Returns size of the mapped file in bytes
+     *
+     * @returns Size in bytes
+     */
+    size_t GetSize() const;
+
+    /**
+     * @brief Reads size and modification time of a file, used to detect stale caches
+     *
+     * @param filePath - File path
+     * @param size - Output file size
+     * @param modifiedTime - Output modification time
+     *
+     * @returns true - Success, false - File doesn't exist
+     */
+    static bool GetStamp(const std::string& filePath, uint64_t& size, int64_t& modifiedTime);
+
+private:
+    const unsigned char* mData;
+    size_t mSize;
+#ifdef _WIN32
+    void* mFileHandle;
+    void* mMappingHandle;
+#else
+    int mFileDescriptor;
+#endif
+};
@@ -0,0 +1,161 @@
+#include "materialsystem.hpp"
+#include "texture.hpp"
+#include "virtualtexturesystem.hpp"
+#include <iostream>
+
+MaterialSystem&
+MaterialSystem::Get() {
+    static MaterialSystem Instance;
+    return Instance;
+}
+
+MaterialSystem::MaterialSystem() {
+    mBlockData = MaterialUniforms();
+    mBlockDirty = true;
+    // NOTE(Jovan): Placeholder is material MATERIAL_DEFAULT
+    Add("");
+}
+
+unsigned
+MaterialSystem::Add(const std::string& diffusePath, const std::string& specularPath, float shininess) {
+    return add(diffusePath.empty() ? MISSING_TEXTURE_PATH : diffusePath, specularPath, shininess, -1);
+}
+
+unsigned
+MaterialSystem::AddVirtual(const std::string& diffusePath, const std::string& specularPath, float shininess) {
+    int VirtualTexture = VirtualTextureSystem::Get().Add(diffusePath);
+    // NOTE(Jovan): Placeholder layer is sampled until the virtual texture's coarsest tile is in.
+    // Without room for another virtual texture the image becomes a regular layer
+    return add(VirtualTexture < 0 ? diffusePath : MISSING_TEXTURE_PATH, specularPath, shininess, VirtualTexture);
+}
+
+unsigned
+MaterialSystem::add(const std::string& diffusePath, const std::string& specularPath, float shininess, int virtualTexture) {
+    std::string Key = TextureCache::GetCanonicalPath(diffusePath) + "|"
+        + (specularPath.empty() ? "" : TextureCache::GetCanonicalPath(specularPath)) + "|" + std::to_string(shininess)
+        + "|" + std::to_string(virtualTexture);
+    std::unordered_map<std::string, unsigned>::iterator Existing = mMaterialKeys.find(Key);
+    if (Existing != mMaterialKeys.end()) {
+        return Existing->second;
+    }
+    if (mMaterials.size() >= MATERIAL_MAX_COUNT) {
+        std::cerr << "[Err] Material limit of " << MATERIAL_MAX_COUNT << " reached, " << diffusePath << " uses the default material" << std::endl;
+        return MATERIAL_DEFAULT;
+    }
+
+    MaterialLayers Layers;
+    Layers.Diffuse = TextureCache::Get().LoadLayerAsync(diffusePath);
+    Layers.HasSpecular = !specularPath.empty();
+    Layers.Specular = Layers.HasSpecular ? TextureCache::Get().LoadLayerAsync(specularPath) : Layers.Diffuse;
+    Layers.VirtualTexture = virtualTexture;
+    unsigned Material = (unsigned)mMaterials.size();
+    mMaterials.push_back(Layers);
+    mMaterialKeys[Key] = Material;
+
+    MaterialData& Data = mBlockData.Materials[Material];
+    Data.DiffuseArray = 0;
+    Data.DiffuseLayer = 0;
+    Data.SpecularArray = 0;
+    Data.SpecularLayer = 0;
+    Data.Shininess = shininess;
+    Data.VirtualTexture = virtualTexture;
+    mBlockDirty = true;
+    return Material;
+}
+
+unsigned
+MaterialSystem::GetShaderFeatures(unsigned material) const {
+    if (material >= mMaterials.size()) {
+        return 0;
+    }
+    const MaterialLayers& Layers = mMaterials[material];
+    return (Layers.HasSpecular ? SHADER_FEATURE_SPECULAR_MAP : 0) | (Layers.VirtualTexture >= 0 ? SHADER_FEATURE_VIRTUAL_TEXTURE : 0);
+}
+
+void
+MaterialSystem::Update(size_t budget) {
+    if (!mBlock) {
+        mBlock.reset(new UniformBuffer(UNIFORM_BINDING_MATERIALS, sizeof(MaterialUniforms)));
+    }
+    // NOTE(Jovan): Uploads bind textures on the active unit, which is rebound right after
+    glActiveTexture(GL_TEXTURE0 + MATERIAL_TEXTURE_UNIT);
+    TextureCache& Cache = TextureCache::Get();
+    Cache.Update(budget);
+    // NOTE(Jovan): Growing an array replaces its texture, so they're bound every frame
+    for (unsigned Array = 0; Array < TEXTURE_ARRAY_COUNT; ++Array) {
+        glActiveTexture(GL_TEXTURE0 + MATERIAL_TEXTURE_UNIT + Array);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, Cache.GetArrayId((ETextureArray)Array));
+    }
+    updateBlock();
+}
+
+void
+MaterialSystem::Finish() {
+    glActiveTexture(GL_TEXTURE0 + MATERIAL_TEXTURE_UNIT);
+    TextureCache::Get().Finish();
+    Update();
+}
+
+MaterialStats
+MaterialSystem::GetStats() const {
+    TextureCacheStats CacheStats = TextureCache::Get().GetStats();
+    MaterialStats Stats;
+    Stats.Materials = (unsigned)mMaterials.size();
+    Stats.Layers = CacheStats.Layers;
+    Stats.Pending = CacheStats.Pending;
+    Stats.BytesResident = CacheStats.ArrayBytes;
+    return Stats;
+}
+
+void
+MaterialSystem::Release() {
+    for (unsigned Material = 0; Material < mMaterials.size(); ++Material) {
+        mMaterials[Material].Diffuse = SharedTexture();
+        mMaterials[Material].Specular = SharedTexture();
+    }
+    mBlock.reset();
+    mBlockDirty = true;
+}
+
+void
+MaterialSystem::SetupShader(const Shader& shader) {
+    for (unsigned Array = 0; Array < TEXTURE_ARRAY_COUNT; ++Array) {
+        shader.SetUniform1i("uMaterialLayers[" + std::to_string(Array) + "]", MATERIAL_TEXTURE_UNIT + Array);
+    }
+    VirtualTextureSystem::SetupShader(shader);
+}
+
+void
+MaterialSystem::Select(const Shader& shader, unsigned material) {
+    shader.SetMaterialIndex((int)material);
+}
+
+void
+MaterialSystem::updateBlock() {
+    // NOTE(Jovan): Layers become resident inside the cache, so every material is checked
+    const MaterialLayers& Placeholder = mMaterials[MATERIAL_DEFAULT];
+    for (unsigned Material = 0; Material < mMaterials.size(); ++Material) {
+        const MaterialLayers& Layers = mMaterials[Material];
+        const SharedTexture& Diffuse = Layers.Diffuse.IsResident() ? Layers.Diffuse : Placeholder.Diffuse;
+        const SharedTexture& Specular = Layers.Specular.IsResident() ? Layers.Specular : Placeholder.Diffuse;
+        // NOTE(Jovan): Array 0 layer 0 until even the placeholder is in
+        int DiffuseArray = Diffuse.IsResident() ? Diffuse.GetArray() : 0;
+        int DiffuseLayer = Diffuse.IsResident() ? (int)Diffuse.GetLayer() : 0;
+        int SpecularArray = Specular.IsResident() ? Specular.GetArray() : 0;
+        int SpecularLayer = Specular.IsResident() ? (int)Specular.GetLayer() : 0;
+
+        MaterialData& Data = mBlockData.Materials[Material];
+        if (Data.DiffuseArray != DiffuseArray || Data.DiffuseLayer != DiffuseLayer
+            || Data.SpecularArray != SpecularArray || Data.SpecularLayer != SpecularLayer) {
+            Data.DiffuseArray = DiffuseArray;
+            Data.DiffuseLayer = DiffuseLayer;
+            Data.SpecularArray = SpecularArray;
+            Data.SpecularLayer = SpecularLayer;
+            mBlockDirty = true;
+        }
+    }
+    if (mBlockDirty) {
+        mBlock->Update(&mBlockData);
+        mBlockDirty = false;
+    }
+}
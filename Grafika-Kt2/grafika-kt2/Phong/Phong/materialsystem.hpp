@@ -0,0 +1,152 @@
+/**
+ * @file materialsystem.hpp
+ * @author Jovan Ivosevic
+ * @brief Materials whose textures are layers of shared texture arrays
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "shader.hpp"
+#include "shadervariants.hpp"
+#include "texturecache.hpp"
+#include "uniformbuffer.hpp"
+
+// NOTE(Jovan): First of the TEXTURE_ARRAY_COUNT units the texture arrays are bound to, for
+// the whole frame. Must match uMaterialLayers in phong_material_texture.frag
+#define MATERIAL_TEXTURE_UNIT 7
+#define MATERIAL_DEFAULT_SHININESS 32.0f
+// NOTE(Jovan): Material every draw uses unless told otherwise, the missing texture placeholder
+#define MATERIAL_DEFAULT 0
+
+struct MaterialStats {
+    unsigned Materials;
+    // NOTE(Jovan): Texture array layers in use, the placeholder's included
+    unsigned Layers;
+    // NOTE(Jovan): Textures still decoding or uploading
+    unsigned Pending;
+    // NOTE(Jovan): Video memory of the texture arrays
+    size_t BytesResident;
+};
+
+/**
+ * @brief Owns every material of the scene. Material textures are texture array layers
+ * loaded through TextureCache::LoadLayerAsync, so they are streamed, shared by path and
+ * contents and block compressed when a compressed file exists. The arrays stay bound to
+ * MATERIAL_TEXTURE_UNIT onwards, and the array and layer of each material's textures live
+ * in the Materials uniform block. A draw only sets its material index, a uniform for single
+ * draws and an instance attribute for instanced ones, so draws never bind textures and
+ * copies with different materials can share one instanced draw.
+ *
+ * Until a layer is resident its materials sample the placeholder's layer
+ *
+ */
+class MaterialSystem {
+public:
+    static MaterialSystem& Get();
+
+    /**
+     * @brief Returns a material with the given textures, adding it on first use. Each
+     * image is loaded into one layer, however many materials use it
+     *
+     * @param diffusePath - Diffuse image path, empty for the placeholder
+     * @param specularPath - Specular image path, empty if the diffuse texture doubles as it
+     * @param shininess - Specular exponent
+     *
+     * @returns Material index, MATERIAL_DEFAULT if there's no room for more materials
+     */
+    unsigned Add(const std::string& diffusePath, const std::string& specularPath = "", float shininess = MATERIAL_DEFAULT_SHININESS);
+
+    /**
+     * @brief Same as Add, but the diffuse image is a virtual texture streamed tile by tile
+     * (see VirtualTextureSystem) instead of a layer. Meant for images too large to keep
+     * whole, stretched over large surfaces
+     *
+     * @param diffusePath - Diffuse image path
+     * @param specularPath - Specular image path, a regular layer. Empty if the diffuse texture doubles as it
+     * @param shininess - Specular exponent
+     *
+     * @returns Material index, MATERIAL_DEFAULT if there's no room for more materials
+     */
+    unsigned AddVirtual(const std::string& diffusePath, const std::string& specularPath = "", float shininess = MATERIAL_DEFAULT_SHININESS);
+
+    /**
+     * @brief Returns shader features a material needs
+     *
+     * @param material - Material index
+     *
+     * @returns SHADER_FEATURE_SPECULAR_MAP if it has its own specular texture,
+     * SHADER_FEATURE_VIRTUAL_TEXTURE if its diffuse texture is virtual
+     */
+    unsigned GetShaderFeatures(unsigned material) const;
+
+    /**
+     * @brief Updates the texture cache, updates the Materials block if any material changed
+     * and binds the arrays from MATERIAL_TEXTURE_UNIT onwards. Call once per frame on the
+     * context thread, instead of TextureCache::Update
+     *
+     * @param budget - Bytes of textures that may be uploaded
+     */
+    void Update(size_t budget = TEXTURE_UPLOAD_BUDGET);
+
+    /**
+     * @brief Runs Update until every layer is resident
+     *
+     */
+    void Finish();
+
+    MaterialStats GetStats() const;
+
+    /**
+     * @brief Releases the layers and frees the Materials block. Called before the context goes away
+     *
+     */
+    void Release();
+
+    /**
+     * @brief Points a program's material samplers at their units, virtual texture ones
+     * included. The program must be in use
+     *
+     * @param shader - Program using the Materials block
+     */
+    static void SetupShader(const Shader& shader);
+
+    /**
+     * @brief Selects the material of the following non-instanced draws
+     *
+     * @param shader - Program in use
+     * @param material - Material index
+     */
+    static void Select(const Shader& shader, unsigned material);
+
+private:
+    // NOTE(Jovan): Layers of a material. The Materials block points at the placeholder
+    // instead of a layer until it is resident
+    struct MaterialLayers {
+        SharedTexture Diffuse;
+        SharedTexture Specular;
+        bool HasSpecular;
+        // NOTE(Jovan): -1 for none
+        int VirtualTexture;
+    };
+
+    std::unordered_map<std::string, unsigned> mMaterialKeys;
+    std::vector<MaterialLayers> mMaterials;
+    MaterialUniforms mBlockData;
+    std::unique_ptr<UniformBuffer> mBlock;
+    bool mBlockDirty;
+
+    MaterialSystem();
+    unsigned add(const std::string& diffusePath, const std::string& specularPath, float shininess, int virtualTexture);
+    void updateBlock();
+};
@@ -1,93 +1,227 @@
 #include "mesh.hpp"
+#include <sstream>
 
-Mesh::Mesh(const aiMesh* mesh, const aiMaterial* material, const std::string &resPath) {
-    processMesh(mesh, material, resPath);
+Mesh::Mesh() {
+    mVertexCount = 0;
+    mIndexCount = 0;
+    mIndexType = GL_UNSIGNED_SHORT;
+    mFormat = VERTEX_FORMAT_FLOAT;
+    mMaterial = MATERIAL_DEFAULT;
+    mMin = mMax = glm::vec3(0.0f);
+    mSphere.Center = glm::vec3(0.0f);
+    mSphere.Radius = 0.0f;
+}
+
+Mesh::Mesh(const aiMesh* mesh, const aiMaterial* material, EVertexFormat format) : Mesh() {
+    mFormat = format;
+    processMesh(mesh, material);
+}
+
+Mesh::Mesh(const PackedMesh& packed, const std::string& resPath) {
+    mFormat = packed.Format;
+    mDiffusePath = packed.DiffusePath;
+    mSpecularPath = packed.SpecularPath;
+    mMin = packed.Min;
+    mMax = packed.Max;
+    mSphere = packed.Sphere;
+    mIndexType = packed.IndexType;
+    mIndexChunks = packed.IndexChunks;
+    mMaterial = loadMaterial(resPath);
+    uploadMesh(packed.VertexData, packed.VertexCount, packed.IndexData, packed.IndexCount);
 }
 
 void
-Mesh::Render() const {
-    glBindVertexArray(mVAO);
+Mesh::Upload(const std::string& resPath) {
+    mMaterial = loadMaterial(resPath);
+    uploadMesh(mVertexData.data(), mVertexCount, mIndexData.data(), mIndexCount);
+}
 
-    if (mDiffuseTexture) {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, mDiffuseTexture);
-    }
+Bounds
+Mesh::GetBounds() const {
+    Bounds Result;
+    Result.Box.Min = mMin;
+    Result.Box.Max = mMax;
+    Result.Sphere = mSphere;
+    return Result;
+}
 
-    if (mSpecularTexture) {
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, mSpecularTexture);
-    }
+void
+Mesh::ReleaseCPUData() {
+    std::vector<unsigned char>().swap(mVertexData);
+    std::vector<unsigned char>().swap(mIndexData);
+}
+
+PackedMesh
+Mesh::GetPacked() const {
+    PackedMesh Packed;
+    Packed.VertexData = mVertexData.data();
+    Packed.VertexCount = mVertexCount;
+    Packed.Format = mFormat;
+    Packed.IndexData = mIndexData.data();
+    Packed.IndexCount = mIndexCount;
+    Packed.IndexType = mIndexType;
+    Packed.IndexChunks = mIndexChunks;
+    Packed.DiffusePath = mDiffusePath;
+    Packed.SpecularPath = mSpecularPath;
+    Packed.Min = mMin;
+    Packed.Max = mMax;
+    Packed.Sphere = mSphere;
+    return Packed;
+}
+
+bool
+Mesh::IsUploaded() const {
+    return mGeometry.IsValid();
+}
+
+unsigned
+Mesh::GetShaderFeatures() const {
+    return MaterialSystem::Get().GetShaderFeatures(mMaterial);
+}
+
+void
+Mesh::SetDequantization(const Shader& shader) const {
+    VertexFormat::SetDequantization(shader, mFormat, mMin, mMax);
+}
+
+EVertexFormat
+Mesh::GetFormat() const {
+    return mFormat;
+}
+
+unsigned
+Mesh::GetMaterial() const {
+    return mMaterial;
+}
 
+void
+Mesh::Draw() const {
+    const GeometryRange& Range = mGeometry.GetRange();
     if (mIndexCount) {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
-        glDrawElements(GL_TRIANGLES, mIndexCount, GL_UNSIGNED_INT, (void*)0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-        return;
+        unsigned IndexSize = IndexFormat::GetSize(mIndexType);
+        for (unsigned ChunkIdx = 0; ChunkIdx < mIndexChunks.size(); ++ChunkIdx) {
+            const IndexChunk& Chunk = mIndexChunks[ChunkIdx];
+            size_t IndexOffset = Range.IndexOffset + (size_t)Chunk.FirstIndex * IndexSize;
+            glDrawElementsBaseVertex(GL_TRIANGLES, Chunk.IndexCount, mIndexType, (void*)IndexOffset, Range.BaseVertex + Chunk.BaseVertex);
+        }
+    } else {
+        glDrawArrays(GL_TRIANGLES, Range.BaseVertex, mVertexCount);
     }
-
-    glDrawArrays(GL_TRIANGLES, 0, mVertexCount);
-    glBindVertexArray(0);
 }
 
 unsigned
-Mesh::loadMeshTexture(const aiMaterial* material, const std::string& resPath, aiTextureType type) {
+Mesh::GetDrawCount() const {
+    return mIndexCount && mIndexChunks.size() > 1 ? (unsigned)mIndexChunks.size() : 1;
+}
+
+std::string
+Mesh::getMaterialTexturePath(const aiMaterial* material, aiTextureType type) const {
     if (material && material->GetTextureCount(type) > 0) {
         aiString Path;
         if (material->GetTexture(type, 0, &Path, NULL, NULL, NULL, NULL, NULL) == AI_SUCCESS) {
-            std::string FullPath = resPath + "/" + Path.data;
-            unsigned TextureID = Texture::LoadImageToTexture(FullPath);
-            return TextureID;
+            return Path.data;
         }
     }
 
-    return 0;
+    return "";
+}
+
+unsigned
+Mesh::loadMaterial(const std::string& resPath) const {
+    std::string Diffuse = mDiffusePath.empty() ? "" : resPath + "/" + mDiffusePath;
+    std::string Specular = mSpecularPath.empty() ? "" : resPath + "/" + mSpecularPath;
+    return MaterialSystem::Get().Add(Diffuse, Specular);
 }
 
 void
-Mesh::processMesh(const aiMesh* mesh, const aiMaterial* material, const std::string& resPath) {
-    const aiVector3D Zero3D(0.0f, 0.0f, 0.0f);
+Mesh::PackVertices(const aiMesh* mesh, float* dst, glm::vec3& min, glm::vec3& max) {
+    const aiVector3D* Positions = mesh->mVertices;
+    const aiVector3D* Normals = mesh->mNormals;
+    const aiVector3D* TexCoords = mesh->HasTextureCoords(0) ? mesh->mTextureCoords[0] : 0;
+    min = glm::vec3(0.0f);
+    max = glm::vec3(0.0f);
+    if (mesh->mNumVertices) {
+        min = max = glm::vec3(Positions[0].x, Positions[0].y, Positions[0].z);
+    }
 
     for (unsigned VertexIndex = 0; VertexIndex < mesh->mNumVertices; ++VertexIndex) {
-        std::vector<float> Position = { mesh->mVertices[VertexIndex].x, mesh->mVertices[VertexIndex].y, mesh->mVertices[VertexIndex].z };
-        mVertices.insert(mVertices.end(), Position.begin(), Position.end());
-        std::vector<float> Normals = { mesh->mNormals[VertexIndex].x, mesh->mNormals[VertexIndex].y, mesh->mNormals[VertexIndex].z };
-        mVertices.insert(mVertices.end(), Normals.begin(), Normals.end());
-        const aiVector3D* TexCoords = mesh->HasTextureCoords(0) ? &(mesh->mTextureCoords[0][VertexIndex]) : &Zero3D;
-        std::vector<float> UV = { TexCoords->x, TexCoords->y };
-        mVertices.insert(mVertices.end(), UV.begin(), UV.end());
+        const aiVector3D& Position = Positions[VertexIndex];
+        dst[0] = Position.x;
+        dst[1] = Position.y;
+        dst[2] = Position.z;
+        dst[3] = Normals ? Normals[VertexIndex].x : 0.0f;
+        dst[4] = Normals ? Normals[VertexIndex].y : 0.0f;
+        dst[5] = Normals ? Normals[VertexIndex].z : 0.0f;
+        dst[6] = TexCoords ? TexCoords[VertexIndex].x : 0.0f;
+        dst[7] = TexCoords ? TexCoords[VertexIndex].y : 0.0f;
+        dst += VERTEX_STRIDE;
+
+        min.x = Position.x < min.x ? Position.x : min.x;
+        min.y = Position.y < min.y ? Position.y : min.y;
+        min.z = Position.z < min.z ? Position.z : min.z;
+        max.x = Position.x > max.x ? Position.x : max.x;
+        max.y = Position.y > max.y ? Position.y : max.y;
+        max.z = Position.z > max.z ? Position.z : max.z;
     }
+}
 
+unsigned
+Mesh::PackIndices(const aiMesh* mesh, unsigned* dst) {
+    unsigned* Start = dst;
     for (unsigned FaceIndex = 0; FaceIndex < mesh->mNumFaces; ++FaceIndex) {
         const aiFace& Face = mesh->mFaces[FaceIndex];
-        mIndices.push_back(Face.mIndices[0]);
-        mIndices.push_back(Face.mIndices[1]);
-        mIndices.push_back(Face.mIndices[2]);
+        if (Face.mNumIndices != 3) {
+            continue;
+        }
+        dst[0] = Face.mIndices[0];
+        dst[1] = Face.mIndices[1];
+        dst[2] = Face.mIndices[2];
+        dst += 3;
     }
 
-    mVertexCount = mVertices.size() / 6;
-    mIndexCount = mIndices.size();
-
-    mDiffuseTexture = loadMeshTexture(material, resPath, aiTextureType_DIFFUSE);
-    mSpecularTexture = loadMeshTexture(material, resPath, aiTextureType_SPECULAR);
-
-    glGenVertexArrays(1, &mVAO);
-    glBindVertexArray(mVAO);
-    glGenBuffers(1, &mVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, mVBO);
-    glBufferData(GL_ARRAY_BUFFER, mVertices.size() * sizeof(float), mVertices.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    
-    if (mIndexCount) {
-        glGenBuffers(1, &mEBO);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mIndexCount * sizeof(float), mIndices.data(), GL_STATIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    return (unsigned)(dst - Start);
+}
+
+void
+Mesh::processMesh(const aiMesh* mesh, const aiMaterial* material) {
+    // NOTE(Jovan): Final sizes are known up front, so everything is written in place
+    // instead of growing the vectors per vertex. Optimization may weld vertices, so the
+    // vertex count is only final after it
+    std::vector<float> Vertices((size_t)mesh->mNumVertices * VERTEX_STRIDE);
+    PackVertices(mesh, Vertices.data(), mMin, mMax);
+    std::vector<unsigned> Indices((size_t)mesh->mNumFaces * 3);
+    Indices.resize(PackIndices(mesh, Indices.data()));
+    MeshOptimizer::Optimize(Vertices, Indices, VERTEX_STRIDE, mesh->mName.C_Str());
+    unsigned VertexCount = (unsigned)(Vertices.size() / VERTEX_STRIDE);
+    mSphere = Bounds::FromPoints(Vertices.data(), VertexCount, VERTEX_STRIDE).Sphere;
+
+    mVertexData.resize((size_t)VertexCount * VertexFormat::GetStride(mFormat));
+    VertexFormat::Encode(mFormat, Vertices.data(), VertexCount, mMin, mMax, mVertexData.data());
+    if (mFormat != VERTEX_FORMAT_FLOAT) {
+        // NOTE(Jovan): Built up front and printed at once, meshes are processed on several threads
+        QuantizationError Error = VertexFormat::MeasureError(mFormat, Vertices.data(), mVertexData.data(), VertexCount, mMin, mMax);
+        std::ostringstream Report;
+        Report << "Mesh " << mesh->mName.C_Str() << ": " << VertexCount << " vertices, "
+            << VertexFormat::GetName(mFormat) << " " << VertexFormat::GetStride(mFormat) << "B/vertex (float "
+            << VertexFormat::GetStride(VERTEX_FORMAT_FLOAT) << "B), max error: position " << Error.MaxPosition
+            << ", normal " << Error.MaxNormalDegrees << " deg, UV " << Error.MaxUV << std::endl;
+        std::cout << Report.str();
     }
-    glBindVertexArray(0);
-}
\ No newline at end of file
+    IndexFormat::Encode(Indices.data(), Indices.size(), VertexCount, mIndexData, mIndexType, mIndexChunks);
+
+    mVertexCount = VertexCount;
+    mIndexCount = (unsigned)Indices.size();
+    mDiffusePath = getMaterialTexturePath(material, aiTextureType_DIFFUSE);
+    mSpecularPath = getMaterialTexturePath(material, aiTextureType_SPECULAR);
+}
+
+void
+Mesh::uploadMesh(const unsigned char* vertexData, unsigned vertexCount, const unsigned char* indexData, unsigned indexCount) {
+    mVertexCount = vertexCount;
+    mIndexCount = indexCount;
+    mGeometry = GeometryAllocation(mFormat, vertexData, vertexCount, indexData, indexCount * IndexFormat::GetSize(mIndexType));
+    if (!mGeometry.IsValid()) {
+        mVertexCount = 0;
+        mIndexCount = 0;
+    }
+}
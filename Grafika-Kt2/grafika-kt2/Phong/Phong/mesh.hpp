@@ -15,37 +15,195 @@
 #include<vector>
 #include <GL/glew.h>
 #include <iostream>
+#include <glm/glm.hpp>
 #include "texture.hpp"
+#include "materialsystem.hpp"
+#include "shadervariants.hpp"
+#include "vertexformat.hpp"
+#include "indexformat.hpp"
+#include "meshoptimizer.hpp"
+#include "geometrybuffer.hpp"
+#include "glhandle.hpp"
+#include "bounds.hpp"
 
+/**
+ * @brief Non-owning view of interleaved (position, normal, UV) mesh data that is
+ * ready to be uploaded as-is. Used to move meshes in and out of the binary mesh cache
+ *
+ */
+struct PackedMesh {
+    // NOTE(Jovan): VertexCount * VertexFormat::GetStride(Format) bytes
+    const unsigned char* VertexData;
+    unsigned VertexCount;
+    EVertexFormat Format;
+    // NOTE(Jovan): IndexCount * IndexFormat::GetSize(IndexType) bytes
+    const unsigned char* IndexData;
+    unsigned IndexCount;
+    GLenum IndexType;
+    std::vector<IndexChunk> IndexChunks;
+    // NOTE(Jovan): Texture paths are relative to the model's directory, empty if not present
+    std::string DiffusePath;
+    std::string SpecularPath;
+    glm::vec3 Min;
+    glm::vec3 Max;
+    BoundingSphere Sphere;
+};
+
+/**
+ * @brief Owns its geometry buffer range, which is freed with the mesh. Textures are layers
+ * of the material system, shared by every mesh with the same material.
+ * Move-only, so the geometry can't end up shared between copies
+ *
+ */
 class Mesh {
 public:
-    std::vector<unsigned> mIndices;
-    std::vector<float> mVertices;
+    static const unsigned VERTEX_STRIDE = VertexFormat::FLOAT_COMPONENTS;
+    // NOTE(Jovan): Indices encoded as mIndexType. Empty after ReleaseCPUData
+    std::vector<unsigned char> mIndexData;
+    // NOTE(Jovan): Vertices encoded in mFormat. Empty after ReleaseCPUData
+    std::vector<unsigned char> mVertexData;
+
+    /**
+     * @brief Ctor - empty mesh, meant to be move assigned into
+     *
+     */
+    Mesh();
 
     /**
-     * @brief Ctor - buffers mesh data
+     * @brief Ctor - packs, optimizes and encodes mesh data on the CPU. Makes no GL calls,
+     * so it can run on a worker thread. Call Upload on the context thread before rendering
      *
      * @param mesh - Assimp mesh
      * @param MeshMaterial - Assimp material
-     * @param resPath - Resource relative path. For loading textures, etc...
+     * @param format - Vertex format the mesh is stored in on the GPU
      * 
      */
-    Mesh(const aiMesh* mesh, const aiMaterial* material, const std::string& resPath);
+    Mesh(const aiMesh* mesh, const aiMaterial* material, EVertexFormat format = VERTEX_FORMAT_FLOAT);
+
+    /**
+     * @brief Ctor - buffers already packed mesh data, skipping any processing
+     *
+     * @param packed - Packed mesh data, can point into a memory mapped file
+     * @param resPath - Resource relative path. For loading textures, etc...
+     *
+     */
+    Mesh(const PackedMesh& packed, const std::string& resPath);
+
+    Mesh(Mesh&& other) = default;
+    Mesh& operator=(Mesh&& other) = default;
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    /**
+     * @brief Buffers the packed data and adds the mesh's material. Must be called on the GL context thread
+     *
+     * @param resPath - Resource relative path. For loading textures, etc...
+     */
+    void Upload(const std::string& resPath);
+
+    /**
+     * @brief Returns object space bounds, computed at import
+     *
+     * @returns Mesh bounds
+     */
+    Bounds GetBounds() const;
+
+    /**
+     * @brief Returns shader features the mesh's material needs
+     *
+     * @returns EShaderFeature bits
+     */
+    unsigned GetShaderFeatures() const;
+
+    /**
+     * @brief Frees the CPU side copies of vertex and index data. The mesh keeps rendering
+     * from its GPU buffers, but GetPacked returns no data afterwards
+     *
+     */
+    void ReleaseCPUData();
+
+    /**
+     * @brief Returns a view of the mesh's CPU side data. Valid as long as the mesh is
+     *
+     * @returns Packed mesh view
+     */
+    PackedMesh GetPacked() const;
+
+    /**
+     * @brief Returns whether Upload got the mesh's geometry into the geometry buffer
+     *
+     * @returns true - Geometry is on the GPU, false - Allocation failed, mesh draws nothing
+     */
+    bool IsUploaded() const;
+
+    /**
+     * @brief Packs interleaved vertices (position, normal, UV) of an Assimp mesh into a
+     * preallocated buffer without any intermediate allocations
+     *
+     * @param mesh - Assimp mesh
+     * @param dst - Destination, must hold mesh->mNumVertices * VERTEX_STRIDE floats
+     * @param min - Output AABB minimum
+     * @param max - Output AABB maximum
+     */
+    static void PackVertices(const aiMesh* mesh, float* dst, glm::vec3& min, glm::vec3& max);
+
+    /**
+     * @brief Packs triangle indices of an Assimp mesh into a preallocated buffer.
+     * Non-triangle faces (points, lines) are skipped
+     *
+     * @param mesh - Assimp mesh
+     * @param dst - Destination, must hold mesh->mNumFaces * 3 indices
+     *
+     * @returns Number of indices written
+     */
+    static unsigned PackIndices(const aiMesh* mesh, unsigned* dst);
+
+    /**
+     * @brief Sets the mesh's vertex dequantization. Used by RenderQueue, which skips it
+     * between draws of the same mesh
+     *
+     * @param shader - Shader in use
+     */
+    void SetDequantization(const Shader& shader) const;
+
+    /**
+     * @brief Issues the mesh's draw calls. The format's VAO must be bound, the mesh's
+     * material selected and its dequantization set. Textures are never bound
+     *
+     */
+    void Draw() const;
+
+    /**
+     * @brief Returns number of draw calls Draw issues, one per 16-bit index chunk
+     *
+     */
+    unsigned GetDrawCount() const;
+
+    EVertexFormat GetFormat() const;
 
     /**
-     * @brief Renders the current mesh
+     * @brief Returns the mesh's material, see MaterialSystem
      *
      */
-    void Render() const;
+    unsigned GetMaterial() const;
 
 private:
-    unsigned mVAO;
-    unsigned mVBO;
-    unsigned mEBO;
+    // NOTE(Jovan): Where the mesh lives in its format's shared geometry buffer
+    GeometryAllocation mGeometry;
     unsigned mVertexCount;
     unsigned mIndexCount;
-    unsigned mDiffuseTexture;
-    unsigned mSpecularTexture;
-    unsigned loadMeshTexture(const aiMaterial* material, const std::string& resPath, aiTextureType type);
-    void processMesh(const aiMesh* mesh, const aiMaterial* material, const std::string& resPath);
+    GLenum mIndexType;
+    std::vector<IndexChunk> mIndexChunks;
+    EVertexFormat mFormat;
+    unsigned mMaterial;
+    std::string mDiffusePath;
+    std::string mSpecularPath;
+    // NOTE(Jovan): Bounding box, also the box positions are quantized in
+    glm::vec3 mMin;
+    glm::vec3 mMax;
+    BoundingSphere mSphere;
+    std::string getMaterialTexturePath(const aiMaterial* material, aiTextureType type) const;
+    unsigned loadMaterial(const std::string& resPath) const;
+    void processMesh(const aiMesh* mesh, const aiMaterial* material);
+    void uploadMesh(const unsigned char* vertexData, unsigned vertexCount, const unsigned char* indexData, unsigned indexCount);
 };
@@ -0,0 +1,205 @@
+#include "meshcache.hpp"
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+
+static const char MESH_CACHE_MAGIC[4] = { 'P', 'M', 'S', 'H' };
+
+struct MeshCacheHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint32_t ImportFlags;
+    uint32_t MeshCount;
+    uint64_t SourceSize;
+    int64_t SourceModifiedTime;
+};
+
+struct MeshCacheEntry {
+    uint32_t VertexCount;
+    uint32_t IndexCount;
+    uint32_t IndexType;
+    uint32_t IndexChunkCount;
+    uint32_t Format;
+    uint32_t VertexStride;
+    uint32_t DiffusePathLength;
+    uint32_t SpecularPathLength;
+    float Min[3];
+    float Max[3];
+    float SphereCenter[3];
+    float SphereRadius;
+};
+
+static size_t
+alignTo4(size_t offset) {
+    return (offset + 3) & ~(size_t)3;
+}
+
+std::string
+MeshCache::GetCachePath(const std::string& sourcePath) {
+    return sourcePath + MESH_CACHE_EXTENSION;
+}
+
+const std::vector<PackedMesh>&
+MeshCache::GetMeshes() const {
+    return mMeshes;
+}
+
+bool
+MeshCache::Open(const std::string& sourcePath, unsigned importFlags, EVertexFormat vertexFormat) {
+    mMeshes.clear();
+    uint64_t SourceSize;
+    int64_t SourceModifiedTime;
+    if (!MappedFile::GetStamp(sourcePath, SourceSize, SourceModifiedTime)) {
+        return false;
+    }
+
+    if (!mFile.Open(GetCachePath(sourcePath))) {
+        return false;
+    }
+
+    const unsigned char* Data = mFile.GetData();
+    size_t Size = mFile.GetSize();
+    if (Size < sizeof(MeshCacheHeader)) {
+        mFile.Close();
+        return false;
+    }
+
+    MeshCacheHeader Header;
+    memcpy(&Header, Data, sizeof(Header));
+    if (memcmp(Header.Magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0
+        || Header.Version != MESH_CACHE_VERSION
+        || Header.ImportFlags != importFlags
+        || Header.SourceSize != SourceSize
+        || Header.SourceModifiedTime != SourceModifiedTime) {
+        std::cout << "Mesh cache for " << sourcePath << " is stale, reimporting" << std::endl;
+        mFile.Close();
+        return false;
+    }
+
+    size_t Offset = sizeof(MeshCacheHeader);
+    mMeshes.reserve(Header.MeshCount);
+    for (unsigned MeshIdx = 0; MeshIdx < Header.MeshCount; ++MeshIdx) {
+        MeshCacheEntry Entry;
+        if (Offset + sizeof(Entry) > Size) {
+            break;
+        }
+        memcpy(&Entry, Data + Offset, sizeof(Entry));
+        Offset += sizeof(Entry);
+
+        if (Entry.Format != (uint32_t)vertexFormat) {
+            std::cout << "Mesh cache for " << sourcePath << " uses a different vertex format, reimporting" << std::endl;
+            break;
+        }
+
+        size_t VertexBytes = (size_t)Entry.VertexCount * Entry.VertexStride;
+        size_t IndexBytes = (size_t)Entry.IndexCount * IndexFormat::GetSize(Entry.IndexType);
+        size_t ChunkBytes = (size_t)Entry.IndexChunkCount * sizeof(IndexChunk);
+        size_t PathBytes = (size_t)Entry.DiffusePathLength + Entry.SpecularPathLength;
+        if (Entry.VertexStride != VertexFormat::GetStride(vertexFormat)
+            || (Entry.IndexType != GL_UNSIGNED_SHORT && Entry.IndexType != GL_UNSIGNED_INT)
+            || alignTo4(Offset + PathBytes) + ChunkBytes + VertexBytes + IndexBytes > Size) {
+            std::cerr << "[Err] Mesh cache for " << sourcePath << " is corrupt, reimporting" << std::endl;
+            break;
+        }
+
+        PackedMesh Packed;
+        Packed.DiffusePath.assign((const char*)Data + Offset, Entry.DiffusePathLength);
+        Offset += Entry.DiffusePathLength;
+        Packed.SpecularPath.assign((const char*)Data + Offset, Entry.SpecularPathLength);
+        Offset = alignTo4(Offset + Entry.SpecularPathLength);
+
+        Packed.IndexChunks.resize(Entry.IndexChunkCount);
+        memcpy(Packed.IndexChunks.data(), Data + Offset, ChunkBytes);
+        Offset += ChunkBytes;
+
+        Packed.VertexData = Data + Offset;
+        Packed.VertexCount = Entry.VertexCount;
+        Packed.Format = vertexFormat;
+        Offset += VertexBytes;
+        Packed.IndexData = Data + Offset;
+        Packed.IndexCount = Entry.IndexCount;
+        Packed.IndexType = Entry.IndexType;
+        Offset += IndexBytes;
+        Packed.Min = glm::vec3(Entry.Min[0], Entry.Min[1], Entry.Min[2]);
+        Packed.Max = glm::vec3(Entry.Max[0], Entry.Max[1], Entry.Max[2]);
+        Packed.Sphere.Center = glm::vec3(Entry.SphereCenter[0], Entry.SphereCenter[1], Entry.SphereCenter[2]);
+        Packed.Sphere.Radius = Entry.SphereRadius;
+        mMeshes.push_back(Packed);
+    }
+
+    if (mMeshes.size() != Header.MeshCount) {
+        mMeshes.clear();
+        mFile.Close();
+        return false;
+    }
+
+    return true;
+}
+
+bool
+MeshCache::Write(const std::string& sourcePath, unsigned importFlags, const std::vector<PackedMesh>& meshes) {
+    MeshCacheHeader Header;
+    memcpy(Header.Magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+    Header.Version = MESH_CACHE_VERSION;
+    Header.ImportFlags = importFlags;
+    Header.MeshCount = (uint32_t)meshes.size();
+    if (!MappedFile::GetStamp(sourcePath, Header.SourceSize, Header.SourceModifiedTime)) {
+        return false;
+    }
+
+    // NOTE(Jovan): Written to a temporary file first so a crash mid-write never leaves
+    // a cache that looks valid but is truncated
+    std::string CachePath = GetCachePath(sourcePath);
+    std::string TempPath = CachePath + ".tmp";
+    std::ofstream Out(TempPath, std::ios::binary | std::ios::trunc);
+    if (!Out) {
+        return false;
+    }
+
+    const char Padding[4] = { 0 };
+    size_t Offset = sizeof(Header);
+    Out.write((const char*)&Header, sizeof(Header));
+    for (size_t MeshIdx = 0; MeshIdx < meshes.size(); ++MeshIdx) {
+        const PackedMesh& Packed = meshes[MeshIdx];
+        MeshCacheEntry Entry;
+        Entry.VertexCount = Packed.VertexCount;
+        Entry.IndexCount = Packed.IndexCount;
+        Entry.IndexType = Packed.IndexType;
+        Entry.IndexChunkCount = (uint32_t)Packed.IndexChunks.size();
+        Entry.Format = (uint32_t)Packed.Format;
+        Entry.VertexStride = VertexFormat::GetStride(Packed.Format);
+        Entry.DiffusePathLength = (uint32_t)Packed.DiffusePath.size();
+        Entry.SpecularPathLength = (uint32_t)Packed.SpecularPath.size();
+        for (int Axis = 0; Axis < 3; ++Axis) {
+            Entry.Min[Axis] = Packed.Min[Axis];
+            Entry.Max[Axis] = Packed.Max[Axis];
+            Entry.SphereCenter[Axis] = Packed.Sphere.Center[Axis];
+        }
+        Entry.SphereRadius = Packed.Sphere.Radius;
+
+        Out.write((const char*)&Entry, sizeof(Entry));
+        Out.write(Packed.DiffusePath.data(), Packed.DiffusePath.size());
+        Out.write(Packed.SpecularPath.data(), Packed.SpecularPath.size());
+        Offset += sizeof(Entry) + Packed.DiffusePath.size() + Packed.SpecularPath.size();
+        Out.write(Padding, alignTo4(Offset) - Offset);
+        Offset = alignTo4(Offset);
+
+        size_t ChunkBytes = Packed.IndexChunks.size() * sizeof(IndexChunk);
+        size_t VertexBytes = (size_t)Packed.VertexCount * Entry.VertexStride;
+        size_t IndexBytes = (size_t)Packed.IndexCount * IndexFormat::GetSize(Packed.IndexType);
+        Out.write((const char*)Packed.IndexChunks.data(), ChunkBytes);
+        Out.write((const char*)Packed.VertexData, VertexBytes);
+        Out.write((const char*)Packed.IndexData, IndexBytes);
+        Offset += ChunkBytes + VertexBytes + IndexBytes;
+    }
+
+    Out.close();
+    if (!Out) {
+        std::remove(TempPath.c_str());
+        return false;
+    }
+
+    std::remove(CachePath.c_str());
+    return std::rename(TempPath.c_str(), CachePath.c_str()) == 0;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file meshcache.hpp
+ * @author Jovan Ivosevic
+ * @brief Versioned binary cache of imported model meshes
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "mesh.hpp"
+#include "mappedfile.hpp"
+
+// NOTE(Jovan): Bump whenever the layout of the cache file or of the packed data changes.
+// Caches with a different version are ignored and rebuilt from the source model
+#define MESH_CACHE_VERSION 6
+#define MESH_CACHE_EXTENSION ".meshcache"
+
+/**
+ * @brief Binary mesh cache stored next to the source model as <model><MESH_CACHE_EXTENSION>.
+ * The file is native-endian and laid out so that vertex and index data can be uploaded
+ * straight from the memory mapped file:
+ *
+ *  MeshCacheHeader
+ *  MeshCount x { MeshCacheEntry, diffuse path, specular path, padding to 4 bytes, index chunks, vertices, indices }
+ *
+ * A cache is only used if its version, import flags, vertex format, source file size and
+ * modification time match the source model
+ */
+class MeshCache {
+public:
+    /**
+     * @brief Maps the cache for the given source model and validates it
+     *
+     * @param sourcePath - Source model path
+     * @param importFlags - Flags the model is imported with
+     * @param vertexFormat - Vertex format the meshes are expected in
+     *
+     * @returns true - Valid cache is mapped, false - Cache is missing or stale
+     */
+    bool Open(const std::string& sourcePath, unsigned importFlags, EVertexFormat vertexFormat);
+
+    /**
+     * @brief Returns meshes read from the cache. They point into the mapped file
+     * and are only valid while this object is alive
+     *
+     * @returns Packed meshes
+     */
+    const std::vector<PackedMesh>& GetMeshes() const;
+
+    /**
+     * @brief Writes packed meshes into the cache file for the given source model
+     *
+     * @param sourcePath - Source model path
+     * @param importFlags - Flags the model was imported with
+     * @param meshes - Packed meshes to be written
+     *
+     * @returns true - Success, false - Failure
+     */
+    static bool Write(const std::string& sourcePath, unsigned importFlags, const std::vector<PackedMesh>& meshes);
+
+    /**
+     * @brief Returns cache file path for the given source model
+     *
+     * @param sourcePath - Source model path
+     *
+     * @returns Cache file path
+     */
+    static std::string GetCachePath(const std::string& sourcePath);
+
+private:
+    MappedFile mFile;
+    std::vector<PackedMesh> mMeshes;
+};
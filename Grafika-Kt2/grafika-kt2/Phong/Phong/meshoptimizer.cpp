@@ -0,0 +1,329 @@
+#include "meshoptimizer.hpp"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+static const unsigned INVALID_INDEX = ~0u;
+
+/**
+ * @brief Hashes and compares vertices by their raw bytes, so that only
+ * bitwise identical vertices get welded
+ *
+ */
+struct VertexKey {
+    const float* Data;
+    unsigned Stride;
+
+    bool operator==(const VertexKey& other) const {
+        return memcmp(Data, other.Data, Stride * sizeof(float)) == 0;
+    }
+};
+
+struct VertexKeyHash {
+    size_t operator()(const VertexKey& key) const {
+        // NOTE(Jovan): FNV-1a over the vertex bytes
+        const unsigned char* Bytes = (const unsigned char*)key.Data;
+        uint32_t Hash = 2166136261u;
+        for (size_t ByteIdx = 0; ByteIdx < key.Stride * sizeof(float); ++ByteIdx) {
+            Hash = (Hash ^ Bytes[ByteIdx]) * 16777619u;
+        }
+        return Hash;
+    }
+};
+
+void
+MeshOptimizer::Optimize(std::vector<float>& vertices, std::vector<unsigned>& indices, unsigned stride, const std::string& name) {
+    unsigned OriginalVertexCount = (unsigned)(vertices.size() / stride);
+    if (indices.size() < 3) {
+        return;
+    }
+
+    VertexCacheStats Before = AnalyzeVertexCache(indices, OriginalVertexCount, VERTEX_CACHE_SIZE);
+    unsigned VertexCount = WeldVertices(vertices, indices, stride);
+    std::vector<unsigned> Clusters;
+    OptimizeVertexCache(indices, VertexCount, &Clusters);
+    OptimizeOverdraw(indices, vertices, stride, Clusters);
+    VertexCount = OptimizeVertexFetch(vertices, indices, stride);
+    VertexCacheStats After = AnalyzeVertexCache(indices, VertexCount, VERTEX_CACHE_SIZE);
+
+    std::ostringstream Report;
+    Report << "Optimized mesh " << name << ": vertices " << OriginalVertexCount << " -> " << VertexCount
+        << ", ACMR " << Before.ACMR << " -> " << After.ACMR
+        << ", ATVR " << Before.ATVR << " -> " << After.ATVR
+        << ", " << Clusters.size() << " clusters" << std::endl;
+    std::cout << Report.str();
+}
+
+unsigned
+MeshOptimizer::WeldVertices(std::vector<float>& vertices, std::vector<unsigned>& indices, unsigned stride) {
+    unsigned VertexCount = (unsigned)(vertices.size() / stride);
+    std::vector<unsigned> Remap(VertexCount);
+    std::unordered_map<VertexKey, unsigned, VertexKeyHash> Unique;
+    Unique.reserve(VertexCount);
+
+    // NOTE(Jovan): Unique vertices are compacted towards the front in place. Keys always
+    // point at already compacted vertices, which are never overwritten afterwards
+    unsigned UniqueCount = 0;
+    for (unsigned Vertex = 0; Vertex < VertexCount; ++Vertex) {
+        const float* Src = vertices.data() + (size_t)Vertex * stride;
+        VertexKey Key = { Src, stride };
+        std::unordered_map<VertexKey, unsigned, VertexKeyHash>::const_iterator Found = Unique.find(Key);
+        if (Found != Unique.end()) {
+            Remap[Vertex] = Found->second;
+            continue;
+        }
+
+        float* Dst = vertices.data() + (size_t)UniqueCount * stride;
+        if (Dst != Src) {
+            memmove(Dst, Src, stride * sizeof(float));
+        }
+        VertexKey Compacted = { Dst, stride };
+        Unique.emplace(Compacted, UniqueCount);
+        Remap[Vertex] = UniqueCount++;
+    }
+
+    for (size_t Index = 0; Index < indices.size(); ++Index) {
+        indices[Index] = Remap[indices[Index]];
+    }
+    vertices.resize((size_t)UniqueCount * stride);
+    return UniqueCount;
+}
+
+void
+MeshOptimizer::OptimizeVertexCache(std::vector<unsigned>& indices, unsigned vertexCount, std::vector<unsigned>* clusters) {
+    unsigned TriangleCount = (unsigned)(indices.size() / 3);
+    if (clusters) {
+        clusters->clear();
+    }
+    if (!TriangleCount) {
+        return;
+    }
+
+    // NOTE(Jovan): Vertex to triangle adjacency in compressed form, triangles of vertex V
+    // are AdjacentTriangles[AdjacencyOffsets[V]] .. AdjacentTriangles[AdjacencyOffsets[V + 1]]
+    std::vector<unsigned> LiveTriangles(vertexCount, 0);
+    for (size_t Index = 0; Index < TriangleCount * 3; ++Index) {
+        ++LiveTriangles[indices[Index]];
+    }
+    std::vector<unsigned> AdjacencyOffsets(vertexCount + 1, 0);
+    for (unsigned Vertex = 0; Vertex < vertexCount; ++Vertex) {
+        AdjacencyOffsets[Vertex + 1] = AdjacencyOffsets[Vertex] + LiveTriangles[Vertex];
+    }
+    std::vector<unsigned> AdjacentTriangles(TriangleCount * 3);
+    std::vector<unsigned> Fill(AdjacencyOffsets.begin(), AdjacencyOffsets.end() - 1);
+    for (unsigned Triangle = 0; Triangle < TriangleCount; ++Triangle) {
+        for (unsigned Corner = 0; Corner < 3; ++Corner) {
+            AdjacentTriangles[Fill[indices[Triangle * 3 + Corner]]++] = Triangle;
+        }
+    }
+
+    std::vector<unsigned> CacheTime(vertexCount, 0);
+    std::vector<bool> Emitted(TriangleCount, false);
+    std::vector<unsigned> DeadEnds;
+    std::vector<unsigned> Candidates;
+    std::vector<unsigned> Output;
+    Output.reserve(TriangleCount * 3);
+
+    // NOTE(Jovan): Timestamps start past the cache size so that every vertex starts out of cache
+    unsigned Time = VERTEX_CACHE_SIZE + 1;
+    // NOTE(Jovan): Starts at the first vertex with triangles, so the first cluster is never empty
+    unsigned Cursor = 0;
+    while (!LiveTriangles[Cursor]) {
+        ++Cursor;
+    }
+    unsigned Fanning = Cursor;
+    bool ClusterStart = true;
+    while (Fanning != INVALID_INDEX) {
+        if (ClusterStart && clusters) {
+            clusters->push_back((unsigned)Output.size());
+        }
+
+        // NOTE(Jovan): Emit every remaining triangle around the fanning vertex
+        Candidates.clear();
+        for (unsigned Adjacent = AdjacencyOffsets[Fanning]; Adjacent < AdjacencyOffsets[Fanning + 1]; ++Adjacent) {
+            unsigned Triangle = AdjacentTriangles[Adjacent];
+            if (Emitted[Triangle]) {
+                continue;
+            }
+            for (unsigned Corner = 0; Corner < 3; ++Corner) {
+                unsigned Vertex = indices[Triangle * 3 + Corner];
+                Output.push_back(Vertex);
+                DeadEnds.push_back(Vertex);
+                Candidates.push_back(Vertex);
+                --LiveTriangles[Vertex];
+                if (Time - CacheTime[Vertex] > VERTEX_CACHE_SIZE) {
+                    CacheTime[Vertex] = Time++;
+                }
+            }
+            Emitted[Triangle] = true;
+        }
+
+        // NOTE(Jovan): Next fanning vertex is the candidate that is still in cache and
+        // will stay there while its remaining triangles are emitted, preferring the oldest one
+        unsigned Next = INVALID_INDEX;
+        int BestPriority = -1;
+        for (size_t CandidateIdx = 0; CandidateIdx < Candidates.size(); ++CandidateIdx) {
+            unsigned Vertex = Candidates[CandidateIdx];
+            if (!LiveTriangles[Vertex]) {
+                continue;
+            }
+            int Priority = 0;
+            if (Time - CacheTime[Vertex] + 2 * LiveTriangles[Vertex] <= VERTEX_CACHE_SIZE) {
+                Priority = (int)(Time - CacheTime[Vertex]);
+            }
+            if (Priority > BestPriority) {
+                BestPriority = Priority;
+                Next = Vertex;
+            }
+        }
+
+        // NOTE(Jovan): Dead end, try recently touched vertices first, then fall back to
+        // scanning for any vertex with triangles left. Either way the cache locality of the
+        // fan is broken, so a new cluster starts. Clusters are what OptimizeOverdraw reorders
+        ClusterStart = Next == INVALID_INDEX;
+        if (Next == INVALID_INDEX) {
+            while (!DeadEnds.empty() && Next == INVALID_INDEX) {
+                unsigned Vertex = DeadEnds.back();
+                DeadEnds.pop_back();
+                if (LiveTriangles[Vertex]) {
+                    Next = Vertex;
+                }
+            }
+            while (Next == INVALID_INDEX && Cursor < vertexCount) {
+                if (LiveTriangles[Cursor]) {
+                    Next = Cursor;
+                }
+                ++Cursor;
+            }
+        }
+        Fanning = Next;
+    }
+
+    indices.swap(Output);
+}
+
+void
+MeshOptimizer::OptimizeOverdraw(std::vector<unsigned>& indices, const std::vector<float>& vertices, unsigned stride, const std::vector<unsigned>& clusters) {
+    if (clusters.size() < 2) {
+        return;
+    }
+
+    struct Cluster {
+        unsigned FirstIndex;
+        unsigned IndexCount;
+        float Sort;
+    };
+
+    std::vector<Cluster> Sorted(clusters.size());
+    glm::vec3 MeshCentroid(0.0f);
+    float MeshArea = 0.0f;
+    std::vector<glm::vec3> ClusterCentroids(clusters.size());
+    std::vector<glm::vec3> ClusterNormals(clusters.size());
+    for (size_t ClusterIdx = 0; ClusterIdx < clusters.size(); ++ClusterIdx) {
+        unsigned First = clusters[ClusterIdx];
+        unsigned End = ClusterIdx + 1 < clusters.size() ? clusters[ClusterIdx + 1] : (unsigned)indices.size();
+        Sorted[ClusterIdx].FirstIndex = First;
+        Sorted[ClusterIdx].IndexCount = End - First;
+
+        // NOTE(Jovan): Area weighted centroid and normal of the cluster
+        glm::vec3 Centroid(0.0f);
+        glm::vec3 Normal(0.0f);
+        float Area = 0.0f;
+        for (unsigned Index = First; Index + 2 < End; Index += 3) {
+            const float* P0 = &vertices[(size_t)indices[Index] * stride];
+            const float* P1 = &vertices[(size_t)indices[Index + 1] * stride];
+            const float* P2 = &vertices[(size_t)indices[Index + 2] * stride];
+            glm::vec3 A(P0[0], P0[1], P0[2]);
+            glm::vec3 B(P1[0], P1[1], P1[2]);
+            glm::vec3 C(P2[0], P2[1], P2[2]);
+            glm::vec3 Cross = glm::cross(B - A, C - A);
+            float TriangleArea = glm::length(Cross);
+            Centroid += (A + B + C) * (TriangleArea / 3.0f);
+            Normal += Cross;
+            Area += TriangleArea;
+        }
+
+        MeshCentroid += Centroid;
+        MeshArea += Area;
+        ClusterCentroids[ClusterIdx] = Area > 0.0f ? Centroid / Area : Centroid;
+        float NormalLength = glm::length(Normal);
+        ClusterNormals[ClusterIdx] = NormalLength > 0.0f ? Normal / NormalLength : Normal;
+    }
+    if (MeshArea > 0.0f) {
+        MeshCentroid /= MeshArea;
+    }
+
+    // NOTE(Jovan): Clusters that face away from the mesh centre are likely to occlude the
+    // rest of the mesh, so they go first
+    for (size_t ClusterIdx = 0; ClusterIdx < clusters.size(); ++ClusterIdx) {
+        Sorted[ClusterIdx].Sort = glm::dot(ClusterCentroids[ClusterIdx] - MeshCentroid, ClusterNormals[ClusterIdx]);
+    }
+    std::stable_sort(Sorted.begin(), Sorted.end(), [](const Cluster& a, const Cluster& b) {
+        return a.Sort > b.Sort;
+    });
+
+    std::vector<unsigned> Output;
+    Output.reserve(indices.size());
+    for (size_t ClusterIdx = 0; ClusterIdx < Sorted.size(); ++ClusterIdx) {
+        const Cluster& Current = Sorted[ClusterIdx];
+        Output.insert(Output.end(), indices.begin() + Current.FirstIndex, indices.begin() + Current.FirstIndex + Current.IndexCount);
+    }
+    indices.swap(Output);
+}
+
+unsigned
+MeshOptimizer::OptimizeVertexFetch(std::vector<float>& vertices, std::vector<unsigned>& indices, unsigned stride) {
+    unsigned VertexCount = (unsigned)(vertices.size() / stride);
+    std::vector<unsigned> Remap(VertexCount, INVALID_INDEX);
+    std::vector<float> Reordered;
+    Reordered.reserve(vertices.size());
+
+    unsigned NextVertex = 0;
+    for (size_t Index = 0; Index < indices.size(); ++Index) {
+        unsigned& Mapped = Remap[indices[Index]];
+        if (Mapped == INVALID_INDEX) {
+            const float* Src = vertices.data() + (size_t)indices[Index] * stride;
+            Reordered.insert(Reordered.end(), Src, Src + stride);
+            Mapped = NextVertex++;
+        }
+        indices[Index] = Mapped;
+    }
+
+    vertices.swap(Reordered);
+    return NextVertex;
+}
+
+VertexCacheStats
+MeshOptimizer::AnalyzeVertexCache(const std::vector<unsigned>& indices, unsigned vertexCount, unsigned cacheSize) {
+    VertexCacheStats Stats = { 0.0f, 0.0f };
+    if (indices.empty() || !vertexCount) {
+        return Stats;
+    }
+
+    // NOTE(Jovan): FIFO cache via timestamps, a vertex is cached if it was
+    // inserted less than cacheSize misses ago
+    std::vector<unsigned> CacheTime(vertexCount, 0);
+    std::vector<bool> Referenced(vertexCount, false);
+    unsigned Time = cacheSize + 1;
+    unsigned Misses = 0;
+    unsigned UniqueCount = 0;
+    for (size_t Index = 0; Index < indices.size(); ++Index) {
+        unsigned Vertex = indices[Index];
+        if (Time - CacheTime[Vertex] > cacheSize) {
+            CacheTime[Vertex] = Time++;
+            ++Misses;
+        }
+        if (!Referenced[Vertex]) {
+            Referenced[Vertex] = true;
+            ++UniqueCount;
+        }
+    }
+
+    Stats.ACMR = (float)Misses / (float)(indices.size() / 3);
+    Stats.ATVR = (float)Misses / (float)UniqueCount;
+    return Stats;
+}
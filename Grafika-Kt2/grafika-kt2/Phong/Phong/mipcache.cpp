@@ -0,0 +1,105 @@
+#include "mipcache.hpp"
+#include "mappedfile.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+static const char MIP_CACHE_MAGIC[4] = { 'P', 'M', 'I', 'P' };
+// NOTE(Jovan): A 2^32 texture would still fit, anything beyond is a corrupt file
+#define MIP_CACHE_MAX_LEVELS 32
+
+struct MipCacheHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint32_t Channels;
+    uint32_t LevelCount;
+    uint64_t SourceSize;
+    int64_t SourceModifiedTime;
+};
+
+std::string
+MipCache::GetCachePath(const std::string& sourcePath) {
+    return sourcePath + MIP_CACHE_EXTENSION;
+}
+
+bool
+MipCache::Read(const std::string& sourcePath, MipChain& chain) {
+    std::ifstream In(GetCachePath(sourcePath), std::ios::binary);
+    if (!In) {
+        return false;
+    }
+
+    MipCacheHeader Header;
+    if (!In.read((char*)&Header, sizeof(Header))
+        || memcmp(Header.Magic, MIP_CACHE_MAGIC, sizeof(MIP_CACHE_MAGIC))
+        || Header.Version != MIP_CACHE_VERSION
+        || !Header.Channels || Header.Channels > 4
+        || !Header.LevelCount || Header.LevelCount > MIP_CACHE_MAX_LEVELS) {
+        return false;
+    }
+
+    uint64_t SourceSize;
+    int64_t SourceModifiedTime;
+    if (!MappedFile::GetStamp(sourcePath, SourceSize, SourceModifiedTime)
+        || Header.SourceSize != SourceSize
+        || Header.SourceModifiedTime != SourceModifiedTime) {
+        return false;
+    }
+
+    chain.Channels = Header.Channels;
+    chain.Levels.resize(Header.LevelCount);
+    if (!In.read((char*)chain.Levels.data(), chain.Levels.size() * sizeof(ImageLevel))) {
+        return false;
+    }
+
+    size_t DataSize = 0;
+    for (unsigned LevelIdx = 0; LevelIdx < chain.Levels.size(); ++LevelIdx) {
+        const ImageLevel& Level = chain.Levels[LevelIdx];
+        if (Level.Offset != DataSize || Level.Size != (size_t)Level.Width * Level.Height * chain.Channels) {
+            return false;
+        }
+        DataSize += Level.Size;
+    }
+
+    chain.Data.resize(DataSize);
+    return (bool)In.read((char*)chain.Data.data(), DataSize);
+}
+
+bool
+MipCache::Write(const std::string& sourcePath, const MipChain& chain) {
+    MipCacheHeader Header;
+    memcpy(Header.Magic, MIP_CACHE_MAGIC, sizeof(MIP_CACHE_MAGIC));
+    Header.Version = MIP_CACHE_VERSION;
+    Header.Channels = chain.Channels;
+    Header.LevelCount = (uint32_t)chain.Levels.size();
+    if (!MappedFile::GetStamp(sourcePath, Header.SourceSize, Header.SourceModifiedTime)) {
+        return false;
+    }
+
+    // NOTE(Jovan): Written to a temporary file first so a crash mid-write never leaves
+    // a cache that looks valid but is truncated. Textures load on the main thread and on
+    // workers, so every write gets its own temporary file and the last rename wins
+    static std::atomic<unsigned> WriteCounter(0);
+    std::string CachePath = GetCachePath(sourcePath);
+    std::string TempPath = CachePath + "." + std::to_string(WriteCounter++) + ".tmp";
+    std::ofstream Out(TempPath, std::ios::binary | std::ios::trunc);
+    if (!Out) {
+        return false;
+    }
+    Out.write((const char*)&Header, sizeof(Header));
+    Out.write((const char*)chain.Levels.data(), chain.Levels.size() * sizeof(ImageLevel));
+    Out.write((const char*)chain.Data.data(), chain.Data.size());
+    Out.close();
+    if (!Out) {
+        std::remove(TempPath.c_str());
+        return false;
+    }
+    std::remove(CachePath.c_str());
+    if (std::rename(TempPath.c_str(), CachePath.c_str()) != 0) {
+        std::remove(TempPath.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file mipcache.hpp
+ * @author Jovan Ivosevic
+ * @brief Versioned binary cache of decoded images with their mip chains
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include "imageops.hpp"
+
+// NOTE(Jovan): Bump whenever the layout of the cache file or the mip filtering changes
+#define MIP_CACHE_VERSION 1
+#define MIP_CACHE_EXTENSION ".mipcache"
+
+/**
+ * @brief Mip chains of decoded images stored next to the source image as
+ * <image><MIP_CACHE_EXTENSION>, so later loads skip decoding and mip generation and
+ * upload the levels as they are:
+ *
+ *  MipCacheHeader, LevelCount x ImageLevel, level pixels
+ *
+ * A cache is only used if its version and the source's size and modification time match
+ */
+class MipCache {
+public:
+    /**
+     * @brief Reads the cached mip chain of a source image
+     *
+     * @param sourcePath - Source image path
+     * @param chain - Output mip chain
+     *
+     * @returns true - Success, false - Cache is missing or stale
+     */
+    static bool Read(const std::string& sourcePath, MipChain& chain);
+
+    /**
+     * @brief Writes the mip chain of a source image into its cache file
+     *
+     * @param sourcePath - Source image path
+     * @param chain - Mip chain
+     *
+     * @returns true - Success, false - Failure
+     */
+    static bool Write(const std::string& sourcePath, const MipChain& chain);
+
+    /**
+     * @brief Returns cache file path for the given source image
+     *
+     * @param sourcePath - Source image path
+     *
+     * @returns Cache file path
+     */
+    static std::string GetCachePath(const std::string& sourcePath);
+};
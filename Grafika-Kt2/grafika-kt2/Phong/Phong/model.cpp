@@ -1,12 +1,33 @@
 #include "model.hpp"
+#include <chrono>
+#include <cstdio>
+#include "meshcache.hpp"
+#include "workerpool.hpp"
 
-Model::Model(std::string filename) {
+Model::Model(std::string filename, EVertexFormat vertexFormat) {
     mFilename = filename;
+    mVertexFormat = vertexFormat;
     mDirectory = filename.substr(0, filename.find_last_of('/'));
+    mBounds = Bounds::FromBox(glm::vec3(0.0f), glm::vec3(0.0f));
 }
 
 bool
 Model::Load() {
+    std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+    mMeshes.clear();
+    MeshCache Cache;
+    if (Cache.Open(mFilename, POSTPROCESS_FLAGS, mVertexFormat)) {
+        const std::vector<PackedMesh>& Packed = Cache.GetMeshes();
+        mMeshes.reserve(Packed.size());
+        for (unsigned MeshIdx = 0; MeshIdx < Packed.size(); ++MeshIdx) {
+            mMeshes.emplace_back(Packed[MeshIdx], mDirectory);
+        }
+        computeBounds();
+        std::cout << mFilename << " Loaded " << mMeshes.size() << " meshes from cache in "
+            << getElapsedMS(Start) << "ms" << std::endl;
+        return true;
+    }
+
     Assimp::Importer Importer;
     const aiScene *Scene = Importer.ReadFile(mFilename, POSTPROCESS_FLAGS);
 
@@ -14,21 +35,97 @@ Model::Load() {
         std::cerr << "[Err] Failed to load model:" << std::endl << Importer.GetErrorString() << std::endl;
         return false;
     }
-    mMeshes.reserve(Scene->mNumMeshes);
-    for(unsigned MeshIdx = 0; MeshIdx < Scene->mNumMeshes; ++MeshIdx) {
-        aiMesh* CurrAIMesh = Scene->mMeshes[MeshIdx];
-        Mesh CurrMesh(CurrAIMesh, Scene->mMaterials[CurrAIMesh->mMaterialIndex], mDirectory);
-        mMeshes.push_back(CurrMesh);
+    float ReadMS = getElapsedMS(Start);
+
+    // NOTE(Jovan): CPU side processing of all meshes runs on the worker pool, largest
+    // meshes first so a big one doesn't end up alone at the tail. Only the GL uploads
+    // stay on this thread
+    std::chrono::steady_clock::time_point ProcessStart = std::chrono::steady_clock::now();
+    std::vector<unsigned> Order(Scene->mNumMeshes);
+    for (unsigned MeshIdx = 0; MeshIdx < Scene->mNumMeshes; ++MeshIdx) {
+        Order[MeshIdx] = MeshIdx;
+    }
+    std::sort(Order.begin(), Order.end(), [Scene](unsigned a, unsigned b) {
+        return Scene->mMeshes[a]->mNumVertices > Scene->mMeshes[b]->mNumVertices;
+    });
+
+    mMeshes.resize(Scene->mNumMeshes);
+    std::vector<float> MeshMS(Scene->mNumMeshes, 0.0f);
+    WorkerPool& Pool = WorkerPool::Get();
+    Pool.ParallelFor(Scene->mNumMeshes, [this, Scene, &Order, &MeshMS](unsigned OrderIdx) {
+        std::chrono::steady_clock::time_point MeshStart = std::chrono::steady_clock::now();
+        unsigned MeshIdx = Order[OrderIdx];
+        const aiMesh* CurrAIMesh = Scene->mMeshes[MeshIdx];
+        mMeshes[MeshIdx] = Mesh(CurrAIMesh, Scene->mMaterials[CurrAIMesh->mMaterialIndex], mVertexFormat);
+        MeshMS[MeshIdx] = getElapsedMS(MeshStart);
+    });
+    float ProcessMS = getElapsedMS(ProcessStart);
+    float SerialMS = 0.0f;
+    for (unsigned MeshIdx = 0; MeshIdx < MeshMS.size(); ++MeshIdx) {
+        SerialMS += MeshMS[MeshIdx];
+    }
+
+    computeBounds();
+    std::chrono::steady_clock::time_point UploadStart = std::chrono::steady_clock::now();
+    for (unsigned MeshIdx = 0; MeshIdx < mMeshes.size(); ++MeshIdx) {
+        mMeshes[MeshIdx].Upload(mDirectory);
+    }
+    std::cout << mFilename << " Loaded " << mMeshes.size() << " meshes in " << getElapsedMS(Start) << "ms (read "
+        << ReadMS << "ms, process " << ProcessMS << "ms on " << Pool.GetThreadCount() + 1 << " threads, "
+        << SerialMS << "ms of work, upload " << getElapsedMS(UploadStart) << "ms)" << std::endl;
+
+    bool Uploaded = true;
+    std::vector<PackedMesh> Packed;
+    Packed.reserve(mMeshes.size());
+    for (unsigned MeshIdx = 0; MeshIdx < mMeshes.size(); ++MeshIdx) {
+        Uploaded = Uploaded && mMeshes[MeshIdx].IsUploaded();
+        Packed.push_back(mMeshes[MeshIdx].GetPacked());
+    }
+    // NOTE(Jovan): Meshes that failed to upload have their counts zeroed. Caching them would
+    // make them invisible on every warm start, so drop the cache and reimport next time
+    if (!Uploaded) {
+        std::cerr << "[Warn] Some meshes of " << mFilename << " failed to upload, not caching it" << std::endl;
+        std::remove(MeshCache::GetCachePath(mFilename).c_str());
+    } else if (!MeshCache::Write(mFilename, POSTPROCESS_FLAGS, Packed)) {
+        std::cerr << "[Warn] Failed to write mesh cache for " << mFilename << std::endl;
+    }
 
+    // NOTE(Jovan): Everything that could be uploaded and cached is by now
+    for (unsigned MeshIdx = 0; MeshIdx < mMeshes.size(); ++MeshIdx) {
+        mMeshes[MeshIdx].ReleaseCPUData();
     }
-    std::cout << mFilename << " Loaded " << mMeshes.size() << " meshes" << std::endl;
     return true;
 }
 
+float
+Model::getElapsedMS(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void
+Model::computeBounds() {
+    mBounds = Bounds::FromBox(glm::vec3(0.0f), glm::vec3(0.0f));
+    for (unsigned MeshIdx = 0; MeshIdx < mMeshes.size(); ++MeshIdx) {
+        mBounds.Enclose(mMeshes[MeshIdx].GetBounds(), MeshIdx == 0);
+    }
+}
+
+const Bounds&
+Model::GetBounds() const {
+    return mBounds;
+}
+
 void
-Model::Render() {
-    for(unsigned MeshIdx = 0; MeshIdx < mMeshes.size(); ++MeshIdx) {
-        Mesh &Mesh = mMeshes[MeshIdx];
-        mMeshes[MeshIdx].Render();
+Model::Enqueue(RenderQueue& queue, ShaderVariants& variants, unsigned features, const glm::mat4& model, Culler& culler) {
+    if (!culler.Intersects(mBounds.Transform(model))) {
+        culler.CountCulled((unsigned)mMeshes.size());
+        return;
+    }
+
+    for (unsigned MeshIdx = 0; MeshIdx < mMeshes.size(); ++MeshIdx) {
+        const Mesh& CurrentMesh = mMeshes[MeshIdx];
+        if (culler.IsVisible(CurrentMesh.GetBounds(), model)) {
+            queue.AddMesh(RENDER_PASS_OPAQUE, variants.Get(features | CurrentMesh.GetShaderFeatures()), CurrentMesh, model);
+        }
     }
 }
@@ -17,10 +17,14 @@
 #include <algorithm>
 #include <vector>
 #include <iostream>
+#include <chrono>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include "shader.hpp"
+#include "shadervariants.hpp"
 #include "mesh.hpp"
+#include "bounds.hpp"
+#include "culling.hpp"
+#include "renderqueue.hpp"
 
 #define POSITION_LOCATION 0
 #define NORMAL_LOCATION 1
@@ -41,6 +45,10 @@ enum EBufferType {
 class Model {
 private:
     std::vector<Mesh> mMeshes;
+    EVertexFormat mVertexFormat;
+    Bounds mBounds;
+    static float getElapsedMS(std::chrono::steady_clock::time_point start);
+    void computeBounds();
 
 public:
     std::string mFilename;
@@ -50,22 +58,40 @@ public:
      * @brief Ctor - sets up data for model loading in Assimp
      *
      * @param filename - Model path
+     * @param vertexFormat - Vertex format the model's meshes are stored in on the GPU
      *
      */
-    Model(std::string filename);
+    Model(std::string filename, EVertexFormat vertexFormat = VERTEX_FORMAT_FLOAT);
 
     /**
-     * @brief Loads all the meshes and model data
+     * @brief Loads all the meshes and model data. Uses the binary mesh cache if it is
+     * up to date, otherwise imports the model through Assimp and (re)writes the cache.
+     * Meshes from a previous load are freed, GPU resources included, and no CPU side
+     * copies of mesh data are kept once loading is done
      *
      * @returns true - Success, false - Failure
      */
     bool Load();
 
     /**
-     * @brief Renderable Render implementation
+     * @brief Returns object space bounds enclosing all meshes
      *
+     * @returns Model bounds
      */
-    void Render();
+    const Bounds& GetBounds() const;
+
+    /**
+     * @brief Adds meshes inside the view frustum to a render queue, each with the variant
+     * its material needs. The whole model is tested first, so a model out of view costs
+     * a single test
+     *
+     * @param queue - Render queue of the current frame
+     * @param variants - Shader variants
+     * @param features - Features every mesh needs, e.g. scene lighting features
+     * @param model - Model matrix
+     * @param culler - Culling pass of the current frame
+     */
+    void Enqueue(RenderQueue& queue, ShaderVariants& variants, unsigned features, const glm::mat4& model, Culler& culler);
 
 };
 
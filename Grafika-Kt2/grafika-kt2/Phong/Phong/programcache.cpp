@@ -0,0 +1,156 @@
+#include "programcache.hpp"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+
+static const char PROGRAM_CACHE_MAGIC[4] = { 'P', 'P', 'R', 'G' };
+static const uint64_t HASH_OFFSET_BASIS = 14695981039346656037ull;
+
+struct ProgramCacheHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint64_t Key;
+    uint32_t BinaryFormat;
+    uint32_t BinaryLength;
+};
+
+/**
+ * @brief Continues a 64-bit FNV-1a hash over a string
+ *
+ * @param hash - Hash so far
+ * @param str - String, may be null
+ *
+ * @returns Hash
+ */
+static uint64_t
+hashString(uint64_t hash, const char* str) {
+    if (!str) {
+        return hash;
+    }
+    while (*str) {
+        hash = (hash ^ (uint8_t)*str++) * 1099511628211ull;
+    }
+    // NOTE(Jovan): Terminator is hashed too, so "ab" + "c" and "a" + "bc" differ
+    return (hash ^ 0xFFu) * 1099511628211ull;
+}
+
+bool
+ProgramCache::IsSupported() {
+    if (!GLEW_ARB_get_program_binary) {
+        return false;
+    }
+    // NOTE(Jovan): Some drivers expose the extension but no binary formats
+    int FormatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &FormatCount);
+    return FormatCount > 0;
+}
+
+uint64_t
+ProgramCache::GetKey(const std::string& vertexSource, const std::string& fragmentSource) {
+    uint64_t Hash = HASH_OFFSET_BASIS;
+    Hash = hashString(Hash, vertexSource.c_str());
+    Hash = hashString(Hash, fragmentSource.c_str());
+    Hash = hashString(Hash, (const char*)glGetString(GL_VENDOR));
+    Hash = hashString(Hash, (const char*)glGetString(GL_RENDERER));
+    Hash = hashString(Hash, (const char*)glGetString(GL_VERSION));
+    return Hash;
+}
+
+std::string
+ProgramCache::GetCachePath(const std::string& vShaderPath, const std::string& fShaderPath, const std::string& defines) {
+    size_t Slash = fShaderPath.find_last_of("/\\");
+    std::string FragmentName = Slash == std::string::npos ? fShaderPath : fShaderPath.substr(Slash + 1);
+    std::string Path = vShaderPath + "." + FragmentName;
+    if (!defines.empty()) {
+        char Variant[17];
+        snprintf(Variant, sizeof(Variant), "%016llx", (unsigned long long)hashString(HASH_OFFSET_BASIS, defines.c_str()));
+        Path += std::string(".") + Variant;
+    }
+    return Path + PROGRAM_CACHE_EXTENSION;
+}
+
+unsigned
+ProgramCache::Load(const std::string& cachePath, uint64_t key) {
+    if (!IsSupported()) {
+        return 0;
+    }
+
+    std::ifstream In(cachePath, std::ios::binary);
+    if (!In) {
+        return 0;
+    }
+
+    ProgramCacheHeader Header;
+    if (!In.read((char*)&Header, sizeof(Header))
+        || memcmp(Header.Magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC)) != 0
+        || Header.Version != PROGRAM_CACHE_VERSION
+        || Header.Key != key) {
+        std::cout << "Program cache " << cachePath << " is stale, recompiling" << std::endl;
+        return 0;
+    }
+
+    std::vector<char> Binary(Header.BinaryLength);
+    if (Binary.empty() || !In.read(&Binary[0], Binary.size())) {
+        std::cerr << "[Err] Program cache " << cachePath << " is corrupt, recompiling" << std::endl;
+        return 0;
+    }
+
+    unsigned Program = glCreateProgram();
+    glProgramBinary(Program, Header.BinaryFormat, &Binary[0], Binary.size());
+    int Success = 0;
+    glGetProgramiv(Program, GL_LINK_STATUS, &Success);
+    if (!Success) {
+        std::cout << "Program cache " << cachePath << " was rejected by the driver, recompiling" << std::endl;
+        glDeleteProgram(Program);
+        return 0;
+    }
+
+    return Program;
+}
+
+bool
+ProgramCache::Write(const std::string& cachePath, uint64_t key, unsigned program) {
+    if (!program || !IsSupported()) {
+        return false;
+    }
+
+    int Length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &Length);
+    if (Length <= 0) {
+        return false;
+    }
+
+    std::vector<char> Binary(Length);
+    GLenum BinaryFormat = 0;
+    glGetProgramBinary(program, Length, &Length, &BinaryFormat, &Binary[0]);
+    if (Length <= 0) {
+        return false;
+    }
+
+    ProgramCacheHeader Header;
+    memcpy(Header.Magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC));
+    Header.Version = PROGRAM_CACHE_VERSION;
+    Header.Key = key;
+    Header.BinaryFormat = BinaryFormat;
+    Header.BinaryLength = Length;
+
+    // NOTE(Jovan): Same as the mesh cache, written to a temporary file first so a crash
+    // mid-write never leaves a truncated cache
+    std::string TempPath = cachePath + ".tmp";
+    std::ofstream Out(TempPath, std::ios::binary | std::ios::trunc);
+    if (!Out) {
+        return false;
+    }
+    Out.write((const char*)&Header, sizeof(Header));
+    Out.write(&Binary[0], Length);
+    Out.close();
+    if (!Out) {
+        std::remove(TempPath.c_str());
+        return false;
+    }
+
+    std::remove(cachePath.c_str());
+    return std::rename(TempPath.c_str(), cachePath.c_str()) == 0;
+}
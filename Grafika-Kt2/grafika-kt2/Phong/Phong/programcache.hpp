@@ -0,0 +1,81 @@
+/**
+ * @file programcache.hpp
+ * @author Jovan Ivosevic
+ * @brief On-disk cache of linked shader program binaries
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+
+// NOTE(Jovan): Bump whenever the layout of the cache file changes
+#define PROGRAM_CACHE_VERSION 1
+#define PROGRAM_CACHE_EXTENSION ".programcache"
+
+/**
+ * @brief Stores linked programs as driver binaries (glGetProgramBinary) so later runs can
+ * skip compiling and linking. The file sits next to the vertex shader:
+ *
+ *  ProgramCacheHeader, program binary
+ *
+ * A cache is only used if its key matches. The key hashes the shader sources together with
+ * the GL vendor, renderer and version strings, so editing a shader or updating the driver
+ * invalidates it. Drivers may still reject a binary, in which case the program is rebuilt
+ */
+class ProgramCache {
+public:
+    /**
+     * @brief Returns whether the driver can save and load program binaries
+     *
+     */
+    static bool IsSupported();
+
+    /**
+     * @brief Returns cache key of a program
+     *
+     * @param vertexSource - Vertex shader source
+     * @param fragmentSource - Fragment shader source
+     *
+     * @returns 64-bit FNV-1a hash of both sources and the GL driver strings
+     */
+    static uint64_t GetKey(const std::string& vertexSource, const std::string& fragmentSource);
+
+    /**
+     * @brief Returns cache file path for a program
+     *
+     * @param vShaderPath - Vertex shader path
+     * @param fShaderPath - Fragment shader path
+     * @param defines - Defines the program is built with, each set gets its own file
+     *
+     * @returns Cache file path
+     */
+    static std::string GetCachePath(const std::string& vShaderPath, const std::string& fShaderPath, const std::string& defines = "");
+
+    /**
+     * @brief Creates a program from a cached binary
+     *
+     * @param cachePath - Cache file path
+     * @param key - Expected cache key
+     *
+     * @returns Linked program ID, 0 if the cache is missing, stale or rejected by the driver
+     */
+    static unsigned Load(const std::string& cachePath, uint64_t key);
+
+    /**
+     * @brief Writes a linked program's binary into the cache
+     *
+     * @param cachePath - Cache file path
+     * @param key - Cache key
+     * @param program - Linked program, linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+     *
+     * @returns true - Success, false - Failure
+     */
+    static bool Write(const std::string& cachePath, uint64_t key, unsigned program);
+};
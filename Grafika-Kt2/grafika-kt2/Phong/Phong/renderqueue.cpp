@@ -0,0 +1,208 @@
+#include "renderqueue.hpp"
+#include "mesh.hpp"
+#include "materialsystem.hpp"
+#include <algorithm>
+#include <cstring>
+
+#define RENDER_KEY_MASK(bits) ((((uint64_t)1) << (bits)) - 1)
+
+RenderQueue::RenderQueue() {
+    mView = glm::mat4(1.0f);
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+void
+RenderQueue::Begin(const glm::mat4& view) {
+    mView = view;
+    mItems.clear();
+    mOrder.clear();
+    mInstances.clear();
+}
+
+void
+RenderQueue::AddRange(ERenderPass pass, const Shader& program, unsigned material, EVertexFormat format, const GeometryRange& range, const glm::mat4& model) {
+    RenderItem Item;
+    Item.Program = &program;
+    Item.Material = material;
+    Item.Format = format;
+    Item.Model = model;
+    Item.SourceMesh = 0;
+    Item.Range = range;
+    Item.InstanceCount = 0;
+    Item.FirstInstance = 0;
+    add(pass, Item, getDepth(model));
+}
+
+void
+RenderQueue::AddMesh(ERenderPass pass, const Shader& program, const Mesh& mesh, const glm::mat4& model) {
+    RenderItem Item;
+    Item.Program = &program;
+    Item.Material = mesh.GetMaterial();
+    Item.Format = mesh.GetFormat();
+    Item.Model = model;
+    Item.SourceMesh = &mesh;
+    Item.Range = GeometryRange();
+    Item.InstanceCount = 0;
+    Item.FirstInstance = 0;
+    add(pass, Item, getDepth(model));
+}
+
+void
+RenderQueue::AddInstances(ERenderPass pass, const Shader& program, EVertexFormat format, const GeometryRange& range, const InstanceTransform* instances, unsigned count) {
+    if (!count) {
+        return;
+    }
+
+    RenderItem Item;
+    Item.Program = &program;
+    // NOTE(Jovan): Instances select their own materials, the uniform is left alone
+    Item.Material = 0;
+    Item.Format = format;
+    Item.Model = glm::mat4(1.0f);
+    Item.SourceMesh = 0;
+    Item.Range = range;
+    Item.InstanceCount = count;
+    Item.FirstInstance = (unsigned)mInstances.size();
+    mInstances.insert(mInstances.end(), instances, instances + count);
+    // NOTE(Jovan): Sorted by the closest instance
+    float Depth = getDepth(instances[0].Model);
+    for (unsigned Instance = 1; Instance < count; ++Instance) {
+        Depth = std::min(Depth, getDepth(instances[Instance].Model));
+    }
+    add(pass, Item, Depth);
+}
+
+void
+RenderQueue::Submit() {
+    memset(&mStats, 0, sizeof(mStats));
+    mStats.Items = (unsigned)mItems.size();
+
+    // NOTE(Jovan): What drawing in the order of adding did: Use and Bind skip repeated
+    // programs and VAOs, but every non-instanced draw selected its material
+    const Shader* Program = 0;
+    int Format = -1;
+    for (unsigned ItemIdx = 0; ItemIdx < mItems.size(); ++ItemIdx) {
+        const RenderItem& Item = mItems[ItemIdx];
+        mStats.UnsortedProgramSwitches += Item.Program != Program;
+        mStats.UnsortedVAOSwitches += (int)Item.Format != Format;
+        mStats.UnsortedMaterialSwitches += !Item.InstanceCount;
+        Program = Item.Program;
+        Format = Item.Format;
+    }
+
+    // NOTE(Jovan): Ties keep the order items were added in, so frames sort the same way
+    std::sort(mOrder.begin(), mOrder.end(), [](const SortEntry& a, const SortEntry& b) {
+        return a.Key != b.Key ? a.Key < b.Key : a.Item < b.Item;
+    });
+
+    // NOTE(Jovan): Materials, model matrices and dequantization are uniforms, so they're
+    // forgotten whenever the program changes
+    Program = 0;
+    Format = -1;
+    int Material = -1;
+    const glm::mat4* Model = 0;
+    const Mesh* Dequantized = 0;
+    bool IsDequantized = false;
+    for (unsigned EntryIdx = 0; EntryIdx < mOrder.size(); ++EntryIdx) {
+        const RenderItem& Item = mItems[mOrder[EntryIdx].Item];
+        if (Item.Program != Program) {
+            if (Program && IsDequantized) {
+                VertexFormat::ResetDequantization(*Program);
+            }
+            Item.Program->Use();
+            Program = Item.Program;
+            Material = -1;
+            Model = 0;
+            Dequantized = 0;
+            IsDequantized = false;
+            ++mStats.ProgramSwitches;
+        }
+        if ((int)Item.Format != Format) {
+            GeometryBuffer::Bind(Item.Format);
+            Format = Item.Format;
+            ++mStats.VAOSwitches;
+        }
+
+        if (Item.InstanceCount) {
+            GeometryBuffer::UploadInstances(Item.Format, &mInstances[Item.FirstInstance], Item.InstanceCount);
+            glDrawArraysInstanced(GL_TRIANGLES, Item.Range.BaseVertex, Item.Range.VertexCount, Item.InstanceCount);
+            ++mStats.DrawCalls;
+            continue;
+        }
+
+        if ((int)Item.Material != Material) {
+            MaterialSystem::Select(*Program, Item.Material);
+            Material = Item.Material;
+            ++mStats.MaterialSwitches;
+        }
+        if (!Model || memcmp(Model, &Item.Model, sizeof(glm::mat4))) {
+            Program->SetModel(Item.Model);
+            Model = &Item.Model;
+        }
+        if (Item.SourceMesh) {
+            if (Item.SourceMesh != Dequantized) {
+                Item.SourceMesh->SetDequantization(*Program);
+                Dequantized = Item.SourceMesh;
+                IsDequantized = true;
+            }
+            Item.SourceMesh->Draw();
+            mStats.DrawCalls += Item.SourceMesh->GetDrawCount();
+        } else {
+            if (IsDequantized) {
+                VertexFormat::ResetDequantization(*Program);
+                Dequantized = 0;
+                IsDequantized = false;
+            }
+            glDrawArrays(GL_TRIANGLES, Item.Range.BaseVertex, Item.Range.VertexCount);
+            ++mStats.DrawCalls;
+        }
+    }
+    if (Program && IsDequantized) {
+        VertexFormat::ResetDequantization(*Program);
+    }
+}
+
+const RenderQueueStats&
+RenderQueue::GetStats() const {
+    return mStats;
+}
+
+void
+RenderQueue::add(ERenderPass pass, const RenderItem& item, float depth) {
+    SortEntry Entry;
+    Entry.Key = makeKey(pass, item, depth);
+    Entry.Item = (unsigned)mItems.size();
+    mItems.push_back(item);
+    mOrder.push_back(Entry);
+}
+
+uint64_t
+RenderQueue::makeKey(ERenderPass pass, const RenderItem& item, float depth) {
+    unsigned ProgramId = item.Program->GetId();
+    std::unordered_map<unsigned, unsigned>::iterator Slot = mProgramSlots.find(ProgramId);
+    if (Slot == mProgramSlots.end()) {
+        Slot = mProgramSlots.insert(std::make_pair(ProgramId, (unsigned)mProgramSlots.size())).first;
+    }
+
+    // NOTE(Jovan): Non-negative floats order the same as their bits. Transparent items
+    // flip them to sort back to front
+    uint32_t DepthBits;
+    depth = std::max(depth, 0.0f);
+    memcpy(&DepthBits, &depth, sizeof(DepthBits));
+    if (pass == RENDER_PASS_TRANSPARENT) {
+        DepthBits = ~DepthBits;
+    }
+
+    uint64_t Key = (uint64_t)pass & RENDER_KEY_MASK(RENDER_KEY_PASS_BITS);
+    Key = (Key << RENDER_KEY_PROGRAM_BITS) | ((uint64_t)Slot->second & RENDER_KEY_MASK(RENDER_KEY_PROGRAM_BITS));
+    Key = (Key << RENDER_KEY_MATERIAL_BITS) | ((uint64_t)item.Material & RENDER_KEY_MASK(RENDER_KEY_MATERIAL_BITS));
+    Key = (Key << RENDER_KEY_FORMAT_BITS) | ((uint64_t)item.Format & RENDER_KEY_MASK(RENDER_KEY_FORMAT_BITS));
+    Key = (Key << RENDER_KEY_DEPTH_BITS) | DepthBits;
+    return Key;
+}
+
+float
+RenderQueue::getDepth(const glm::mat4& model) const {
+    // NOTE(Jovan): Distance of the model's origin along the view direction
+    return -(mView * model[3]).z;
+}
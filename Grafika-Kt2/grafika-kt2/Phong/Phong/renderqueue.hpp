@@ -0,0 +1,153 @@
+/**
+ * @file renderqueue.hpp
+ * @author Jovan Ivosevic
+ * @brief Draws collected over a frame and submitted sorted by state
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+#include "shader.hpp"
+#include "geometrybuffer.hpp"
+#include "vertexformat.hpp"
+
+class Mesh;
+
+// NOTE(Jovan): Sort key layout, most significant first: pass, program, material, vertex
+// format (VAO), view depth
+#define RENDER_KEY_PASS_BITS 2
+#define RENDER_KEY_PROGRAM_BITS 12
+#define RENDER_KEY_MATERIAL_BITS 12
+#define RENDER_KEY_FORMAT_BITS 6
+#define RENDER_KEY_DEPTH_BITS 32
+
+enum ERenderPass {
+    // NOTE(Jovan): Front to back inside a state bucket
+    RENDER_PASS_OPAQUE = 0,
+    // NOTE(Jovan): Back to front inside a state bucket
+    RENDER_PASS_TRANSPARENT = 1,
+    RENDER_PASS_COUNT = 2,
+};
+
+struct RenderQueueStats {
+    unsigned Items;
+    unsigned DrawCalls;
+    // NOTE(Jovan): State changes of the submitted draws, after sorting and filtering
+    unsigned ProgramSwitches;
+    unsigned MaterialSwitches;
+    unsigned VAOSwitches;
+    // NOTE(Jovan): State changes the same draws would make in the order they were added,
+    // i.e. drawn immediately
+    unsigned UnsortedProgramSwitches;
+    unsigned UnsortedMaterialSwitches;
+    unsigned UnsortedVAOSwitches;
+};
+
+/**
+ * @brief Collects a frame's draws instead of drawing them right away. Submit sorts them
+ * by a 64-bit key (see RENDER_KEY_*), so draws sharing a program, material and VAO end up
+ * next to each other, and then draws them, changing only the state that differs from the
+ * previous draw. Model matrices and mesh dequantization are also only set when they change.
+ *
+ * Items keep pointers to the programs and meshes they draw, which must stay alive until
+ * Submit. Instanced items copy their instances, so batches may be changed right after
+ *
+ */
+class RenderQueue {
+public:
+    RenderQueue();
+
+    /**
+     * @brief Removes all items and starts a new frame
+     *
+     * @param view - View matrix, items are sorted by depth in view space
+     */
+    void Begin(const glm::mat4& view);
+
+    /**
+     * @brief Adds a draw of a non-indexed geometry range
+     *
+     * @param pass - Render pass
+     * @param program - Program drawn with
+     * @param material - Material, see MaterialSystem
+     * @param format - Vertex format of the geometry
+     * @param range - Geometry range, drawn as GL_TRIANGLES without indices
+     * @param model - Model matrix
+     */
+    void AddRange(ERenderPass pass, const Shader& program, unsigned material, EVertexFormat format, const GeometryRange& range, const glm::mat4& model);
+
+    /**
+     * @brief Adds a draw of a mesh with its own material and dequantization
+     *
+     * @param pass - Render pass
+     * @param program - Program drawn with
+     * @param mesh - Mesh
+     * @param model - Model matrix
+     */
+    void AddMesh(ERenderPass pass, const Shader& program, const Mesh& mesh, const glm::mat4& model);
+
+    /**
+     * @brief Adds an instanced draw of a non-indexed geometry range. Instances carry their
+     * own materials, see InstanceBatch
+     *
+     * @param pass - Render pass
+     * @param program - Instanced program drawn with
+     * @param format - Vertex format of the geometry
+     * @param range - Geometry range, drawn as GL_TRIANGLES without indices
+     * @param instances - Instances, copied into the queue
+     * @param count - Number of instances
+     */
+    void AddInstances(ERenderPass pass, const Shader& program, EVertexFormat format, const GeometryRange& range, const InstanceTransform* instances, unsigned count);
+
+    /**
+     * @brief Sorts and draws all items. Leaves the last program in use and its VAO bound,
+     * with dequantization reset
+     *
+     */
+    void Submit();
+
+    /**
+     * @brief Returns counts of the last submitted frame
+     *
+     */
+    const RenderQueueStats& GetStats() const;
+
+private:
+    struct RenderItem {
+        const Shader* Program;
+        unsigned Material;
+        EVertexFormat Format;
+        glm::mat4 Model;
+        // NOTE(Jovan): Null for geometry ranges
+        const Mesh* SourceMesh;
+        GeometryRange Range;
+        // NOTE(Jovan): Zero for non-instanced draws
+        unsigned InstanceCount;
+        unsigned FirstInstance;
+    };
+
+    struct SortEntry {
+        uint64_t Key;
+        unsigned Item;
+    };
+
+    glm::mat4 mView;
+    std::vector<RenderItem> mItems;
+    std::vector<SortEntry> mOrder;
+    std::vector<InstanceTransform> mInstances;
+    // NOTE(Jovan): Program ID -> key slot, kept between frames so slots stay the same
+    std::unordered_map<unsigned, unsigned> mProgramSlots;
+    RenderQueueStats mStats;
+
+    void add(ERenderPass pass, const RenderItem& item, float depth);
+    uint64_t makeKey(ERenderPass pass, const RenderItem& item, float depth);
+    float getDepth(const glm::mat4& model) const;
+};
@@ -1,53 +1,261 @@
 #include "shader.hpp"
+#include "uniformbuffer.hpp"
+#include "programcache.hpp"
+#include <cmath>
 
-Shader::Shader(const std::string& vShaderPath, const std::string& fShaderPath) {
-    unsigned vs = loadAndCompileShader(vShaderPath, GL_VERTEX_SHADER);
-    unsigned fs = loadAndCompileShader(fShaderPath, GL_FRAGMENT_SHADER);
-    mId = createBasicProgram(vs, fs);
+unsigned Shader::sCurrentProgram = 0;
+bool Shader::sParallelCompile = false;
+
+/**
+ * @brief Inserts lines after the #version directive, which has to stay first
+ *
+ * @param source - Shader source
+ * @param defines - Lines to insert
+ *
+ * @returns Source with the lines inserted
+ */
+static std::string
+insertDefines(const std::string& source, const std::string& defines) {
+    if (defines.empty()) {
+        return source;
+    }
+    size_t Version = source.find("#version");
+    size_t LineEnd = Version == std::string::npos ? std::string::npos : source.find('\n', Version);
+    if (LineEnd == std::string::npos) {
+        return Version == std::string::npos ? defines + source : source + "\n" + defines;
+    }
+    return source.substr(0, LineEnd + 1) + defines + source.substr(LineEnd + 1);
+}
+
+Shader::Shader(const std::string& vShaderPath, const std::string& fShaderPath, const std::string& defines, bool async)
+    : mVertexPath(vShaderPath), mFragmentPath(fShaderPath) {
+    mReady = false;
+    mModelLocation = -1;
+    mNormalMatrixLocation = -1;
+    mMaterialIndexLocation = -1;
+    mPositionScaleLocation = -1;
+    mPositionOffsetLocation = -1;
+    mNormalEncodingLocation = -1;
+    std::string VertexSource = insertDefines(loadSource(vShaderPath), defines);
+    std::string FragmentSource = insertDefines(loadSource(fShaderPath), defines);
+    mCachePath = ProgramCache::GetCachePath(vShaderPath, fShaderPath, defines);
+    mCacheKey = ProgramCache::GetKey(VertexSource, FragmentSource);
+    unsigned Program = ProgramCache::Load(mCachePath, mCacheKey);
+    if (Program) {
+        std::cout << "Loaded " << vShaderPath << " + " << fShaderPath << " from program cache" << std::endl;
+    } else {
+        // NOTE(Jovan): Only submitted here, nothing queries the driver until finish
+        mVertexShader.Reset(compileShader(VertexSource, GL_VERTEX_SHADER));
+        mFragmentShader.Reset(compileShader(FragmentSource, GL_FRAGMENT_SHADER));
+        Program = createBasicProgram(mVertexShader.GetId(), mFragmentShader.GetId());
+    }
+    mProgram.Reset(Program);
+    if (!async) {
+        finish();
+    }
+}
+
+bool
+Shader::EnableParallelCompile() {
+    sParallelCompile = GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+    // NOTE(Jovan): 0xFFFFFFFF lets the driver pick the number of compiler threads
+    if (GLEW_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    } else if (GLEW_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    }
+    return sParallelCompile;
+}
+
+bool
+Shader::IsReady() const {
+    return mReady;
+}
+
+bool
+Shader::Poll() {
+    if (mReady) {
+        return true;
+    }
+    if (sParallelCompile) {
+        int Completed = 0;
+        glGetProgramiv(mProgram.GetId(), GL_COMPLETION_STATUS_KHR, &Completed);
+        if (!Completed) {
+            return false;
+        }
+    }
+    finish();
+    return true;
+}
+
+void
+Shader::Wait() {
+    if (!mReady) {
+        finish();
+    }
 }
 
 unsigned
 Shader::GetId() const {
-    return mId;
+    return mProgram.GetId();
+}
+
+void
+Shader::Use() const {
+    UseProgram(mProgram.GetId());
+}
+
+void
+Shader::UseProgram(unsigned program) {
+    if (program != sCurrentProgram) {
+        glUseProgram(program);
+        sCurrentProgram = program;
+    }
+}
+
+unsigned
+Shader::GetCurrentProgram() {
+    return sCurrentProgram;
+}
+
+int
+Shader::GetUniformLocation(UniformKey uniform) const {
+    std::unordered_map<uint32_t, int>::const_iterator Location = mUniformLocations.find(uniform.GetHash());
+    return Location != mUniformLocations.end() ? Location->second : -1;
 }
 
 void
-Shader::SetUniform1i(const std::string& uniform, int v) const {
-    glUniform1i(glGetUniformLocation(mId, uniform.c_str()), v);
+Shader::SetUniform1i(UniformKey uniform, int v) const {
+    glUniform1i(GetUniformLocation(uniform), v);
 }
 
 void
-Shader::SetUniform1f(const std::string& uniform, float v) const {
-    glUniform1f(glGetUniformLocation(mId, uniform.c_str()), v);
+Shader::SetUniform1f(UniformKey uniform, float v) const {
+    glUniform1f(GetUniformLocation(uniform), v);
 }
 
 void
-Shader::SetUniform3f(const std::string& uniform, const glm::vec3& v) const {
-    glUniform3f(glGetUniformLocation(mId, uniform.c_str()), v.x, v.y, v.z);
+Shader::SetUniform3f(UniformKey uniform, const glm::vec3& v) const {
+    glUniform3f(GetUniformLocation(uniform), v.x, v.y, v.z);
 }
 
 void
-Shader::SetUniform4m(const std::string& uniform, const glm::mat4& m) const {
-    glUniformMatrix4fv(glGetUniformLocation(mId, uniform.c_str()), 1, GL_FALSE, &m[0][0]);
+Shader::SetUniform4m(UniformKey uniform, const glm::mat4& m) const {
+    glUniformMatrix4fv(GetUniformLocation(uniform), 1, GL_FALSE, &m[0][0]);
 }
 
 void
 Shader::SetModel(const glm::mat4& m) const {
-    SetUniform4m("uModel", m);
+    glUniformMatrix4fv(mModelLocation, 1, GL_FALSE, &m[0][0]);
+    if (mNormalMatrixLocation >= 0) {
+        glm::mat3 NormalMatrix = GetNormalMatrix(m);
+        glUniformMatrix3fv(mNormalMatrixLocation, 1, GL_FALSE, &NormalMatrix[0][0]);
+    }
 }
 
 void
-Shader::SetView(const glm::mat4& m) const {
-    SetUniform4m("uView", m);
+Shader::SetMaterialIndex(int material) const {
+    glUniform1i(mMaterialIndexLocation, material);
 }
 
-void Shader::SetProjection(const glm::mat4& m) const {
-    SetUniform4m("uProjection", m);
+void
+Shader::SetDequantization(const glm::vec3& scale, const glm::vec3& offset, int normalEncoding) const {
+    glUniform3f(mPositionScaleLocation, scale.x, scale.y, scale.z);
+    glUniform3f(mPositionOffsetLocation, offset.x, offset.y, offset.z);
+    glUniform1i(mNormalEncodingLocation, normalEncoding);
 }
 
-unsigned
-Shader::loadAndCompileShader(std::string filename, GLuint shaderType) {
-    unsigned ShaderID = 0;
+glm::mat3
+Shader::GetNormalMatrix(const glm::mat4& m) {
+    glm::mat3 Linear(m);
+    float X = glm::dot(Linear[0], Linear[0]);
+    float Y = glm::dot(Linear[1], Linear[1]);
+    float Z = glm::dot(Linear[2], Linear[2]);
+    // NOTE(Jovan): Orthogonal axes of equal length, inverse transpose is the matrix itself up to scale
+    float Tolerance = 1e-4f * X;
+    if (std::fabs(X - Y) <= Tolerance && std::fabs(X - Z) <= Tolerance
+        && std::fabs(glm::dot(Linear[0], Linear[1])) <= Tolerance
+        && std::fabs(glm::dot(Linear[0], Linear[2])) <= Tolerance
+        && std::fabs(glm::dot(Linear[1], Linear[2])) <= Tolerance) {
+        return Linear;
+    }
+    return glm::transpose(glm::inverse(Linear));
+}
+
+void
+Shader::cacheUniformLocations() {
+    mUniformLocations.clear();
+    unsigned Program = mProgram.GetId();
+    int UniformCount = 0;
+    if (Program) {
+        glGetProgramiv(Program, GL_ACTIVE_UNIFORMS, &UniformCount);
+    }
+
+    std::unordered_map<uint32_t, std::string> Names;
+    for (int UniformIdx = 0; UniformIdx < UniformCount; ++UniformIdx) {
+        char Name[256];
+        int Size = 0;
+        GLenum Type;
+        glGetActiveUniform(Program, UniformIdx, sizeof(Name), 0, &Size, &Type, Name);
+
+        // NOTE(Jovan): Arrays are reported as "name[0]" with their element count. Elements
+        // are looked up by name, their locations are not guaranteed to be consecutive
+        std::vector<std::string> Aliases;
+        std::string BaseName = Name;
+        size_t Bracket = BaseName.find('[');
+        if (Bracket != std::string::npos) {
+            BaseName = BaseName.substr(0, Bracket);
+            Aliases.push_back(BaseName);
+            for (int Element = 0; Element < Size; ++Element) {
+                Aliases.push_back(BaseName + "[" + std::to_string(Element) + "]");
+            }
+        } else {
+            Aliases.push_back(BaseName);
+        }
+
+        for (unsigned AliasIdx = 0; AliasIdx < Aliases.size(); ++AliasIdx) {
+            const std::string& Alias = Aliases[AliasIdx];
+            uint32_t Hash = UniformKey(Alias).GetHash();
+            std::unordered_map<uint32_t, std::string>::const_iterator Existing = Names.find(Hash);
+            if (Existing != Names.end() && Existing->second != Alias) {
+                std::cerr << "[Err] Uniform names " << Existing->second << " and " << Alias << " have the same hash" << std::endl;
+                continue;
+            }
+            Names[Hash] = Alias;
+            mUniformLocations[Hash] = glGetUniformLocation(Program, Alias.c_str());
+        }
+    }
+
+    mModelLocation = GetUniformLocation("uModel");
+    mNormalMatrixLocation = GetUniformLocation("uNormalMatrix");
+    mMaterialIndexLocation = GetUniformLocation("uMaterialIndex");
+    mPositionScaleLocation = GetUniformLocation("uPositionScale");
+    mPositionOffsetLocation = GetUniformLocation("uPositionOffset");
+    mNormalEncodingLocation = GetUniformLocation("uNormalEncoding");
+}
+
+void
+Shader::bindUniformBlocks() {
+    unsigned Program = mProgram.GetId();
+    int BlockCount = 0;
+    if (Program) {
+        glGetProgramiv(Program, GL_ACTIVE_UNIFORM_BLOCKS, &BlockCount);
+    }
+
+    for (int BlockIdx = 0; BlockIdx < BlockCount; ++BlockIdx) {
+        char Name[256];
+        glGetActiveUniformBlockName(Program, BlockIdx, sizeof(Name), 0, Name);
+        int Binding = UniformBuffer::GetBinding(Name);
+        if (Binding < 0) {
+            std::cerr << "[Err] Unknown uniform block " << Name << std::endl;
+            continue;
+        }
+        glUniformBlockBinding(Program, BlockIdx, Binding);
+    }
+}
+
+std::string
+Shader::loadSource(const std::string& filename) {
     std::ifstream In(filename);
     std::string Str;
 
@@ -56,25 +264,35 @@ Shader::loadAndCompileShader(std::string filename, GLuint shaderType) {
     In.seekg(0, std::ios::beg);
 
     Str.assign((std::istreambuf_iterator<char>(In)), std::istreambuf_iterator<char>());
-    const char* CharContent = Str.c_str();
+    return Str;
+}
+
+unsigned
+Shader::compileShader(const std::string& source, GLuint shaderType) {
+    unsigned ShaderID = 0;
+    const char* CharContent = source.c_str();
 
     ShaderID = glCreateShader(shaderType);
     glShaderSource(ShaderID, 1, &CharContent, NULL);
     glCompileShader(ShaderID);
+    return ShaderID;
+}
 
+bool
+Shader::checkShader(unsigned shader, const std::string& filename, GLuint shaderType) {
     int Success;
     char InfoLog[512];
-    glGetShaderiv(ShaderID, GL_COMPILE_STATUS, &Success);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &Success);
     if (!Success) {
-        glGetShaderInfoLog(ShaderID, 256, NULL, InfoLog);
+        glGetShaderInfoLog(shader, 256, NULL, InfoLog);
         std::string ShaderTypeName = shaderType == GL_VERTEX_SHADER ? "vertex" : "fragment";
         std::cout << "Error while compiling shader [" << ShaderTypeName << "]:" << std::endl << InfoLog << std::endl;
-        return 0;
+        return false;
     }
 
     std::cout << "Loaded " << filename << " shader" << std::endl;
 
-    return ShaderID;
+    return true;
 }
 
 unsigned
@@ -83,21 +301,44 @@ Shader::createBasicProgram(unsigned vShader, unsigned fShader) {
     ProgramID = glCreateProgram();
     glAttachShader(ProgramID, vShader);
     glAttachShader(ProgramID, fShader);
+    // NOTE(Jovan): Asks the driver to keep the binary around for the program cache
+    if (ProgramCache::IsSupported()) {
+        glProgramParameteri(ProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glLinkProgram(ProgramID);
 
-    int Success;
-    char InfoLog[512];
-    glGetProgramiv(ProgramID, GL_LINK_STATUS, &Success);
-    if (!Success) {
-        glGetProgramInfoLog(ProgramID, 512, NULL, InfoLog);
-        std::cerr << "[Err] Failed to link shader program:" << std::endl << InfoLog << std::endl;
-        return 0;
-    }
+    return ProgramID;
+}
 
-    glDetachShader(ProgramID, vShader);
-    glDetachShader(ProgramID, fShader);
-    glDeleteShader(vShader);
-    glDeleteShader(fShader);
+void
+Shader::finish() {
+    mReady = true;
+    if (mVertexShader.GetId() || mFragmentShader.GetId()) {
+        unsigned Program = mProgram.GetId();
+        bool Compiled = checkShader(mVertexShader.GetId(), mVertexPath, GL_VERTEX_SHADER);
+        Compiled = checkShader(mFragmentShader.GetId(), mFragmentPath, GL_FRAGMENT_SHADER) && Compiled;
 
-    return ProgramID;
-}
\ No newline at end of file
+        int Success = 0;
+        if (Compiled) {
+            glGetProgramiv(Program, GL_LINK_STATUS, &Success);
+            if (!Success) {
+                char InfoLog[512];
+                glGetProgramInfoLog(Program, 512, NULL, InfoLog);
+                std::cerr << "[Err] Failed to link shader program:" << std::endl << InfoLog << std::endl;
+            }
+        }
+
+        glDetachShader(Program, mVertexShader.GetId());
+        glDetachShader(Program, mFragmentShader.GetId());
+        mVertexShader.Reset();
+        mFragmentShader.Reset();
+        if (Success) {
+            ProgramCache::Write(mCachePath, mCacheKey, Program);
+        } else {
+            mProgram.Reset();
+        }
+    }
+
+    cacheUniformLocations();
+    bindUniformBlocks();
+}
@@ -13,88 +13,261 @@
 #include <iostream>
 #include <vector>
 #include <fstream>
+#include <cstdint>
+#include <unordered_map>
 #include <GL/glew.h>
 #include <glm/glm.hpp>
+#include "glhandle.hpp"
 
+/**
+ * @brief Hashed uniform name (32-bit FNV-1a). The hash is only guaranteed to be computed at
+ * compile time for constexpr keys, and setting a uniform by key still looks it up, so uniforms
+ * set per draw go through the locations Shader resolves after link instead (see SetModel)
+ *
+ */
+class UniformKey {
+public:
+    constexpr UniformKey(const char* name) : mHash(hash(name)) {}
+    UniformKey(const std::string& name) : mHash(hash(name.c_str())) {}
+    constexpr uint32_t GetHash() const { return mHash; }
+
+private:
+    uint32_t mHash;
+
+    static constexpr uint32_t hash(const char* name) {
+        uint32_t Hash = 2166136261u;
+        while (*name) {
+            Hash = (Hash ^ (uint8_t)*name++) * 16777619u;
+        }
+        return Hash;
+    }
+};
+
+/**
+ * @brief Owns its shader program, which is deleted with the shader. Move-only
+ *
+ */
 class Shader {
 public:
     static const unsigned POSITION_LOCATION = 0;
     static const unsigned COLOR_LOCATION = 1;
-    unsigned mId;
 
-    Shader(const std::string& vShaderPath, const std::string& fShaderPath);
+    /**
+     * @brief Ctor - loads the program from the program cache, or compiles and links it
+     * and caches the result, see programcache.hpp
+     *
+     * @param vShaderPath Vertex shader path
+     * @param fShaderPath Fragment shader path
+     * @param defines Lines inserted after the #version line of both stages, e.g. "#define INSTANCED\n"
+     * @param async Only submit the compile and link. The program can't be used until Poll
+     * returns true or Wait returns
+     */
+    Shader(const std::string& vShaderPath, const std::string& fShaderPath, const std::string& defines = "", bool async = false);
+    Shader(Shader&& other) = default;
+    Shader& operator=(Shader&& other) = default;
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
     unsigned GetId() const;
 
+    /**
+     * @brief Lets the driver compile and link on its own threads, if it supports
+     * GL_KHR_parallel_shader_compile or GL_ARB_parallel_shader_compile. Call once after glewInit
+     *
+     * @returns true - Poll can check programs without blocking
+     */
+    static bool EnableParallelCompile();
+
+    /**
+     * @brief Returns whether the program is finished, without asking the driver
+     *
+     */
+    bool IsReady() const;
+
+    /**
+     * @brief Checks whether an async program is finished and, if it is, checks its status
+     * and looks up its uniforms. Never blocks with parallel compile enabled, otherwise it
+     * waits for the program
+     *
+     * @returns true - Program is ready, it may still have failed to build (GetId is 0)
+     */
+    bool Poll();
+
+    /**
+     * @brief Blocks until an async program is finished
+     *
+     */
+    void Wait();
+
+    /**
+     * @brief Puts the program in use, unless it already is
+     *
+     */
+    void Use() const;
+
+    /**
+     * @brief Puts a program in use, unless it already is. Program changes should all go
+     * through Use, so the program in use is known without asking the driver
+     *
+     * @param program Program ID, 0 for none
+     */
+    static void UseProgram(unsigned program);
+
+    static unsigned GetCurrentProgram();
+
+    /**
+     * @brief Returns location of an active uniform, resolved once after link
+     *
+     * @param uniform Uniform key
+     *
+     * @returns Uniform location, -1 if the program has no such active uniform
+     */
+    int GetUniformLocation(UniformKey uniform) const;
+
     /**
      * @brief Sets int uniform value
      *
-     * @param uniform Name of uniform
+     * @param uniform Uniform key
      * @param v Value
      */
-    void SetUniform1i(const std::string& uniform, int v) const;
+    void SetUniform1i(UniformKey uniform, int v) const;
 
     /**
      * @brief Sets float uniform value
      *
-     * @param uniform Name of uniform
+     * @param uniform Uniform key
      * @param v Value
      */
-    void SetUniform1f(const std::string& uniform, float v) const;
+    void SetUniform1f(UniformKey uniform, float v) const;
 
     /**
     * @brief Sets float uniform value
     *
-    * @param uniform Name of uniform
+    * @param uniform Uniform key
     * @param v Value
     */
-    void SetUniform3f(const std::string& uniform, const glm::vec3& v) const;
+    void SetUniform3f(UniformKey uniform, const glm::vec3& v) const;
 
     /**
      * @brief Sets 4x4 matrix uniform value
      *
-     * @param uniform Name of uniform
+     * @param uniform Uniform key
      * @param m GLM matrix
      */
-    void SetUniform4m(const std::string& uniform, const glm::mat4& m) const;
+    void SetUniform4m(UniformKey uniform, const glm::mat4& m) const;
 
     /**
-     * @brief Sets the Model matrix
+     * @brief Sets the Model matrix and the normal matrix that goes with it
      *
      * @param m Model matrix
      */
     void SetModel(const glm::mat4& m) const;
 
     /**
-     * @brief Sets the View matrix
+     * @brief Sets the material index of the following non-instanced draws, see MaterialSystem
      *
-     * @param m View matrix
+     * @param material Material index
      */
-    void SetView(const glm::mat4& m) const;
+    void SetMaterialIndex(int material) const;
 
     /**
-     * @brief Sets the Projection matrix
+     * @brief Sets the dequantization uniforms of basic.vert, see VertexFormat
      *
-     * @param m Projection matrix
+     * @param scale Position scale
+     * @param offset Position offset
+     * @param normalEncoding Normal encoding
      */
-    void SetProjection(const glm::mat4& m) const;
+    void SetDequantization(const glm::vec3& scale, const glm::vec3& offset, int normalEncoding) const;
+
+    /**
+     * @brief Returns the matrix that transforms normals for a model matrix. Rotations with
+     * uniform scale, most of the scene, skip the inverse and use the model matrix as is,
+     * the shader normalizes the result anyway
+     *
+     * @param m Model matrix
+     *
+     * @returns Normal matrix, up to scale
+     */
+    static glm::mat3 GetNormalMatrix(const glm::mat4& m);
 private:
+    static unsigned sCurrentProgram;
+    static bool sParallelCompile;
+    ProgramHandle mProgram;
+    // NOTE(Jovan): Shaders of a program built from source, deleted once it's finished
+    ShaderHandle mVertexShader;
+    ShaderHandle mFragmentShader;
+    std::string mVertexPath;
+    std::string mFragmentPath;
+    std::string mCachePath;
+    uint64_t mCacheKey;
+    bool mReady;
+    // NOTE(Jovan): Name hash -> location of every active uniform, filled after link
+    std::unordered_map<uint32_t, int> mUniformLocations;
+    // NOTE(Jovan): Uniforms set per draw, resolved once after link
+    int mModelLocation;
+    int mNormalMatrixLocation;
+    int mMaterialIndexLocation;
+    int mPositionScaleLocation;
+    int mPositionOffsetLocation;
+    int mNormalEncodingLocation;
 
     /**
-     * @brief Loads shader from file and returns the compiled shader's ID
+     * @brief Introspects active uniforms of the linked program and stores their locations.
+     * Array uniforms are stored under their bare name and under every element's name
+     *
+     */
+    void cacheUniformLocations();
+
+    /**
+     * @brief Points the program's shared uniform blocks (Frame, Lights, ...) at their
+     * binding points, see uniformbuffer.hpp
+     *
+     */
+    void bindUniformBlocks();
+
+    /**
+     * @brief Reads shader source from file
      *
      * @param filename File path to be loaded
+     *
+     * @returns Source text, empty if the file can't be read
+     */
+    std::string loadSource(const std::string& filename);
+
+    /**
+     * @brief Submits shader source for compilation
+     *
+     * @param source Shader source
      * @param shadertType Type of shader: vertex or fragment
      * 
-     * @returns Compiled shader's ID
+     * @returns Shader's ID
      */
-    unsigned loadAndCompileShader(std::string filename, GLuint shaderType);
+    unsigned compileShader(const std::string& source, GLuint shaderType);
+
     /**
-     * @brief Creates a shader program and returns the ID
+     * @brief Checks compile status of a shader and prints its log on failure
      *
-     * @param filename File path to be loaded
+     * @param shader Shader ID
+     * @param filename File path the source was loaded from, used in messages
      * @param shadertType Type of shader: vertex or fragment
+     *
+     * @returns true - Compiled, false - Failed
+     */
+    bool checkShader(unsigned shader, const std::string& filename, GLuint shaderType);
+
+    /**
+     * @brief Creates a shader program and submits it for linking
+     *
+     * @param vShader Vertex shader ID
+     * @param fShader Fragment shader ID
      * 
      * @returns Shader program ID
      */
     unsigned createBasicProgram(unsigned vShader, unsigned fShader);
+
+    /**
+     * @brief Checks build status, caches the program binary, looks up uniforms and binds
+     * uniform blocks. Blocks until the driver is done with the program
+     *
+     */
+    void finish();
 };
\ No newline at end of file
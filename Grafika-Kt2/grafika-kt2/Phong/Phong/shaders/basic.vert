@@ -3,19 +3,65 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aUV;
+#ifdef INSTANCED
+// NOTE(Jovan): Per instance model and normal matrices (see InstanceTransform in vertexformat.hpp)
+layout (location = 3) in mat4 aInstanceModel;
+layout (location = 7) in mat3 aInstanceNormalMatrix;
+// NOTE(Jovan): Per instance material, so one draw can cover copies with different materials
+layout (location = 10) in uint aInstanceMaterial;
+#endif
 
-uniform mat4 uProjection;
-uniform mat4 uView;
+// NOTE(Jovan): Shared with all programs, see FrameUniforms in uniformbuffer.hpp
+layout (std140) uniform Frame {
+	mat4 uProjection;
+	mat4 uView;
+	mat4 uViewProjection;
+	vec3 uViewPos;
+	float uTime;
+};
+
+#ifndef INSTANCED
 uniform mat4 uModel;
+// NOTE(Jovan): Set with uModel, see Shader::SetModel
+uniform mat3 uNormalMatrix;
+// NOTE(Jovan): Index into the Materials block, see MaterialSystem::Select
+uniform int uMaterialIndex;
+#endif
+
+// NOTE(Jovan): Dequantization of compact vertex formats (see vertexformat.hpp).
+// Identity (scale 1, offset 0, xyz normals) for plain float vertices
+uniform vec3 uPositionScale;
+uniform vec3 uPositionOffset;
+uniform int uNormalEncoding;
 
 out vec2 UV;
 out vec3 vWorldSpaceFragment;
 out vec3 vWorldSpaceNormal;
+flat out int vMaterial;
+
+vec3 OctDecode(vec2 e) {
+	vec3 N = vec3(e.xy, 1.0f - abs(e.x) - abs(e.y));
+	float T = max(-N.z, 0.0f);
+	N.x += N.x >= 0.0f ? -T : T;
+	N.y += N.y >= 0.0f ? -T : T;
+	return normalize(N);
+}
 
 void main() {
-	vWorldSpaceFragment = vec3(uModel * vec4(aPos, 1.0f));
-	vWorldSpaceNormal = normalize(mat3(transpose(inverse(uModel))) * aNormal);
+	vec3 Position = aPos * uPositionScale + uPositionOffset;
+	vec3 Normal = uNormalEncoding == 1 ? OctDecode(aNormal.xy) : aNormal;
+
+#ifdef INSTANCED
+	vec4 WorldPosition = aInstanceModel * vec4(Position, 1.0f);
+	vWorldSpaceNormal = normalize(aInstanceNormalMatrix * Normal);
+	vMaterial = int(aInstanceMaterial);
+#else
+	vec4 WorldPosition = uModel * vec4(Position, 1.0f);
+	vWorldSpaceNormal = normalize(uNormalMatrix * Normal);
+	vMaterial = uMaterialIndex;
+#endif
 
+	vWorldSpaceFragment = vec3(WorldPosition);
 	UV = aUV;
-	gl_Position = uProjection * uView * uModel * vec4(aPos, 1.0f);
+	gl_Position = uViewProjection * WorldPosition;
 }
\ No newline at end of file
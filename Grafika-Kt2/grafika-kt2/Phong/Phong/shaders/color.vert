@@ -2,12 +2,19 @@
 
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 uProjection;
-uniform mat4 uView;
+// NOTE(Jovan): Shared with all programs, see FrameUniforms in uniformbuffer.hpp
+layout (std140) uniform Frame {
+	mat4 uProjection;
+	mat4 uView;
+	mat4 uViewProjection;
+	vec3 uViewPos;
+	float uTime;
+};
+
 uniform mat4 uModel;
 uniform mat4 uMVP;
 
 
 void main() {
-	gl_Position = uMVP * uProjection * uView * uModel * vec4(aPos, 1.0f);
+	gl_Position = uMVP * (uViewProjection * (uModel * vec4(aPos, 1.0f)));
 }
\ No newline at end of file
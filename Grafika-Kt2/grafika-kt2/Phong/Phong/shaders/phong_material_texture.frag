@@ -1,205 +1,239 @@
 #version 330 core
 
-struct PositionalLight {
-	vec3 Position;
-	vec3 Ka;
-	vec3 Kd;
-	vec3 Ks;
-	float Kc;
-	float Kl;
-	float Kq;
+// NOTE(Jovan): HAS_SPECULAR_MAP, HAS_SPOT_LIGHTS, HAS_LOCAL_LIGHTS and HAS_VIRTUAL_TEXTURE
+// are defined per variant by ShaderVariants (see shadervariants.hpp)
+
+// NOTE(Jovan): Must match ELightType and LIGHT_TEXELS in lightsystem.hpp
+#define LIGHT_TYPE_POINT 0
+#define LIGHT_TYPE_SPOT 1
+#define LIGHT_TYPE_DIRECTIONAL 2
+#define LIGHT_TEXELS 6
+// NOTE(Jovan): Must match MATERIAL_MAX_COUNT and MaterialData in uniformbuffer.hpp
+#define MATERIAL_MAX_COUNT 256
+// NOTE(Jovan): Must match TEXTURE_ARRAY_COUNT in texturecache.hpp
+#define TEXTURE_ARRAY_COUNT 4
+// NOTE(Jovan): Must match VIRTUAL_TEXTURE_MAX_COUNT in uniformbuffer.hpp, VIRTUAL_TILE_* in
+// tilepyramid.hpp and VIRTUAL_ATLAS_TILES in virtualtexturesystem.hpp
+#define VIRTUAL_TEXTURE_MAX_COUNT 16
+#define VIRTUAL_TILE_SIZE 128.0f
+#define VIRTUAL_TILE_BORDER 4.0f
+#define VIRTUAL_TILE_STRIDE 136.0f
+#define VIRTUAL_ATLAS_TILES 16.0f
+
+struct Material {
+	// NOTE(Jovan): Array of uMaterialLayers and layer in it of each texture. Diffuse is used
+	// as ambient as well since the light source defines the ambient colour
+	int DiffuseArray;
+	int DiffuseLayer;
+	int SpecularArray;
+	int SpecularLayer;
+	float Shininess;
+	// NOTE(Jovan): Replaces the diffuse layer if not -1
+	int VirtualTexture;
+	ivec2 Padding;
 };
 
-struct DirectionalLight {
-	vec3 Position;
-	vec3 Direction;
-	vec3 Ka;
-	vec3 Kd;
-	vec3 Ks;
-	float InnerCutOff;
-	float OuterCutOff;
-	float Kc;
-	float Kl;
-	float Kq;
+struct VirtualTexture {
+	// NOTE(Jovan): -1 until the texture's coarsest tile is resident
+	int TilesLog2;
+	int PageTableLevel;
+	float Size;
+	float Padding;
 };
 
-struct Material {
-	// NOTE(Jovan): Diffuse is used as ambient as well since the light source
-	// defines the ambient colour
-	sampler2D Kd;
-	sampler2D Ks;
-	float Shininess;
+layout (std140) uniform Frame {
+	mat4 uProjection;
+	mat4 uView;
+	mat4 uViewProjection;
+	vec3 uViewPos;
+	float uTime;
 };
 
-//tackasta
-uniform PositionalLight uKamenLight;
-uniform PositionalLight uKamenLight1;
-uniform PositionalLight uKamenLight2;
-uniform PositionalLight uKamenLight3;
-uniform PositionalLight uKamenLight4;
-uniform PositionalLight uSunceLight;
-uniform PositionalLight uMesecLight;
-
-uniform DirectionalLight uSpotlight;
-uniform DirectionalLight uDirLight;
-uniform DirectionalLight uReflektorLight1;
-uniform DirectionalLight uReflektorLight2;
-uniform Material uMaterial;
-uniform vec3 uViewPos;
+layout (std140) uniform Lights {
+	int uLightCount;
+	// NOTE(Jovan): Lights [0, uGlobalLightCount) reach every fragment, the rest are clustered
+	int uGlobalLightCount;
+	ivec4 uClusterCount;
+	float uClusterDepthNear;
+	float uClusterDepthScale;
+	vec2 uClusterTileSize;
+};
+
+layout (std140) uniform Materials {
+	Material uMaterials[MATERIAL_MAX_COUNT];
+};
+
+#ifdef HAS_VIRTUAL_TEXTURE
+layout (std140) uniform VirtualTextures {
+	VirtualTexture uVirtualTextures[VIRTUAL_TEXTURE_MAX_COUNT];
+};
+#endif
+
+// NOTE(Jovan): LIGHT_TEXELS texels per light:
+// Position, Type | Direction, Range | Ka, Kc | Kd, Kl | Ks, Kq | InnerCutOff, OuterCutOff
+uniform samplerBuffer uLightData;
+// NOTE(Jovan): Offset and count into uClusterLightIndices, per cluster
+uniform usamplerBuffer uClusterGrid;
+uniform usamplerBuffer uClusterLightIndices;
+// NOTE(Jovan): Every material texture, one layer each, an array per format (see texturecache.hpp)
+uniform sampler2DArray uMaterialLayers[TEXTURE_ARRAY_COUNT];
+#ifdef HAS_VIRTUAL_TEXTURE
+// NOTE(Jovan): Resident tiles and, per virtual texture, the slot of each tile of each level
+// (see virtualtexturesystem.hpp)
+uniform sampler2D uVirtualAtlas;
+uniform sampler2DArray uVirtualPageTable;
+#endif
 
 in vec2 UV;
 in vec3 vWorldSpaceFragment;
 in vec3 vWorldSpaceNormal;
+flat in int vMaterial;
 
 out vec4 FragColor;
 
-void main() {
-	vec3 ViewDirection = normalize(uViewPos - vWorldSpaceFragment);
-	// NOTE(Jovan): Directional light
-	vec3 DirLightVector = normalize(-uDirLight.Direction);
-	float DirDiffuse = max(dot(vWorldSpaceNormal, DirLightVector), 0.0f);
-	vec3 DirReflectDirection = reflect(-DirLightVector, vWorldSpaceNormal);
-	// NOTE(Jovan): 32 is the specular shininess factor. Hardcoded for now
-	float DirSpecular = pow(max(dot(ViewDirection, DirReflectDirection), 0.0f), uMaterial.Shininess);
-
-	vec3 DirAmbientColor = uDirLight.Ka * vec3(texture(uMaterial.Kd, UV));
-	vec3 DirDiffuseColor = uDirLight.Kd * DirDiffuse * vec3(texture(uMaterial.Kd, UV));
-	vec3 DirSpecularColor = uDirLight.Ks * DirSpecular * vec3(texture(uMaterial.Ks, UV));
-	vec3 DirColor = DirAmbientColor + DirDiffuseColor + DirSpecularColor;
-
-
-
-	//ukras1
-	// NOTE(Jovan): Point light
-	vec3 PtLightVector = normalize(uKamenLight.Position - vWorldSpaceFragment);
-	float PtDiffuse = max(dot(vWorldSpaceNormal, PtLightVector), 0.0f);
-	vec3 PtReflectDirection = reflect(-PtLightVector, vWorldSpaceNormal);
-	float PtSpecular = pow(max(dot(ViewDirection, PtReflectDirection), 0.0f), uMaterial.Shininess);
-
-	vec3 PtAmbientColor = uKamenLight.Ka * vec3(texture(uMaterial.Kd, UV));
-	vec3 PtDiffuseColor = PtDiffuse * uKamenLight.Kd * vec3(texture(uMaterial.Kd, UV));
-	vec3 PtSpecularColor = PtSpecular * uKamenLight.Ks * vec3(texture(uMaterial.Ks, UV));
-
-	float PtLightDistance = length(uKamenLight.Position - vWorldSpaceFragment);
-	float PtAttenuation = 1.0f / (uKamenLight.Kc + uKamenLight.Kl * PtLightDistance + uKamenLight.Kq * (PtLightDistance * PtLightDistance));
-	vec3 PtColor = PtAttenuation * (PtAmbientColor + PtDiffuseColor + PtSpecularColor);
-
-
-	// ukras2
-	PtLightVector = normalize(uKamenLight1.Position - vWorldSpaceFragment);
-	PtDiffuse = max(dot(vWorldSpaceNormal, PtLightVector), 0.0f);
-	PtReflectDirection = reflect(-PtLightVector, vWorldSpaceNormal);
-	PtSpecular = pow(max(dot(ViewDirection, PtReflectDirection), 0.0f), uMaterial.Shininess);
-
-	PtAmbientColor = uKamenLight1.Ka * vec3(texture(uMaterial.Kd, UV));
-	PtDiffuseColor = PtDiffuse * uKamenLight1.Kd * vec3(texture(uMaterial.Kd, UV));
-	PtSpecularColor = PtSpecular * uKamenLight1.Ks * vec3(texture(uMaterial.Ks, UV));
-
-	PtLightDistance = length(uKamenLight1.Position - vWorldSpaceFragment);
-	PtAttenuation = 1.0f / (uKamenLight1.Kc + uKamenLight1.Kl * PtLightDistance + uKamenLight1.Kq * (PtLightDistance * PtLightDistance));
-	vec3 PtColorTorch2 = PtAttenuation * (PtAmbientColor + PtDiffuseColor + PtSpecularColor);
-
-	
-	// ukras3
-	PtLightVector = normalize(uKamenLight2.Position - vWorldSpaceFragment);
-	PtDiffuse = max(dot(vWorldSpaceNormal, PtLightVector), 0.0f);
-	PtReflectDirection = reflect(-PtLightVector, vWorldSpaceNormal);
-	PtSpecular = pow(max(dot(ViewDirection, PtReflectDirection), 0.0f), uMaterial.Shininess);
-
-	PtAmbientColor = uKamenLight2.Ka * vec3(texture(uMaterial.Kd, UV));
-	PtDiffuseColor = PtDiffuse * uKamenLight2.Kd * vec3(texture(uMaterial.Kd, UV));
-	PtSpecularColor = PtSpecular * uKamenLight2.Ks * vec3(texture(uMaterial.Ks, UV));
-
-	PtLightDistance = length(uKamenLight2.Position - vWorldSpaceFragment);
-	PtAttenuation = 1.0f / (uKamenLight2.Kc + uKamenLight2.Kl * PtLightDistance + uKamenLight2.Kq * (PtLightDistance * PtLightDistance));
-	vec3 PtColorTorch3 = PtAttenuation * (PtAmbientColor + PtDiffuseColor + PtSpecularColor);
-
-
-	// ukras4
-	PtLightVector = normalize(uKamenLight3.Position - vWorldSpaceFragment);
-	PtDiffuse = max(dot(vWorldSpaceNormal, PtLightVector), 0.0f);
-	PtReflectDirection = reflect(-PtLightVector, vWorldSpaceNormal);
-	PtSpecular = pow(max(dot(ViewDirection, PtReflectDirection), 0.0f), uMaterial.Shininess);
-
-	PtAmbientColor = uKamenLight3.Ka * vec3(texture(uMaterial.Kd, UV));
-	PtDiffuseColor = PtDiffuse * uKamenLight3.Kd * vec3(texture(uMaterial.Kd, UV));
-	PtSpecularColor = PtSpecular * uKamenLight3.Ks * vec3(texture(uMaterial.Ks, UV));
-
-	PtLightDistance = length(uKamenLight3.Position - vWorldSpaceFragment);
-	PtAttenuation = 1.0f / (uKamenLight3.Kc + uKamenLight3.Kl * PtLightDistance + uKamenLight3.Kq * (PtLightDistance * PtLightDistance));
-	vec3 PtColorTorch4 = PtAttenuation * (PtAmbientColor + PtDiffuseColor + PtSpecularColor);
-
-	// ukras5
-	PtLightVector = normalize(uKamenLight4.Position - vWorldSpaceFragment);
-	PtDiffuse = max(dot(vWorldSpaceNormal, PtLightVector), 0.0f);
-	PtReflectDirection = reflect(-PtLightVector, vWorldSpaceNormal);
-	PtSpecular = pow(max(dot(ViewDirection, PtReflectDirection), 0.0f), uMaterial.Shininess);
-
-	PtAmbientColor = uKamenLight4.Ka * vec3(texture(uMaterial.Kd, UV));
-	PtDiffuseColor = PtDiffuse * uKamenLight4.Kd * vec3(texture(uMaterial.Kd, UV));
-	PtSpecularColor = PtSpecular * uKamenLight4.Ks * vec3(texture(uMaterial.Ks, UV));
-
-	PtLightDistance = length(uKamenLight4.Position - vWorldSpaceFragment);
-	PtAttenuation = 1.0f / (uKamenLight4.Kc + uKamenLight4.Kl * PtLightDistance + uKamenLight4.Kq * (PtLightDistance * PtLightDistance));
-	vec3 PtColorTorch5 = PtAttenuation * (PtAmbientColor + PtDiffuseColor + PtSpecularColor);
-
-	// sunce
-	PtLightVector = normalize(uSunceLight.Position - vWorldSpaceFragment);
-	PtDiffuse = max(dot(vWorldSpaceNormal, PtLightVector), 0.0f);
-	PtReflectDirection = reflect(-PtLightVector, vWorldSpaceNormal);
-	PtSpecular = pow(max(dot(ViewDirection, PtReflectDirection), 0.0f), uMaterial.Shininess);
-
-	PtAmbientColor = uSunceLight.Ka * vec3(texture(uMaterial.Kd, UV));
-	PtDiffuseColor = PtDiffuse * uSunceLight.Kd * vec3(texture(uMaterial.Kd, UV));
-	PtSpecularColor = PtSpecular * uSunceLight.Ks * vec3(texture(uMaterial.Ks, UV));
-
-	PtLightDistance = length(uSunceLight.Position - vWorldSpaceFragment);
-	PtAttenuation = 1.0f / (uSunceLight.Kc + uSunceLight.Kl * PtLightDistance + uSunceLight.Kq * (PtLightDistance * PtLightDistance));
-	vec3 PtColorSunce = PtAttenuation * (PtAmbientColor + PtDiffuseColor + PtSpecularColor);
-
-
-	
-	// uReflektorLight1
-	vec3 SpotlightVector1 = normalize(uReflektorLight1.Position - vWorldSpaceFragment);
-
-	float SpotDiffuse1 = max(dot(vWorldSpaceNormal, SpotlightVector1), 0.0f);
-	vec3 SpotReflectDirection1 = reflect(-SpotlightVector1, vWorldSpaceNormal);
-	float SpotSpecular1 = pow(max(dot(ViewDirection, SpotReflectDirection1), 0.0f), uMaterial.Shininess);
-
-	vec3 SpotAmbientColor1 = uReflektorLight1.Ka * vec3(texture(uMaterial.Kd, UV));
-	vec3 SpotDiffuseColor1 = SpotDiffuse1 * uReflektorLight1.Kd * vec3(texture(uMaterial.Kd, UV));
-	vec3 SpotSpecularColor1 = SpotSpecular1 * uReflektorLight1.Ks * vec3(texture(uMaterial.Ks, UV));
-
-	float SpotlightDistance1 = length(uReflektorLight1.Position - vWorldSpaceFragment);
-	float SpotAttenuation1 = 1.0f / (uReflektorLight1.Kc + uReflektorLight1.Kl * SpotlightDistance1 + uReflektorLight1.Kq * (SpotlightDistance1 * SpotlightDistance1));
-
-	float Theta1 = dot(SpotlightVector1, normalize(-uReflektorLight1.Direction));
-	float Epsilon1 = uReflektorLight1.InnerCutOff - uReflektorLight1.OuterCutOff;
-	float SpotIntensity1 = clamp((Theta1 - uReflektorLight1.OuterCutOff) / Epsilon1, 0.0f, 1.0f);
-	vec3 SpotColor1 = SpotIntensity1 * SpotAttenuation1 * (SpotAmbientColor1 + SpotDiffuseColor1 + SpotSpecularColor1);
-
-		// uReflektorLight2
-	vec3 SpotlightVector2 = normalize(uReflektorLight2.Position - vWorldSpaceFragment);
-
-	float SpotDiffuse2 = max(dot(vWorldSpaceNormal, SpotlightVector2), 0.0f);
-	vec3 SpotReflectDirection2 = reflect(-SpotlightVector2, vWorldSpaceNormal);
-	float SpotSpecular2 = pow(max(dot(ViewDirection, SpotReflectDirection2), 0.0f), uMaterial.Shininess);
-
-	vec3 SpotAmbientColor2 = uReflektorLight2.Ka * vec3(texture(uMaterial.Kd, UV));
-	vec3 SpotDiffuseColor2 = SpotDiffuse2 * uReflektorLight2.Kd * vec3(texture(uMaterial.Kd, UV));
-	vec3 SpotSpecularColor2 = SpotSpecular2 * uReflektorLight2.Ks * vec3(texture(uMaterial.Ks, UV));
+/**
+ * @brief Shades the fragment with one light
+ *
+ * @param lightIdx - Light index in uLightData
+ * @param viewDirection - Fragment to camera direction
+ * @param diffuseTexel - Material diffuse colour
+ * @param specularTexel - Material specular colour
+ * @param shininess - Material specular exponent
+ *
+ * @returns Light's contribution, zero if out of range
+ */
+vec3 ShadeLight(int lightIdx, vec3 viewDirection, vec3 diffuseTexel, vec3 specularTexel, float shininess) {
+	int Base = lightIdx * LIGHT_TEXELS;
+	vec4 PositionType = texelFetch(uLightData, Base);
+	vec4 DirectionRange = texelFetch(uLightData, Base + 1);
+	int Type = int(PositionType.w);
+
+	vec3 LightVector = -DirectionRange.xyz;
+	float Distance = 0.0f;
+	if (Type != LIGHT_TYPE_DIRECTIONAL) {
+		vec3 ToLight = PositionType.xyz - vWorldSpaceFragment;
+		Distance = length(ToLight);
+		// NOTE(Jovan): Out of range lights are skipped before any of their other data is fetched
+		if (Distance > DirectionRange.w) {
+			return vec3(0.0f);
+		}
+		LightVector = ToLight / Distance;
+	}
+
+	vec4 AmbientKc = texelFetch(uLightData, Base + 2);
+	vec4 DiffuseKl = texelFetch(uLightData, Base + 3);
+	vec4 SpecularKq = texelFetch(uLightData, Base + 4);
+	float Attenuation = 1.0f;
+	if (Type != LIGHT_TYPE_DIRECTIONAL) {
+		Attenuation = 1.0f / (AmbientKc.w + DiffuseKl.w * Distance + SpecularKq.w * (Distance * Distance));
+	}
+#ifdef HAS_SPOT_LIGHTS
+	if (Type == LIGHT_TYPE_SPOT) {
+		vec2 CutOffs = texelFetch(uLightData, Base + 5).xy;
+		float Theta = dot(LightVector, -DirectionRange.xyz);
+		Attenuation *= clamp((Theta - CutOffs.y) / (CutOffs.x - CutOffs.y), 0.0f, 1.0f);
+	}
+#endif
+
+	float Diffuse = max(dot(vWorldSpaceNormal, LightVector), 0.0f);
+	vec3 ReflectDirection = reflect(-LightVector, vWorldSpaceNormal);
+	float Specular = pow(max(dot(viewDirection, ReflectDirection), 0.0f), shininess);
+	return Attenuation * (AmbientKc.rgb * diffuseTexel + Diffuse * DiffuseKl.rgb * diffuseTexel + Specular * SpecularKq.rgb * specularTexel);
+}
 
-	float SpotlightDistance2 = length(uReflektorLight2.Position - vWorldSpaceFragment);
-	float SpotAttenuation2 = 1.0f / (uReflektorLight2.Kc + uReflektorLight2.Kl * SpotlightDistance2 + uReflektorLight2.Kq * (SpotlightDistance2 * SpotlightDistance2));
+/**
+ * @brief Samples a material texture. Samplers can only be indexed by constants, hence the branches
+ *
+ * @param array - Index into uMaterialLayers
+ * @param layer - Layer in the array
+ * @param uv - Texture coordinates
+ * @param uvDx - Screen space x derivative of uv, taken in uniform control flow
+ * @param uvDy - Screen space y derivative of uv, taken in uniform control flow
+ *
+ * @returns Texel
+ */
+vec3 SampleMaterial(int array, int layer, vec2 uv, vec2 uvDx, vec2 uvDy) {
+	vec3 Coordinates = vec3(uv, float(layer));
+	if (array == 1) {
+		return textureGrad(uMaterialLayers[1], Coordinates, uvDx, uvDy).rgb;
+	} else if (array == 2) {
+		return textureGrad(uMaterialLayers[2], Coordinates, uvDx, uvDy).rgb;
+	} else if (array == 3) {
+		return textureGrad(uMaterialLayers[3], Coordinates, uvDx, uvDy).rgb;
+	}
+	return textureGrad(uMaterialLayers[0], Coordinates, uvDx, uvDy).rgb;
+}
 
-	float Theta2 = dot(SpotlightVector2, normalize(-uReflektorLight2.Direction));
-	float Epsilon2 = uReflektorLight2.InnerCutOff - uReflektorLight2.OuterCutOff;
-	float SpotIntensity2 = clamp((Theta2 - uReflektorLight2.OuterCutOff) / Epsilon2, 0.0f, 1.0f);
-	vec3 SpotColor2 = SpotIntensity2 * SpotAttenuation2 * (SpotAmbientColor2 + SpotDiffuseColor2 + SpotSpecularColor2);
+#ifdef HAS_VIRTUAL_TEXTURE
+/**
+ * @brief Samples a virtual texture through its page table. The level is picked like a
+ * mip level, the closest resident tile is used if that level's tile isn't in yet
+ *
+ * @param virtualTexture - Index into uVirtualTextures
+ * @param uv - Texture coordinates, wrapped
+ * @param uvDx - Screen space x derivative of uv, taken in uniform control flow
+ * @param uvDy - Screen space y derivative of uv, taken in uniform control flow
+ *
+ * @returns Texel from the atlas
+ */
+vec3 SampleVirtual(int virtualTexture, vec2 uv, vec2 uvDx, vec2 uvDy) {
+	VirtualTexture Info = uVirtualTextures[virtualTexture];
+	vec2 TexelsX = uvDx * Info.Size;
+	vec2 TexelsY = uvDy * Info.Size;
+	float Footprint = max(dot(TexelsX, TexelsX), dot(TexelsY, TexelsY));
+	int Level = int(clamp(floor(0.5f * log2(max(Footprint, 1.0f))), 0.0f, float(Info.TilesLog2)));
+
+	vec2 Wrapped = fract(uv);
+	ivec2 Page = ivec2(Wrapped * float(1 << (Info.TilesLog2 - Level)));
+	// NOTE(Jovan): Atlas slot x and y, level of the tile in it
+	vec3 Entry = texelFetch(uVirtualPageTable, ivec3(Page, virtualTexture), Info.PageTableLevel + Level).xyz * 255.0f;
+	vec2 InTile = fract(Wrapped * float(1 << (Info.TilesLog2 - int(Entry.z + 0.5f))));
+	vec2 Texel = floor(Entry.xy + 0.5f) * VIRTUAL_TILE_STRIDE + VIRTUAL_TILE_BORDER + InTile * VIRTUAL_TILE_SIZE;
+	return textureLod(uVirtualAtlas, Texel / (VIRTUAL_ATLAS_TILES * VIRTUAL_TILE_STRIDE), 0.0f).rgb;
+}
+#endif
 
+void main() {
+	vec3 ViewDirection = normalize(uViewPos - vWorldSpaceFragment);
+	// NOTE(Jovan): Sampled once, shared by all lights
+	Material FragmentMaterial = uMaterials[vMaterial];
+	// NOTE(Jovan): Derivatives are taken before branching on the per-instance material, they're
+	// undefined in non-uniform control flow. Footprint of the unwrapped coordinates, wrapping
+	// would jump at the seam
+	vec2 UVDx = dFdx(UV);
+	vec2 UVDy = dFdy(UV);
+#ifdef HAS_VIRTUAL_TEXTURE
+	vec3 DiffuseTexel;
+	if (FragmentMaterial.VirtualTexture >= 0 && uVirtualTextures[FragmentMaterial.VirtualTexture].TilesLog2 >= 0) {
+		DiffuseTexel = SampleVirtual(FragmentMaterial.VirtualTexture, UV, UVDx, UVDy);
+	} else {
+		DiffuseTexel = SampleMaterial(FragmentMaterial.DiffuseArray, FragmentMaterial.DiffuseLayer, UV, UVDx, UVDy);
+	}
+#else
+	vec3 DiffuseTexel = SampleMaterial(FragmentMaterial.DiffuseArray, FragmentMaterial.DiffuseLayer, UV, UVDx, UVDy);
+#endif
+#ifdef HAS_SPECULAR_MAP
+	vec3 SpecularTexel = SampleMaterial(FragmentMaterial.SpecularArray, FragmentMaterial.SpecularLayer, UV, UVDx, UVDy);
+#else
+	vec3 SpecularTexel = DiffuseTexel;
+#endif
+
+	vec3 FinalColor = vec3(0.0f);
+	for (int LightIdx = 0; LightIdx < uGlobalLightCount; ++LightIdx) {
+		FinalColor += ShadeLight(LightIdx, ViewDirection, DiffuseTexel, SpecularTexel, FragmentMaterial.Shininess);
+	}
+
+#ifdef HAS_LOCAL_LIGHTS
+	// NOTE(Jovan): Depth slices grow exponentially, slice = log(depth / near) * scale
+	float ViewDepth = -(uView * vec4(vWorldSpaceFragment, 1.0f)).z;
+	ivec3 Cluster = ivec3(ivec2(gl_FragCoord.xy / uClusterTileSize), int(log(max(ViewDepth, uClusterDepthNear) / uClusterDepthNear) * uClusterDepthScale));
+	Cluster = clamp(Cluster, ivec3(0), uClusterCount.xyz - 1);
+	uvec2 OffsetCount = texelFetch(uClusterGrid, (Cluster.z * uClusterCount.y + Cluster.y) * uClusterCount.x + Cluster.x).xy;
+	for (uint Entry = 0u; Entry < OffsetCount.y; ++Entry) {
+		int LightIdx = int(texelFetch(uClusterLightIndices, int(OffsetCount.x + Entry)).x);
+		FinalColor += ShadeLight(LightIdx, ViewDirection, DiffuseTexel, SpecularTexel, FragmentMaterial.Shininess);
+	}
+#endif
 
-	
-	
-	vec3 FinalColor = DirColor + PtColor  + PtColorTorch2+PtColorTorch3+PtColorTorch4+PtColorTorch5+ PtColorSunce+ SpotColor1+SpotColor2;
 	FragColor = vec4(FinalColor, 1.0f);
 }
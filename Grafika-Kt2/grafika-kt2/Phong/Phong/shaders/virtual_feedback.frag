@@ -0,0 +1,64 @@
+#version 330 core
+
+// NOTE(Jovan): Writes the virtual texture tile each pixel wants, read back by
+// VirtualTextureSystem. Drawn with basic.vert into a framebuffer VIRTUAL_FEEDBACK_DIVISOR
+// times smaller than the window
+
+// NOTE(Jovan): Must match MATERIAL_MAX_COUNT, MaterialData and VIRTUAL_TEXTURE_MAX_COUNT in
+// uniformbuffer.hpp
+#define MATERIAL_MAX_COUNT 256
+#define VIRTUAL_TEXTURE_MAX_COUNT 16
+// NOTE(Jovan): log2 of VIRTUAL_FEEDBACK_DIVISOR in virtualtexturesystem.hpp, derivatives of
+// the small framebuffer are that many levels larger than the window's
+#define VIRTUAL_FEEDBACK_LEVEL_BIAS 3.0f
+
+struct Material {
+	int DiffuseArray;
+	int DiffuseLayer;
+	int SpecularArray;
+	int SpecularLayer;
+	float Shininess;
+	int VirtualTexture;
+	ivec2 Padding;
+};
+
+struct VirtualTexture {
+	int TilesLog2;
+	int PageTableLevel;
+	float Size;
+	float Padding;
+};
+
+layout (std140) uniform Materials {
+	Material uMaterials[MATERIAL_MAX_COUNT];
+};
+
+layout (std140) uniform VirtualTextures {
+	VirtualTexture uVirtualTextures[VIRTUAL_TEXTURE_MAX_COUNT];
+};
+
+in vec2 UV;
+flat in int vMaterial;
+
+out vec4 FragColor;
+
+void main() {
+	// NOTE(Jovan): Same level selection as SampleVirtual in phong_material_texture.frag
+	vec2 TexelsX = dFdx(UV);
+	vec2 TexelsY = dFdy(UV);
+	int Virtual = uMaterials[vMaterial].VirtualTexture;
+	if (Virtual < 0 || uVirtualTextures[Virtual].TilesLog2 < 0) {
+		// NOTE(Jovan): Nothing to request
+		FragColor = vec4(0.0f);
+		return;
+	}
+
+	VirtualTexture Info = uVirtualTextures[Virtual];
+	TexelsX *= Info.Size;
+	TexelsY *= Info.Size;
+	float Footprint = max(dot(TexelsX, TexelsX), dot(TexelsY, TexelsY));
+	float Level = clamp(floor(0.5f * log2(max(Footprint, 1.0f)) - VIRTUAL_FEEDBACK_LEVEL_BIAS), 0.0f, float(Info.TilesLog2));
+	ivec2 Page = ivec2(fract(UV) * float(1 << (Info.TilesLog2 - int(Level))));
+	// NOTE(Jovan): Column, row, level and texture + 1, zero alpha means no request
+	FragColor = vec4(vec2(Page), Level, float(Virtual + 1)) / 255.0f;
+}
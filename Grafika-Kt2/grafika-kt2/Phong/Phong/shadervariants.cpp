@@ -0,0 +1,100 @@
+#include "shadervariants.hpp"
+#include <iostream>
+
+// NOTE(Jovan): Indexed by feature bit
+static const char* FEATURE_DEFINES[SHADER_FEATURE_COUNT] = {
+    "HAS_SPECULAR_MAP",
+    "HAS_SPOT_LIGHTS",
+    "HAS_LOCAL_LIGHTS",
+    "INSTANCED",
+    "HAS_VIRTUAL_TEXTURE",
+};
+
+ShaderVariants::ShaderVariants(const std::string& vShaderPath, const std::string& fShaderPath, const std::function<void(const Shader&)>& setup)
+    : mVertexPath(vShaderPath), mFragmentPath(fShaderPath), mSetup(setup) {
+    mPendingCount = 0;
+}
+
+std::string
+ShaderVariants::GetDefines(unsigned features) {
+    std::string Defines;
+    for (unsigned Feature = 0; Feature < SHADER_FEATURE_COUNT; ++Feature) {
+        if (features & (1u << Feature)) {
+            Defines += std::string("#define ") + FEATURE_DEFINES[Feature] + "\n";
+        }
+    }
+    return Defines;
+}
+
+Shader&
+ShaderVariants::request(unsigned features) {
+    std::unordered_map<unsigned, Shader>::iterator Variant = mVariants.find(features);
+    if (Variant == mVariants.end()) {
+        Variant = mVariants.emplace(features, Shader(mVertexPath, mFragmentPath, GetDefines(features), true)).first;
+        ++mPendingCount;
+    }
+    return Variant->second;
+}
+
+void
+ShaderVariants::finish(Shader& variant) {
+    --mPendingCount;
+    // NOTE(Jovan): Every variant finishes exactly once, so this is logged once per variant
+    if (!variant.GetId()) {
+        std::cerr << "[Err] Shader variant of " << mVertexPath << " and " << mFragmentPath
+            << " failed to build, its draws use the fallback" << std::endl;
+        return;
+    }
+    if (!mSetup) {
+        return;
+    }
+    unsigned Previous = Shader::GetCurrentProgram();
+    variant.Use();
+    mSetup(variant);
+    Shader::UseProgram(Previous);
+}
+
+void
+ShaderVariants::Request(unsigned features) {
+    request(features);
+}
+
+const Shader&
+ShaderVariants::Get(unsigned features) {
+    Shader& Variant = request(features);
+    if (!Variant.IsReady() && Variant.Poll()) {
+        finish(Variant);
+    }
+    // NOTE(Jovan): Failed variants are ready too, but have no program
+    if (Variant.IsReady() && (Variant.GetId() || features == (features & SHADER_FEATURE_FALLBACK_MASK))) {
+        return Variant;
+    }
+    return Wait(features & SHADER_FEATURE_FALLBACK_MASK);
+}
+
+const Shader&
+ShaderVariants::Use(unsigned features) {
+    const Shader& Variant = Get(features);
+    Variant.Use();
+    return Variant;
+}
+
+const Shader&
+ShaderVariants::Wait(unsigned features) {
+    Shader& Variant = request(features);
+    if (!Variant.IsReady()) {
+        Variant.Wait();
+        finish(Variant);
+    }
+    return Variant;
+}
+
+unsigned
+ShaderVariants::GetCount() const {
+    return mVariants.size();
+}
+
+unsigned
+ShaderVariants::GetPendingCount() const {
+    return mPendingCount;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file shadervariants.hpp
+ * @author Jovan Ivosevic
+ * @brief Shader permutations selected by feature bits
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include "shader.hpp"
+
+// NOTE(Jovan): Each feature becomes a #define in both stages, see GetDefines
+enum EShaderFeature {
+    // NOTE(Jovan): Samples the material's specular layer, otherwise the diffuse texture doubles as the specular one
+    SHADER_FEATURE_SPECULAR_MAP = 1 << 0,
+    // NOTE(Jovan): Spot light cone falloff, only needed while a spot light is on
+    SHADER_FEATURE_SPOT_LIGHTS = 1 << 1,
+    // NOTE(Jovan): Cluster light list loop, only needed while there are lights with limited range
+    SHADER_FEATURE_LOCAL_LIGHTS = 1 << 2,
+    // NOTE(Jovan): Model matrix from the per instance attribute instead of uModel
+    SHADER_FEATURE_INSTANCED = 1 << 3,
+    // NOTE(Jovan): Diffuse colour from the material's virtual texture, see virtualtexturesystem.hpp
+    SHADER_FEATURE_VIRTUAL_TEXTURE = 1 << 4,
+    SHADER_FEATURE_COUNT = 5,
+};
+
+// NOTE(Jovan): Features a fallback variant keeps, the ones that change where vertices end up
+#define SHADER_FEATURE_FALLBACK_MASK SHADER_FEATURE_INSTANCED
+
+/**
+ * @brief One vertex and fragment shader pair built with different feature sets. Variants
+ * are compiled the first time they are asked for and kept for the lifetime of the object,
+ * so each draw can use the cheapest program that covers what it needs.
+ *
+ * Variants build asynchronously. Until a variant is ready, draws asking for it get its
+ * fallback, the variant with only the SHADER_FEATURE_FALLBACK_MASK features, which is
+ * waited for if needed
+ *
+ */
+class ShaderVariants {
+public:
+    /**
+     * @brief Ctor
+     *
+     * @param vShaderPath - Vertex shader path
+     * @param fShaderPath - Fragment shader path
+     * @param setup - Called with every new variant in use, sets uniforms that never change
+     * (sampler units, material constants, ...)
+     */
+    ShaderVariants(const std::string& vShaderPath, const std::string& fShaderPath, const std::function<void(const Shader&)>& setup);
+
+    /**
+     * @brief Submits a variant for compilation, if it's new. Never blocks
+     *
+     * @param features - EShaderFeature bits
+     */
+    void Request(unsigned features);
+
+    /**
+     * @brief Returns a variant if it's ready, its fallback otherwise or if it failed to
+     * build. New variants are requested. The program in use is left unchanged
+     *
+     * @param features - EShaderFeature bits
+     *
+     * @returns Variant or fallback, set up and ready
+     */
+    const Shader& Get(unsigned features);
+
+    /**
+     * @brief Same as Get, and puts the returned program in use
+     *
+     * @param features - EShaderFeature bits
+     *
+     * @returns Variant or fallback
+     */
+    const Shader& Use(unsigned features);
+
+    /**
+     * @brief Returns a variant, blocking until it's ready
+     *
+     * @param features - EShaderFeature bits
+     *
+     * @returns Variant
+     */
+    const Shader& Wait(unsigned features);
+
+    /**
+     * @brief Returns number of variants requested so far
+     *
+     */
+    unsigned GetCount() const;
+
+    /**
+     * @brief Returns number of requested variants that aren't ready yet
+     *
+     */
+    unsigned GetPendingCount() const;
+
+    /**
+     * @brief Returns #define lines for a feature set
+     *
+     * @param features - EShaderFeature bits
+     *
+     * @returns One line per feature, e.g. "#define HAS_SPECULAR_MAP\n"
+     */
+    static std::string GetDefines(unsigned features);
+
+private:
+    std::string mVertexPath;
+    std::string mFragmentPath;
+    std::function<void(const Shader&)> mSetup;
+    std::unordered_map<unsigned, Shader> mVariants;
+    unsigned mPendingCount;
+
+    /**
+     * @brief Returns a variant, submitting it if it's new
+     *
+     */
+    Shader& request(unsigned features);
+
+    /**
+     * @brief Sets up a variant that just became ready
+     *
+     */
+    void finish(Shader& variant);
+};
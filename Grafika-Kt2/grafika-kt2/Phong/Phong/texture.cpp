@@ -1,44 +1,103 @@
 #include "texture.hpp"
+#include "compressedtexture.hpp"
+#include "mipcache.hpp"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 unsigned
 Texture::LoadImageToTexture(const std::string& filePath) {
+    CompressedImage Compressed;
+    if (CompressedTexture::Read(filePath, Compressed)) {
+        std::cout << "Loading compressed texture: " << filePath << std::endl;
+        return CompressedTexture::CreateTexture(Compressed, Compressed.Data.data());
+    }
+
+    MipChain Mips;
+    if (!LoadMipChain(filePath, Mips)) {
+        // NOTE(Jovan): Stops here if the default is missing too
+        if (filePath == MISSING_TEXTURE_PATH) {
+            std::cerr << "Failed to load default texture: " << filePath << std::endl;
+            return 0;
+        }
+        std::cerr << "Failed to load texture: " << filePath << " loading default instead" << std::endl;
+        return LoadImageToTexture(MISSING_TEXTURE_PATH);
+    }
+
+    return CreateFromMipChain(Mips, Mips.Data.data());
+}
+
+bool
+Texture::LoadMipChain(const std::string& filePath, MipChain& chain) {
+    if (MipCache::Read(filePath, chain)) {
+        std::cout << "Loading texture: " << filePath << " from mip cache" << std::endl;
+        return true;
+    }
+
     int TextureWidth;
     int TextureHeight;
     int TextureChannels;
     std::cout << "Loading texture: " << filePath << std::endl;
     unsigned char* ImageData = stbi_load(filePath.c_str(), &TextureWidth, &TextureHeight, &TextureChannels, 0);
-
     if (!ImageData) {
-        std::cerr << "Failed to load texture: " << filePath << " loading default instead" << std::endl;
-        return LoadImageToTexture(MISSING_TEXTURE_PATH);
+        return false;
     }
 
     // NOTE(Jovan): Images should usually flipped vertically as they are loaded "upside-down"
-    stbi__vertical_flip(ImageData, TextureWidth, TextureHeight, TextureChannels);
+    ImageOps::FlipVertical(ImageData, (size_t)TextureWidth * TextureChannels, TextureHeight);
+    // NOTE(Jovan): Single channel images are usually data rather than color and are filtered as is
+    bool IsColor = TextureChannels != 1;
+    if (TextureChannels == 2) {
+        // NOTE(Jovan): Grey and alpha, expanded so it samples the same as it did as an image
+        const int GreyAlpha[4] = { 0, 0, 0, 1 };
+        std::vector<unsigned char> Expanded((size_t)TextureWidth * TextureHeight * 4);
+        ImageOps::Swizzle(ImageData, 2, Expanded.data(), 4, GreyAlpha, (size_t)TextureWidth * TextureHeight);
+        ImageOps::BuildMipChain(Expanded.data(), TextureWidth, TextureHeight, 4, MIP_FILTER_BOX, IsColor, chain);
+    } else {
+        ImageOps::BuildMipChain(ImageData, TextureWidth, TextureHeight, TextureChannels, MIP_FILTER_BOX, IsColor, chain);
+    }
+    // NOTE(Jovan): ImageData is no longer necessary in RAM and can be deallocated
+    stbi_image_free(ImageData);
 
-    // NOTE(Jovan): Checks or "guesses" the loaded image's format
-    GLint InternalFormat = -1;
-    switch (TextureChannels) {
-    case 1: InternalFormat = GL_RED; break;
-    case 3: InternalFormat = GL_RGB; break;
-    case 4: InternalFormat = GL_RGBA; break;
-    default: InternalFormat = GL_RGB; break;
+    if (!MipCache::Write(filePath, chain)) {
+        std::cerr << "[Warn] Failed to write mip cache of " << filePath << std::endl;
     }
+    return true;
+}
 
+unsigned
+Texture::CreateFromMipChain(const MipChain& chain, const unsigned char* data) {
+    GLenum Format = GetFormat(chain.Channels);
     unsigned Texture;
     glGenTextures(1, &Texture);
     glBindTexture(GL_TEXTURE_2D, Texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, InternalFormat, TextureWidth, TextureHeight, 0, InternalFormat, GL_UNSIGNED_BYTE, ImageData);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    // NOTE(Jovan): Rows are tightly packed, RGB rows aren't always a multiple of 4 bytes
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (unsigned LevelIdx = 0; LevelIdx < chain.Levels.size(); ++LevelIdx) {
+        const ImageLevel& Level = chain.Levels[LevelIdx];
+        glTexImage2D(GL_TEXTURE_2D, LevelIdx, Format, Level.Width, Level.Height, 0, Format, GL_UNSIGNED_BYTE, data + Level.Offset);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)chain.Levels.size() - 1);
+    SetDefaultParameters();
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return Texture;
+}
 
+GLenum
+Texture::GetFormat(int channels) {
+    // NOTE(Jovan): Checks or "guesses" the loaded image's format
+    switch (channels) {
+    case 1: return GL_RED;
+    case 3: return GL_RGB;
+    case 4: return GL_RGBA;
+    default: return GL_RGB;
+    }
+}
+
+void
+Texture::SetDefaultParameters() {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    // NOTE(Jovan): ImageData is no longer necessary in RAM and can be deallocated
-    stbi_image_free(ImageData);
-    return Texture;
-}
\ No newline at end of file
+}
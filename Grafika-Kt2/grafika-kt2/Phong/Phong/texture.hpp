@@ -2,8 +2,9 @@
 #include <string>
 #include <GL/glew.h>
 #include <iostream>
+#include "imageops.hpp"
 
-static const std::string MISSING_TEXTURE_PATH = "res/missing_texture";
+static const std::string MISSING_TEXTURE_PATH = "res/missing_textures.png";
 
 class Texture {
 public:
@@ -11,10 +12,48 @@ public:
 	 * @brief Loads image file and creates an OpenGL texture.
 	 * NOTE: Try avoiding .jpg and other lossy compression formats as
 	 * they are uncompressed during loading and the memory benefit is
-	 * negated with the addition of loss of quality
+	 * negated with the addition of loss of quality. Images converted with
+	 * --compress-textures are loaded from their block compressed file instead,
+	 * which stays compressed in video memory
 	 *
 	 * @param filePath Image file path
 	 * @returns TextureID
 	 */
 	static unsigned LoadImageToTexture(const std::string& filePath);
+
+	/**
+	 * @brief Loads an image and its mip chain, from the mip cache if it's up to date,
+	 * otherwise decoding it and writing the cache. Makes no GL calls, so it can run on
+	 * a worker thread
+	 *
+	 * @param filePath Image file path
+	 * @param chain Output mip chain, flipped and ready for upload
+	 * @returns true if the image was loaded
+	 */
+	static bool LoadMipChain(const std::string& filePath, MipChain& chain);
+
+	/**
+	 * @brief Creates an OpenGL texture with every level of a mip chain
+	 *
+	 * @param chain Mip chain
+	 * @param data Level data, or 0 to upload from the bound pixel unpack buffer which
+	 * holds it at offset 0
+	 * @returns TextureID
+	 */
+	static unsigned CreateFromMipChain(const MipChain& chain, const unsigned char* data);
+
+	/**
+	 * @brief Returns pixel format of an image with the given number of channels
+	 *
+	 * @param channels Channels per pixel
+	 * @returns GL_RED, GL_RGB or GL_RGBA
+	 */
+	static GLenum GetFormat(int channels);
+
+	/**
+	 * @brief Sets wrapping and filtering every loaded texture uses on the bound GL_TEXTURE_2D
+	 *
+	 */
+	static void SetDefaultParameters();
+
 };
@@ -0,0 +1,671 @@
+#include "texturecache.hpp"
+#include "texture.hpp"
+#include "workerpool.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <unordered_set>
+
+/**
+ * @brief 64-bit FNV-1a hash of a buffer
+ *
+ * @param data - Buffer
+ *
+ * @returns Hash
+ */
+static uint64_t
+hashData(const std::vector<unsigned char>& data) {
+    uint64_t Hash = 14695981039346656037ull;
+    for (size_t ByteIdx = 0; ByteIdx < data.size(); ++ByteIdx) {
+        Hash = (Hash ^ data[ByteIdx]) * 1099511628211ull;
+    }
+    // NOTE(Jovan): Size is mixed in so a file and its zero padded copy don't collide as easily
+    return (Hash ^ data.size()) * 1099511628211ull;
+}
+
+unsigned
+SharedTexture::GetId() const {
+    if (!mEntry) {
+        return 0;
+    }
+    const Entry* Target = mEntry->Alias ? mEntry->Alias.get() : mEntry.get();
+    return Target->Resident ? Target->Texture.GetId() : mEntry->Placeholder;
+}
+
+bool
+SharedTexture::IsResident() const {
+    return mEntry && (mEntry->Alias ? mEntry->Alias->Resident : mEntry->Resident);
+}
+
+int
+SharedTexture::GetArray() const {
+    if (!IsResident()) {
+        return -1;
+    }
+    return mEntry->Alias ? mEntry->Alias->Array : mEntry->Array;
+}
+
+unsigned
+SharedTexture::GetLayer() const {
+    if (!mEntry) {
+        return 0;
+    }
+    return mEntry->Alias ? mEntry->Alias->Layer : mEntry->Layer;
+}
+
+long
+SharedTexture::GetRefCount() const {
+    return mEntry.use_count();
+}
+
+TextureCache&
+TextureCache::Get() {
+    static TextureCache Instance;
+    return Instance;
+}
+
+TextureCache::TextureCache() {
+    mStats.Hits = 0;
+    mStats.ContentHits = 0;
+    mStats.Misses = 0;
+    mStats.BytesSaved = 0;
+    mStats.BytesResident = 0;
+    mStats.Pending = 0;
+    mStats.Layers = 0;
+    mStats.ArrayBytes = 0;
+    mDecoded = std::make_shared<DecodeQueue>();
+    mPlaceholderLoaded = false;
+    mDecoding = 0;
+}
+
+std::string
+TextureCache::GetCanonicalPath(const std::string& path) {
+    std::vector<std::string> Segments;
+    bool Absolute = !path.empty() && (path[0] == '/' || path[0] == '\\');
+    size_t Start = 0;
+    while (Start <= path.size()) {
+        size_t End = path.find_first_of("/\\", Start);
+        if (End == std::string::npos) {
+            End = path.size();
+        }
+        std::string Segment = path.substr(Start, End - Start);
+        Start = End + 1;
+        if (Segment.empty() || Segment == ".") {
+            continue;
+        }
+        // NOTE(Jovan): Leading ".." segments of relative paths can't be resolved and are kept
+        if (Segment == ".." && !Segments.empty() && Segments.back() != "..") {
+            Segments.pop_back();
+            continue;
+        }
+        Segments.push_back(Segment);
+    }
+
+    std::string Result = Absolute ? "/" : "";
+    for (unsigned SegmentIdx = 0; SegmentIdx < Segments.size(); ++SegmentIdx) {
+        if (SegmentIdx) {
+            Result += '/';
+        }
+        Result += Segments[SegmentIdx];
+    }
+#ifdef _WIN32
+    for (size_t CharIdx = 0; CharIdx < Result.size(); ++CharIdx) {
+        Result[CharIdx] = (char)std::tolower((unsigned char)Result[CharIdx]);
+    }
+#endif
+    return Result;
+}
+
+SharedTexture
+TextureCache::Load(const std::string& path, bool hashContent) {
+    SharedTexture Result;
+    std::string Canonical = GetCanonicalPath(path);
+    std::unordered_map<std::string, WeakEntry>::iterator ByPath = mByPath.find(Canonical);
+    if (ByPath != mByPath.end()) {
+        Result.mEntry = ByPath->second.lock();
+        if (Result.mEntry) {
+            ++mStats.Hits;
+            mStats.BytesSaved += (Result.mEntry->Alias ? Result.mEntry->Alias : Result.mEntry)->Bytes;
+            // NOTE(Jovan): Already streaming, waits for it like for any other load
+            if (!Result.IsResident() && getPending()) {
+                Finish();
+            }
+            return Result;
+        }
+    }
+
+    CompressedImage Compressed;
+    MipChain Mips;
+    bool IsCompressed = CompressedTexture::Read(path, Compressed);
+    bool Read = IsCompressed || Texture::LoadMipChain(path, Mips);
+    uint64_t Hash = 0;
+    if (Read && hashContent) {
+        Hash = hashData(IsCompressed ? Compressed.Data : Mips.Data);
+        std::unordered_map<uint64_t, WeakEntry>::iterator ByContent = mByContent.find(Hash);
+        if (ByContent != mByContent.end()) {
+            Result.mEntry = ByContent->second.lock();
+            if (Result.mEntry) {
+                std::cout << "Texture " << path << " has the same contents as a loaded texture" << std::endl;
+                ++mStats.ContentHits;
+                mStats.BytesSaved += Result.mEntry->Bytes;
+                mByPath[Canonical] = Result.mEntry;
+                return Result;
+            }
+        }
+    }
+
+    ++mStats.Misses;
+    Result.mEntry = std::make_shared<SharedTexture::Entry>();
+    Result.mEntry->Bytes = 0;
+    Result.mEntry->Placeholder = 0;
+    Result.mEntry->Array = -1;
+    Result.mEntry->Layer = 0;
+    unsigned Id = 0;
+    if (IsCompressed) {
+        std::cout << "Loading compressed texture: " << path << std::endl;
+        Id = CompressedTexture::CreateTexture(Compressed, Compressed.Data.data());
+        Result.mEntry->Bytes = Compressed.Data.size();
+    } else if (Read) {
+        Id = Texture::CreateFromMipChain(Mips, Mips.Data.data());
+        Result.mEntry->Bytes = Mips.Data.size();
+    }
+    if (!Id) {
+        std::cerr << "Failed to load texture: " << path << " using default instead" << std::endl;
+        Result.mEntry->Placeholder = getPlaceholder();
+        Read = false;
+    }
+    Result.mEntry->Texture.Reset(Id);
+    Result.mEntry->Resident = Id != 0;
+    mByPath[Canonical] = Result.mEntry;
+    if (Read && hashContent) {
+        mByContent[Hash] = Result.mEntry;
+    }
+    return Result;
+}
+
+SharedTexture
+TextureCache::LoadAsync(const std::string& path, bool hashContent) {
+    return loadAsync(path, hashContent, false);
+}
+
+SharedTexture
+TextureCache::LoadLayerAsync(const std::string& path, bool hashContent) {
+    return loadAsync(path, hashContent, true);
+}
+
+unsigned
+TextureCache::GetArrayId(ETextureArray array) const {
+    return mArrays[array].Texture.GetId();
+}
+
+SharedTexture
+TextureCache::loadAsync(const std::string& path, bool hashContent, bool isLayer) {
+    SharedTexture Result;
+    std::string Canonical = GetCanonicalPath(path);
+    std::unordered_map<std::string, WeakEntry>& Paths = isLayer ? mLayersByPath : mByPath;
+    std::unordered_map<std::string, WeakEntry>::iterator ByPath = Paths.find(Canonical);
+    if (ByPath != Paths.end()) {
+        Result.mEntry = ByPath->second.lock();
+        if (Result.mEntry) {
+            ++mStats.Hits;
+            mStats.BytesSaved += (Result.mEntry->Alias ? Result.mEntry->Alias : Result.mEntry)->Bytes;
+            return Result;
+        }
+    }
+
+    Result.mEntry = std::make_shared<SharedTexture::Entry>();
+    Result.mEntry->Bytes = 0;
+    Result.mEntry->Resident = false;
+    Result.mEntry->Placeholder = isLayer ? 0 : getPlaceholder();
+    Result.mEntry->Array = -1;
+    Result.mEntry->Layer = 0;
+    Paths[Canonical] = Result.mEntry;
+
+    ++mDecoding;
+    std::shared_ptr<DecodeQueue> Queue = mDecoded;
+    WeakEntry Entry = Result.mEntry;
+    WorkerPool::Get().Submit([Queue, Entry, path, hashContent, isLayer] {
+        DecodedImage Image;
+        Image.Entry = Entry;
+        Image.Path = path;
+        Image.IsLayer = isLayer;
+        Image.Hashed = false;
+        Image.Hash = 0;
+        if (isLayer) {
+            // NOTE(Jovan): Compressed layers need the whole chain, the array has every level
+            if (CompressedTexture::Read(path, Image.Compressed, TEXTURE_LAYER_SIZE) && Image.Compressed.Levels.size() == getLayerLevelCount()) {
+                if (hashContent) {
+                    Image.Hash = hashData(Image.Compressed.Data);
+                    Image.Hashed = true;
+                }
+            } else {
+                Image.Compressed = CompressedImage();
+                MipChain Source;
+                if (Texture::LoadMipChain(path, Source)) {
+                    ImageOps::ResampleMipChain(Source, TEXTURE_LAYER_SIZE, MIP_FILTER_BOX, Source.Channels != 1, Image.Mips);
+                    if (hashContent) {
+                        Image.Hash = hashData(Image.Mips.Data);
+                        Image.Hashed = true;
+                    }
+                }
+            }
+        } else if (CompressedTexture::Read(path, Image.Compressed)) {
+            if (hashContent) {
+                Image.Hash = hashData(Image.Compressed.Data);
+                Image.Hashed = true;
+            }
+        } else if (Texture::LoadMipChain(path, Image.Mips)) {
+            // NOTE(Jovan): Hashes decoded pixels, so the same image saved in another
+            // lossless format matches too
+            if (hashContent) {
+                Image.Hash = hashData(Image.Mips.Data);
+                Image.Hashed = true;
+            }
+        }
+
+        std::lock_guard<std::mutex> Lock(Queue->Mutex);
+        Queue->Images.push_back(std::move(Image));
+    });
+    return Result;
+}
+
+void
+TextureCache::Update(size_t budget) {
+    {
+        std::lock_guard<std::mutex> Lock(mDecoded->Mutex);
+        mDecoding -= (unsigned)mDecoded->Images.size();
+        mReady.insert(mReady.end(), std::make_move_iterator(mDecoded->Images.begin()), std::make_move_iterator(mDecoded->Images.end()));
+        mDecoded->Images.clear();
+    }
+
+    // NOTE(Jovan): Arrays grow once for all layers that are ready, not once per layer
+    unsigned Needed[TEXTURE_ARRAY_COUNT] = {};
+    for (size_t ImageIdx = 0; ImageIdx < mReady.size(); ++ImageIdx) {
+        const DecodedImage& Image = mReady[ImageIdx];
+        if (Image.IsLayer && (!Image.Compressed.Levels.empty() || !Image.Mips.Levels.empty())) {
+            ++Needed[getArray(Image)];
+        }
+    }
+    for (unsigned Array = 0; Array < TEXTURE_ARRAY_COUNT; ++Array) {
+        if (Needed[Array]) {
+            reserveLayers((ETextureArray)Array, Needed[Array]);
+        }
+    }
+
+    size_t Copied = 0;
+    while (!mReady.empty()) {
+        const DecodedImage& Next = mReady.front();
+        size_t Size = Next.Compressed.Data.size() + Next.Mips.Data.size();
+        if (Copied && Copied + Size > budget) {
+            break;
+        }
+        Copied += upload(mReady.front());
+        mReady.pop_front();
+    }
+    completeUploads();
+}
+
+void
+TextureCache::Finish() {
+    while (getPending()) {
+        Update();
+        if (getPending()) {
+            // NOTE(Jovan): Fences only signal once their commands reach the driver
+            glFlush();
+            std::this_thread::yield();
+        }
+    }
+}
+
+TextureCacheStats
+TextureCache::GetStats() {
+    prune();
+    std::unordered_set<const SharedTexture::Entry*> Counted;
+    mStats.BytesResident = 0;
+    for (std::unordered_map<std::string, WeakEntry>::const_iterator It = mByPath.begin(); It != mByPath.end(); ++It) {
+        EntryPtr Entry = It->second.lock();
+        if (Entry && Entry->Resident && Counted.insert(Entry.get()).second) {
+            mStats.BytesResident += Entry->Bytes;
+        }
+    }
+    mStats.Pending = getPending();
+    mStats.Layers = 0;
+    for (unsigned Array = 0; Array < TEXTURE_ARRAY_COUNT; ++Array) {
+        const std::vector<WeakEntry>& Layers = mArrays[Array].Layers;
+        for (size_t Layer = 0; Layer < Layers.size(); ++Layer) {
+            mStats.Layers += !Layers[Layer].expired();
+        }
+    }
+    mStats.ArrayBytes = getArrayBytes();
+    return mStats;
+}
+
+void
+TextureCache::Release() {
+    for (size_t UploadIdx = 0; UploadIdx < mUploads.size(); ++UploadIdx) {
+        glDeleteSync(mUploads[UploadIdx].Fence);
+    }
+    mUploads.clear();
+    mFreeBuffers.clear();
+    mReady.clear();
+    mPlaceholder.Reset();
+    for (unsigned Array = 0; Array < TEXTURE_ARRAY_COUNT; ++Array) {
+        mArrays[Array].Texture.Reset();
+        mArrays[Array].Layers.clear();
+    }
+}
+
+unsigned
+TextureCache::getPlaceholder() {
+    if (!mPlaceholderLoaded) {
+        mPlaceholderLoaded = true;
+        mPlaceholder.Reset(Texture::LoadImageToTexture(MISSING_TEXTURE_PATH));
+    }
+    return mPlaceholder.GetId();
+}
+
+unsigned
+TextureCache::getPending() const {
+    return mDecoding + (unsigned)mReady.size() + (unsigned)mUploads.size();
+}
+
+size_t
+TextureCache::upload(DecodedImage& image) {
+    EntryPtr Entry = image.Entry.lock();
+    bool IsCompressed = !image.Compressed.Levels.empty();
+    if (!Entry || (!IsCompressed && image.Mips.Levels.empty())) {
+        if (Entry) {
+            // NOTE(Jovan): Entry keeps its placeholder
+            std::cerr << "Failed to load texture: " << image.Path << " using default instead" << std::endl;
+            ++mStats.Misses;
+        }
+        return 0;
+    }
+
+    // NOTE(Jovan): Contents are only known after decoding, so a duplicate still costs
+    // a decode but no upload or video memory
+    std::unordered_map<uint64_t, WeakEntry>& Contents = image.IsLayer ? mLayersByContent : mByContent;
+    if (image.Hashed) {
+        std::unordered_map<uint64_t, WeakEntry>::iterator ByContent = Contents.find(image.Hash);
+        EntryPtr Original = ByContent != Contents.end() ? ByContent->second.lock() : EntryPtr();
+        if (Original && Original != Entry) {
+            std::cout << "Texture " << image.Path << " has the same contents as a loaded texture" << std::endl;
+            ++mStats.ContentHits;
+            Entry->Alias = Original->Alias ? Original->Alias : Original;
+            mStats.BytesSaved += Entry->Alias->Bytes;
+            return 0;
+        }
+        Contents[image.Hash] = Entry;
+    }
+
+    if (image.IsLayer) {
+        ETextureArray Array = getArray(image);
+        int Layer = findFreeLayer(Array);
+        if (Layer < 0) {
+            std::cerr << "[Err] Texture arrays are full, " << image.Path << " is not loaded" << std::endl;
+            ++mStats.Misses;
+            if (image.Hashed) {
+                Contents.erase(image.Hash);
+            }
+            return 0;
+        }
+        Entry->Array = Array;
+        Entry->Layer = Layer;
+        mArrays[Array].Layers[Layer] = Entry;
+    }
+
+    ++mStats.Misses;
+    std::cout << "Uploading texture: " << image.Path << std::endl;
+    const std::vector<unsigned char>& Data = IsCompressed ? image.Compressed.Data : image.Mips.Data;
+    size_t Size = Data.size();
+    PixelBuffer Buffer;
+    if (!mFreeBuffers.empty()) {
+        Buffer = std::move(mFreeBuffers.back());
+        mFreeBuffers.pop_back();
+    } else {
+        unsigned Id;
+        glGenBuffers(1, &Id);
+        Buffer.Buffer.Reset(Id);
+        Buffer.Capacity = 0;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, Buffer.Buffer.GetId());
+    if (Buffer.Capacity < Size) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, Size, 0, GL_STREAM_DRAW);
+        Buffer.Capacity = Size;
+    }
+    // NOTE(Jovan): Invalidating lets the driver hand out fresh memory instead of waiting
+    // for the buffer's previous upload
+    unsigned char* Mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, Size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    std::vector<unsigned char> Staging;
+    const unsigned char* Source = 0;
+    if (!Mapped) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        Staging.resize(Size);
+        Source = Staging.data();
+    }
+    // NOTE(Jovan): Blocks and mip chains are already flipped, so this is a straight copy
+    memcpy(Mapped ? Mapped : Staging.data(), Data.data(), Size);
+    if (Mapped && !glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+        std::cerr << "[Err] Upload buffer of " << image.Path << " was lost, texture may be corrupt" << std::endl;
+    }
+
+    if (image.IsLayer) {
+        uploadLayer(image, *Entry, Source);
+    } else {
+        unsigned Id = IsCompressed ? CompressedTexture::CreateTexture(image.Compressed, Source) : Texture::CreateFromMipChain(image.Mips, Source);
+        Entry->Texture.Reset(Id);
+    }
+    Entry->Bytes = Size;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    PendingUpload Upload;
+    Upload.Entry = Entry;
+    Upload.Buffer = std::move(Buffer);
+    Upload.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    mUploads.push_back(std::move(Upload));
+    return Size;
+}
+
+void
+TextureCache::completeUploads() {
+    for (size_t UploadIdx = 0; UploadIdx < mUploads.size();) {
+        PendingUpload& Upload = mUploads[UploadIdx];
+        GLenum Status = glClientWaitSync(Upload.Fence, 0, 0);
+        if (Status != GL_ALREADY_SIGNALED && Status != GL_CONDITION_SATISFIED) {
+            ++UploadIdx;
+            continue;
+        }
+
+        glDeleteSync(Upload.Fence);
+        EntryPtr Entry = Upload.Entry.lock();
+        if (Entry) {
+            Entry->Resident = true;
+        }
+        mFreeBuffers.push_back(std::move(Upload.Buffer));
+        if (UploadIdx + 1 != mUploads.size()) {
+            Upload = std::move(mUploads.back());
+        }
+        mUploads.pop_back();
+    }
+}
+
+void
+TextureCache::prune() {
+    for (std::unordered_map<std::string, WeakEntry>::iterator It = mByPath.begin(); It != mByPath.end();) {
+        It = It->second.expired() ? mByPath.erase(It) : std::next(It);
+    }
+    for (std::unordered_map<uint64_t, WeakEntry>::iterator It = mByContent.begin(); It != mByContent.end();) {
+        It = It->second.expired() ? mByContent.erase(It) : std::next(It);
+    }
+    for (std::unordered_map<std::string, WeakEntry>::iterator It = mLayersByPath.begin(); It != mLayersByPath.end();) {
+        It = It->second.expired() ? mLayersByPath.erase(It) : std::next(It);
+    }
+    for (std::unordered_map<uint64_t, WeakEntry>::iterator It = mLayersByContent.begin(); It != mLayersByContent.end();) {
+        It = It->second.expired() ? mLayersByContent.erase(It) : std::next(It);
+    }
+}
+
+void
+TextureCache::uploadLayer(const DecodedImage& image, const SharedTexture::Entry& entry, const unsigned char* data) {
+    bool IsCompressed = !image.Compressed.Levels.empty();
+    glBindTexture(GL_TEXTURE_2D_ARRAY, mArrays[entry.Array].Texture.GetId());
+    if (IsCompressed) {
+        GLenum InternalFormat = CompressedTexture::GetInternalFormat(image.Compressed.Format);
+        for (unsigned LevelIdx = 0; LevelIdx < image.Compressed.Levels.size(); ++LevelIdx) {
+            const CompressedLevel& Level = image.Compressed.Levels[LevelIdx];
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, LevelIdx, 0, 0, entry.Layer, Level.Width, Level.Height, 1, InternalFormat, Level.Size, data + Level.Offset);
+        }
+    } else {
+        for (unsigned LevelIdx = 0; LevelIdx < image.Mips.Levels.size(); ++LevelIdx) {
+            const ImageLevel& Level = image.Mips.Levels[LevelIdx];
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, LevelIdx, 0, 0, entry.Layer, Level.Width, Level.Height, 1, GL_RGBA, GL_UNSIGNED_BYTE, data + Level.Offset);
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void
+TextureCache::reserveLayers(ETextureArray array, unsigned count) {
+    TextureArray& Target = mArrays[array];
+    unsigned Capacity = (unsigned)Target.Layers.size();
+    unsigned Free = 0;
+    for (unsigned Layer = 0; Layer < Capacity; ++Layer) {
+        Free += Target.Layers[Layer].expired();
+    }
+    if (Free >= count) {
+        return;
+    }
+
+    // NOTE(Jovan): Sized exactly for the first layers, later growth leaves some room. Never
+    // past the driver's limit or what the other arrays leave of the budget
+    int MaxLayers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &MaxLayers);
+    size_t LayerBytes = getLayerBytes(array);
+    size_t OtherBytes = getArrayBytes() - Capacity * LayerBytes;
+    size_t Limit = OtherBytes < TEXTURE_ARRAY_BUDGET ? (TEXTURE_ARRAY_BUDGET - OtherBytes) / LayerBytes : 0;
+    Limit = std::min(Limit, (size_t)std::max(MaxLayers, 0));
+    unsigned NewCapacity = (unsigned)std::min((size_t)std::max(Capacity + count - Free, Capacity + Capacity / 2), Limit);
+    if (NewCapacity <= Capacity) {
+        return;
+    }
+
+    bool IsCompressed = array != TEXTURE_ARRAY_RGBA8;
+    GLenum InternalFormat = IsCompressed ? CompressedTexture::GetInternalFormat((ETextureBlockFormat)(array - TEXTURE_ARRAY_BC1)) : GL_RGBA8;
+    unsigned Levels = getLayerLevelCount();
+    unsigned Id;
+    glGenTextures(1, &Id);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, Id);
+    for (unsigned Level = 0; Level < Levels; ++Level) {
+        unsigned Size = std::max(1u, (unsigned)TEXTURE_LAYER_SIZE >> Level);
+        if (IsCompressed) {
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, Level, InternalFormat, Size, Size, NewCapacity, 0, (GLsizei)(getLayerLevelBytes(array, Level) * NewCapacity), 0);
+        } else {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, Level, GL_RGBA8, Size, Size, NewCapacity, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        }
+    }
+    // NOTE(Jovan): Same sampling as Texture::SetDefaultParameters
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, Levels - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    if (array == TEXTURE_ARRAY_BC4) {
+        // NOTE(Jovan): Single channel layers are grey, like the RGBA8 ones
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_G, GL_RED);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_B, GL_RED);
+    }
+
+    if (Capacity) {
+        // NOTE(Jovan): Storage can't grow in place. Layers are copied over through a buffer
+        // that never leaves the GPU, which works for block formats as well
+        unsigned Buffer;
+        glGenBuffers(1, &Buffer);
+        BufferHandle Copy(Buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, Buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, LayerBytes * Capacity, 0, GL_STREAM_COPY);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, Target.Texture.GetId());
+        size_t Offset = 0;
+        for (unsigned Level = 0; Level < Levels; ++Level) {
+            if (IsCompressed) {
+                glGetCompressedTexImage(GL_TEXTURE_2D_ARRAY, Level, (void*)Offset);
+            } else {
+                glGetTexImage(GL_TEXTURE_2D_ARRAY, Level, GL_RGBA, GL_UNSIGNED_BYTE, (void*)Offset);
+            }
+            Offset += getLayerLevelBytes(array, Level) * Capacity;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, Buffer);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, Id);
+        Offset = 0;
+        for (unsigned Level = 0; Level < Levels; ++Level) {
+            unsigned Size = std::max(1u, (unsigned)TEXTURE_LAYER_SIZE >> Level);
+            size_t LevelBytes = getLayerLevelBytes(array, Level) * Capacity;
+            if (IsCompressed) {
+                glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, Level, 0, 0, 0, Size, Size, Capacity, InternalFormat, (GLsizei)LevelBytes, (const void*)Offset);
+            } else {
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, Level, 0, 0, 0, Size, Size, Capacity, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)Offset);
+            }
+            Offset += LevelBytes;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    Target.Texture.Reset(Id);
+    Target.Layers.resize(NewCapacity);
+}
+
+int
+TextureCache::findFreeLayer(ETextureArray array) const {
+    const std::vector<WeakEntry>& Layers = mArrays[array].Layers;
+    for (size_t Layer = 0; Layer < Layers.size(); ++Layer) {
+        if (Layers[Layer].expired()) {
+            return (int)Layer;
+        }
+    }
+    return -1;
+}
+
+size_t
+TextureCache::getArrayBytes() const {
+    size_t Bytes = 0;
+    for (unsigned Array = 0; Array < TEXTURE_ARRAY_COUNT; ++Array) {
+        Bytes += getLayerBytes((ETextureArray)Array) * mArrays[Array].Layers.size();
+    }
+    return Bytes;
+}
+
+ETextureArray
+TextureCache::getArray(const DecodedImage& image) {
+    return image.Compressed.Levels.empty() ? TEXTURE_ARRAY_RGBA8 : (ETextureArray)(TEXTURE_ARRAY_BC1 + image.Compressed.Format);
+}
+
+unsigned
+TextureCache::getLayerLevelCount() {
+    unsigned Levels = 1;
+    while ((TEXTURE_LAYER_SIZE >> Levels) > 0) {
+        ++Levels;
+    }
+    return Levels;
+}
+
+size_t
+TextureCache::getLayerLevelBytes(ETextureArray array, unsigned level) {
+    size_t Size = std::max(1u, (unsigned)TEXTURE_LAYER_SIZE >> level);
+    if (array == TEXTURE_ARRAY_RGBA8) {
+        return Size * Size * 4;
+    }
+    return ((Size + 3) / 4) * ((Size + 3) / 4) * CompressedTexture::GetBlockSize((ETextureBlockFormat)(array - TEXTURE_ARRAY_BC1));
+}
+
+size_t
+TextureCache::getLayerBytes(ETextureArray array) {
+    size_t Bytes = 0;
+    for (unsigned Level = 0; Level < getLayerLevelCount(); ++Level) {
+        Bytes += getLayerLevelBytes(array, Level);
+    }
+    return Bytes;
+}
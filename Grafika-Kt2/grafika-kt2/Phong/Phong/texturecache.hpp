@@ -0,0 +1,305 @@
+/**
+ * @file texturecache.hpp
+ * @author Jovan Ivosevic
+ * @brief Shared, de-duplicated and streamed textures
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "glhandle.hpp"
+#include "compressedtexture.hpp"
+#include "imageops.hpp"
+
+// NOTE(Jovan): Bytes of pixels copied into upload buffers per Update. At least one texture
+// is always started, so images larger than this still get through
+#define TEXTURE_UPLOAD_BUDGET (16 * 1024 * 1024)
+// NOTE(Jovan): Width and height of every texture array layer, images are resampled to it
+#define TEXTURE_LAYER_SIZE 1024
+// NOTE(Jovan): Video memory all texture arrays together may take up
+#define TEXTURE_ARRAY_BUDGET ((size_t)256 * 1024 * 1024)
+
+/**
+ * @brief Texture arrays layers are stored in, one per format. Layers with an up to date
+ * compressed file go to the array of its block format, others are RGBA8
+ *
+ */
+enum ETextureArray {
+    TEXTURE_ARRAY_RGBA8 = 0,
+    // NOTE(Jovan): In ETextureBlockFormat order
+    TEXTURE_ARRAY_BC1,
+    TEXTURE_ARRAY_BC3,
+    TEXTURE_ARRAY_BC4,
+
+    TEXTURE_ARRAY_COUNT
+};
+
+struct TextureCacheStats {
+    // NOTE(Jovan): Loads served by a texture already loaded from the same path
+    unsigned Hits;
+    // NOTE(Jovan): Loads of a new path whose file contents matched a loaded texture
+    unsigned ContentHits;
+    // NOTE(Jovan): Loads that had to decode and upload
+    unsigned Misses;
+    // NOTE(Jovan): Video memory hits didn't have to allocate
+    size_t BytesSaved;
+    // NOTE(Jovan): Video memory of cached textures currently alive
+    size_t BytesResident;
+    // NOTE(Jovan): Streamed textures still decoding or uploading
+    unsigned Pending;
+    // NOTE(Jovan): Texture array layers in use
+    unsigned Layers;
+    // NOTE(Jovan): Video memory of the texture arrays, free layers included
+    size_t ArrayBytes;
+};
+
+class TextureCache;
+
+/**
+ * @brief Reference counted handle to a cached texture. Copies share the texture, which
+ * is deleted together with the last copy. Must be destroyed while the GL context is current
+ *
+ */
+class SharedTexture {
+public:
+    SharedTexture() {}
+
+    /**
+     * @brief Returns texture name, the placeholder's while a streamed texture isn't
+     * resident yet, 0 if empty
+     *
+     */
+    unsigned GetId() const;
+
+    /**
+     * @brief Returns whether the texture itself, not a placeholder, is ready to sample
+     *
+     */
+    bool IsResident() const;
+
+    /**
+     * @brief Returns the array a layer loaded with LoadLayerAsync is in, -1 if empty, not
+     * a layer or not resident yet
+     *
+     */
+    int GetArray() const;
+
+    /**
+     * @brief Returns the layer of a resident layer in its array
+     *
+     */
+    unsigned GetLayer() const;
+
+    /**
+     * @brief Returns number of handles sharing the texture, 0 if empty
+     *
+     */
+    long GetRefCount() const;
+
+private:
+    friend class TextureCache;
+    struct Entry {
+        TextureHandle Texture;
+        size_t Bytes;
+        bool Resident;
+        // NOTE(Jovan): Sampled until the texture is resident
+        unsigned Placeholder;
+        // NOTE(Jovan): ETextureArray and layer holding it instead of Texture, -1 for textures
+        int Array;
+        unsigned Layer;
+        // NOTE(Jovan): Set if the contents turned out to match another texture after decoding
+        std::shared_ptr<Entry> Alias;
+    };
+    std::shared_ptr<Entry> mEntry;
+};
+
+/**
+ * @brief Loads every texture once. Loads are looked up by canonical path first, then
+ * optionally by a hash of the file contents, so copies of one image under different
+ * names share a texture too.
+ *
+ * Images with an up to date compressed file (see CompressedTexture) are loaded from its
+ * blocks and skip decoding. Others come with their mip chain, from the mip cache (see
+ * MipCache) or built on the worker, so uploads never generate mips on the GPU.
+ *
+ * Streamed loads return right away with a placeholder. Files are read and decoded on the
+ * worker pool, and Update copies finished images into pixel unpack buffers on the context
+ * thread. A texture becomes resident once the fence after its upload signals, so no draw
+ * waits on a transfer.
+ *
+ * Layers are loaded the same way, but are resampled to TEXTURE_LAYER_SIZE and uploaded
+ * into a layer of a texture array shared by every layer of the same format. Arrays grow as
+ * layers are added, up to GL_MAX_ARRAY_TEXTURE_LAYERS and TEXTURE_ARRAY_BUDGET.
+ *
+ * The cache only keeps weak references, textures are freed as soon as nothing uses
+ * them and a later load of the same path reloads it. A freed layer is reused by the next one
+ *
+ */
+class TextureCache {
+public:
+    static TextureCache& Get();
+
+    /**
+     * @brief Returns a shared texture for an image file, loading it on a miss. Blocks
+     * until the texture is resident
+     *
+     * @param path - Image file path
+     * @param hashContent - Whether to also match textures by file contents on a path miss
+     *
+     * @returns Shared texture
+     */
+    SharedTexture Load(const std::string& path, bool hashContent = true);
+
+    /**
+     * @brief Returns a shared texture for an image file, queueing it for decoding on a miss.
+     * The placeholder is sampled until Update has made it resident
+     *
+     * @param path - Image file path
+     * @param hashContent - Whether to also match textures by file contents once decoded
+     *
+     * @returns Shared texture
+     */
+    SharedTexture LoadAsync(const std::string& path, bool hashContent = true);
+
+    /**
+     * @brief Same as LoadAsync, but the image becomes a layer of a texture array instead
+     * of a texture of its own. Prefers the image's compressed file of TEXTURE_LAYER_SIZE
+     * (see CompressedTexture). Not resident until uploaded, there is no placeholder
+     *
+     * @param path - Image file path
+     * @param hashContent - Whether to also match layers by contents once decoded
+     *
+     * @returns Shared layer
+     */
+    SharedTexture LoadLayerAsync(const std::string& path, bool hashContent = true);
+
+    /**
+     * @brief Returns texture name of an array, 0 before its first layer. Changes when
+     * the array grows
+     *
+     * @param array - Texture array
+     */
+    unsigned GetArrayId(ETextureArray array) const;
+
+    /**
+     * @brief Starts uploads of decoded images and makes finished ones resident. Call once
+     * per frame on the context thread
+     *
+     * @param budget - Bytes of pixels that may be copied for upload
+     */
+    void Update(size_t budget = TEXTURE_UPLOAD_BUDGET);
+
+    /**
+     * @brief Runs Update until every streamed texture is resident
+     *
+     */
+    void Finish();
+
+    /**
+     * @brief Returns load statistics. Forgets textures that were freed since the last call
+     *
+     */
+    TextureCacheStats GetStats();
+
+    /**
+     * @brief Frees the placeholder, texture arrays and upload buffers. Called before the context goes away,
+     * with every other texture already released
+     *
+     */
+    void Release();
+
+    /**
+     * @brief Returns path with separators unified and "." and ".." segments resolved,
+     * case folded on Windows
+     *
+     * @param path - File path
+     *
+     * @returns Canonical path
+     */
+    static std::string GetCanonicalPath(const std::string& path);
+
+private:
+    typedef std::shared_ptr<SharedTexture::Entry> EntryPtr;
+    typedef std::weak_ptr<SharedTexture::Entry> WeakEntry;
+
+    // NOTE(Jovan): Written by workers. Workers only hold weak references, so the last
+    // reference to a texture can't be dropped off the context thread
+    struct DecodedImage {
+        WeakEntry Entry;
+        std::string Path;
+        // NOTE(Jovan): Only one of the two has levels, none if loading failed
+        CompressedImage Compressed;
+        MipChain Mips;
+        bool IsLayer;
+        bool Hashed;
+        uint64_t Hash;
+    };
+
+    // NOTE(Jovan): Shared with queued jobs, so it outlives the cache if they finish after it
+    struct DecodeQueue {
+        std::mutex Mutex;
+        std::deque<DecodedImage> Images;
+    };
+
+    struct PixelBuffer {
+        BufferHandle Buffer;
+        size_t Capacity;
+    };
+
+    struct TextureArray {
+        TextureHandle Texture;
+        // NOTE(Jovan): Entry in each layer, expired for free ones. As many as the array has room for
+        std::vector<WeakEntry> Layers;
+    };
+
+    struct PendingUpload {
+        WeakEntry Entry;
+        PixelBuffer Buffer;
+        GLsync Fence;
+    };
+
+    std::unordered_map<std::string, WeakEntry> mByPath;
+    std::unordered_map<uint64_t, WeakEntry> mByContent;
+    // NOTE(Jovan): Layers are looked up separately, a texture can't stand in for a layer
+    std::unordered_map<std::string, WeakEntry> mLayersByPath;
+    std::unordered_map<uint64_t, WeakEntry> mLayersByContent;
+    TextureArray mArrays[TEXTURE_ARRAY_COUNT];
+    std::shared_ptr<DecodeQueue> mDecoded;
+    std::deque<DecodedImage> mReady;
+    std::vector<PendingUpload> mUploads;
+    std::vector<PixelBuffer> mFreeBuffers;
+    TextureHandle mPlaceholder;
+    bool mPlaceholderLoaded;
+    // NOTE(Jovan): Jobs submitted whose images haven't been taken off the decode queue yet
+    unsigned mDecoding;
+    TextureCacheStats mStats;
+
+    TextureCache();
+    unsigned getPlaceholder();
+    unsigned getPending() const;
+    SharedTexture loadAsync(const std::string& path, bool hashContent, bool isLayer);
+    size_t upload(DecodedImage& image);
+    void uploadLayer(const DecodedImage& image, const SharedTexture::Entry& entry, const unsigned char* data);
+    void reserveLayers(ETextureArray array, unsigned count);
+    int findFreeLayer(ETextureArray array) const;
+    size_t getArrayBytes() const;
+    static ETextureArray getArray(const DecodedImage& image);
+    static unsigned getLayerLevelCount();
+    static size_t getLayerLevelBytes(ETextureArray array, unsigned level);
+    static size_t getLayerBytes(ETextureArray array);
+    void completeUploads();
+    void prune();
+};
@@ -0,0 +1,184 @@
+#include "tilepyramid.hpp"
+#include "imageops.hpp"
+#include "stb_image.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+static const char TILE_PYRAMID_MAGIC[4] = { 'P', 'V', 'T', 'X' };
+
+struct TilePyramidHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint32_t TilesLog2;
+    uint32_t Padding;
+    uint64_t SourceSize;
+    int64_t SourceModifiedTime;
+};
+
+TilePyramid::TilePyramid() {
+    mTilesLog2 = 0;
+}
+
+size_t
+TilePyramid::GetLevelTileOffset(unsigned tilesLog2, unsigned level) {
+    size_t Offset = 0;
+    for (unsigned LevelIdx = 0; LevelIdx < level; ++LevelIdx) {
+        size_t Side = (size_t)1 << (tilesLog2 - LevelIdx);
+        Offset += Side * Side;
+    }
+    return Offset;
+}
+
+std::string
+TilePyramid::GetPyramidPath(const std::string& sourcePath) {
+    return sourcePath + TILE_PYRAMID_EXTENSION;
+}
+
+bool
+TilePyramid::Build(const std::string& sourcePath) {
+    TilePyramidHeader Header;
+    memcpy(Header.Magic, TILE_PYRAMID_MAGIC, sizeof(TILE_PYRAMID_MAGIC));
+    Header.Version = TILE_PYRAMID_VERSION;
+    Header.Padding = 0;
+    if (!MappedFile::GetStamp(sourcePath, Header.SourceSize, Header.SourceModifiedTime)) {
+        return false;
+    }
+
+    // NOTE(Jovan): Decoded straight to RGBA, without going through Texture::LoadMipChain,
+    // which would build and cache the full resolution chain only for it to be resampled
+    int Width;
+    int Height;
+    int Channels;
+    unsigned char* ImageData = stbi_load(sourcePath.c_str(), &Width, &Height, &Channels, 4);
+    if (!ImageData) {
+        std::cerr << "[Err] Failed to load " << sourcePath << " for its tile pyramid" << std::endl;
+        return false;
+    }
+    ImageOps::FlipVertical(ImageData, (size_t)Width * 4, Height);
+    // NOTE(Jovan): Single channel images are data rather than color, same as Texture::LoadMipChain
+    bool IsColor = Channels != 1;
+
+    // NOTE(Jovan): Smallest power of two tile count covering the image, larger images are shrunk
+    unsigned Largest = std::max((unsigned)Width, (unsigned)Height);
+    unsigned TilesLog2 = 0;
+    while (((unsigned)VIRTUAL_TILE_SIZE << TilesLog2) < Largest && TilesLog2 + 1 < VIRTUAL_PAGE_TABLE_LEVELS) {
+        ++TilesLog2;
+    }
+    Header.TilesLog2 = TilesLog2;
+    unsigned Size = VIRTUAL_TILE_SIZE << TilesLog2;
+
+    // NOTE(Jovan): Only images larger than the largest pyramid shrink, halved until
+    // Resize is within 2x of the square
+    std::vector<unsigned char> Halved;
+    const unsigned char* Pixels = ImageData;
+    unsigned PixelsWidth = Width;
+    unsigned PixelsHeight = Height;
+    while (PixelsWidth > 2 * Size || PixelsHeight > 2 * Size) {
+        unsigned HalfWidth = std::max(PixelsWidth / 2, 1u);
+        unsigned HalfHeight = std::max(PixelsHeight / 2, 1u);
+        std::vector<unsigned char> Half((size_t)HalfWidth * HalfHeight * 4);
+        ImageOps::Resize(Pixels, PixelsWidth, PixelsHeight, 4, HalfWidth, HalfHeight, MIP_FILTER_BOX, IsColor, Half.data());
+        Halved.swap(Half);
+        Pixels = Halved.data();
+        PixelsWidth = HalfWidth;
+        PixelsHeight = HalfHeight;
+    }
+    std::vector<unsigned char> Square((size_t)Size * Size * 4);
+    ImageOps::Resize(Pixels, PixelsWidth, PixelsHeight, 4, Size, Size, MIP_FILTER_KAISER, IsColor, Square.data());
+    stbi_image_free(ImageData);
+    std::vector<unsigned char>().swap(Halved);
+    MipChain Mips;
+    ImageOps::BuildMipChain(Square.data(), Size, Size, 4, MIP_FILTER_BOX, IsColor, Mips);
+    std::vector<unsigned char>().swap(Square);
+
+    // NOTE(Jovan): Written to a temporary file first, same as MipCache::Write
+    std::string PyramidPath = GetPyramidPath(sourcePath);
+    std::string TempPath = PyramidPath + ".tmp";
+    std::ofstream Out(TempPath, std::ios::binary | std::ios::trunc);
+    if (!Out) {
+        return false;
+    }
+    Out.write((const char*)&Header, sizeof(Header));
+    std::vector<unsigned char> Tile(VIRTUAL_TILE_BYTES);
+    for (unsigned TileLevel = 0; TileLevel <= TilesLog2; ++TileLevel) {
+        const ImageLevel& MipLevel = Mips.Levels[TileLevel];
+        const unsigned char* LevelPixels = Mips.Data.data() + MipLevel.Offset;
+        int LevelSize = (int)MipLevel.Width;
+        unsigned Side = 1u << (TilesLog2 - TileLevel);
+        for (unsigned TileY = 0; TileY < Side; ++TileY) {
+            for (unsigned TileX = 0; TileX < Side; ++TileX) {
+                // NOTE(Jovan): Borders wrap around like GL_REPEAT, the sampling mode of other textures
+                for (int Row = 0; Row < VIRTUAL_TILE_STRIDE; ++Row) {
+                    int SourceY = ((int)(TileY * VIRTUAL_TILE_SIZE) + Row - VIRTUAL_TILE_BORDER + LevelSize) % LevelSize;
+                    unsigned char* Dst = Tile.data() + (size_t)Row * VIRTUAL_TILE_STRIDE * 4;
+                    for (int Column = 0; Column < VIRTUAL_TILE_STRIDE; ++Column) {
+                        int SourceX = ((int)(TileX * VIRTUAL_TILE_SIZE) + Column - VIRTUAL_TILE_BORDER + LevelSize) % LevelSize;
+                        memcpy(Dst + Column * 4, LevelPixels + ((size_t)SourceY * LevelSize + SourceX) * 4, 4);
+                    }
+                }
+                Out.write((const char*)Tile.data(), Tile.size());
+            }
+        }
+    }
+    Out.close();
+    if (!Out) {
+        std::remove(TempPath.c_str());
+        return false;
+    }
+    std::remove(PyramidPath.c_str());
+    if (std::rename(TempPath.c_str(), PyramidPath.c_str()) != 0) {
+        std::remove(TempPath.c_str());
+        return false;
+    }
+    std::cout << "Built tile pyramid of " << sourcePath << ": " << Size << "x" << Size << ", "
+        << GetLevelTileOffset(TilesLog2, TilesLog2 + 1) << " tiles" << std::endl;
+    return true;
+}
+
+bool
+TilePyramid::Open(const std::string& sourcePath) {
+    if (!mFile.Open(GetPyramidPath(sourcePath)) || mFile.GetSize() < sizeof(TilePyramidHeader)) {
+        mFile.Close();
+        return false;
+    }
+
+    TilePyramidHeader Header;
+    memcpy(&Header, mFile.GetData(), sizeof(Header));
+    uint64_t SourceSize;
+    int64_t SourceModifiedTime;
+    if (memcmp(Header.Magic, TILE_PYRAMID_MAGIC, sizeof(TILE_PYRAMID_MAGIC))
+        || Header.Version != TILE_PYRAMID_VERSION
+        || Header.TilesLog2 >= VIRTUAL_PAGE_TABLE_LEVELS
+        || mFile.GetSize() != sizeof(Header) + GetLevelTileOffset(Header.TilesLog2, Header.TilesLog2 + 1) * VIRTUAL_TILE_BYTES
+        || !MappedFile::GetStamp(sourcePath, SourceSize, SourceModifiedTime)
+        || Header.SourceSize != SourceSize
+        || Header.SourceModifiedTime != SourceModifiedTime) {
+        mFile.Close();
+        return false;
+    }
+    mTilesLog2 = Header.TilesLog2;
+    return true;
+}
+
+unsigned
+TilePyramid::GetTilesLog2() const {
+    return mTilesLog2;
+}
+
+const unsigned char*
+TilePyramid::GetTile(unsigned level, unsigned x, unsigned y) const {
+    if (!mFile.GetData() || level > mTilesLog2) {
+        return 0;
+    }
+    unsigned Side = 1u << (mTilesLog2 - level);
+    if (x >= Side || y >= Side) {
+        return 0;
+    }
+    size_t Index = GetLevelTileOffset(mTilesLog2, level) + (size_t)y * Side + x;
+    return mFile.GetData() + sizeof(TilePyramidHeader) + Index * VIRTUAL_TILE_BYTES;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file tilepyramid.hpp
+ * @author Jovan Ivosevic
+ * @brief Images cut into tiles of every mip level, stored on disk for virtual texturing
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include "mappedfile.hpp"
+
+// NOTE(Jovan): Bump whenever the layout of the pyramid file or the tile filtering changes
+#define TILE_PYRAMID_VERSION 2
+#define TILE_PYRAMID_EXTENSION ".vtiles"
+// NOTE(Jovan): Texels per side of a tile, without the border
+#define VIRTUAL_TILE_SIZE 128
+// NOTE(Jovan): Texels copied from neighbouring tiles around each tile, so bilinear
+// filtering near a tile's edge never reads the atlas slot next to it
+#define VIRTUAL_TILE_BORDER 4
+#define VIRTUAL_TILE_STRIDE (VIRTUAL_TILE_SIZE + 2 * VIRTUAL_TILE_BORDER)
+// NOTE(Jovan): Tiles are always RGBA
+#define VIRTUAL_TILE_BYTES (VIRTUAL_TILE_STRIDE * VIRTUAL_TILE_STRIDE * 4)
+// NOTE(Jovan): Mips of the page table, the largest virtual texture has
+// 1 << (VIRTUAL_PAGE_TABLE_LEVELS - 1) tiles per side, 16384 texels
+#define VIRTUAL_PAGE_TABLE_LEVELS 8
+
+/**
+ * @brief Tile pyramid of a source image, stored next to it as <image><TILE_PYRAMID_EXTENSION>:
+ *
+ *  TilePyramidHeader, level 0 tiles, level 1 tiles, ..., the single tile of the last level
+ *
+ * The image is resampled to a square of VIRTUAL_TILE_SIZE << TilesLog2 texels, the
+ * smallest one covering it, and its mip chain is cut down to the level that fits a
+ * single tile. Tiles of a level are stored row by row, bottom row first like GL
+ * textures, each VIRTUAL_TILE_STRIDE texels per side with its border wrapped around
+ * the image.
+ *
+ * Open maps the file, so tiles are read from disk as they're asked for and never the
+ * whole image at once. A pyramid is only used if its version and the source's size
+ * and modification time match
+ *
+ */
+class TilePyramid {
+public:
+    TilePyramid();
+
+    /**
+     * @brief Builds the pyramid file of a source image. Decodes the whole image, so
+     * it's meant for worker threads or offline conversion
+     *
+     * @param sourcePath - Source image path
+     *
+     * @returns true - Success, false - Failure
+     */
+    static bool Build(const std::string& sourcePath);
+
+    /**
+     * @brief Maps the pyramid file of a source image
+     *
+     * @param sourcePath - Source image path
+     *
+     * @returns true - Success, false - File is missing or stale
+     */
+    bool Open(const std::string& sourcePath);
+
+    /**
+     * @brief Returns log2 of the number of tiles per side of level 0. Level TilesLog2 is
+     * a single tile
+     *
+     */
+    unsigned GetTilesLog2() const;
+
+    /**
+     * @brief Returns a tile's pixels, VIRTUAL_TILE_BYTES of them inside the mapping
+     *
+     * @param level - Mip level, at most GetTilesLog2
+     * @param x - Tile column
+     * @param y - Tile row, from the bottom
+     *
+     * @returns Tile pixels, NULL if out of range
+     */
+    const unsigned char* GetTile(unsigned level, unsigned x, unsigned y) const;
+
+    /**
+     * @brief Returns pyramid file path for the given source image
+     *
+     * @param sourcePath - Source image path
+     *
+     * @returns Pyramid file path
+     */
+    static std::string GetPyramidPath(const std::string& sourcePath);
+
+    /**
+     * @brief Returns number of tiles in the levels before the given one, levels being
+     * stored finest first
+     *
+     * @param tilesLog2 - Log2 of the number of tiles per side of level 0
+     * @param level - Mip level, tilesLog2 + 1 for the total
+     *
+     * @returns Tile count
+     */
+    static size_t GetLevelTileOffset(unsigned tilesLog2, unsigned level);
+
+private:
+    MappedFile mFile;
+    unsigned mTilesLog2;
+};
@@ -0,0 +1,42 @@
+#include "uniformbuffer.hpp"
+
+struct UniformBlockBinding {
+    const char* Name;
+    int Binding;
+};
+
+static const UniformBlockBinding BlockBindings[] = {
+    { "Frame", UNIFORM_BINDING_FRAME },
+    { "Lights", UNIFORM_BINDING_LIGHTS },
+    { "Materials", UNIFORM_BINDING_MATERIALS },
+    { "VirtualTextures", UNIFORM_BINDING_VIRTUAL_TEXTURES },
+};
+
+int
+UniformBuffer::GetBinding(const std::string& blockName) {
+    for (unsigned BlockIdx = 0; BlockIdx < sizeof(BlockBindings) / sizeof(BlockBindings[0]); ++BlockIdx) {
+        if (blockName == BlockBindings[BlockIdx].Name) {
+            return BlockBindings[BlockIdx].Binding;
+        }
+    }
+    return -1;
+}
+
+UniformBuffer::UniformBuffer(unsigned binding, unsigned size) {
+    mBinding = binding;
+    mSize = size;
+    unsigned Buffer;
+    glGenBuffers(1, &Buffer);
+    mBuffer.Reset(Buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, Buffer);
+    glBufferData(GL_UNIFORM_BUFFER, mSize, 0, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, mBinding, Buffer);
+}
+
+void
+UniformBuffer::Update(const void* data) {
+    glBindBuffer(GL_UNIFORM_BUFFER, mBuffer.GetId());
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, mSize, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
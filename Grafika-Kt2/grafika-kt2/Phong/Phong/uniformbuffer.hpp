@@ -0,0 +1,152 @@
+/**
+ * @file uniformbuffer.hpp
+ * @author Jovan Ivosevic
+ * @brief std140 uniform blocks shared by all shader programs
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <string>
+#include "glhandle.hpp"
+
+// NOTE(Jovan): Binding points of the blocks, programs are pointed at them by block name after link
+#define UNIFORM_BINDING_FRAME 0
+#define UNIFORM_BINDING_LIGHTS 1
+#define UNIFORM_BINDING_MATERIALS 2
+#define UNIFORM_BINDING_VIRTUAL_TEXTURES 3
+// NOTE(Jovan): Entries of the Materials block. Must match MATERIAL_MAX_COUNT in phong_material_texture.frag
+#define MATERIAL_MAX_COUNT 256
+// NOTE(Jovan): Entries of the VirtualTextures block, layers of the page table array.
+// Must match VIRTUAL_TEXTURE_MAX_COUNT in the shaders sampling virtual textures
+#define VIRTUAL_TEXTURE_MAX_COUNT 16
+
+// NOTE(Jovan): The structs below mirror std140 blocks in the shaders and must be kept in sync
+// with them. A vec3 takes a 16 byte slot, so each one is followed by a float filling it
+
+/**
+ * @brief Frame block, per frame camera data
+ *
+ */
+struct FrameUniforms {
+    glm::mat4 Projection;
+    glm::mat4 View;
+    // NOTE(Jovan): Projection * View, so vertex shaders don't multiply matrices per vertex
+    glm::mat4 ViewProjection;
+    glm::vec3 ViewPosition;
+    // NOTE(Jovan): Seconds since start
+    float Time;
+};
+
+/**
+ * @brief Lights block of phong_material_texture.frag. The lights themselves are in a
+ * buffer texture, see lightsystem.hpp
+ *
+ */
+struct LightUniforms {
+    int LightCount;
+    // NOTE(Jovan): Lights [0, GlobalLightCount) reach every fragment and are not clustered
+    int GlobalLightCount;
+    int Padding[2];
+    // NOTE(Jovan): xyz used, ivec4 so the C++ layout needs no guesswork
+    int ClusterCount[4];
+    float ClusterDepthNear;
+    float ClusterDepthScale;
+    // NOTE(Jovan): Cluster tile size in pixels
+    glm::vec2 ClusterTileSize;
+};
+
+/**
+ * @brief One material of the Materials block, see materialsystem.hpp
+ *
+ */
+struct MaterialData {
+    // NOTE(Jovan): Texture array (ETextureArray) and layer of each texture
+    int DiffuseArray;
+    int DiffuseLayer;
+    int SpecularArray;
+    int SpecularLayer;
+    float Shininess;
+    // NOTE(Jovan): Virtual texture replacing the diffuse layer, -1 for none
+    int VirtualTexture;
+    int Padding[2];
+};
+
+/**
+ * @brief Materials block of phong_material_texture.frag, indexed by the per draw material index
+ *
+ */
+struct MaterialUniforms {
+    MaterialData Materials[MATERIAL_MAX_COUNT];
+};
+
+/**
+ * @brief One virtual texture of the VirtualTextures block, see virtualtexturesystem.hpp
+ *
+ */
+struct VirtualTextureData {
+    // NOTE(Jovan): Tiles per side of the finest level are 1 << TilesLog2, -1 until the
+    // tile pyramid is open
+    int TilesLog2;
+    // NOTE(Jovan): Page table mip holding the finest level's pages
+    int PageTableLevel;
+    // NOTE(Jovan): Texels per side of the finest level
+    float Size;
+    float Padding;
+};
+
+/**
+ * @brief VirtualTextures block, indexed by MaterialData::VirtualTexture
+ *
+ */
+struct VirtualTextureUniforms {
+    VirtualTextureData VirtualTextures[VIRTUAL_TEXTURE_MAX_COUNT];
+};
+
+static_assert(sizeof(FrameUniforms) == 208, "FrameUniforms does not match std140 layout");
+static_assert(sizeof(LightUniforms) == 48, "LightUniforms does not match std140 layout");
+static_assert(sizeof(MaterialData) == 32, "MaterialData does not match std140 layout");
+static_assert(sizeof(VirtualTextureData) == 16, "VirtualTextureData does not match std140 layout");
+
+/**
+ * @brief Uniform buffer bound to a fixed binding point. Written whole, once per update,
+ * and read by every program that declares the matching block. Move-only
+ *
+ */
+class UniformBuffer {
+public:
+    /**
+     * @brief Returns the binding point of a uniform block
+     *
+     * @param blockName - Block name as declared in the shader
+     *
+     * @returns Binding point, -1 if the block is not a known shared block
+     */
+    static int GetBinding(const std::string& blockName);
+
+    /**
+     * @brief Ctor - creates the buffer and binds it to its binding point
+     *
+     * @param binding - Binding point
+     * @param size - Size in bytes
+     */
+    UniformBuffer(unsigned binding, unsigned size);
+
+    /**
+     * @brief Replaces buffer contents
+     *
+     * @param data - Block data, size given in ctor
+     */
+    void Update(const void* data);
+
+private:
+    BufferHandle mBuffer;
+    unsigned mBinding;
+    unsigned mSize;
+};
@@ -0,0 +1,320 @@
+#include "vertexformat.hpp"
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Converts float to IEEE 754 half precision, rounding to nearest even.
+ * Values out of half range are clamped to infinity
+ */
+static uint16_t
+floatToHalf(float value) {
+    uint32_t Bits;
+    memcpy(&Bits, &value, sizeof(Bits));
+    uint32_t Sign = (Bits >> 16) & 0x8000;
+    int32_t Exponent = (int32_t)((Bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t Mantissa = Bits & 0x7FFFFF;
+
+    if (((Bits >> 23) & 0xFF) == 0xFF) {
+        return (uint16_t)(Sign | 0x7C00 | (Mantissa ? 0x200 : 0));
+    }
+    if (Exponent >= 31) {
+        return (uint16_t)(Sign | 0x7C00);
+    }
+    if (Exponent <= 0) {
+        if (Exponent < -10) {
+            return (uint16_t)Sign;
+        }
+        Mantissa |= 0x800000;
+        uint32_t Shift = (uint32_t)(14 - Exponent);
+        uint32_t Half = Mantissa >> Shift;
+        uint32_t Remainder = Mantissa & ((1u << Shift) - 1);
+        uint32_t Midpoint = 1u << (Shift - 1);
+        if (Remainder > Midpoint || (Remainder == Midpoint && (Half & 1))) {
+            ++Half;
+        }
+        return (uint16_t)(Sign | Half);
+    }
+
+    uint32_t Half = Sign | ((uint32_t)Exponent << 10) | (Mantissa >> 13);
+    uint32_t Remainder = Mantissa & 0x1FFF;
+    if (Remainder > 0x1000 || (Remainder == 0x1000 && (Half & 1))) {
+        // NOTE(Jovan): Carry into the exponent is intended, it rounds up to the next power of two
+        ++Half;
+    }
+    return (uint16_t)Half;
+}
+
+static float
+halfToFloat(uint16_t value) {
+    uint32_t Sign = (uint32_t)(value & 0x8000) << 16;
+    uint32_t Exponent = (value >> 10) & 0x1F;
+    uint32_t Mantissa = value & 0x3FF;
+    uint32_t Bits;
+    if (Exponent == 0) {
+        if (Mantissa == 0) {
+            Bits = Sign;
+        } else {
+            // NOTE(Jovan): Denormal, normalize it
+            Exponent = 127 - 15 + 1;
+            while (!(Mantissa & 0x400)) {
+                Mantissa <<= 1;
+                --Exponent;
+            }
+            Bits = Sign | (Exponent << 23) | ((Mantissa & 0x3FF) << 13);
+        }
+    } else if (Exponent == 31) {
+        Bits = Sign | 0x7F800000 | (Mantissa << 13);
+    } else {
+        Bits = Sign | ((Exponent - 15 + 127) << 23) | (Mantissa << 13);
+    }
+
+    float Result;
+    memcpy(&Result, &Bits, sizeof(Result));
+    return Result;
+}
+
+static float
+signNotZero(float v) {
+    return v >= 0.0f ? 1.0f : -1.0f;
+}
+
+static float
+clampf(float v, float min, float max) {
+    return v < min ? min : v > max ? max : v;
+}
+
+static glm::vec2
+octEncode(glm::vec3 n) {
+    float L1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    if (L1 == 0.0f) {
+        return glm::vec2(0.0f, 0.0f);
+    }
+    glm::vec2 P(n.x / L1, n.y / L1);
+    if (n.z < 0.0f) {
+        P = glm::vec2((1.0f - std::fabs(P.y)) * signNotZero(P.x), (1.0f - std::fabs(P.x)) * signNotZero(P.y));
+    }
+    return P;
+}
+
+static glm::vec3
+octDecode(glm::vec2 e) {
+    glm::vec3 N(e.x, e.y, 1.0f - std::fabs(e.x) - std::fabs(e.y));
+    float T = N.z < 0.0f ? -N.z : 0.0f;
+    N.x += N.x >= 0.0f ? -T : T;
+    N.y += N.y >= 0.0f ? -T : T;
+    return glm::normalize(N);
+}
+
+static int16_t
+toSnorm16(float v) {
+    return (int16_t)std::lround(clampf(v, -1.0f, 1.0f) * 32767.0f);
+}
+
+static float
+fromSnorm16(int16_t v) {
+    return clampf(v / 32767.0f, -1.0f, 1.0f);
+}
+
+static uint32_t
+toSnorm10(float v) {
+    return (uint32_t)((int32_t)std::lround(clampf(v, -1.0f, 1.0f) * 511.0f)) & 0x3FF;
+}
+
+static float
+fromSnorm10(uint32_t v) {
+    // NOTE(Jovan): Sign extend 10 bits
+    int32_t Signed = (int32_t)(v << 22) >> 22;
+    return clampf(Signed / 511.0f, -1.0f, 1.0f);
+}
+
+/**
+ * @brief Returns per axis AABB extent used as the position dequantization scale.
+ * Flat axes get 1 so they don't divide by zero
+ */
+static glm::vec3
+getPositionScale(const glm::vec3& min, const glm::vec3& max) {
+    glm::vec3 Scale = max - min;
+    for (int Axis = 0; Axis < 3; ++Axis) {
+        if (Scale[Axis] <= 0.0f) {
+            Scale[Axis] = 1.0f;
+        }
+    }
+    return Scale;
+}
+
+unsigned
+VertexFormat::GetStride(EVertexFormat format) {
+    switch (format) {
+    case VERTEX_FORMAT_QUANTIZED_OCT: return 16;
+    case VERTEX_FORMAT_QUANTIZED_1010102: return 16;
+    default: return FLOAT_COMPONENTS * sizeof(float);
+    }
+}
+
+const char*
+VertexFormat::GetName(EVertexFormat format) {
+    switch (format) {
+    case VERTEX_FORMAT_QUANTIZED_OCT: return "quantized (oct normals)";
+    case VERTEX_FORMAT_QUANTIZED_1010102: return "quantized (10_10_10_2 normals)";
+    default: return "float";
+    }
+}
+
+void
+VertexFormat::SetupAttributes(EVertexFormat format) {
+    unsigned Stride = GetStride(format);
+    switch (format) {
+    case VERTEX_FORMAT_QUANTIZED_OCT: {
+        glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, Stride, (void*)0);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, Stride, (void*)8);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, Stride, (void*)12);
+    } break;
+    case VERTEX_FORMAT_QUANTIZED_1010102: {
+        glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, Stride, (void*)0);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, Stride, (void*)8);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, Stride, (void*)12);
+    } break;
+    default: {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, Stride, (void*)0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, Stride, (void*)(3 * sizeof(float)));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, Stride, (void*)(6 * sizeof(float)));
+    } break;
+    }
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+}
+
+void
+VertexFormat::SetupInstanceAttributes() {
+    // NOTE(Jovan): Matrix attributes take one location per column
+    for (unsigned Column = 0; Column < 4; ++Column) {
+        unsigned Location = INSTANCE_ATTRIBUTE_LOCATION + Column;
+        glVertexAttribPointer(Location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceTransform), (void*)(offsetof(InstanceTransform, Model) + Column * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(Location);
+        glVertexAttribDivisor(Location, 1);
+    }
+    for (unsigned Column = 0; Column < 3; ++Column) {
+        unsigned Location = INSTANCE_NORMAL_ATTRIBUTE_LOCATION + Column;
+        glVertexAttribPointer(Location, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceTransform), (void*)(offsetof(InstanceTransform, Normal) + Column * sizeof(glm::vec3)));
+        glEnableVertexAttribArray(Location);
+        glVertexAttribDivisor(Location, 1);
+    }
+    // NOTE(Jovan): Integer attribute, read as is instead of converted to float
+    glVertexAttribIPointer(INSTANCE_MATERIAL_ATTRIBUTE_LOCATION, 1, GL_UNSIGNED_INT, sizeof(InstanceTransform), (void*)offsetof(InstanceTransform, Material));
+    glEnableVertexAttribArray(INSTANCE_MATERIAL_ATTRIBUTE_LOCATION);
+    glVertexAttribDivisor(INSTANCE_MATERIAL_ATTRIBUTE_LOCATION, 1);
+}
+
+void
+VertexFormat::Encode(EVertexFormat format, const float* src, unsigned vertexCount, const glm::vec3& min, const glm::vec3& max, unsigned char* dst) {
+    if (format == VERTEX_FORMAT_FLOAT) {
+        memcpy(dst, src, (size_t)vertexCount * GetStride(format));
+        return;
+    }
+
+    glm::vec3 Scale = getPositionScale(min, max);
+    unsigned Stride = GetStride(format);
+    for (unsigned VertexIdx = 0; VertexIdx < vertexCount; ++VertexIdx, src += FLOAT_COMPONENTS, dst += Stride) {
+        uint16_t Position[4];
+        for (int Axis = 0; Axis < 3; ++Axis) {
+            float Normalized = clampf((src[Axis] - min[Axis]) / Scale[Axis], 0.0f, 1.0f);
+            Position[Axis] = (uint16_t)std::lround(Normalized * 65535.0f);
+        }
+        Position[3] = 0;
+        memcpy(dst, Position, sizeof(Position));
+
+        glm::vec3 Normal(src[3], src[4], src[5]);
+        if (format == VERTEX_FORMAT_QUANTIZED_OCT) {
+            glm::vec2 Oct = octEncode(Normal);
+            int16_t Encoded[2] = { toSnorm16(Oct.x), toSnorm16(Oct.y) };
+            memcpy(dst + 8, Encoded, sizeof(Encoded));
+        } else {
+            uint32_t Packed = toSnorm10(Normal.x) | (toSnorm10(Normal.y) << 10) | (toSnorm10(Normal.z) << 20);
+            memcpy(dst + 8, &Packed, sizeof(Packed));
+        }
+
+        uint16_t UV[2] = { floatToHalf(src[6]), floatToHalf(src[7]) };
+        memcpy(dst + 12, UV, sizeof(UV));
+    }
+}
+
+void
+VertexFormat::Decode(EVertexFormat format, const unsigned char* src, const glm::vec3& min, const glm::vec3& max, float* dst) {
+    if (format == VERTEX_FORMAT_FLOAT) {
+        memcpy(dst, src, GetStride(format));
+        return;
+    }
+
+    glm::vec3 Scale = getPositionScale(min, max);
+    uint16_t Position[4];
+    memcpy(Position, src, sizeof(Position));
+    for (int Axis = 0; Axis < 3; ++Axis) {
+        dst[Axis] = min[Axis] + (Position[Axis] / 65535.0f) * Scale[Axis];
+    }
+
+    glm::vec3 Normal;
+    if (format == VERTEX_FORMAT_QUANTIZED_OCT) {
+        int16_t Encoded[2];
+        memcpy(Encoded, src + 8, sizeof(Encoded));
+        Normal = octDecode(glm::vec2(fromSnorm16(Encoded[0]), fromSnorm16(Encoded[1])));
+    } else {
+        uint32_t Packed;
+        memcpy(&Packed, src + 8, sizeof(Packed));
+        Normal = glm::vec3(fromSnorm10(Packed & 0x3FF), fromSnorm10((Packed >> 10) & 0x3FF), fromSnorm10((Packed >> 20) & 0x3FF));
+    }
+    dst[3] = Normal.x;
+    dst[4] = Normal.y;
+    dst[5] = Normal.z;
+
+    uint16_t UV[2];
+    memcpy(UV, src + 12, sizeof(UV));
+    dst[6] = halfToFloat(UV[0]);
+    dst[7] = halfToFloat(UV[1]);
+}
+
+QuantizationError
+VertexFormat::MeasureError(EVertexFormat format, const float* src, const unsigned char* encoded, unsigned vertexCount, const glm::vec3& min, const glm::vec3& max) {
+    QuantizationError Error = { 0.0f, 0.0f, 0.0f };
+    unsigned Stride = GetStride(format);
+    float Decoded[FLOAT_COMPONENTS];
+    for (unsigned VertexIdx = 0; VertexIdx < vertexCount; ++VertexIdx, src += FLOAT_COMPONENTS, encoded += Stride) {
+        Decode(format, encoded, min, max, Decoded);
+        float PositionError = glm::length(glm::vec3(Decoded[0] - src[0], Decoded[1] - src[1], Decoded[2] - src[2]));
+        Error.MaxPosition = PositionError > Error.MaxPosition ? PositionError : Error.MaxPosition;
+
+        glm::vec3 Original(src[3], src[4], src[5]);
+        float OriginalLength = glm::length(Original);
+        glm::vec3 Normal(Decoded[3], Decoded[4], Decoded[5]);
+        float NormalLength = glm::length(Normal);
+        if (OriginalLength > 0.0f && NormalLength > 0.0f) {
+            float Cos = clampf(glm::dot(Original / OriginalLength, Normal / NormalLength), -1.0f, 1.0f);
+            float Degrees = std::acos(Cos) * 57.2957795f;
+            Error.MaxNormalDegrees = Degrees > Error.MaxNormalDegrees ? Degrees : Error.MaxNormalDegrees;
+        }
+
+        for (int Component = 6; Component < 8; ++Component) {
+            float UVError = std::fabs(Decoded[Component] - src[Component]);
+            Error.MaxUV = UVError > Error.MaxUV ? UVError : Error.MaxUV;
+        }
+    }
+
+    return Error;
+}
+
+void
+VertexFormat::SetDequantization(const Shader& shader, EVertexFormat format, const glm::vec3& min, const glm::vec3& max) {
+    if (format == VERTEX_FORMAT_FLOAT) {
+        ResetDequantization(shader);
+        return;
+    }
+
+    shader.SetDequantization(getPositionScale(min, max), min, format == VERTEX_FORMAT_QUANTIZED_OCT ? NORMAL_ENCODING_OCTAHEDRAL : NORMAL_ENCODING_XYZ);
+}
+
+void
+VertexFormat::ResetDequantization(const Shader& shader) {
+    shader.SetDequantization(glm::vec3(1.0f), glm::vec3(0.0f), NORMAL_ENCODING_XYZ);
+}
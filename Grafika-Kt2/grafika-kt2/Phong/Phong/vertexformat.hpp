@@ -0,0 +1,154 @@
+/**
+ * @file vertexformat.hpp
+ * @author Jovan Ivosevic
+ * @brief Mesh vertex layouts, quantization and attribute setup
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "shader.hpp"
+
+enum EVertexFormat {
+    // NOTE(Jovan): 32 bytes. float3 position, float3 normal, float2 UV
+    VERTEX_FORMAT_FLOAT = 0,
+    // NOTE(Jovan): 16 bytes. unorm16x4 position inside the mesh AABB, snorm16x2 octahedral normal, half2 UV
+    VERTEX_FORMAT_QUANTIZED_OCT = 1,
+    // NOTE(Jovan): 16 bytes. unorm16x4 position inside the mesh AABB, snorm 10_10_10_2 normal, half2 UV
+    VERTEX_FORMAT_QUANTIZED_1010102 = 2,
+    VERTEX_FORMAT_COUNT = 3,
+};
+
+// NOTE(Jovan): Per instance model matrix, one column per location (3 - 6). Must match basic.vert
+#define INSTANCE_ATTRIBUTE_LOCATION 3
+// NOTE(Jovan): Per instance normal matrix, one vec3 column per location (7 - 9)
+#define INSTANCE_NORMAL_ATTRIBUTE_LOCATION 7
+// NOTE(Jovan): Per instance material index (10)
+#define INSTANCE_MATERIAL_ATTRIBUTE_LOCATION 10
+
+/**
+ * @brief Per instance data in the instance buffer. The normal matrix is computed once on
+ * the CPU instead of inverting the model matrix for every vertex
+ *
+ */
+struct InstanceTransform {
+    glm::mat4 Model;
+    glm::mat3 Normal;
+    // NOTE(Jovan): Material index, see MaterialSystem
+    unsigned Material;
+};
+
+// NOTE(Jovan): Must match the normal decoding in basic.vert
+enum ENormalEncoding {
+    NORMAL_ENCODING_XYZ = 0,
+    NORMAL_ENCODING_OCTAHEDRAL = 1,
+};
+
+struct QuantizationError {
+    // NOTE(Jovan): In model space units
+    float MaxPosition;
+    float MaxNormalDegrees;
+    float MaxUV;
+};
+
+class VertexFormat {
+public:
+    // NOTE(Jovan): Number of floats per vertex in VERTEX_FORMAT_FLOAT
+    static const unsigned FLOAT_COMPONENTS = 8;
+
+    /**
+     * @brief Returns size of one vertex in bytes
+     *
+     * @param format - Vertex format
+     *
+     * @returns Stride in bytes
+     */
+    static unsigned GetStride(EVertexFormat format);
+
+    /**
+     * @brief Returns human readable name of the format
+     *
+     * @param format - Vertex format
+     *
+     * @returns Format name
+     */
+    static const char* GetName(EVertexFormat format);
+
+    /**
+     * @brief Sets up position (0), normal (1) and UV (2) attribute pointers for the
+     * currently bound VAO and array buffer
+     *
+     * @param format - Vertex format
+     */
+    static void SetupAttributes(EVertexFormat format);
+
+    /**
+     * @brief Sets up the per instance InstanceTransform attributes (INSTANCE_ATTRIBUTE_LOCATION,
+     * INSTANCE_NORMAL_ATTRIBUTE_LOCATION and INSTANCE_MATERIAL_ATTRIBUTE_LOCATION) for the currently bound VAO and array buffer.
+     * Advances once per instance
+     *
+     */
+    static void SetupInstanceAttributes();
+
+    /**
+     * @brief Converts interleaved float vertices (position, normal, UV) into the given format
+     *
+     * @param format - Target vertex format
+     * @param src - Float vertices, Mesh::VERTEX_STRIDE floats per vertex
+     * @param vertexCount - Number of vertices
+     * @param min - Mesh AABB minimum, positions are quantized relative to it
+     * @param max - Mesh AABB maximum
+     * @param dst - Destination, must hold vertexCount * GetStride(format) bytes
+     */
+    static void Encode(EVertexFormat format, const float* src, unsigned vertexCount, const glm::vec3& min, const glm::vec3& max, unsigned char* dst);
+
+    /**
+     * @brief Decodes one vertex back to floats, mirroring what basic.vert does
+     *
+     * @param format - Vertex format
+     * @param src - Encoded vertex
+     * @param min - Mesh AABB minimum
+     * @param max - Mesh AABB maximum
+     * @param dst - Destination, Mesh::VERTEX_STRIDE floats
+     */
+    static void Decode(EVertexFormat format, const unsigned char* src, const glm::vec3& min, const glm::vec3& max, float* dst);
+
+    /**
+     * @brief Measures the precision lost by encoding float vertices in the given format
+     *
+     * @param format - Vertex format
+     * @param src - Float vertices, Mesh::VERTEX_STRIDE floats per vertex
+     * @param encoded - Same vertices encoded with Encode
+     * @param vertexCount - Number of vertices
+     * @param min - Mesh AABB minimum
+     * @param max - Mesh AABB maximum
+     *
+     * @returns Maximum errors over all vertices
+     */
+    static QuantizationError MeasureError(EVertexFormat format, const float* src, const unsigned char* encoded, unsigned vertexCount, const glm::vec3& min, const glm::vec3& max);
+
+    /**
+     * @brief Sets dequantization uniforms of basic.vert for a mesh in the given format.
+     * Shader must be in use
+     *
+     * @param shader - Shader
+     * @param format - Vertex format
+     * @param min - Mesh AABB minimum
+     * @param max - Mesh AABB maximum
+     */
+    static void SetDequantization(const Shader& shader, EVertexFormat format, const glm::vec3& min, const glm::vec3& max);
+
+    /**
+     * @brief Resets dequantization uniforms of basic.vert to identity, for plain float vertices.
+     * Shader must be in use
+     *
+     * @param shader - Shader
+     */
+    static void ResetDequantization(const Shader& shader);
+};
@@ -0,0 +1,516 @@
+#include "virtualtexturesystem.hpp"
+#include "texturecache.hpp"
+#include "workerpool.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#define VIRTUAL_ATLAS_SIZE (VIRTUAL_ATLAS_TILES * VIRTUAL_TILE_STRIDE)
+#define VIRTUAL_PAGE_TABLE_SIZE (1 << (VIRTUAL_PAGE_TABLE_LEVELS - 1))
+
+/**
+ * @brief Unpacks a key made by makeKey
+ *
+ */
+static void
+splitKey(uint32_t key, unsigned& texture, unsigned& level, unsigned& x, unsigned& y) {
+    texture = (key >> 20) & 0xFF;
+    level = (key >> 14) & 0x3F;
+    y = (key >> 7) & 0x7F;
+    x = key & 0x7F;
+}
+
+VirtualTextureSystem&
+VirtualTextureSystem::Get() {
+    static VirtualTextureSystem Instance;
+    return Instance;
+}
+
+VirtualTextureSystem::VirtualTextureSystem() {
+    for (unsigned Texture = 0; Texture < VIRTUAL_TEXTURE_MAX_COUNT; ++Texture) {
+        VirtualTextureData& Data = mBlockData.VirtualTextures[Texture];
+        Data.TilesLog2 = -1;
+        Data.PageTableLevel = 0;
+        Data.Size = 0.0f;
+        Data.Padding = 0.0f;
+    }
+    mBlockDirty = true;
+    mLoaded = std::make_shared<LoadQueue>();
+    mOpening = 0;
+    mFeedbackWidth = 0;
+    mFeedbackHeight = 0;
+    for (unsigned ReadbackIdx = 0; ReadbackIdx < VIRTUAL_FEEDBACK_BUFFERS; ++ReadbackIdx) {
+        mReadbacks[ReadbackIdx].Fence = 0;
+        mReadbacks[ReadbackIdx].Width = 0;
+        mReadbacks[ReadbackIdx].Height = 0;
+    }
+    mNextReadback = 0;
+    mFrame = 0;
+    mLastFeedback = 0;
+    mEvictions = 0;
+}
+
+int
+VirtualTextureSystem::Add(const std::string& path) {
+    std::string Canonical = TextureCache::GetCanonicalPath(path);
+    std::unordered_map<std::string, int>::iterator Existing = mTextureIndices.find(Canonical);
+    if (Existing != mTextureIndices.end()) {
+        return Existing->second;
+    }
+    if (mTextures.size() >= VIRTUAL_TEXTURE_MAX_COUNT) {
+        std::cerr << "[Err] Virtual texture limit of " << VIRTUAL_TEXTURE_MAX_COUNT << " reached, " << path << " is not virtual" << std::endl;
+        return -1;
+    }
+
+    int Index = (int)mTextures.size();
+    VirtualTexture Texture;
+    Texture.Path = path;
+    Texture.PageTableDirty = false;
+    mTextures.push_back(Texture);
+    mTextureIndices[Canonical] = Index;
+
+    ++mOpening;
+    std::shared_ptr<LoadQueue> Queue = mLoaded;
+    WorkerPool::Get().Submit([Queue, Index, path] {
+        OpenedTexture Opened;
+        Opened.Index = Index;
+        Opened.Pyramid = std::make_shared<TilePyramid>();
+        if (!Opened.Pyramid->Open(path) && (!TilePyramid::Build(path) || !Opened.Pyramid->Open(path))) {
+            Opened.Pyramid.reset();
+        }
+
+        std::lock_guard<std::mutex> Lock(Queue->Mutex);
+        Queue->Textures.push_back(Opened);
+    });
+    return Index;
+}
+
+void
+VirtualTextureSystem::Update() {
+    if (mTextures.empty()) {
+        return;
+    }
+
+    std::deque<OpenedTexture> Opened;
+    {
+        std::lock_guard<std::mutex> Lock(mLoaded->Mutex);
+        Opened.swap(mLoaded->Textures);
+        mReady.insert(mReady.end(), std::make_move_iterator(mLoaded->Tiles.begin()), std::make_move_iterator(mLoaded->Tiles.end()));
+        mLoaded->Tiles.clear();
+    }
+    if (!mAtlas.GetId()) {
+        createResources();
+    }
+    ++mFrame;
+
+    for (unsigned OpenedIdx = 0; OpenedIdx < Opened.size(); ++OpenedIdx) {
+        --mOpening;
+        VirtualTexture& Texture = mTextures[Opened[OpenedIdx].Index];
+        if (!Opened[OpenedIdx].Pyramid) {
+            // NOTE(Jovan): Materials using it keep their diffuse layer
+            std::cerr << "Failed to open tile pyramid of " << Texture.Path << std::endl;
+            continue;
+        }
+        Texture.Pyramid = Opened[OpenedIdx].Pyramid;
+        unsigned TilesLog2 = Texture.Pyramid->GetTilesLog2();
+        Texture.PageTable.assign(TilePyramid::GetLevelTileOffset(TilesLog2, TilesLog2 + 1) * 4, 0);
+        request(makeKey(Opened[OpenedIdx].Index, TilesLog2, 0, 0), true);
+    }
+
+    // NOTE(Jovan): Oldest readback first, each one is read as soon as the GPU is done with it
+    for (unsigned ReadbackIdx = 0; ReadbackIdx < VIRTUAL_FEEDBACK_BUFFERS; ++ReadbackIdx) {
+        FeedbackReadback& Readback = mReadbacks[(mNextReadback + ReadbackIdx) % VIRTUAL_FEEDBACK_BUFFERS];
+        if (!Readback.Fence) {
+            continue;
+        }
+        GLenum Status = glClientWaitSync(Readback.Fence, 0, 0);
+        if (Status != GL_ALREADY_SIGNALED && Status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        readFeedback(Readback);
+    }
+
+    glActiveTexture(GL_TEXTURE0 + VIRTUAL_ATLAS_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, mAtlas.GetId());
+    for (unsigned Uploaded = 0; Uploaded < VIRTUAL_TILE_UPLOAD_BUDGET && !mReady.empty(); ++Uploaded) {
+        upload(mReady.front());
+        mReady.pop_front();
+    }
+
+    glActiveTexture(GL_TEXTURE0 + VIRTUAL_PAGE_TABLE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, mPageTable.GetId());
+    for (unsigned TextureIdx = 0; TextureIdx < mTextures.size(); ++TextureIdx) {
+        if (mTextures[TextureIdx].PageTableDirty) {
+            updatePageTable(TextureIdx);
+        }
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    if (mBlockDirty) {
+        mBlock->Update(&mBlockData);
+        mBlockDirty = false;
+    }
+}
+
+bool
+VirtualTextureSystem::BeginFeedback(int width, int height) {
+    bool AnyOpen = false;
+    for (unsigned TextureIdx = 0; TextureIdx < mTextures.size(); ++TextureIdx) {
+        AnyOpen |= mTextures[TextureIdx].Pyramid != 0;
+    }
+    // NOTE(Jovan): The next readback still being in flight means the GPU is behind,
+    // skipping a pass costs nothing but a frame of latency
+    if (!AnyOpen || !mFeedbackFramebuffer.GetId() || mReadbacks[mNextReadback].Fence) {
+        return false;
+    }
+
+    int Width = std::max(1, width / VIRTUAL_FEEDBACK_DIVISOR);
+    int Height = std::max(1, height / VIRTUAL_FEEDBACK_DIVISOR);
+    glBindFramebuffer(GL_FRAMEBUFFER, mFeedbackFramebuffer.GetId());
+    if (Width != mFeedbackWidth || Height != mFeedbackHeight) {
+        unsigned Targets[2];
+        glGenTextures(2, Targets);
+        mFeedbackColor.Reset(Targets[0]);
+        mFeedbackDepth.Reset(Targets[1]);
+        glBindTexture(GL_TEXTURE_2D, Targets[0]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, Width, Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, Targets[1]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, Width, Height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, Targets[0], 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, Targets[1], 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "[Err] Virtual texture feedback framebuffer is incomplete" << std::endl;
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            mFeedbackFramebuffer.Reset();
+            return false;
+        }
+        mFeedbackWidth = Width;
+        mFeedbackHeight = Height;
+    }
+
+    glViewport(0, 0, Width, Height);
+    // NOTE(Jovan): Cleared without touching the clear colour the scene set
+    const float NoRequest[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const float FarDepth = 1.0f;
+    glClearBufferfv(GL_COLOR, 0, NoRequest);
+    glClearBufferfv(GL_DEPTH, 0, &FarDepth);
+    return true;
+}
+
+void
+VirtualTextureSystem::EndFeedback(int width, int height) {
+    FeedbackReadback& Readback = mReadbacks[mNextReadback];
+    size_t Size = (size_t)mFeedbackWidth * mFeedbackHeight * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, Readback.Buffer.GetId());
+    if ((size_t)Readback.Width * Readback.Height * 4 != Size) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, Size, 0, GL_STREAM_READ);
+    }
+    // NOTE(Jovan): Copies into the buffer on the GPU timeline, mapped once the fence signals
+    glReadPixels(0, 0, mFeedbackWidth, mFeedbackHeight, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    Readback.Width = mFeedbackWidth;
+    Readback.Height = mFeedbackHeight;
+    Readback.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    mNextReadback = (mNextReadback + 1) % VIRTUAL_FEEDBACK_BUFFERS;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+}
+
+VirtualTextureStats
+VirtualTextureSystem::GetStats() const {
+    VirtualTextureStats Stats;
+    Stats.Textures = (unsigned)mTextures.size();
+    Stats.ResidentTiles = (unsigned)mResident.size();
+    Stats.PendingTiles = (unsigned)mRequested.size() + mOpening;
+    Stats.Evictions = mEvictions;
+    Stats.BytesResident = 0;
+    if (mAtlas.GetId()) {
+        size_t PageTableEntries = 0;
+        for (unsigned Level = 0; Level < VIRTUAL_PAGE_TABLE_LEVELS; ++Level) {
+            size_t Side = VIRTUAL_PAGE_TABLE_SIZE >> Level;
+            PageTableEntries += Side * Side;
+        }
+        Stats.BytesResident = (size_t)VIRTUAL_ATLAS_SIZE * VIRTUAL_ATLAS_SIZE * 4 + PageTableEntries * VIRTUAL_TEXTURE_MAX_COUNT * 4;
+    }
+    return Stats;
+}
+
+void
+VirtualTextureSystem::Release() {
+    for (unsigned ReadbackIdx = 0; ReadbackIdx < VIRTUAL_FEEDBACK_BUFFERS; ++ReadbackIdx) {
+        FeedbackReadback& Readback = mReadbacks[ReadbackIdx];
+        if (Readback.Fence) {
+            glDeleteSync(Readback.Fence);
+            Readback.Fence = 0;
+        }
+        Readback.Buffer.Reset();
+        Readback.Width = 0;
+        Readback.Height = 0;
+    }
+    mFeedbackFramebuffer.Reset();
+    mFeedbackColor.Reset();
+    mFeedbackDepth.Reset();
+    mFeedbackWidth = 0;
+    mFeedbackHeight = 0;
+    mAtlas.Reset();
+    mPageTable.Reset();
+    mBlock.reset();
+    mSlots.clear();
+    mResident.clear();
+    mRequested.clear();
+    mReady.clear();
+    for (unsigned TextureIdx = 0; TextureIdx < mTextures.size(); ++TextureIdx) {
+        mTextures[TextureIdx].PageTableDirty = true;
+        mBlockData.VirtualTextures[TextureIdx].TilesLog2 = -1;
+    }
+    mBlockDirty = true;
+}
+
+void
+VirtualTextureSystem::SetupShader(const Shader& shader) {
+    shader.SetUniform1i("uVirtualAtlas", VIRTUAL_ATLAS_TEXTURE_UNIT);
+    shader.SetUniform1i("uVirtualPageTable", VIRTUAL_PAGE_TABLE_TEXTURE_UNIT);
+}
+
+void
+VirtualTextureSystem::createResources() {
+    unsigned Textures[2];
+    glGenTextures(2, Textures);
+    mAtlas.Reset(Textures[0]);
+    mPageTable.Reset(Textures[1]);
+
+    // NOTE(Jovan): Single level, tiles of every mip level are separate tiles of the atlas
+    glBindTexture(GL_TEXTURE_2D, Textures[0]);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, VIRTUAL_ATLAS_SIZE, VIRTUAL_ATLAS_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // NOTE(Jovan): Every texture uses the mips of its layer from PageTableLevel down
+    glBindTexture(GL_TEXTURE_2D_ARRAY, Textures[1]);
+    for (unsigned Level = 0; Level < VIRTUAL_PAGE_TABLE_LEVELS; ++Level) {
+        unsigned Side = VIRTUAL_PAGE_TABLE_SIZE >> Level;
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, Level, GL_RGBA8, Side, Side, VIRTUAL_TEXTURE_MAX_COUNT, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, VIRTUAL_PAGE_TABLE_LEVELS - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    mBlock.reset(new UniformBuffer(UNIFORM_BINDING_VIRTUAL_TEXTURES, sizeof(VirtualTextureUniforms)));
+    mBlockDirty = true;
+    AtlasSlot Free = { 0, false, false, 0 };
+    mSlots.assign(VIRTUAL_ATLAS_TILES * VIRTUAL_ATLAS_TILES, Free);
+
+    unsigned Framebuffer;
+    glGenFramebuffers(1, &Framebuffer);
+    mFeedbackFramebuffer.Reset(Framebuffer);
+    for (unsigned ReadbackIdx = 0; ReadbackIdx < VIRTUAL_FEEDBACK_BUFFERS; ++ReadbackIdx) {
+        unsigned Buffer;
+        glGenBuffers(1, &Buffer);
+        mReadbacks[ReadbackIdx].Buffer.Reset(Buffer);
+    }
+
+    // NOTE(Jovan): After a Release the coarsest tiles have to come back before anything else
+    for (std::unordered_set<uint32_t>::const_iterator Pinned = mPinned.begin(); Pinned != mPinned.end(); ++Pinned) {
+        request(*Pinned, true);
+    }
+}
+
+void
+VirtualTextureSystem::readFeedback(FeedbackReadback& readback) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.Buffer.GetId());
+    size_t Size = (size_t)readback.Width * readback.Height * 4;
+    const unsigned char* Pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, Size, GL_MAP_READ_BIT);
+    std::unordered_set<uint32_t> Seen;
+    if (Pixels) {
+        // NOTE(Jovan): Each pixel is column, row, level and texture + 1 of the tile it wants,
+        // all zero where no virtual texture was drawn
+        for (size_t Pixel = 0; Pixel < Size; Pixel += 4) {
+            unsigned Texture = Pixels[Pixel + 3];
+            if (!Texture || Texture > mTextures.size() || !mTextures[Texture - 1].Pyramid) {
+                continue;
+            }
+            unsigned TilesLog2 = mTextures[Texture - 1].Pyramid->GetTilesLog2();
+            unsigned Level = Pixels[Pixel + 2];
+            unsigned Side = Level <= TilesLog2 ? 1u << (TilesLog2 - Level) : 0;
+            if (Pixels[Pixel] < Side && Pixels[Pixel + 1] < Side) {
+                Seen.insert(makeKey(Texture - 1, Level, Pixels[Pixel], Pixels[Pixel + 1]));
+            }
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glDeleteSync(readback.Fence);
+    readback.Fence = 0;
+    mLastFeedback = mFrame;
+
+    // NOTE(Jovan): Missing tiles are drawn with their closest resident ancestor, which
+    // counts as seen so it isn't evicted in the meantime
+    std::vector<uint32_t> Missing;
+    for (std::unordered_set<uint32_t>::const_iterator Wanted = Seen.begin(); Wanted != Seen.end(); ++Wanted) {
+        unsigned Texture, Level, X, Y;
+        splitKey(*Wanted, Texture, Level, X, Y);
+        unsigned TilesLog2 = mTextures[Texture].Pyramid->GetTilesLog2();
+        for (;;) {
+            uint32_t Key = makeKey(Texture, Level, X, Y);
+            std::unordered_map<uint32_t, unsigned>::iterator Resident = mResident.find(Key);
+            if (Resident != mResident.end()) {
+                mSlots[Resident->second].LastSeen = mFrame;
+                break;
+            }
+            if (Key == *Wanted) {
+                Missing.push_back(Key);
+            }
+            if (Level == TilesLog2) {
+                break;
+            }
+            ++Level;
+            X >>= 1;
+            Y >>= 1;
+        }
+    }
+
+    // NOTE(Jovan): Coarse tiles first, each one improves a larger part of the screen
+    std::sort(Missing.begin(), Missing.end(), [](uint32_t a, uint32_t b) {
+        return ((a >> 14) & 0x3F) > ((b >> 14) & 0x3F);
+    });
+    for (unsigned MissingIdx = 0; MissingIdx < Missing.size() && mRequested.size() < VIRTUAL_MAX_PENDING_TILES; ++MissingIdx) {
+        request(Missing[MissingIdx], false);
+    }
+}
+
+void
+VirtualTextureSystem::request(uint32_t key, bool pinned) {
+    if (pinned) {
+        mPinned.insert(key);
+    }
+    if (mResident.count(key) || mRequested.count(key)) {
+        return;
+    }
+
+    unsigned Texture, Level, X, Y;
+    splitKey(key, Texture, Level, X, Y);
+    mRequested.insert(key);
+    std::shared_ptr<TilePyramid> Pyramid = mTextures[Texture].Pyramid;
+    std::shared_ptr<LoadQueue> Queue = mLoaded;
+    // NOTE(Jovan): Reading from the mapping is what goes to disk, so it's done on a worker
+    WorkerPool::Get().Submit([Queue, Pyramid, key, Level, X, Y] {
+        LoadedTile Tile;
+        Tile.Key = key;
+        const unsigned char* Pixels = Pyramid->GetTile(Level, X, Y);
+        if (Pixels) {
+            Tile.Pixels.assign(Pixels, Pixels + VIRTUAL_TILE_BYTES);
+        }
+
+        std::lock_guard<std::mutex> Lock(Queue->Mutex);
+        Queue->Tiles.push_back(std::move(Tile));
+    });
+}
+
+void
+VirtualTextureSystem::upload(const LoadedTile& tile) {
+    mRequested.erase(tile.Key);
+    if (tile.Pixels.empty() || mResident.count(tile.Key)) {
+        return;
+    }
+
+    // NOTE(Jovan): A free slot if there is one, the least recently seen unpinned tile otherwise.
+    // Tiles seen in the last feedback are in use and never evicted
+    unsigned Slot = (unsigned)mSlots.size();
+    for (unsigned SlotIdx = 0; SlotIdx < mSlots.size(); ++SlotIdx) {
+        const AtlasSlot& Candidate = mSlots[SlotIdx];
+        if (!Candidate.Used) {
+            Slot = SlotIdx;
+            break;
+        }
+        if (!Candidate.Pinned && Candidate.LastSeen < mLastFeedback
+            && (Slot == mSlots.size() || Candidate.LastSeen < mSlots[Slot].LastSeen)) {
+            Slot = SlotIdx;
+        }
+    }
+    if (Slot == mSlots.size()) {
+        // NOTE(Jovan): Atlas is full of tiles in use, the tile is asked for again by later feedback
+        return;
+    }
+
+    unsigned Texture, Level, X, Y;
+    AtlasSlot& Target = mSlots[Slot];
+    if (Target.Used) {
+        splitKey(Target.Key, Texture, Level, X, Y);
+        mResident.erase(Target.Key);
+        mTextures[Texture].PageTableDirty = true;
+        ++mEvictions;
+    }
+    Target.Key = tile.Key;
+    Target.Used = true;
+    Target.Pinned = mPinned.count(tile.Key) != 0;
+    Target.LastSeen = mFrame;
+    mResident[tile.Key] = Slot;
+
+    glTexSubImage2D(GL_TEXTURE_2D, 0, (Slot % VIRTUAL_ATLAS_TILES) * VIRTUAL_TILE_STRIDE, (Slot / VIRTUAL_ATLAS_TILES) * VIRTUAL_TILE_STRIDE,
+        VIRTUAL_TILE_STRIDE, VIRTUAL_TILE_STRIDE, GL_RGBA, GL_UNSIGNED_BYTE, tile.Pixels.data());
+    splitKey(tile.Key, Texture, Level, X, Y);
+    mTextures[Texture].PageTableDirty = true;
+}
+
+void
+VirtualTextureSystem::updatePageTable(unsigned index) {
+    VirtualTexture& Texture = mTextures[index];
+    Texture.PageTableDirty = false;
+    if (!Texture.Pyramid) {
+        return;
+    }
+
+    unsigned TilesLog2 = Texture.Pyramid->GetTilesLog2();
+    unsigned PageTableLevel = VIRTUAL_PAGE_TABLE_LEVELS - 1 - TilesLog2;
+    VirtualTextureData& Data = mBlockData.VirtualTextures[index];
+    // NOTE(Jovan): Shaders ignore the texture until its coarsest tile is in, every other
+    // entry falls back on it
+    int Published = mResident.count(makeKey(index, TilesLog2, 0, 0)) ? (int)TilesLog2 : -1;
+    if (Data.TilesLog2 != Published) {
+        Data.TilesLog2 = Published;
+        Data.PageTableLevel = (int)PageTableLevel;
+        Data.Size = (float)(VIRTUAL_TILE_SIZE << TilesLog2);
+        mBlockDirty = true;
+    }
+    if (Published < 0) {
+        return;
+    }
+
+    // NOTE(Jovan): Coarsest level first, so each entry without a tile can copy its parent's
+    for (int Level = (int)TilesLog2; Level >= 0; --Level) {
+        unsigned Side = 1u << (TilesLog2 - Level);
+        unsigned char* Entries = Texture.PageTable.data() + TilePyramid::GetLevelTileOffset(TilesLog2, Level) * 4;
+        const unsigned char* Parents = Level < (int)TilesLog2 ? Texture.PageTable.data() + TilePyramid::GetLevelTileOffset(TilesLog2, Level + 1) * 4 : 0;
+        for (unsigned Y = 0; Y < Side; ++Y) {
+            for (unsigned X = 0; X < Side; ++X) {
+                unsigned char* Entry = Entries + ((size_t)Y * Side + X) * 4;
+                std::unordered_map<uint32_t, unsigned>::const_iterator Resident = mResident.find(makeKey(index, Level, X, Y));
+                if (Resident != mResident.end()) {
+                    Entry[0] = (unsigned char)(Resident->second % VIRTUAL_ATLAS_TILES);
+                    Entry[1] = (unsigned char)(Resident->second / VIRTUAL_ATLAS_TILES);
+                    Entry[2] = (unsigned char)Level;
+                    Entry[3] = 255;
+                } else {
+                    memcpy(Entry, Parents + ((size_t)(Y >> 1) * (Side >> 1) + (X >> 1)) * 4, 4);
+                }
+            }
+        }
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, PageTableLevel + Level, 0, 0, index, Side, Side, 1, GL_RGBA, GL_UNSIGNED_BYTE, Entries);
+    }
+}
+
+uint32_t
+VirtualTextureSystem::makeKey(unsigned texture, unsigned level, unsigned x, unsigned y) {
+    return (texture << 20) | (level << 14) | (y << 7) | x;
+}
@@ -0,0 +1,212 @@
+/**
+ * @file virtualtexturesystem.hpp
+ * @author Jovan Ivosevic
+ * @brief Virtual textures streamed tile by tile into a fixed size atlas
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "glhandle.hpp"
+#include "shader.hpp"
+#include "tilepyramid.hpp"
+#include "uniformbuffer.hpp"
+
+#define VIRTUAL_ATLAS_TEXTURE_UNIT 5
+#define VIRTUAL_PAGE_TABLE_TEXTURE_UNIT 6
+// NOTE(Jovan): Atlas slots per side, the atlas is all the video memory tiles ever take.
+// Must match VIRTUAL_ATLAS_TILES in the shaders sampling virtual textures
+#define VIRTUAL_ATLAS_TILES 16
+// NOTE(Jovan): Feedback is rendered at 1 / VIRTUAL_FEEDBACK_DIVISOR of the window per axis.
+// Must match VIRTUAL_FEEDBACK_LEVEL_BIAS in virtual_feedback.frag
+#define VIRTUAL_FEEDBACK_DIVISOR 8
+// NOTE(Jovan): Feedback readbacks in flight, read a couple of frames late so they never stall
+#define VIRTUAL_FEEDBACK_BUFFERS 3
+// NOTE(Jovan): Tiles uploaded to the atlas per frame
+#define VIRTUAL_TILE_UPLOAD_BUDGET 16
+// NOTE(Jovan): Tiles being read by workers or waiting for upload
+#define VIRTUAL_MAX_PENDING_TILES 64
+
+struct VirtualTextureStats {
+    unsigned Textures;
+    unsigned ResidentTiles;
+    unsigned PendingTiles;
+    unsigned Evictions;
+    // NOTE(Jovan): Video memory of the atlas and page table, fixed whatever the textures' size
+    size_t BytesResident;
+};
+
+/**
+ * @brief Owns the scene's virtual textures. Each one is a tile pyramid on disk (see
+ * TilePyramid) of which only the tiles currently seen are in video memory, in slots of
+ * one atlas shared by all of them. A page table per texture, layers of one texture
+ * array, maps each tile of each level to its atlas slot, or to the slot of the closest
+ * coarser tile that's resident. The coarsest tile of every texture stays resident, so
+ * there's always something to sample.
+ *
+ * Which tiles are seen comes from a feedback pass: virtual textured geometry is drawn
+ * into a small framebuffer with virtual_feedback.frag, which writes the tile each pixel
+ * wants, and the result is read back asynchronously. Wanted tiles are read from disk on
+ * the worker pool and uploaded by Update, evicting the least recently seen ones once
+ * the atlas is full
+ *
+ */
+class VirtualTextureSystem {
+public:
+    static VirtualTextureSystem& Get();
+
+    /**
+     * @brief Returns a virtual texture of an image, adding it on first use. Its tile
+     * pyramid is opened, or built if missing or stale, on the worker pool
+     *
+     * @param path - Source image path
+     *
+     * @returns Virtual texture index, -1 if there's no room for more
+     */
+    int Add(const std::string& path);
+
+    /**
+     * @brief Reads finished feedback, uploads loaded tiles, updates page tables and binds
+     * the atlas and page table. Call once per frame on the context thread
+     *
+     */
+    void Update();
+
+    /**
+     * @brief Starts the feedback pass: binds and clears the feedback framebuffer. Virtual
+     * textured geometry is drawn with virtual_feedback.frag until EndFeedback
+     *
+     * @param width - Window width
+     * @param height - Window height
+     *
+     * @returns true - Pass started, false - Nothing to do this frame, skip the pass
+     */
+    bool BeginFeedback(int width, int height);
+
+    /**
+     * @brief Ends the feedback pass, queues its readback and restores the window framebuffer
+     *
+     * @param width - Window width
+     * @param height - Window height
+     */
+    void EndFeedback(int width, int height);
+
+    VirtualTextureStats GetStats() const;
+
+    /**
+     * @brief Frees every GL object. Called before the context goes away
+     *
+     */
+    void Release();
+
+    /**
+     * @brief Points a program's virtual texture samplers at their units. The program must be in use
+     *
+     * @param shader - Program using the VirtualTextures block
+     */
+    static void SetupShader(const Shader& shader);
+
+private:
+    struct VirtualTexture {
+        std::string Path;
+        // NOTE(Jovan): Null until opened
+        std::shared_ptr<TilePyramid> Pyramid;
+        // NOTE(Jovan): RGBA8 entries of every level back to back, finest first: atlas slot
+        // x and y, level of the tile in the slot, 255
+        std::vector<unsigned char> PageTable;
+        bool PageTableDirty;
+    };
+
+    struct AtlasSlot {
+        // NOTE(Jovan): Tile in the slot, see makeKey
+        uint32_t Key;
+        bool Used;
+        // NOTE(Jovan): Coarsest tiles are never evicted
+        bool Pinned;
+        // NOTE(Jovan): Last feedback frame the tile was seen in
+        uint64_t LastSeen;
+    };
+
+    // NOTE(Jovan): Written by workers, no pyramid or pixels if loading failed
+    struct OpenedTexture {
+        unsigned Index;
+        std::shared_ptr<TilePyramid> Pyramid;
+    };
+
+    struct LoadedTile {
+        uint32_t Key;
+        std::vector<unsigned char> Pixels;
+    };
+
+    // NOTE(Jovan): Shared with queued jobs, so it outlives the system if they finish after it
+    struct LoadQueue {
+        std::mutex Mutex;
+        std::deque<OpenedTexture> Textures;
+        std::deque<LoadedTile> Tiles;
+    };
+
+    struct FeedbackReadback {
+        BufferHandle Buffer;
+        // NOTE(Jovan): Non-zero while the readback is in flight
+        GLsync Fence;
+        int Width;
+        int Height;
+    };
+
+    std::vector<VirtualTexture> mTextures;
+    std::unordered_map<std::string, int> mTextureIndices;
+    VirtualTextureUniforms mBlockData;
+    std::unique_ptr<UniformBuffer> mBlock;
+    bool mBlockDirty;
+    TextureHandle mAtlas;
+    TextureHandle mPageTable;
+    std::vector<AtlasSlot> mSlots;
+    // NOTE(Jovan): Resident tiles by key, mapped to their atlas slot
+    std::unordered_map<uint32_t, unsigned> mResident;
+    // NOTE(Jovan): Tiles being read or waiting for upload
+    std::unordered_set<uint32_t> mRequested;
+    std::unordered_set<uint32_t> mPinned;
+    std::shared_ptr<LoadQueue> mLoaded;
+    std::deque<LoadedTile> mReady;
+    unsigned mOpening;
+    FramebufferHandle mFeedbackFramebuffer;
+    TextureHandle mFeedbackColor;
+    TextureHandle mFeedbackDepth;
+    int mFeedbackWidth;
+    int mFeedbackHeight;
+    FeedbackReadback mReadbacks[VIRTUAL_FEEDBACK_BUFFERS];
+    // NOTE(Jovan): Readback the next pass writes to, the oldest one in flight
+    unsigned mNextReadback;
+    uint64_t mFrame;
+    // NOTE(Jovan): Frame the last feedback was read in, tiles seen since are in use
+    uint64_t mLastFeedback;
+    unsigned mEvictions;
+
+    VirtualTextureSystem();
+    void createResources();
+    void readFeedback(FeedbackReadback& readback);
+    void request(uint32_t key, bool pinned);
+    void upload(const LoadedTile& tile);
+    void updatePageTable(unsigned index);
+
+    /**
+     * @brief Packs a tile into a key: texture in bits 20-27, level in bits 14-19,
+     * row in bits 7-13 and column in bits 0-6
+     *
+     */
+    static uint32_t makeKey(unsigned texture, unsigned level, unsigned x, unsigned y);
+};
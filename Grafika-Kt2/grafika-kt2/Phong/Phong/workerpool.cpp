@@ -0,0 +1,108 @@
+#include "workerpool.hpp"
+#include <atomic>
+#include <memory>
+
+WorkerPool&
+WorkerPool::Get() {
+    static WorkerPool Shared(std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 1);
+    return Shared;
+}
+
+WorkerPool::WorkerPool(unsigned threadCount) {
+    mStopping = false;
+    threadCount = threadCount ? threadCount : 1;
+    for (unsigned ThreadIdx = 0; ThreadIdx < threadCount; ++ThreadIdx) {
+        mThreads.push_back(std::thread(&WorkerPool::workerLoop, this));
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> Lock(mMutex);
+        mStopping = true;
+    }
+    mJobReady.notify_all();
+    for (size_t ThreadIdx = 0; ThreadIdx < mThreads.size(); ++ThreadIdx) {
+        mThreads[ThreadIdx].join();
+    }
+}
+
+unsigned
+WorkerPool::GetThreadCount() const {
+    return (unsigned)mThreads.size();
+}
+
+void
+WorkerPool::Submit(const std::function<void()>& job) {
+    {
+        std::lock_guard<std::mutex> Lock(mMutex);
+        mJobs.push_back(job);
+    }
+    mJobReady.notify_one();
+}
+
+void
+WorkerPool::workerLoop() {
+    for (;;) {
+        std::function<void()> Job;
+        {
+            std::unique_lock<std::mutex> Lock(mMutex);
+            mJobReady.wait(Lock, [this] { return mStopping || !mJobs.empty(); });
+            if (mJobs.empty()) {
+                return;
+            }
+            Job = mJobs.front();
+            mJobs.pop_front();
+        }
+        Job();
+    }
+}
+
+/**
+ * @brief State shared between the caller of ParallelFor and its runner jobs. Runners
+ * that get scheduled after all indices are taken still reference it, so it is refcounted
+ *
+ */
+struct ParallelForState {
+    std::function<void(unsigned)> Job;
+    unsigned Count;
+    std::atomic<unsigned> Next;
+    std::atomic<unsigned> Completed;
+    std::mutex Mutex;
+    std::condition_variable Done;
+};
+
+static void
+runParallelFor(ParallelForState& state) {
+    for (unsigned Index = state.Next++; Index < state.Count; Index = state.Next++) {
+        state.Job(Index);
+        if (++state.Completed == state.Count) {
+            std::lock_guard<std::mutex> Lock(state.Mutex);
+            state.Done.notify_all();
+        }
+    }
+}
+
+void
+WorkerPool::ParallelFor(unsigned count, const std::function<void(unsigned)>& job) {
+    if (!count) {
+        return;
+    }
+
+    std::shared_ptr<ParallelForState> State = std::make_shared<ParallelForState>();
+    State->Job = job;
+    State->Count = count;
+    State->Next = 0;
+    State->Completed = 0;
+
+    unsigned RunnerCount = count - 1 < mThreads.size() ? count - 1 : (unsigned)mThreads.size();
+    for (unsigned RunnerIdx = 0; RunnerIdx < RunnerCount; ++RunnerIdx) {
+        Submit([State] { runParallelFor(*State); });
+    }
+
+    // NOTE(Jovan): Caller works too and then waits on completed indices rather than on
+    // the runners, so this can't deadlock even if all workers are busy elsewhere
+    runParallelFor(*State);
+    std::unique_lock<std::mutex> Lock(State->Mutex);
+    State->Done.wait(Lock, [&State] { return State->Completed == State->Count; });
+}
@@ -0,0 +1,77 @@
+/**
+ * @file workerpool.hpp
+ * @author Jovan Ivosevic
+ * @brief Fixed size pool of worker threads for CPU side loading work
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/**
+ * @brief Runs jobs on a fixed set of worker threads. Jobs must not make GL calls,
+ * the GL context is only current on the main thread
+ *
+ */
+class WorkerPool {
+public:
+    /**
+     * @brief Returns the shared pool, sized to leave one hardware thread for the caller
+     *
+     * @returns Shared worker pool
+     */
+    static WorkerPool& Get();
+
+    /**
+     * @brief Ctor - starts worker threads
+     *
+     * @param threadCount - Number of worker threads, at least 1 is started
+     */
+    WorkerPool(unsigned threadCount);
+
+    /**
+     * @brief Dtor - finishes queued jobs and joins worker threads
+     *
+     */
+    ~WorkerPool();
+
+    /**
+     * @brief Queues a job to be run on one of the workers
+     *
+     * @param job - Job
+     */
+    void Submit(const std::function<void()>& job);
+
+    /**
+     * @brief Runs job(0) .. job(count - 1) across the workers and the calling thread.
+     * Indices are handed out one at a time, so jobs of uneven size balance themselves.
+     * Returns once all of them are done
+     *
+     * @param count - Number of job indices
+     * @param job - Job, called once per index
+     */
+    void ParallelFor(unsigned count, const std::function<void(unsigned)>& job);
+
+    unsigned GetThreadCount() const;
+
+private:
+    std::vector<std::thread> mThreads;
+    std::deque<std::function<void()> > mJobs;
+    std::mutex mMutex;
+    std::condition_variable mJobReady;
+    bool mStopping;
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    void workerLoop();
+};